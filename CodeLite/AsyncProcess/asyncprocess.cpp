@@ -30,6 +30,7 @@ class IProcess;
 
 #include "StdToWX.h"
 #include "StringUtils.h"
+#include "clProcessReactor.h"
 #include "clTempFile.hpp"
 #include "cl_command_event.h"
 #include "file_logger.h"
@@ -333,6 +334,11 @@ void IProcess::SuspendAsyncReads()
         m_thr->Suspend();
         clDEBUG1() << "Suspending process reader thread...done" << endl;
     }
+#if CL_USE_PROCESS_REACTOR
+    else {
+        clProcessReactor::Get().Suspend(this);
+    }
+#endif
 }
 
 void IProcess::ResumeAsyncReads()
@@ -342,4 +348,9 @@ void IProcess::ResumeAsyncReads()
         m_thr->Resume();
         clDEBUG1() << "Resuming process reader thread..." << endl;
     }
+#if CL_USE_PROCESS_REACTOR
+    else {
+        clProcessReactor::Get().Resume(this);
+    }
+#endif
 }
@@ -0,0 +1,389 @@
+#include "clProcessReactor.h"
+
+#if CL_USE_PROCESS_REACTOR
+#include "StringUtils.h"
+#include "cl_command_event.h"
+#include "file_logger.h"
+#include "processreaderthread.h"
+#include "unixprocess_impl.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+// deliver the output of a process at most once per UI frame
+constexpr int FLUSH_INTERVAL_MS = 16;
+constexpr int MAX_EVENTS = 64;
+constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+// the events data: the channel id in the high 32 bits, the file descriptor in the low 32 bits
+// the wakeup eventfd uses the id 0
+constexpr uint32_t WAKEUP_ID = 0;
+
+uint64_t make_event_data(uint32_t id, int fd) { return (static_cast<uint64_t>(id) << 32) | static_cast<uint32_t>(fd); }
+} // namespace
+
+clProcessReactor::clProcessReactor() { m_buffer.resize(READ_BUFFER_SIZE); }
+
+clProcessReactor::~clProcessReactor() { DoStop(); }
+
+clProcessReactor& clProcessReactor::Get()
+{
+    static clProcessReactor reactor;
+    return reactor;
+}
+
+bool clProcessReactor::DoStart()
+{
+    if(m_thread) {
+        return true;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(m_epollFd < 0) {
+        clWARNING() << "Process reactor: epoll_create1 failed." << strerror(errno) << endl;
+        return false;
+    }
+
+    m_wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = make_event_data(WAKEUP_ID, m_wakeupFd);
+    if(m_wakeupFd < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeupFd, &ev) < 0) {
+        clWARNING() << "Process reactor: failed to create the wakeup handle." << strerror(errno) << endl;
+        if(m_wakeupFd >= 0) {
+            close(m_wakeupFd);
+        }
+        close(m_epollFd);
+        m_wakeupFd = -1;
+        m_epollFd = -1;
+        return false;
+    }
+
+    m_shutdown = false;
+    m_thread.reset(new std::thread(&clProcessReactor::Entry, this));
+    clDEBUG() << "Process reactor started" << endl;
+    return true;
+}
+
+void clProcessReactor::DoStop()
+{
+    if(!m_thread) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        m_shutdown = true;
+    }
+    uint64_t one = 1;
+    if(write(m_wakeupFd, &one, sizeof(one)) < 0) {
+        clWARNING() << "Process reactor: failed to wakeup the reactor thread." << strerror(errno) << endl;
+    }
+    m_thread->join();
+    m_thread.reset();
+
+    m_fds.clear();
+    m_channels.clear();
+    close(m_wakeupFd);
+    close(m_epollFd);
+    m_wakeupFd = -1;
+    m_epollFd = -1;
+}
+
+bool clProcessReactor::DoWatch(Channel& channel, int fd)
+{
+    if(fd < 0) {
+        return true;
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = make_event_data(channel.id, fd);
+    if(epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        clWARNING() << "Process reactor: failed to watch file descriptor" << fd << "." << strerror(errno) << endl;
+        return false;
+    }
+    m_fds[fd] = &channel;
+    return true;
+}
+
+void clProcessReactor::DoUnwatch(int fd)
+{
+    if(fd < 0) {
+        return;
+    }
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    m_fds.erase(fd);
+}
+
+bool clProcessReactor::DoWatchChannel(Channel& channel)
+{
+    // events that were already returned by epoll_wait for an older id are ignored
+    channel.id = m_nextId++;
+    if(m_nextId == WAKEUP_ID) {
+        ++m_nextId;
+    }
+
+    if(!DoWatch(channel, channel.stdout_fd)) {
+        return false;
+    }
+
+    if(!DoWatch(channel, channel.stderr_fd)) {
+        DoUnwatch(channel.stdout_fd);
+        return false;
+    }
+    return true;
+}
+
+void clProcessReactor::DoUnwatchChannel(Channel& channel)
+{
+    DoUnwatch(channel.stdout_fd);
+    DoUnwatch(channel.stderr_fd);
+}
+
+bool clProcessReactor::Add(UnixProcessImpl* process)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    if(!DoStart()) {
+        return false;
+    }
+
+    std::unique_ptr<Channel> channel{ new Channel() };
+    channel->process = process;
+    channel->stdout_fd = process->GetReadHandle();
+    channel->stderr_fd = process->GetStderrHandle();
+    if(!DoWatchChannel(*channel)) {
+        return false;
+    }
+    m_channels[process] = std::move(channel);
+    return true;
+}
+
+void clProcessReactor::DoRemove(IProcess* process)
+{
+    auto iter = m_channels.find(process);
+    if(iter == m_channels.end()) {
+        return;
+    }
+
+    DoUnwatchChannel(*iter->second);
+    m_channels.erase(iter);
+}
+
+void clProcessReactor::Remove(IProcess* process)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    DoRemove(process);
+}
+
+void clProcessReactor::Suspend(IProcess* process)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    auto iter = m_channels.find(process);
+    if(iter == m_channels.end() || iter->second->suspended) {
+        return;
+    }
+
+    Channel& channel = *iter->second;
+    DoFlush(channel, std::chrono::steady_clock::now());
+    DoUnwatchChannel(channel);
+    channel.suspended = true;
+}
+
+void clProcessReactor::Resume(IProcess* process)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    auto iter = m_channels.find(process);
+    if(iter == m_channels.end() || !iter->second->suspended) {
+        return;
+    }
+
+    Channel& channel = *iter->second;
+    channel.suspended = false;
+    if(!DoWatchChannel(channel)) {
+        clWARNING() << "Process reactor: failed to resume reading from process" << process->GetPid() << endl;
+    }
+}
+
+void clProcessReactor::Entry()
+{
+    std::vector<epoll_event> events(MAX_EVENTS);
+    int timeout = -1;
+    while(true) {
+        int count = epoll_wait(m_epollFd, events.data(), events.size(), timeout);
+        if(count < 0 && errno != EINTR) {
+            clWARNING() << "Process reactor: epoll_wait failed." << strerror(errno) << endl;
+            break;
+        }
+
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        if(m_shutdown) {
+            break;
+        }
+
+        for(int i = 0; i < count; ++i) {
+            DoHandleEvent(events[i].data.u64);
+        }
+        timeout = DoFlushPending();
+    }
+    clDEBUG() << "Process reactor stopped" << endl;
+}
+
+void clProcessReactor::DoHandleEvent(uint64_t data)
+{
+    uint32_t id = static_cast<uint32_t>(data >> 32);
+    int fd = static_cast<int>(data & 0xFFFFFFFF);
+    if(id == WAKEUP_ID) {
+        uint64_t value = 0;
+        while(read(m_wakeupFd, &value, sizeof(value)) > 0) {
+        }
+        return;
+    }
+
+    // the process might have been removed (and its file descriptor re-used) since epoll_wait returned
+    auto iter = m_fds.find(fd);
+    if(iter == m_fds.end() || iter->second->id != id || iter->second->suspended) {
+        return;
+    }
+
+    Channel& channel = *iter->second;
+    if(DoRead(channel, fd)) {
+        return;
+    }
+
+    if(fd == channel.stderr_fd) {
+        // stderr was closed, keep reading stdout
+        DoUnwatch(fd);
+        channel.stderr_fd = -1;
+        return;
+    }
+
+    // stdout was closed: the process terminated
+    DoDrain(channel, channel.stderr_fd);
+    DoFlush(channel, std::chrono::steady_clock::now());
+    DoNotifyTerminated(channel);
+    DoRemove(channel.process);
+}
+
+bool clProcessReactor::DoRead(Channel& channel, int fd)
+{
+    ssize_t bytes_read = read(fd, m_buffer.data(), m_buffer.size());
+    if(bytes_read < 0) {
+        return errno == EINTR || errno == EAGAIN;
+    } else if(bytes_read == 0) {
+        return false;
+    }
+
+    std::string& output = (fd == channel.stderr_fd) ? channel.stderr_buffer : channel.stdout_buffer;
+    if(channel.process->m_flags & IProcessRawOutput) {
+        output.append(m_buffer.data(), bytes_read);
+    } else {
+        // Remove coloring chars from the incoming buffer
+        std::string stripped_buffer;
+        StringUtils::StripTerminalColouring(std::string(m_buffer.data(), bytes_read), stripped_buffer);
+        output.append(stripped_buffer);
+    }
+    return true;
+}
+
+void clProcessReactor::DoDrain(Channel& channel, int fd)
+{
+    if(fd < 0) {
+        return;
+    }
+
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    while(poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN) && DoRead(channel, fd)) {
+        pfd.revents = 0;
+    }
+}
+
+void clProcessReactor::DoFlush(Channel& channel, const std::chrono::steady_clock::time_point& now)
+{
+    if(channel.stdout_buffer.empty() && channel.stderr_buffer.empty()) {
+        return;
+    }
+    channel.last_flush = now;
+
+    UnixProcessImpl* process = channel.process;
+    IProcessCallback* callback = process->m_callback;
+    if(callback) {
+        // callbacks are only notified about stdout
+        if(!channel.stdout_buffer.empty()) {
+            std::string output;
+            output.swap(channel.stdout_buffer);
+            callback->CallAfter([callback, output = std::move(output)]() {
+                callback->OnProcessOutput(StringUtils::FromStdString(output));
+            });
+        }
+        channel.stderr_buffer.clear();
+        return;
+    }
+
+    wxEvtHandler* parent = process->m_parent;
+    if(parent && !channel.stdout_buffer.empty()) {
+        clProcessEvent e(wxEVT_ASYNC_PROCESS_OUTPUT);
+        e.SetOutputRawOnly(channel.stdout_buffer);
+        e.SetProcess(process);
+        parent->QueueEvent(e.Clone());
+    }
+
+    if(parent && !channel.stderr_buffer.empty()) {
+        clProcessEvent e(wxEVT_ASYNC_PROCESS_STDERR);
+        e.SetOutputRawOnly(channel.stderr_buffer);
+        e.SetProcess(process);
+        parent->QueueEvent(e.Clone());
+    }
+    channel.stdout_buffer.clear();
+    channel.stderr_buffer.clear();
+}
+
+int clProcessReactor::DoFlushPending()
+{
+    // flush the processes that did not fire an event during the last FLUSH_INTERVAL_MS and return the time (ms)
+    // until the next process is due, -1 if there is nothing pending
+    auto now = std::chrono::steady_clock::now();
+    int timeout = -1;
+    for(auto& vt : m_channels) {
+        Channel& channel = *vt.second;
+        if(channel.stdout_buffer.empty() && channel.stderr_buffer.empty()) {
+            continue;
+        }
+
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - channel.last_flush).count();
+        if(elapsed >= FLUSH_INTERVAL_MS) {
+            DoFlush(channel, now);
+            continue;
+        }
+
+        int due = FLUSH_INTERVAL_MS - static_cast<int>(elapsed);
+        timeout = (timeout == -1) ? due : std::min(timeout, due);
+    }
+    return timeout;
+}
+
+void clProcessReactor::DoNotifyTerminated(Channel& channel)
+{
+    UnixProcessImpl* process = channel.process;
+    if(process->m_callback) {
+        process->m_callback->CallAfter(&IProcessCallback::OnProcessTerminated);
+
+    } else if(process->m_parent) {
+        clProcessEvent e(wxEVT_ASYNC_PROCESS_TERMINATED);
+        e.SetProcess(process);
+        process->m_parent->AddPendingEvent(e);
+    }
+}
+#endif // CL_USE_PROCESS_REACTOR
@@ -0,0 +1,104 @@
+#ifndef CLPROCESSREACTOR_H
+#define CLPROCESSREACTOR_H
+
+#include "codelite_exports.h"
+
+// On Linux, the output of all the child processes is read by a single epoll based thread (clProcessReactor)
+// On other platforms, each process has its own reader thread (ProcessReaderThread)
+#if defined(__linux__) && defined(__WXGTK__)
+#define CL_USE_PROCESS_REACTOR 1
+#else
+#define CL_USE_PROCESS_REACTOR 0
+#endif
+
+#if CL_USE_PROCESS_REACTOR
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class IProcess;
+class UnixProcessImpl;
+
+/**
+ * @class clProcessReactor
+ * @brief read the stdout/stderr of all the redirected child processes from a single thread (epoll)
+ * The output is accumulated per process and delivered at most once per FLUSH_INTERVAL_MS, using the same
+ * notifications as ProcessReaderThread: IProcessCallback::OnProcessOutput or wxEVT_ASYNC_PROCESS_OUTPUT /
+ * wxEVT_ASYNC_PROCESS_STDERR events (their output is converted into wxString only when GetOutput() is called)
+ * followed by IProcessCallback::OnProcessTerminated or wxEVT_ASYNC_PROCESS_TERMINATED
+ */
+class WXDLLIMPEXP_CL clProcessReactor
+{
+    struct Channel {
+        UnixProcessImpl* process = nullptr;
+        uint32_t id = 0;
+        int stdout_fd = -1;
+        int stderr_fd = -1;
+        bool suspended = false;
+        std::string stdout_buffer;
+        std::string stderr_buffer;
+        std::chrono::steady_clock::time_point last_flush;
+    };
+
+    std::mutex m_mutex;
+    std::unique_ptr<std::thread> m_thread;
+    int m_epollFd = -1;
+    int m_wakeupFd = -1;
+    bool m_shutdown = false;
+    uint32_t m_nextId = 1;
+    std::vector<char> m_buffer;
+    std::unordered_map<IProcess*, std::unique_ptr<Channel>> m_channels;
+    std::unordered_map<int, Channel*> m_fds;
+
+protected:
+    clProcessReactor();
+    ~clProcessReactor();
+
+    void Entry();
+    bool DoStart();
+    void DoStop();
+    bool DoWatch(Channel& channel, int fd);
+    void DoUnwatch(int fd);
+    bool DoWatchChannel(Channel& channel);
+    void DoUnwatchChannel(Channel& channel);
+    void DoRemove(IProcess* process);
+    void DoHandleEvent(uint64_t data);
+    bool DoRead(Channel& channel, int fd);
+    void DoDrain(Channel& channel, int fd);
+    void DoFlush(Channel& channel, const std::chrono::steady_clock::time_point& now);
+    int DoFlushPending();
+    void DoNotifyTerminated(Channel& channel);
+
+public:
+    static clProcessReactor& Get();
+
+    /**
+     * @brief start reading the output of `process`. The reactor thread is started on the first call
+     * @return false if the reactor is not available, in this case the caller should use ProcessReaderThread
+     */
+    bool Add(UnixProcessImpl* process);
+
+    /**
+     * @brief stop reading the output of `process`. Output that was not delivered yet is discarded.
+     * When this function returns, the reactor no longer touches `process` or its handles, so they can be closed
+     */
+    void Remove(IProcess* process);
+
+    /**
+     * @brief deliver the output that was read so far and stop reading from `process` until Resume() is called.
+     * While suspended, the caller may read from the process directly (IProcess::Read)
+     */
+    void Suspend(IProcess* process);
+
+    /**
+     * @brief resume reading the output of `process`
+     */
+    void Resume(IProcess* process);
+};
+#endif // CL_USE_PROCESS_REACTOR
+#endif // CLPROCESSREACTOR_H
@@ -139,18 +139,21 @@ UnixProcessImpl::~UnixProcessImpl() { Cleanup(); }
 
 void UnixProcessImpl::Cleanup()
 {
+#if CL_USE_PROCESS_REACTOR
+    // the reactor must forget about our handles before we close them
+    if (m_inReactor) {
+        clProcessReactor::Get().Remove(this);
+        m_inReactor = false;
+    }
+#endif
+
     close(GetReadHandle());
     close(GetWriteHandle());
     if (GetStderrHandle() != wxNOT_FOUND) {
         close(GetStderrHandle());
     }
 
-    if (m_thr) {
-        // Stop the reader thread
-        m_thr->Stop();
-        delete m_thr;
-    }
-    m_thr = NULL;
+    StopReaderThread();
 
     if (GetPid() != wxNOT_FOUND) {
         wxKill(GetPid(), GetHardKill() ? wxSIGKILL : wxSIGTERM, NULL, wxKILL_CHILDREN);
@@ -184,12 +187,7 @@ bool UnixProcessImpl::ReadFromFd(int fd, fd_set& rset, wxString& output, std::st
                 raw_output.swap(stripped_buffer);
             }
 
-            wxString convBuff = wxString(raw_output.c_str(), wxConvUTF8, raw_output.length());
-            if (convBuff.empty()) {
-                convBuff = wxString::From8BitData(raw_output.c_str(), raw_output.length());
-            }
-
-            output.swap(convBuff);
+            output = StringUtils::FromStdString(raw_output);
             return true;
         }
     }
@@ -472,6 +470,14 @@ IProcess* UnixProcessImpl::Execute(wxEvtHandler* parent, const wxString& cmd, si
 
 void UnixProcessImpl::StartReaderThread()
 {
+#if CL_USE_PROCESS_REACTOR
+    // redirected processes are read by the shared reactor thread
+    if (IsRedirect() && clProcessReactor::Get().Add(this)) {
+        m_inReactor = true;
+        return;
+    }
+#endif
+
     // Launch the 'Reader' thread
     m_thr = new ProcessReaderThread();
     m_thr->SetProcess(this);
@@ -499,8 +505,15 @@ bool UnixProcessImpl::WriteToConsole(const wxString& buff)
     return do_write(GetWriteHandle(), mb);
 }
 
-void UnixProcessImpl::Detach()
+void UnixProcessImpl::StopReaderThread()
 {
+#if CL_USE_PROCESS_REACTOR
+    if (m_inReactor) {
+        clProcessReactor::Get().Remove(this);
+        m_inReactor = false;
+    }
+#endif
+
     if (m_thr) {
         // Stop the reader thread
         m_thr->Stop();
@@ -509,6 +522,8 @@ void UnixProcessImpl::Detach()
     m_thr = NULL;
 }
 
+void UnixProcessImpl::Detach() { StopReaderThread(); }
+
 void UnixProcessImpl::Signal(wxSignal sig) { wxKill(GetPid(), sig, NULL, wxKILL_CHILDREN); }
 
 #endif // #if defined(__WXMAC )||defined(__WXGTK__)
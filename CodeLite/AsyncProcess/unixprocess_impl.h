@@ -27,6 +27,7 @@
 
 #if defined(__WXMAC__) || defined(__WXGTK__)
 #include "asyncprocess.h"
+#include "clProcessReactor.h"
 #include "codelite_exports.h"
 #include "processreaderthread.h"
 
@@ -38,10 +39,15 @@ class WXDLLIMPEXP_CL UnixProcessImpl : public IProcess
     int m_stderrHandle = wxNOT_FOUND;
     int m_writeHandle;
     wxString m_tty;
+#if CL_USE_PROCESS_REACTOR
+    bool m_inReactor = false;
+    friend class clProcessReactor;
+#endif
     friend class wxTerminal;
 
 private:
     void StartReaderThread();
+    void StopReaderThread();
     bool ReadFromFd(int fd, fd_set& rset, wxString& output, std::string& raw_output);
 
 public:
@@ -8,6 +8,7 @@
 #include "fileutils.h"
 #include "procutils.h"
 
+#include <limits>
 #include <set>
 #include <wx/stopwatch.h>
 #include <wx/tokenzr.h>
@@ -59,10 +60,56 @@ wxString fix_macro_entry(const wxString& macro)
     //fixed.Replace("\"", "\\\"");
     return fixed;
 }
+
+/// construct a tag from a ctags output line. `prev_scoped_tag` is the last enum seen, it is used
+/// to fix the scope of its enumerators
+TagEntryPtr line_to_tag(const wxString& line, TagEntryPtr& prev_scoped_tag)
+{
+    TagEntryPtr tag(new TagEntry());
+    tag->FromLine(line);
+
+    if(tag->IsEnumerator()                                // looking at an enumerator
+       && prev_scoped_tag                                 // we have a previously seen scope
+       && prev_scoped_tag->GetFile() == tag->GetFile()    /// and they are on the same file
+       && prev_scoped_tag->GetName() == tag->GetParent()) // and it belongs to it
+    {
+        // remove one part of the scope
+        wxArrayString scopes = ::wxStringTokenize(tag->GetScope(), ":", wxTOKEN_STRTOK);
+        if(scopes.size()) {
+            scopes.pop_back(); // remove the last part of the scope
+            wxString new_scope;
+            for(const wxString& scope : scopes) {
+                if(!new_scope.empty()) {
+                    new_scope << "::";
+                }
+                new_scope << scope;
+            }
+            // update the scope
+            tag->SetScope(new_scope.empty() ? "<global>" : new_scope);
+        }
+    }
+
+    if(tag->IsEnum()) {
+        prev_scoped_tag = tag;
+    }
+    return tag;
+}
 } // namespace
 
 bool CTags::DoGenerate(const wxString& filesContent, const wxString& codelite_indexer, const wxStringMap_t& macro_table,
                        const wxString& ctags_kinds, wxString* output)
+{
+    wxString content;
+    bool res = DoGenerate(filesContent, codelite_indexer, macro_table, ctags_kinds,
+                          [&content](const wxString& line) { content << line << "\n"; });
+    if(output) {
+        content.swap(*output);
+    }
+    return res;
+}
+
+bool CTags::DoGenerate(const wxString& filesContent, const wxString& codelite_indexer, const wxStringMap_t& macro_table,
+                       const wxString& ctags_kinds, const std::function<void(const wxString&)>& on_line)
 {
     Initialise(codelite_indexer);
     clDEBUG() << "Generating ctags files" << clEndl;
@@ -137,7 +184,8 @@ bool CTags::DoGenerate(const wxString& filesContent, const wxString& codelite_in
     WrapInShell(command_to_run);
     clDEBUG() << "Running command:" << command_to_run << endl;
 
-    *output = ProcUtils::SafeExecuteCommand(command_to_run);
+    // consume the output as it is produced instead of buffering all of it
+    ProcUtils::SafeExecuteCommandWithCallback(command_to_run, on_line);
 
     long elapsed = sw.Time();
 
@@ -148,63 +196,61 @@ bool CTags::DoGenerate(const wxString& filesContent, const wxString& codelite_in
 
 size_t CTags::ParseFiles(const std::vector<wxString>& files, const wxString& codelite_indexer,
                          const wxStringMap_t& macro_table, std::vector<TagEntryPtr>& tags)
+{
+    tags.clear();
+    // a single batch holding all the tags
+    return ParseFiles(files, codelite_indexer, macro_table, std::numeric_limits<size_t>::max(),
+                      [&tags](std::vector<TagEntryPtr>& batch) {
+                          if(tags.empty()) {
+                              tags.swap(batch);
+                          } else {
+                              tags.insert(tags.end(), batch.begin(), batch.end());
+                          }
+                      });
+}
+
+size_t CTags::ParseFiles(const std::vector<wxString>& files, const wxString& codelite_indexer,
+                         const wxStringMap_t& macro_table, size_t batch_size,
+                         const std::function<void(std::vector<TagEntryPtr>&)>& on_tags)
 {
     wxString filesList;
     for(const auto& file : files) {
         filesList << file << "\n";
     }
-    wxString content;
-    if(!DoGenerate(filesList, codelite_indexer, macro_table, wxEmptyString, &content)) {
-        return 0;
-    }
 
-    tags.clear();
-    wxArrayString lines = ::wxStringTokenize(content, "\n", wxTOKEN_STRTOK);
-    tags.reserve(lines.size());
-
-    // convert the lines into tags
+    size_t count = 0;
+    std::vector<TagEntryPtr> batch;
     TagEntryPtr prev_scoped_tag = nullptr;
-    for(wxString& line : lines) {
+    auto on_line = [&](const wxString& output_line) {
+        wxString line = output_line;
         line.Trim(false).Trim();
         if(line.empty()) {
-            continue;
+            return;
         }
 
-        // construct a tag from the line
-        tags.emplace_back(new TagEntry());
-        auto tag = tags.back();
-        tag->FromLine(line);
-
-        if(tag->IsEnumerator()                                // looking at an enumerator
-           && prev_scoped_tag                                 // we have a previously seen scope
-           && prev_scoped_tag->GetFile() == tag->GetFile()    /// and they are on the same file
-           && prev_scoped_tag->GetName() == tag->GetParent()) // and it belongs to it
-        {
-            // remove one part of the scope
-            wxArrayString scopes = ::wxStringTokenize(tag->GetScope(), ":", wxTOKEN_STRTOK);
-            if(scopes.size()) {
-                scopes.pop_back(); // remove the last part of the scope
-                wxString new_scope;
-                for(const wxString& scope : scopes) {
-                    if(!new_scope.empty()) {
-                        new_scope << "::";
-                    }
-                    new_scope << scope;
-                }
-                // update the scope
-                tag->SetScope(new_scope.empty() ? "<global>" : new_scope);
-            }
+        TagEntryPtr tag = line_to_tag(line, prev_scoped_tag);
+        ++count;
+        // ctags reports the files one after the other. Only flush on a file boundary, so
+        // the tags of a file are never split between batches
+        if(batch.size() >= batch_size && batch.back()->GetFile() != tag->GetFile()) {
+            on_tags(batch);
+            batch.clear();
         }
+        batch.push_back(tag);
+    };
 
-        if(tag->IsEnum()) {
-            prev_scoped_tag = tag;
-        }
+    if(!DoGenerate(filesList, codelite_indexer, macro_table, wxEmptyString, on_line)) {
+        return 0;
     }
 
-    if(tags.empty()) {
-        clDEBUG() << "0 tags, ctags output:" << content << endl;
+    if(!batch.empty()) {
+        on_tags(batch);
     }
-    return tags.size();
+
+    if(count == 0) {
+        clDEBUG() << "0 tags generated for" << files.size() << "files" << endl;
+    }
+    return count;
 }
 
 size_t CTags::ParseFile(const wxString& file, const wxString& codelite_indexer, const wxStringMap_t& macro_table,
@@ -5,6 +5,7 @@
 #include "database/entry.h"
 #include "tag_tree.h"
 
+#include <functional>
 #include <vector>
 #include <wx/filename.h>
 #include <wx/textfile.h>
@@ -26,6 +27,13 @@ protected:
                            const wxStringMap_t& macro_table, const wxString& ctags_kinds = wxEmptyString,
                            wxString* output = nullptr);
 
+    /**
+     * @brief same as above, but the ctags output is passed to `on_line`, one line at a time, while it is generated
+     */
+    static bool DoGenerate(const wxString& filesContent, const wxString& codelite_indexer,
+                           const wxStringMap_t& macro_table, const wxString& ctags_kinds,
+                           const std::function<void(const wxString&)>& on_line);
+
     static void Initialise(const wxString& codelite_indexer);
 
 public:
@@ -35,6 +43,17 @@ public:
     static size_t ParseFiles(const std::vector<wxString>& files, const wxString& codelite_indexer,
                              const wxStringMap_t& macro_table, std::vector<TagEntryPtr>& tags);
 
+    /**
+     * @brief parse list of files, streaming the indexer output. The tags are passed to `on_tags` in
+     * batches of up to `batch_size` tags as soon as they are read, so the memory used is proportional
+     * to the batch size and not to the whole output. The tags of a single file are never split between
+     * batches (a batch may exceed `batch_size` for this). `on_tags` may take ownership of the batch content
+     * @return the number of tags generated
+     */
+    static size_t ParseFiles(const std::vector<wxString>& files, const wxString& codelite_indexer,
+                             const wxStringMap_t& macro_table, size_t batch_size,
+                             const std::function<void(std::vector<TagEntryPtr>&)>& on_tags);
+
     /**
      * @brief given a list of files, generate an output tags file and place it under 'path'
      */
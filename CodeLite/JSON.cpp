@@ -40,6 +40,12 @@ JSON::JSON(const wxString& text)
     m_json = cJSON_Parse(text.mb_str(wxConvUTF8).data());
 }
 
+JSON::JSON(const char* text, size_t len)
+    : m_json(NULL)
+{
+    m_json = cJSON_ParseWithLength(text, len);
+}
+
 JSON::JSON(cJSON* json)
     : m_json(json)
 {
@@ -243,6 +243,8 @@ protected:
 public:
     JSON(int type);
     JSON(const wxString& text);
+    /// parse `len` bytes of UTF-8 encoded text. `text` does not need to be null terminated
+    JSON(const char* text, size_t len);
     JSON(const wxFileName& filename);
     JSON(JSONItem item);
     JSON(cJSON* json);
@@ -0,0 +1,27 @@
+#include "CancelRequestNotification.hpp"
+
+namespace LSP
+{
+struct CancelParams : public Params {
+    int m_id = wxNOT_FOUND;
+
+    JSONItem ToJSON(const wxString& name) const override
+    {
+        JSONItem json = JSONItem::createObject(name);
+        json.addProperty("id", m_id);
+        return json;
+    }
+
+    void FromJSON(const JSONItem& json) override { m_id = json["id"].toInt(m_id); };
+};
+
+CancelRequestNotification::CancelRequestNotification(int requestId)
+{
+    SetMethod("$/cancelRequest");
+    m_params.reset(new CancelParams());
+    m_params->As<CancelParams>()->m_id = requestId;
+}
+
+CancelRequestNotification::~CancelRequestNotification() {}
+
+} // namespace LSP
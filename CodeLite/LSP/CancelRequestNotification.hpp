@@ -0,0 +1,22 @@
+#ifndef CANCELREQUESTNOTIFICATION_HPP
+#define CANCELREQUESTNOTIFICATION_HPP
+
+#include "LSP/Notification.h"
+
+namespace LSP
+{
+
+/**
+ * @brief `$/cancelRequest` notification: tell the server that we are no longer interested in the
+ * response of a request that was already sent
+ */
+class WXDLLIMPEXP_CL CancelRequestNotification : public Notification
+{
+public:
+    explicit CancelRequestNotification(int requestId);
+    virtual ~CancelRequestNotification();
+};
+
+} // namespace LSP
+
+#endif // CANCELREQUESTNOTIFICATION_HPP
@@ -59,6 +59,11 @@ void LSP::CompletionRequest::OnResponse(const LSP::ResponseMessage& response, wx
     }
 }
 
+wxString LSP::CompletionRequest::GetSupersedeKey() const
+{
+    return GetMethod() + ":" + m_params->As<CompletionParams>()->GetTextDocument().GetPath();
+}
+
 bool LSP::CompletionRequest::IsValidAt(const wxString& filename, size_t line, size_t col) const
 {
     wxString path = m_params->As<CompletionParams>()->GetTextDocument().GetPath();
@@ -17,6 +17,7 @@ public:
     bool IsPositionDependantRequest() const { return true; }
     bool IsValidAt(const wxString& filename, size_t line, size_t col) const;
     bool IsUserTriggeredRequest() const { return m_userTrigger; }
+    wxString GetSupersedeKey() const override;
 
 private:
     bool m_userTrigger = false;
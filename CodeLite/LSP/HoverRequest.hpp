@@ -12,6 +12,8 @@ public:
     explicit HoverRequest(const wxString& filename, size_t line, size_t column);
     virtual ~HoverRequest();
     void OnResponse(const LSP::ResponseMessage& response, wxEvtHandler* owner);
+    // only the last hover tip is displayed
+    wxString GetSupersedeKey() const override { return GetMethod(); }
 };
 };     // namespace LSP
 #endif // HOVERREQUEST_HPP
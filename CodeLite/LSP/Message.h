@@ -31,6 +31,8 @@ public:
     /**
      * @brief return the **first** JSON payload from the network buffer
      * @param network_buffer - network buffer (may contain multiple messages)
+     * @note this erases the message from the head of `network_buffer`, readers of a stream should use
+     * LSP::MessageFramer instead
      */
     static std::unique_ptr<JSON> GetJSONPayload(std::string& network_buffer);
 
@@ -0,0 +1,157 @@
+#include "MessageFramer.hpp"
+
+#include "LSP/basic_types.h"
+#include "cl_standard_paths.h"
+#include "fileutils.h"
+
+#include <cstring>
+
+namespace
+{
+#define HEADER_CONTENT_LENGTH "Content-Length"
+#define HEADERS_TERMINATOR "\r\n\r\n"
+
+// reclaim the consumed space once it reaches this size (and is larger than the unconsumed data)
+constexpr size_t COMPACT_THRESHOLD = 64 * 1024;
+
+inline bool is_blank(char ch) { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; }
+
+void trim(const char*& begin, const char*& end)
+{
+    while(begin < end && is_blank(*begin)) {
+        ++begin;
+    }
+    while(end > begin && is_blank(*(end - 1))) {
+        --end;
+    }
+}
+} // namespace
+
+bool LSP::MessageFramer::ParseHeaders(const char* headers, size_t len, size_t* content_length)
+{
+    const size_t header_name_len = strlen(HEADER_CONTENT_LENGTH);
+    const char* p = headers;
+    const char* end = headers + len;
+    while(p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if(eol == nullptr) {
+            eol = end;
+        }
+
+        const char* colon = static_cast<const char*>(memchr(p, ':', eol - p));
+        if(colon) {
+            const char* name_begin = p;
+            const char* name_end = colon;
+            trim(name_begin, name_end);
+            if((size_t)(name_end - name_begin) == header_name_len &&
+               memcmp(name_begin, HEADER_CONTENT_LENGTH, header_name_len) == 0) {
+                const char* value_begin = colon + 1;
+                const char* value_end = eol;
+                trim(value_begin, value_end);
+                if(value_begin == value_end) {
+                    return false;
+                }
+
+                size_t value = 0;
+                for(const char* v = value_begin; v < value_end; ++v) {
+                    if(*v < '0' || *v > '9') {
+                        return false;
+                    }
+                    value = (value * 10) + (*v - '0');
+                }
+                *content_length = value;
+                return true;
+            }
+        }
+        p = eol + 1;
+    }
+    return false;
+}
+
+void LSP::MessageFramer::Append(const char* data, size_t len)
+{
+    Compact();
+    m_buffer.append(data, len);
+}
+
+void LSP::MessageFramer::Compact()
+{
+    if(IsEmpty()) {
+        // cheap: keeps the allocated memory
+        m_buffer.clear();
+        m_offset = 0;
+        m_scanOffset = 0;
+        return;
+    }
+
+    if(m_offset < COMPACT_THRESHOLD || m_offset < GetSize()) {
+        return;
+    }
+
+    m_buffer.erase(0, m_offset);
+    m_scanOffset -= m_offset;
+    m_offset = 0;
+}
+
+void LSP::MessageFramer::Consume(size_t count)
+{
+    m_offset += count;
+    m_scanOffset = m_offset;
+    m_haveHeaders = false;
+    m_headersSize = 0;
+    m_contentLength = 0;
+}
+
+void LSP::MessageFramer::Clear()
+{
+    m_buffer.clear();
+    m_offset = 0;
+    Consume(0);
+}
+
+std::unique_ptr<JSON> LSP::MessageFramer::Next()
+{
+    while(!IsEmpty()) {
+        if(!m_haveHeaders) {
+            size_t where = m_buffer.find(HEADERS_TERMINATOR, m_scanOffset);
+            if(where == std::string::npos) {
+                // the terminator might be split between two reads, resume the search a bit before the end
+                size_t len = m_buffer.length();
+                m_scanOffset = (len > m_offset + 3) ? len - 3 : m_offset;
+                return nullptr;
+            }
+
+            size_t headers_size = where + strlen(HEADERS_TERMINATOR) - m_offset;
+            size_t content_length = 0;
+            if(!ParseHeaders(m_buffer.data() + m_offset, where - m_offset, &content_length)) {
+                LSP_WARNING() << "LSP message header does not contain a valid Content-Length header!" << endl;
+                LSP_WARNING() << m_buffer.substr(m_offset, headers_size) << endl;
+                // skip it
+                Consume(headers_size);
+                continue;
+            }
+            m_haveHeaders = true;
+            m_headersSize = headers_size;
+            m_contentLength = content_length;
+        }
+
+        if(GetSize() < (m_headersSize + m_contentLength)) {
+            LSP_DEBUG() << "Input buffer is too small" << endl;
+            return nullptr;
+        }
+
+        const char* payload = m_buffer.data() + m_offset + m_headersSize;
+        std::unique_ptr<JSON> json(new JSON(payload, m_contentLength));
+        if(!json->isOk()) {
+            LSP_ERROR() << "Unable to parse JSON object from response!" << endl;
+
+            // for debugging purposes, dump the content
+            auto cfile = FileUtils::CreateTempFileName(clStandardPaths::Get().GetTempDir(), "cfile", "json");
+            FileUtils::WriteFileContentRaw(cfile, std::string(payload, m_contentLength));
+            LSP_WARNING() << "c-content written into:" << cfile << endl;
+        }
+        Consume(m_headersSize + m_contentLength);
+        return json;
+    }
+    return nullptr;
+}
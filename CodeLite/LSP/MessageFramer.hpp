@@ -0,0 +1,76 @@
+#ifndef MESSAGEFRAMER_HPP
+#define MESSAGEFRAMER_HPP
+
+#include "JSON.h"
+#include "codelite_exports.h"
+
+#include <memory>
+#include <string>
+
+namespace LSP
+{
+
+/**
+ * @brief split a stream of LSP messages ("Content-Length: N\r\n\r\n<N bytes of JSON>") into JSON objects
+ *
+ * Incoming data is appended at the end of the buffer and messages are consumed from its head by moving
+ * a read offset, so consuming a message does not move the remaining bytes. The headers are scanned in place
+ * and the UTF-8 payload is handed directly to the JSON parser (no intermediate copies or wxString conversion).
+ * The consumed space is reclaimed only when it is large enough to make the move worth it
+ */
+class WXDLLIMPEXP_CL MessageFramer
+{
+    std::string m_buffer;
+    // start of the unconsumed data
+    size_t m_offset = 0;
+    // where to resume the search for the end of the headers
+    size_t m_scanOffset = 0;
+    // the headers of the message at m_offset were already parsed
+    bool m_haveHeaders = false;
+    size_t m_headersSize = 0;
+    size_t m_contentLength = 0;
+
+protected:
+    void Compact();
+    void Consume(size_t count);
+
+public:
+    MessageFramer() {}
+    ~MessageFramer() {}
+
+    void Append(const char* data, size_t len);
+    void Append(const std::string& data) { Append(data.data(), data.length()); }
+
+    /**
+     * @brief return the next complete JSON message, or nullptr if there is no complete message in the buffer
+     * A message with invalid headers or an invalid payload is dropped (the returned JSON object is not "ok"
+     * if the payload could not be parsed)
+     */
+    std::unique_ptr<JSON> Next();
+
+    /**
+     * @brief is there unconsumed data in the buffer?
+     */
+    bool IsEmpty() const { return m_offset == m_buffer.length(); }
+
+    /**
+     * @brief the number of unconsumed bytes
+     */
+    size_t GetSize() const { return m_buffer.length() - m_offset; }
+
+    /**
+     * @brief return a copy of the unconsumed data (for debugging purposes)
+     */
+    std::string GetContent() const { return m_buffer.substr(m_offset); }
+
+    void Clear();
+
+    /**
+     * @brief find the Content-Length value in the headers section `headers` (excluding the "\r\n\r\n")
+     */
+    static bool ParseHeaders(const char* headers, size_t len, size_t* content_length);
+};
+
+}; // namespace LSP
+
+#endif // MESSAGEFRAMER_HPP
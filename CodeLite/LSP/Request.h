@@ -44,6 +44,13 @@ public:
         return true;
     }
 
+    /**
+     * @brief requests returning the same non empty key are redundant: only the response to the most recent
+     * one is useful (e.g. code completion in a given file). When a new request is queued, the older ones
+     * with the same key are dropped or cancelled
+     */
+    virtual wxString GetSupersedeKey() const { return wxEmptyString; }
+
     /**
      * @brief this method will get called by the protocol for handling the response.
      * Override it in the various requests
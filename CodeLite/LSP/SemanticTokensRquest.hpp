@@ -16,6 +16,7 @@ public:
     ~SemanticTokensRquest();
 
     void OnResponse(const LSP::ResponseMessage& response, wxEvtHandler* owner);
+    wxString GetSupersedeKey() const override { return GetMethod() + ":" + m_filename; }
 };
 } // namespace LSP
 
@@ -12,6 +12,11 @@
 #include "fileutils.h"
 
 #include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <wx/filename.h>
 #include <wx/log.h>
 #include <wx/stopwatch.h>
@@ -161,6 +166,167 @@ const static wxString CREATE_FILES_TABLE_SQL =
 const static wxString CREATE_FILES_TABLE_SQL_IDX1 =
     "CREATE UNIQUE INDEX IF NOT EXISTS FILES_TABLE_IDX_1 ON FILES_TABLE(FILE_NAME)";
 
+namespace
+{
+// the number of parsed files the workers can keep ahead of the database writer
+constexpr size_t PARSE_WINDOW_SIZE = 512;
+
+/// a file parsed by a worker thread
+struct ParsedFile {
+    std::unique_ptr<PHPSourceFile> source;
+    // the classes looked up while parsing the file, with the answer given to the parser
+    std::vector<std::pair<wxString, bool>> classLookups;
+};
+
+void collect_classes(PHPEntityBase::Ptr_t entity, wxArrayString& classes)
+{
+    if(entity->Is(kEntityTypeClass)) {
+        classes.Add(entity->GetFullName());
+    }
+    for(const auto& child : entity->GetChildren()) {
+        collect_classes(child, classes);
+    }
+}
+
+/**
+ * @class PHPParserPool
+ * @brief parse files using a pool of worker threads. The parsed files are handed to the caller in order.
+ *
+ * When storing the files one after the other, the parser resolves the types against the classes stored by the
+ * previous files (PHPLookupTable::ClassExists()). The workers can not access the lookup table: they answer these
+ * lookups with the classes defined by the previous files parsed so far, and record them. The caller replays the
+ * lookups against the lookup table before storing a file, and re-parses the file if any of the answers differ.
+ */
+class PHPParserPool
+{
+    std::vector<wxFileName> m_files;
+    bool m_parseFuncBodies = false;
+    std::vector<std::unique_ptr<ParsedFile>> m_parsed;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    size_t m_next = 0;
+    size_t m_consumed = 0;
+    bool m_stop = false;
+
+    // class name -> the index of the first file defining it
+    std::mutex m_classesMutex;
+    std::unordered_map<wxString, size_t> m_classes;
+
+    bool DoClassExists(const wxString& classname, size_t index)
+    {
+        std::lock_guard<std::mutex> lock{ m_classesMutex };
+        auto iter = m_classes.find(classname);
+        return iter != m_classes.end() && iter->second < index;
+    }
+
+    void DoAddClasses(const wxArrayString& classes, size_t index)
+    {
+        std::lock_guard<std::mutex> lock{ m_classesMutex };
+        for(const wxString& classname : classes) {
+            auto iter = m_classes.insert({ classname, index }).first;
+            iter->second = std::min(iter->second, index);
+        }
+    }
+
+    std::unique_ptr<ParsedFile> DoParse(size_t index)
+    {
+        std::unique_ptr<ParsedFile> parsed(new ParsedFile());
+        // For performance reaons, load the file into memory and then parse it
+        wxString content;
+        if(!FileUtils::ReadFileContent(m_files[index], content, wxConvISO8859_1)) {
+            return parsed;
+        }
+
+        ParsedFile* p = parsed.get();
+        parsed->source.reset(new PHPSourceFile(content, nullptr));
+        parsed->source->SetFilename(m_files[index]);
+        parsed->source->SetParseFunctionBody(m_parseFuncBodies);
+        parsed->source->SetClassExistsFunc([this, p, index](const wxString& classname) -> bool {
+            bool exists = DoClassExists(classname, index);
+            p->classLookups.push_back({ classname, exists });
+            return exists;
+        });
+        parsed->source->Parse();
+        parsed->source->SetClassExistsFunc(nullptr);
+
+        wxArrayString classes;
+        if(parsed->source->Namespace()) {
+            collect_classes(parsed->source->Namespace(), classes);
+        }
+        DoAddClasses(classes, index);
+        return parsed;
+    }
+
+    void DoWork()
+    {
+        while(true) {
+            size_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock{ m_mutex };
+                m_cv.wait(lock, [this]() {
+                    return m_stop || m_next >= m_files.size() || m_next < m_consumed + PARSE_WINDOW_SIZE;
+                });
+                if(m_stop || m_next >= m_files.size()) {
+                    return;
+                }
+                index = m_next++;
+            }
+
+            auto parsed = DoParse(index);
+            {
+                std::lock_guard<std::mutex> lock{ m_mutex };
+                m_parsed[index].swap(parsed);
+            }
+            m_cv.notify_all();
+        }
+    }
+
+public:
+    PHPParserPool(std::vector<wxFileName>&& files, bool parseFuncBodies)
+        : m_files(std::move(files))
+        , m_parseFuncBodies(parseFuncBodies)
+    {
+        m_parsed.resize(m_files.size());
+        size_t num_workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), m_files.size());
+        m_threads.reserve(num_workers);
+        for(size_t i = 0; i < num_workers; ++i) {
+            m_threads.emplace_back([this]() { DoWork(); });
+        }
+    }
+
+    ~PHPParserPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for(auto& thr : m_threads) {
+            thr.join();
+        }
+    }
+
+    /**
+     * @brief wait for the next file to be parsed and return it. Files that could not be read are returned without
+     * a source
+     */
+    std::unique_ptr<ParsedFile> Next()
+    {
+        std::unique_ptr<ParsedFile> parsed;
+        {
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            m_cv.wait(lock, [this]() { return m_parsed[m_consumed] != nullptr; });
+            parsed.swap(m_parsed[m_consumed]);
+            ++m_consumed;
+        }
+        m_cv.notify_all();
+        return parsed;
+    }
+};
+} // namespace
+
 PHPLookupTable::PHPLookupTable()
     : m_sizeLimit(50)
 {
@@ -398,6 +564,129 @@ void PHPLookupTable::UpdateSourceFile(PHPSourceFile& source, bool autoCommit)
     }
 }
 
+void PHPLookupTable::DoRecreateSymbolsDatabase(const wxArrayString& files, eUpdateMode updateMode,
+                                               const std::function<bool()>& goingDown, bool parseFuncBodies)
+{
+    try {
+
+        {
+            clParseEvent event(wxPHP_PARSE_STARTED);
+            event.SetTotalFiles(files.GetCount());
+            event.SetCurfileIndex(0);
+            EventNotifier::Get()->AddPendingEvent(event);
+        }
+
+        wxStopWatch sw;
+        sw.Start();
+
+        m_allClasses.clear(); // clear the cache
+
+        // Collect the files that need to be parsed. The database is only accessed from this thread
+        std::vector<bool> reParseNeeded(files.GetCount(), true);
+        std::vector<wxFileName> filesToParse;
+        for(size_t i = 0; i < files.GetCount(); ++i) {
+            wxFileName fnFile(files.Item(i));
+            if(!fnFile.Exists()) {
+                // Ensure that the file exists
+                reParseNeeded[i] = false;
+
+            } else if(updateMode == kUpdateMode_Fast) {
+                // Check to see if we need to re-parse this file
+                // and store it to the database
+                time_t lastModifiedOnDisk = fnFile.GetModificationTime().GetTicks();
+                wxLongLong lastModifiedInDB = GetFileLastParsedTimestamp(fnFile);
+                if(lastModifiedOnDisk <= lastModifiedInDB.ToLong()) {
+                    reParseNeeded[i] = false;
+                }
+            }
+
+            // Parse only valid PHP files
+            if(FileExtManager::GetType(fnFile.GetFullName()) != FileExtManager::TypePhp) {
+                reParseNeeded[i] = false;
+            }
+
+            if(reParseNeeded[i]) {
+                filesToParse.push_back(fnFile);
+            }
+        }
+
+        PHPParserPool pool(std::move(filesToParse), parseFuncBodies);
+        size_t reparsedCount = 0;
+        m_db.Begin();
+        for(size_t i = 0; i < files.GetCount(); ++i) {
+            if(goingDown()) {
+                break;
+            }
+            {
+                clParseEvent event(wxPHP_PARSE_PROGRESS);
+                event.SetTotalFiles(files.GetCount());
+                event.SetCurfileIndex(i);
+                event.SetFileName(files.Item(i));
+                EventNotifier::Get()->AddPendingEvent(event);
+            }
+
+            if(!reParseNeeded[i]) {
+                continue;
+            }
+
+            std::unique_ptr<ParsedFile> parsed = pool.Next();
+            if(!parsed->source) {
+                clWARNING() << "PHP: Failed to read file:" << files.Item(i) << "for parsing" << clEndl;
+                continue;
+            }
+
+            // The worker did not know all the classes stored so far: if it resolved a type differently, parse the
+            // file again against the lookup table so the database is the same as when parsing the files in order
+            bool lookupsMatch = std::all_of(parsed->classLookups.begin(), parsed->classLookups.end(),
+                                            [this](const std::pair<wxString, bool>& lookup) {
+                                                return ClassExists(lookup.first) == lookup.second;
+                                            });
+            if(!lookupsMatch) {
+                PHPSourceFile sourceFile(parsed->source->GetText(), this);
+                sourceFile.SetFilename(parsed->source->GetFilename());
+                sourceFile.SetParseFunctionBody(parseFuncBodies);
+                sourceFile.Parse();
+                UpdateSourceFile(sourceFile, false);
+                ++reparsedCount;
+            } else {
+                UpdateSourceFile(*parsed->source, false);
+            }
+        }
+        m_db.Commit();
+        long elapsedMs = sw.Time();
+
+        LOG_IF_TRACE
+        {
+            clDEBUG1() << _("PHP: parsed ") << files.GetCount() << " in " << elapsedMs << " milliseconds ("
+                       << reparsedCount << " files parsed again)" << clEndl;
+        }
+
+        {
+            clParseEvent event(wxPHP_PARSE_ENDED);
+            event.SetTotalFiles(files.GetCount());
+            event.SetCurfileIndex(files.GetCount());
+            EventNotifier::Get()->AddPendingEvent(event);
+        }
+
+    } catch (const wxSQLite3Exception& e) {
+        try {
+            m_db.Rollback();
+
+        } catch (...) {
+        }
+
+        {
+            // always make sure that the end event is sent
+            clParseEvent event(wxPHP_PARSE_ENDED);
+            event.SetTotalFiles(files.GetCount());
+            event.SetCurfileIndex(files.GetCount());
+            EventNotifier::Get()->AddPendingEvent(event);
+        }
+
+        clWARNING() << "PHPLookupTable::UpdateSourceFiles:" << e.GetMessage() << clEndl;
+    }
+}
+
 PHPEntityBase::Ptr_t PHPLookupTable::DoFindMemberOf(wxLongLong parentDbId, const wxString& exactName,
                                                     bool parentIsNamespace)
 {
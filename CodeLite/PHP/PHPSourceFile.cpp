@@ -1491,31 +1491,31 @@ wxString PHPSourceFile::DoMakeIdentifierAbsolute(const wxString& type, bool exac
         return m_converter->MakeIdentifierAbsolute(type);
     }
 
-    static std::unordered_set<std::string> phpKeywords;
-    if(phpKeywords.empty()) {
+    static const std::unordered_set<std::string> phpKeywords = {
         // List taken from https://www.php.net/manual/en/language.types.intro.php
         // Native types
-        phpKeywords.insert("bool");
-        phpKeywords.insert("int");
-        phpKeywords.insert("float");
-        phpKeywords.insert("string");
-        phpKeywords.insert("array");
-        phpKeywords.insert("object");
-        phpKeywords.insert("iterable");
-        phpKeywords.insert("callable");
-        phpKeywords.insert("null");
-        phpKeywords.insert("mixed");
-        phpKeywords.insert("void");
+        "bool",
+        "int",
+        "float",
+        "string",
+        "array",
+        "object",
+        "iterable",
+        "callable",
+        "null",
+        "mixed",
+        "void",
         // Types that are common in documentation
-        phpKeywords.insert("boolean");
-        phpKeywords.insert("integer");
-        phpKeywords.insert("double");
-        phpKeywords.insert("real");
-        phpKeywords.insert("binery");
-        phpKeywords.insert("resource");
-        phpKeywords.insert("number");
-        phpKeywords.insert("callback");
-    }
+        "boolean",
+        "integer",
+        "double",
+        "real",
+        "binery",
+        "resource",
+        "number",
+        "callback"
+    };
+
     wxString typeWithNS(type);
     typeWithNS.Trim().Trim(false);
 
@@ -1561,7 +1561,7 @@ wxString PHPSourceFile::DoMakeIdentifierAbsolute(const wxString& type, bool exac
         ns << "\\";
     }
 
-    if(exactMatch && m_lookup && !typeWithNS.Contains("\\") && !m_lookup->ClassExists(ns + typeWithNS)) {
+    if(exactMatch && (m_lookup || m_classExistsFunc) && !typeWithNS.Contains("\\") && !ClassExists(ns + typeWithNS)) {
         // Only when "exactMatch" apply this logic, otherwise, we might be getting a partially typed string
         // which we will not find by calling FindChild()
         typeWithNS.Prepend("\\"); // Use the global NS
@@ -1571,6 +1571,14 @@ wxString PHPSourceFile::DoMakeIdentifierAbsolute(const wxString& type, bool exac
     return typeWithNS;
 }
 
+bool PHPSourceFile::ClassExists(const wxString& classname) const
+{
+    if(m_classExistsFunc) {
+        return m_classExistsFunc(classname);
+    }
+    return m_lookup && m_lookup->ClassExists(classname);
+}
+
 const PHPEntityBase::List_t& PHPSourceFile::GetAllMatchesInOrder()
 {
     if(m_allMatchesInorder.empty()) {
@@ -29,6 +29,7 @@
 #include "PHPEntityBase.h"
 #include "PhpLexerAPI.h"
 #include "codelite_exports.h"
+#include <functional>
 #include <vector>
 #include <wx/filename.h>
 
@@ -51,9 +52,11 @@ class WXDLLIMPEXP_CL PHPSourceFile
     PHPSourceFile* m_converter = nullptr;
     PHPLookupTable* m_lookup = nullptr;
     PHPEntityBase::List_t m_allMatchesInorder;
+    std::function<bool(const wxString&)> m_classExistsFunc;
 
 public:
     typedef wxSharedPtr<PHPSourceFile> Ptr_t;
+    typedef std::function<bool(const wxString&)> ClassExistsFunc_t;
 
 protected:
     /**
@@ -62,6 +65,11 @@ protected:
      */
     bool ReadVariableInitialization(PHPEntityBase::Ptr_t var);
 
+    /**
+     * @brief check if a class exists, using the class exists function if set, or the lookup table
+     */
+    bool ClassExists(const wxString& classname) const;
+
     /**
      * @brief calls phpLexerNextToken. Use this call instead of the global phpLexerNextToken
      * since this function will handle all PHP comments found
@@ -242,6 +250,12 @@ public:
      */
     void SetTypeAbsoluteConverter(PHPSourceFile* converter) { m_converter = converter; }
 
+    /**
+     * @brief replace the lookup table when checking if a class exists while resolving types. This allows parsing
+     * without accessing the lookup table (e.g. from a worker thread)
+     */
+    void SetClassExistsFunc(const ClassExistsFunc_t& func) { m_classExistsFunc = func; }
+
     /**
      * @brief check if we are inside a PHP block at the end of the given buffer
      */
@@ -108,6 +108,8 @@ private:
     int m_commentEndLine;
     bool m_insidePhp;
     FILE* m_fp;
+    // nesting level of the '[' inside an attribute
+    int m_bracketCount;
 
 public:
     void Clear()
@@ -117,6 +119,7 @@ public:
         }
         m_fp = NULL;
         m_insidePhp = false;
+        m_bracketCount = 0;
         ClearComment();
         m_rawStringLabel.clear();
         m_string.clear();
@@ -128,6 +131,7 @@ public:
         , m_commentEndLine(wxNOT_FOUND)
         , m_insidePhp(false)
         , m_fp(NULL)
+        , m_bracketCount(0)
     {
     }
 
@@ -150,6 +154,9 @@ public:
     void SetInsidePhp(bool insidePhp) { this->m_insidePhp = insidePhp; }
     bool IsInsidePhp() const { return m_insidePhp; }
 
+    void SetBracketCount(int bracketCount) { this->m_bracketCount = bracketCount; }
+    int GetBracketCount() const { return m_bracketCount; }
+
     void SetString(const std::string& string) { this->m_string = string; }
     std::string& GetString() { return m_string; }
 
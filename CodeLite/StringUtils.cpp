@@ -83,6 +83,15 @@ std::string StringUtils::ToStdString(const wxString& str)
     return res;
 }
 
+wxString StringUtils::FromStdString(const std::string& str)
+{
+    wxString res = wxString(str.c_str(), wxConvUTF8, str.length());
+    if (res.empty() && !str.empty()) {
+        res = wxString::From8BitData(str.c_str(), str.length());
+    }
+    return res;
+}
+
 #define BUFF_STATE_NORMAL 0
 #define BUFF_STATE_IN_ESC 1
 #define BUFF_STATE_IN_OSC 2
@@ -52,6 +52,11 @@ public:
      */
     static std::string ToStdString(const wxString& str);
 
+    /**
+     * @brief convert UTF-8 buffer into wxString. If the buffer is not a valid UTF-8, treat it as 8 bit data
+     */
+    static wxString FromStdString(const std::string& str);
+
     /**
      * @brief remove terminal colours from buffer
      */
@@ -1,42 +1,485 @@
 #include "clFileSystemWatcher.h"
 #include <algorithm>
 #include <set>
+#include "file_logger.h"
 #include "fileutils.h"
 
+#if CL_FSW_USE_INOTIFY
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
 wxDEFINE_EVENT(wxEVT_FILE_MODIFIED, clFileSystemEvent);
 wxDEFINE_EVENT(wxEVT_FILE_NOT_FOUND, clFileSystemEvent);
 
 // In milliseconds
 #define FILE_CHECK_INTERVAL 500
 
+namespace
+{
+void SendBatch(wxEvtHandler* owner, wxEventType type, wxArrayString& paths)
+{
+    if(!owner || paths.empty()) {
+        return;
+    }
+    paths.Sort();
+    clFileSystemEvent evt(type);
+    evt.SetPath(paths.Item(0));
+    evt.SetPaths(paths);
+    owner->QueueEvent(evt.Clone());
+}
+} // namespace
+
+#if CL_FSW_USE_INOTIFY
+namespace
+{
+// report a batch of changes once no new event arrived for this long (milliseconds)
+constexpr int INOTIFY_QUIET_PERIOD_MS = 200;
+// but never hold a batch longer than this, e.g. during a long `git checkout` (milliseconds)
+constexpr int INOTIFY_MAX_BATCH_DELAY_MS = 1000;
+constexpr uint32_t INOTIFY_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                  IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+} // namespace
+
+/**
+ * @brief the inotify backend. All the inotify state is owned by a worker thread which blocks on the inotify
+ * descriptor, coalesces the changes and queues them as batches to the owner
+ */
+class clFSWInotify
+{
+    struct Watch {
+        wxString path;
+        // this folder is part of a watched tree (and not only the parent folder of a watched file)
+        bool tree = false;
+        // index of the tree in m_roots
+        size_t root = 0;
+    };
+
+    struct Root {
+        wxString path;
+        wxStringSet_t excludeNames;
+        wxStringSet_t excludePaths;
+    };
+
+    wxEvtHandler* m_owner = nullptr;
+    int m_fd = wxNOT_FOUND;
+    int m_wakeupFd = wxNOT_FOUND;
+    std::thread* m_thread = nullptr;
+    std::vector<Root> m_roots;
+    wxStringSet_t m_files;
+    // set by the worker thread once the initial watches are in place
+    std::atomic_bool m_treesWatched{ false };
+    // set by the worker thread when a folder could not be watched (e.g. the watches limit was reached)
+    std::atomic_bool m_watchFailed{ false };
+
+    // the members below are accessed by the worker thread only
+    std::unordered_map<int, Watch> m_watches;
+    wxStringSet_t m_modified;
+    wxStringSet_t m_deleted;
+    bool m_limitReported = false;
+
+protected:
+    void Run();
+    bool AddWatch(const wxString& path, bool tree, size_t root);
+    void AddTree(const wxString& path, size_t root, bool report);
+    void RemoveTree(const wxString& path);
+    bool IsExcluded(const Root& root, const wxString& fullpath, const wxString& name) const;
+    void HandleEvent(const struct inotify_event* ev);
+    void AddModified(const wxString& path);
+    void AddDeleted(const wxString& path, bool isDirectory);
+    void Flush();
+
+public:
+    clFSWInotify(wxEvtHandler* owner, const clFileSystemWatcher::File::Map_t& files,
+                 const std::vector<clFileSystemWatcher::Directory>& directories);
+    ~clFSWInotify();
+
+    bool Start();
+    void Stop();
+    /**
+     * @brief true once all the folders of the trees are watched. Changes made in a folder that could not be
+     * watched are not reported, the owner has to rescan the trees
+     */
+    bool IsWatchingDirectories() const
+    {
+        return !m_roots.empty() && m_treesWatched.load() && !m_watchFailed.load();
+    }
+};
+
+clFSWInotify::clFSWInotify(wxEvtHandler* owner, const clFileSystemWatcher::File::Map_t& files,
+                           const std::vector<clFileSystemWatcher::Directory>& directories)
+    : m_owner(owner)
+{
+    for(const auto& [path, _] : files) {
+        m_files.insert(path);
+    }
+
+    for(const auto& directory : directories) {
+        Root root;
+        root.path = directory.path;
+        for(wxString spec : directory.excludeFolders) {
+            while(spec.EndsWith("/")) {
+                spec.RemoveLast();
+            }
+            if(spec.empty()) {
+                continue;
+            }
+
+            if(spec.StartsWith("/")) {
+                root.excludePaths.insert(spec);
+            } else if(spec.Contains("/")) {
+                root.excludePaths.insert(root.path + "/" + spec);
+            } else {
+                root.excludeNames.insert(spec);
+            }
+        }
+        m_roots.push_back(root);
+    }
+}
+
+clFSWInotify::~clFSWInotify() { Stop(); }
+
+bool clFSWInotify::Start()
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_fd < 0) {
+        clWARNING() << "inotify_init1 failed:" << strerror(errno) << endl;
+        return false;
+    }
+
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(m_wakeupFd < 0) {
+        clWARNING() << "eventfd failed:" << strerror(errno) << endl;
+        ::close(m_fd);
+        m_fd = wxNOT_FOUND;
+        return false;
+    }
+    m_thread = new std::thread(&clFSWInotify::Run, this);
+    return true;
+}
+
+void clFSWInotify::Stop()
+{
+    if(m_thread) {
+        // wake the worker thread
+        uint64_t one = 1;
+        ssize_t rc = ::write(m_wakeupFd, &one, sizeof(one));
+        wxUnusedVar(rc);
+        m_thread->join();
+        wxDELETE(m_thread);
+    }
+
+    if(m_fd != wxNOT_FOUND) {
+        ::close(m_fd);
+        m_fd = wxNOT_FOUND;
+    }
+
+    if(m_wakeupFd != wxNOT_FOUND) {
+        ::close(m_wakeupFd);
+        m_wakeupFd = wxNOT_FOUND;
+    }
+}
+
+bool clFSWInotify::AddWatch(const wxString& path, bool tree, size_t root)
+{
+    int wd = inotify_add_watch(m_fd, path.mb_str(wxConvUTF8).data(), INOTIFY_MASK);
+    if(wd < 0) {
+        if(errno != ENOENT) {
+            // a folder removed in the meantime has nothing left to report
+            m_watchFailed.store(true);
+        }
+        if(errno == ENOSPC && !m_limitReported) {
+            m_limitReported = true;
+            clWARNING() << "inotify watches limit reached (see /proc/sys/fs/inotify/max_user_watches)."
+                        << "Some folders will not be watched" << endl;
+        }
+        return false;
+    }
+
+    // adding a watch to an already watched folder returns the same descriptor
+    Watch& watch = m_watches[wd];
+    watch.path = path;
+    if(tree) {
+        watch.tree = true;
+        watch.root = root;
+    }
+    return true;
+}
+
+bool clFSWInotify::IsExcluded(const Root& root, const wxString& fullpath, const wxString& name) const
+{
+    return root.excludeNames.count(name) || root.excludePaths.count(fullpath);
+}
+
+void clFSWInotify::AddTree(const wxString& path, size_t root, bool report)
+{
+    // symbolic links to folders are not followed, this also protects us from cycles
+    std::vector<wxString> Q = { path };
+    while(!Q.empty()) {
+        wxString dirpath = Q.back();
+        Q.pop_back();
+
+        // watch the folder before listing it, so files created in between are not missed
+        if(!AddWatch(dirpath, true, root)) {
+            continue;
+        }
+
+        DIR* dir = opendir(dirpath.mb_str(wxConvUTF8).data());
+        if(!dir) {
+            continue;
+        }
+
+        while(struct dirent* entry = readdir(dir)) {
+            if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+
+            wxString name = wxString::FromUTF8(entry->d_name);
+            wxString fullpath = dirpath + "/" + name;
+            unsigned char type = entry->d_type;
+            if(type == DT_UNKNOWN) {
+                struct stat st;
+                if(lstat(fullpath.mb_str(wxConvUTF8).data(), &st) == 0) {
+                    type = S_ISDIR(st.st_mode) ? DT_DIR : (S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN);
+                }
+            }
+
+            if(type == DT_DIR) {
+                if(!IsExcluded(m_roots[root], fullpath, name)) {
+                    Q.push_back(fullpath);
+                }
+            } else if(report && type == DT_REG) {
+                AddModified(fullpath);
+            }
+        }
+        closedir(dir);
+    }
+}
+
+void clFSWInotify::RemoveTree(const wxString& path)
+{
+    wxString prefix = path + "/";
+    for(auto iter = m_watches.begin(); iter != m_watches.end();) {
+        if(iter->second.path == path || iter->second.path.StartsWith(prefix)) {
+            inotify_rm_watch(m_fd, iter->first);
+            iter = m_watches.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+void clFSWInotify::AddModified(const wxString& path)
+{
+    m_deleted.erase(path);
+    m_modified.insert(path);
+}
+
+void clFSWInotify::AddDeleted(const wxString& path, bool isDirectory)
+{
+    m_modified.erase(path);
+    m_deleted.insert(path);
+    if(isDirectory) {
+        // drop the pending changes of the files that were in this folder
+        wxString prefix = path + "/";
+        for(auto iter = m_modified.begin(); iter != m_modified.end();) {
+            if(iter->StartsWith(prefix)) {
+                iter = m_modified.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+}
+
+void clFSWInotify::HandleEvent(const struct inotify_event* ev)
+{
+    if(ev->mask & IN_Q_OVERFLOW) {
+        // events were lost: report the roots as modified, the owner should rescan them
+        clWARNING() << "inotify queue overflow, file system events were lost" << endl;
+        for(const Root& root : m_roots) {
+            AddModified(root.path);
+        }
+        for(const wxString& file : m_files) {
+            AddModified(file);
+        }
+        return;
+    }
+
+    auto iter = m_watches.find(ev->wd);
+    if(iter == m_watches.end()) {
+        return;
+    }
+
+    if(ev->mask & IN_IGNORED) {
+        // the folder was deleted or unmounted
+        m_watches.erase(iter);
+        return;
+    }
+
+    // take a copy, the map might change below
+    Watch watch = iter->second;
+    if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+        // the parent folder reports the deletion of this folder, unless it is one of the roots
+        if(watch.tree && watch.path == m_roots[watch.root].path) {
+            AddDeleted(watch.path, true);
+        }
+        if(ev->mask & IN_MOVE_SELF) {
+            RemoveTree(watch.path);
+        }
+        return;
+    }
+
+    if(ev->len == 0) {
+        return;
+    }
+
+    wxString name = wxString::FromUTF8(ev->name);
+    wxString fullpath = watch.path + "/" + name;
+    if(ev->mask & IN_ISDIR) {
+        if(!watch.tree) {
+            return;
+        }
+
+        if(ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+            if(!IsExcluded(m_roots[watch.root], fullpath, name)) {
+                // watch the new folder and report its content
+                AddTree(fullpath, watch.root, true);
+            }
+        } else if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            if(ev->mask & IN_MOVED_FROM) {
+                RemoveTree(fullpath);
+            }
+            AddDeleted(fullpath, true);
+        }
+        return;
+    }
+
+    if(!watch.tree && m_files.count(fullpath) == 0) {
+        // a file that we don't watch
+        return;
+    }
+
+    if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        AddDeleted(fullpath, false);
+    } else {
+        AddModified(fullpath);
+    }
+}
+
+void clFSWInotify::Flush()
+{
+    wxArrayString deleted;
+    deleted.Alloc(m_deleted.size());
+    for(const wxString& path : m_deleted) {
+        deleted.Add(path);
+    }
+    m_deleted.clear();
+
+    wxArrayString modified;
+    modified.Alloc(m_modified.size());
+    for(const wxString& path : m_modified) {
+        modified.Add(path);
+    }
+    m_modified.clear();
+
+    clDEBUG1() << "File system watcher:" << modified.size() << "modified," << deleted.size() << "deleted" << endl;
+    SendBatch(m_owner, wxEVT_FILE_NOT_FOUND, deleted);
+    SendBatch(m_owner, wxEVT_FILE_MODIFIED, modified);
+}
+
+void clFSWInotify::Run()
+{
+    for(size_t i = 0; i < m_roots.size(); ++i) {
+        AddTree(m_roots[i].path, i, false);
+    }
+
+    // watch the parent folder of the files, this way we also catch "save to temp file + rename"
+    for(const wxString& file : m_files) {
+        wxFileName fn(file);
+        AddWatch(fn.GetPath(), false, 0);
+    }
+    m_treesWatched.store(true);
+    clDEBUG() << "File system watcher: watching" << m_watches.size() << "folders" << endl;
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    auto batch_start = std::chrono::steady_clock::now();
+    while(true) {
+        bool pending = !m_modified.empty() || !m_deleted.empty();
+        struct pollfd fds[2];
+        fds[0] = { m_fd, POLLIN, 0 };
+        fds[1] = { m_wakeupFd, POLLIN, 0 };
+        int rc = poll(fds, 2, pending ? INOTIFY_QUIET_PERIOD_MS : -1);
+        if(rc < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            clWARNING() << "File system watcher: poll error:" << strerror(errno) << endl;
+            break;
+        }
+
+        if(fds[1].revents) {
+            // shutdown requested
+            break;
+        }
+
+        if(rc == 0) {
+            // quiet period elapsed
+            Flush();
+            continue;
+        }
+
+        ssize_t len = ::read(m_fd, buffer, sizeof(buffer));
+        if(len < 0 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        } else if(len <= 0) {
+            break;
+        }
+
+        if(!pending) {
+            batch_start = std::chrono::steady_clock::now();
+        }
+
+        for(char* p = buffer; p < buffer + len;) {
+            const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(p);
+            HandleEvent(ev);
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+
+        if((!m_modified.empty() || !m_deleted.empty()) &&
+           std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batch_start)
+                   .count() >= INOTIFY_MAX_BATCH_DELAY_MS) {
+            Flush();
+        }
+    }
+}
+#endif
+
 clFileSystemWatcher::clFileSystemWatcher()
     : m_owner(NULL)
-#if CL_FSW_USE_TIMER
     , m_timer(NULL)
-#endif
 {
-#if CL_FSW_USE_TIMER
     Bind(wxEVT_TIMER, &clFileSystemWatcher::OnTimer, this);
-#else
-    m_watcher.SetOwner(this);
-    Bind(wxEVT_FSWATCHER, &clFileSystemWatcher::OnFileModified, this);
-#endif
 }
 
 clFileSystemWatcher::~clFileSystemWatcher()
 {
-#if CL_FSW_USE_TIMER
     Stop();
     Unbind(wxEVT_TIMER, &clFileSystemWatcher::OnTimer, this);
-#else
-    m_watcher.RemoveAll();
-    Unbind(wxEVT_FSWATCHER, &clFileSystemWatcher::OnFileModified, this);
-#endif
 }
 
 void clFileSystemWatcher::SetFile(const wxFileName& filename)
 {
-#if CL_FSW_USE_TIMER
     if(filename.Exists()) {
         m_files.clear();
         File f;
@@ -45,67 +488,74 @@ void clFileSystemWatcher::SetFile(const wxFileName& filename)
         f.file_size = FileUtils::GetFileSize(filename);
         m_files.insert(std::make_pair(filename.GetFullPath(), f));
     }
-#else
-    m_watcher.RemoveAll();
-    wxFileName dironly = filename;
-    dironly.SetFullName(""); // must be directory only
-    m_watcher.Add(dironly);
-    m_watchedFile = filename; // but we keep the file name for later usage
+    DoRestart();
+}
+
+void clFileSystemWatcher::AddDirectory(const wxString& path, const wxStringSet_t& excludeFolders)
+{
+    Directory directory;
+    directory.path = wxFileName(path, "").GetPath();
+    directory.excludeFolders = excludeFolders;
+    m_directories.push_back(directory);
+    DoRestart();
+}
+
+void clFileSystemWatcher::DoRestart()
+{
+#if CL_FSW_USE_INOTIFY
+    // the inotify backend takes a copy of the watched paths when started
+    if(m_inotify) {
+        Start();
+    }
 #endif
 }
 
 void clFileSystemWatcher::Start()
 {
-#if CL_FSW_USE_TIMER
     Stop();
 
+#if CL_FSW_USE_INOTIFY
+    m_inotify = new clFSWInotify(GetOwner(), m_files, m_directories);
+    if(m_inotify->Start()) {
+        return;
+    }
+    clWARNING() << "inotify is not available, polling the watched files instead" << endl;
+    wxDELETE(m_inotify);
+#endif
+
     m_timer = new wxTimer(this);
     m_timer->Start(FILE_CHECK_INTERVAL, true);
-#else
-#endif
 }
 
 void clFileSystemWatcher::Stop()
 {
-#if CL_FSW_USE_TIMER
     if(m_timer) {
         m_timer->Stop();
     }
     wxDELETE(m_timer);
-#else
-    m_watcher.RemoveAll();
+#if CL_FSW_USE_INOTIFY
+    wxDELETE(m_inotify);
 #endif
 }
 
 void clFileSystemWatcher::Clear()
 {
-#if CL_FSW_USE_TIMER
     Stop();
     m_files.clear();
-#else
-    m_watcher.RemoveAll();
-#endif
+    m_directories.clear();
 }
 
-#if CL_FSW_USE_TIMER
 void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
 {
     std::set<wxString> nonExistingFiles;
+    wxArrayString modifiedFiles;
     for (const auto& [_, f] : m_files) {
         const wxFileName& fn = f.filename;
         if(!fn.Exists()) {
-
-            // fire file not found event
-            if(GetOwner()) {
-                clFileSystemEvent evt(wxEVT_FILE_NOT_FOUND);
-                evt.SetPath(fn.GetFullPath());
-                GetOwner()->AddPendingEvent(evt);
-            }
-
             // add the missing file to a set
             nonExistingFiles.insert(fn.GetFullPath());
         } else {
-            
+
 #ifdef __WXMSW__
             size_t prev_value = f.file_size;
             size_t curr_value = FileUtils::GetFileSize(fn);
@@ -115,12 +565,7 @@ void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
 #endif
 
             if(prev_value != curr_value) {
-                // Fire a modified event
-                if(GetOwner()) {
-                    clFileSystemEvent evt(wxEVT_FILE_MODIFIED);
-                    evt.SetPath(fn.GetFullPath());
-                    GetOwner()->AddPendingEvent(evt);
-                }
+                modifiedFiles.Add(fn.GetFullPath());
             }
 #ifdef __WXMSW__
             File updatdFile = f;
@@ -134,6 +579,14 @@ void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
         }
     }
 
+    // fire the file not found / modified events
+    wxArrayString missingFiles;
+    for (const wxString& fn : nonExistingFiles) {
+        missingFiles.Add(fn);
+    }
+    SendBatch(GetOwner(), wxEVT_FILE_NOT_FOUND, missingFiles);
+    SendBatch(GetOwner(), wxEVT_FILE_MODIFIED, modifiedFiles);
+
     // Remove the non existing files
     for (const wxString& fn : nonExistingFiles) {
         m_files.erase(fn);
@@ -143,38 +596,30 @@ void clFileSystemWatcher::OnTimer(wxTimerEvent& event)
         m_timer->Start(FILE_CHECK_INTERVAL, true);
     }
 }
-#endif
-
-#if !CL_FSW_USE_TIMER
-void clFileSystemWatcher::OnFileModified(wxFileSystemWatcherEvent& event)
-{
-    if(event.GetChangeType() == wxFSW_EVENT_MODIFY) {
-        const wxFileName& modpath = event.GetPath();
-        if(modpath == m_watchedFile) {
-            if(GetOwner()) {
-                clFileSystemEvent evt(wxEVT_FILE_MODIFIED);
-                evt.SetPath(modpath.GetFullPath());
-                GetOwner()->AddPendingEvent(evt);
-            }
-        }
-    }
-}
-#endif
 
 void clFileSystemWatcher::RemoveFile(const wxFileName& filename)
 {
-#if CL_FSW_USE_TIMER
     if(m_files.count(filename.GetFullPath())) {
         m_files.erase(filename.GetFullPath());
+        DoRestart();
     }
-#endif
 }
 
 bool clFileSystemWatcher::IsRunning() const
 {
-#if CL_FSW_USE_TIMER
+#if CL_FSW_USE_INOTIFY
+    if(m_inotify) {
+        return true;
+    }
+#endif
     return m_timer;
+}
+
+bool clFileSystemWatcher::IsWatchingDirectories() const
+{
+#if CL_FSW_USE_INOTIFY
+    return m_inotify && m_inotify->IsWatchingDirectories();
 #else
-    return m_watcher.GetWatchedPathsCount();
+    return false;
 #endif
 }
@@ -3,20 +3,21 @@
 
 #include "codelite_exports.h"
 #include "clFileSystemEvent.h"
+#include "macros.h"
 #include <map>
+#include <vector>
 #include <wx/timer.h>
 #include <wx/filename.h>
 
-#ifdef __WXMSW__
-#define CL_FSW_USE_TIMER 1
+// On Linux, the watcher uses inotify. If inotify is not available at runtime (or on other platforms)
+// it falls back to polling the watched files with a timer
+#ifdef __linux__
+#define CL_FSW_USE_INOTIFY 1
 #else
-#define CL_FSW_USE_TIMER 1
-#endif
-
-#if !CL_FSW_USE_TIMER
-#include <wx/fswatcher.h>
+#define CL_FSW_USE_INOTIFY 0
 #endif
 
+class clFSWInotify;
 class WXDLLIMPEXP_CL clFileSystemWatcher : public wxEvtHandler
 {
 public:
@@ -27,24 +28,25 @@ public:
         typedef std::map<wxString, File> Map_t;
     };
 
+    struct Directory {
+        wxString path;
+        wxStringSet_t excludeFolders;
+    };
+
     wxEvtHandler* m_owner;
-#if CL_FSW_USE_TIMER
     clFileSystemWatcher::File::Map_t m_files;
+    std::vector<Directory> m_directories;
     wxTimer* m_timer;
-#else
-    wxFileSystemWatcher m_watcher;
-    wxFileName m_watchedFile;
+#if CL_FSW_USE_INOTIFY
+    clFSWInotify* m_inotify = nullptr;
 #endif
 
 public:
     typedef wxSharedPtr<clFileSystemWatcher> Ptr_t;
 
 protected:
-#if CL_FSW_USE_TIMER
     void OnTimer(wxTimerEvent& event);
-#else
-    void OnFileModified(wxFileSystemWatcherEvent& event);
-#endif
+    void DoRestart();
 
 public:
     clFileSystemWatcher();
@@ -63,10 +65,18 @@ public:
      */
     void RemoveFile(const wxFileName& filename);
 
+    /**
+     * @brief watch all the files under `path` (recursively). Folders created later are watched as well
+     * @param excludeFolders folders to skip: folder names (e.g. ".git"), paths relative to `path` or full paths
+     * @note this is only supported by the inotify backend, see IsWatchingDirectories()
+     */
+    void AddDirectory(const wxString& path, const wxStringSet_t& excludeFolders = {});
+
     /**
      * @brief start to watching list of files.
      * This object fires the following events (clFileSystemEvent):
-     * wxEVT_FILE_MODIFIED, wxEVT_FILE_DELETED
+     * wxEVT_FILE_MODIFIED (modified or created files), wxEVT_FILE_NOT_FOUND (deleted files or folders)
+     * Changes are batched: GetPaths() holds all the paths of the batch and GetPath() its first entry
      */
     void Start();
 
@@ -84,6 +94,13 @@ public:
      * @brief is the watcher running?
      */
     bool IsRunning() const;
+
+    /**
+     * @brief is the watcher running and reporting the changes of the folders added with AddDirectory()?
+     * This is false when the watcher had to fall back to polling, while the folders are being added to the watch
+     * list and once a folder could not be watched (e.g. the inotify watches limit was reached)
+     */
+    bool IsWatchingDirectories() const;
 };
 
 wxDECLARE_EXPORTED_EVENT(WXDLLIMPEXP_CL, wxEVT_FILE_MODIFIED, clFileSystemEvent);
@@ -3,6 +3,7 @@
 #include "file_logger.h"
 #include "fileutils.h"
 
+#include <algorithm>
 #include <queue>
 #include <unordered_set>
 #include <vector>
@@ -10,6 +11,20 @@
 #include <wx/filename.h>
 #include <wx/tokenzr.h>
 
+#ifdef __linux__
+#include <condition_variable>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <mutex>
+#include <set>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
 clFilesScanner::clFilesScanner() {}
 
 clFilesScanner::~clFilesScanner() {}
@@ -68,6 +83,318 @@ bool IsRelPathContainedInSpec(const wxString& rootPath, const wxString& fullPath
 }
 } // namespace
 
+#ifdef __linux__
+namespace
+{
+constexpr size_t GETDENTS_BUFFER_SIZE = 32 * 1024;
+constexpr size_t MAX_WALKER_THREADS = 8;
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/// skip to the next UTF-8 character
+const char* next_char(const char* p)
+{
+    ++p;
+    while ((*p & 0xC0) == 0x80) {
+        ++p;
+    }
+    return p;
+}
+
+/// same as ::wxMatchWild(pattern, name, false) for UTF-8 strings: '*' matches any sequence, '?' any character
+bool match_wild(const char* pattern, const char* name)
+{
+    const char* star = nullptr;
+    const char* star_name = nullptr;
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            star_name = name;
+        } else if (*pattern == '?') {
+            ++pattern;
+            name = next_char(name);
+        } else if (*pattern == *name) {
+            ++pattern;
+            ++name;
+        } else if (star) {
+            pattern = star + 1;
+            star_name = next_char(star_name);
+            name = star_name;
+        } else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == 0;
+}
+
+/// same as FileUtils::WildMatch(masks, name)
+bool wild_match(const std::vector<std::string>& masks, const char* name)
+{
+    for (const std::string& mask : masks) {
+        if (mask == "*") {
+            return true;
+        }
+    }
+
+    for (const std::string& mask : masks) {
+        if (mask.find('*') == std::string::npos ? mask == name : match_wild(mask.c_str(), name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> to_fn_strings(const wxArrayString& arr)
+{
+    std::vector<std::string> result;
+    result.reserve(arr.size());
+    for (const wxString& str : arr) {
+        result.emplace_back(str.fn_str());
+    }
+    return result;
+}
+
+/**
+ * @brief walk a directory tree using a pool of threads
+ * The directories are read with getdents64(): the entry type reported by the kernel (d_type) saves a stat() per
+ * entry (only symlinks and file systems that do not report the type are stat()-ed). The entries are filtered by
+ * their name before any string is allocated for them.
+ * The callbacks are always called from the thread that called Walk(), one directory at a time
+ */
+class ParallelWalker
+{
+public:
+    struct Filter {
+        size_t search_flags = clFilesScanner::SF_NONE;
+        std::vector<std::string> exclude_folders_spec;
+        bool match_all_files = true;
+        std::vector<std::string> files_spec;
+        std::vector<std::string> exclude_files_spec;
+    };
+
+private:
+    struct Batch {
+        std::vector<std::pair<std::string, wxString>> folders;
+        wxArrayString files;
+    };
+
+    Filter m_filter;
+    std::mutex m_lock;
+    std::condition_variable m_workCond;
+    std::condition_variable m_resultsCond;
+    std::deque<std::string> m_work;
+    std::deque<Batch> m_results;
+    std::set<std::pair<dev_t, ino_t>> m_visited;
+    bool m_stop = false;
+    bool m_done = false;
+
+    bool AcceptFolder(const char* name, bool is_symlink) const
+    {
+        if ((m_filter.search_flags & clFilesScanner::SF_EXCLUDE_HIDDEN_DIRS) && (name[0] == '.' || name[0] == '_')) {
+            return false;
+        }
+
+        if ((m_filter.search_flags & clFilesScanner::SF_DONT_FOLLOW_SYMLINKS) && is_symlink) {
+            return false;
+        }
+        return !wild_match(m_filter.exclude_folders_spec, name);
+    }
+
+    bool AcceptFile(const char* name) const
+    {
+        if (wild_match(m_filter.exclude_files_spec, name)) {
+            return false;
+        }
+        return m_filter.match_all_files || wild_match(m_filter.files_spec, name);
+    }
+
+    void List(const std::string& dirpath, Batch& batch, std::vector<char>& buffer)
+    {
+        int fd = open(dirpath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        // a folder can be reached more than once via symlinks
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            std::lock_guard<std::mutex> lk{ m_lock };
+            if (!m_visited.insert({ st.st_dev, st.st_ino }).second) {
+                close(fd);
+                return;
+            }
+        }
+
+        std::string prefix = dirpath;
+        if (prefix.empty() || prefix.back() != '/') {
+            prefix += '/';
+        }
+
+        while (true) {
+            long bytes_read = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+            if (bytes_read <= 0) {
+                break;
+            }
+
+            for (long pos = 0; pos < bytes_read;) {
+                const linux_dirent64* entry = reinterpret_cast<const linux_dirent64*>(buffer.data() + pos);
+                pos += entry->d_reclen;
+
+                const char* name = entry->d_name;
+                if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+                    continue;
+                }
+
+                bool is_dir = entry->d_type == DT_DIR;
+                bool is_symlink = entry->d_type == DT_LNK;
+                struct stat entry_st;
+                if (entry->d_type == DT_UNKNOWN && fstatat(fd, name, &entry_st, AT_SYMLINK_NOFOLLOW) == 0) {
+                    is_dir = S_ISDIR(entry_st.st_mode);
+                    is_symlink = S_ISLNK(entry_st.st_mode);
+                }
+
+                if (is_symlink) {
+                    is_dir = fstatat(fd, name, &entry_st, 0) == 0 && S_ISDIR(entry_st.st_mode);
+                }
+
+                if (is_dir) {
+                    if (AcceptFolder(name, is_symlink)) {
+                        std::string fullpath = prefix + name;
+                        wxString wx_fullpath(fullpath.c_str(), *wxConvFileName);
+                        batch.folders.emplace_back(std::move(fullpath), std::move(wx_fullpath));
+                    }
+                } else if (AcceptFile(name)) {
+                    batch.files.Add(wxString((prefix + name).c_str(), *wxConvFileName));
+                }
+            }
+        }
+        close(fd);
+    }
+
+    void Worker()
+    {
+        std::vector<char> buffer(GETDENTS_BUFFER_SIZE);
+        while (true) {
+            std::string dirpath;
+            bool stop = false;
+            {
+                std::unique_lock<std::mutex> lk{ m_lock };
+                m_workCond.wait(lk, [this]() { return m_done || !m_work.empty(); });
+                if (m_work.empty()) {
+                    return;
+                }
+                dirpath = std::move(m_work.front());
+                m_work.pop_front();
+                stop = m_stop;
+            }
+
+            // an empty batch is posted when stopped, so the caller can account for every folder it pushed
+            Batch batch;
+            if (!stop) {
+                List(dirpath, batch, buffer);
+            }
+
+            {
+                std::lock_guard<std::mutex> lk{ m_lock };
+                m_results.push_back(std::move(batch));
+            }
+            m_resultsCond.notify_one();
+        }
+    }
+
+    /// pass the batch to the callbacks and queue the folders to traverse. Return the number of queued folders
+    size_t Process(Batch& batch, const std::function<bool(const wxString&)>& on_folder,
+                   const std::function<bool(const wxArrayString&)>& on_files)
+    {
+        size_t count = 0;
+        for (auto& folder : batch.folders) {
+            if (on_folder && on_folder(folder.second)) {
+                {
+                    std::lock_guard<std::mutex> lk{ m_lock };
+                    m_work.push_back(std::move(folder.first));
+                }
+                m_workCond.notify_one();
+                ++count;
+            }
+        }
+
+        if (on_files && !on_files(batch.files)) {
+            std::lock_guard<std::mutex> lk{ m_lock };
+            m_stop = true;
+        }
+        return count;
+    }
+
+public:
+    ParallelWalker(const Filter& filter)
+        : m_filter(filter)
+    {
+    }
+
+    /**
+     * @param on_folder called for every folder, return true to traverse into it
+     * @param on_files called with the files of every folder, return false to stop the walk
+     */
+    void Walk(const wxString& rootFolder, const std::function<bool(const wxString&)>& on_folder,
+              const std::function<bool(const wxArrayString&)>& on_files)
+    {
+        // the root folder is listed on this thread, the workers are only started if there are folders to traverse
+        std::vector<char> buffer(GETDENTS_BUFFER_SIZE);
+        Batch root_batch;
+        List(std::string(rootFolder.fn_str()), root_batch, buffer);
+        size_t pending = Process(root_batch, on_folder, on_files);
+        if (pending == 0) {
+            return;
+        }
+
+        size_t threads_count = std::thread::hardware_concurrency();
+        threads_count = std::max<size_t>(2, std::min(threads_count, MAX_WALKER_THREADS));
+        std::vector<std::thread> workers;
+        workers.reserve(threads_count);
+        for (size_t i = 0; i < threads_count; ++i) {
+            workers.emplace_back(&ParallelWalker::Worker, this);
+        }
+
+        while (pending) {
+            Batch batch;
+            bool stop = false;
+            {
+                std::unique_lock<std::mutex> lk{ m_lock };
+                m_resultsCond.wait(lk, [this]() { return !m_results.empty(); });
+                batch = std::move(m_results.front());
+                m_results.pop_front();
+                stop = m_stop;
+            }
+
+            --pending;
+            if (!stop) {
+                pending += Process(batch, on_folder, on_files);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lk{ m_lock };
+            m_done = true;
+        }
+        m_workCond.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+};
+} // namespace
+#endif
+
 size_t clFilesScanner::Scan(const wxString& rootFolder, std::vector<wxString>& filesOutput, const wxString& filespec,
                             const wxString& excludeFilespec, const wxStringSet_t& excludeFolders)
 {
@@ -150,6 +477,29 @@ size_t clFilesScanner::Scan(const wxString& rootFolder, const wxString& filespec
     wxArrayString specArr = ::wxStringTokenize(filespec.Lower(), ";,|", wxTOKEN_STRTOK);
     wxArrayString excludeSpecArr = ::wxStringTokenize(excludeFilespec.Lower(), ";,|", wxTOKEN_STRTOK);
     wxArrayString excludeFoldersSpecArr = ::wxStringTokenize(excludeFoldersSpec.Lower(), ";,|", wxTOKEN_STRTOK);
+#ifdef __linux__
+    ParallelWalker::Filter filter;
+    filter.exclude_folders_spec = to_fn_strings(excludeFoldersSpecArr);
+    filter.match_all_files = false;
+    filter.files_spec = to_fn_strings(specArr);
+    filter.exclude_files_spec = to_fn_strings(excludeSpecArr);
+
+    size_t nCount = 0;
+    auto on_folder = [](const wxString&) -> bool { return true; };
+    auto on_files = [&](const wxArrayString& files) -> bool {
+        for (const wxString& fullpath : files) {
+            if (!collect_cb(fullpath)) {
+                // requested to stop
+                return false;
+            }
+            ++nCount;
+        }
+        return true;
+    };
+    ParallelWalker walker(filter);
+    walker.Walk(FileUtils::RealPath(rootFolder), on_folder, on_files);
+    return nCount;
+#else
     std::queue<wxString> Q;
     std::unordered_set<wxString> Visited;
 
@@ -198,6 +548,7 @@ size_t clFilesScanner::Scan(const wxString& rootFolder, const wxString& filespec
         }
     }
     return nCount;
+#endif
 }
 
 size_t clFilesScanner::ScanNoRecurse(const wxString& rootFolder, clFilesScanner::EntryData::Vec_t& results,
@@ -256,6 +607,18 @@ void clFilesScanner::ScanWithCallbacks(const wxString& rootFolder, std::function
         return;
     }
 
+#ifdef __linux__
+    ParallelWalker::Filter filter;
+    filter.search_flags = search_flags;
+    auto on_files = [&on_file_cb](const wxArrayString& files) -> bool {
+        if (on_file_cb) {
+            on_file_cb(files);
+        }
+        return true;
+    };
+    ParallelWalker walker(filter);
+    walker.Walk(FileUtils::RealPath(rootFolder), on_folder_cb, on_files);
+#else
     std::vector<wxString> Q;
     std::unordered_set<wxString> Visited;
 
@@ -315,4 +678,5 @@ void clFilesScanner::ScanWithCallbacks(const wxString& rootFolder, std::function
             on_file_cb(files);
         }
     }
+#endif
 }
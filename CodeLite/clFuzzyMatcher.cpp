@@ -0,0 +1,328 @@
+#include "clFuzzyMatcher.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <wx/tokenzr.h>
+#include <wx/wxcrt.h>
+
+namespace
+{
+// the scores, as used by fzf
+constexpr int SCORE_MATCH = 16;
+constexpr int SCORE_GAP_START = -3;
+constexpr int SCORE_GAP_EXTENSION = -1;
+constexpr int BONUS_BOUNDARY = SCORE_MATCH / 2;
+constexpr int BONUS_BOUNDARY_WHITE = BONUS_BOUNDARY + 2;
+constexpr int BONUS_BOUNDARY_DELIMITER = BONUS_BOUNDARY + 1;
+constexpr int BONUS_NON_WORD = SCORE_MATCH / 2;
+constexpr int BONUS_CAMEL = BONUS_BOUNDARY + SCORE_GAP_EXTENSION;
+constexpr int BONUS_CONSECUTIVE = -(SCORE_GAP_START + SCORE_GAP_EXTENSION);
+constexpr int BONUS_FIRST_CHAR_MULTIPLIER = 2;
+
+// below this number of candidates, a search is done by the calling thread
+constexpr size_t PARALLEL_THRESHOLD = 16 * 1024;
+// the candidates are handed to the worker threads in chunks of this size
+constexpr size_t CHUNK_SIZE = 4 * 1024;
+
+clFuzzyMatcher::eCharClass get_char_class(wxChar ch)
+{
+    if(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+        return clFuzzyMatcher::kCharWhitespace;
+    } else if(ch == '/' || ch == '\\' || ch == ',' || ch == ':' || ch == ';' || ch == '|') {
+        return clFuzzyMatcher::kCharDelimiter;
+    } else if(wxIsdigit(ch)) {
+        return clFuzzyMatcher::kCharDigit;
+    } else if(wxIsupper(ch)) {
+        return clFuzzyMatcher::kCharUpper;
+    } else if(wxIsalpha(ch) || ch >= 0x80) {
+        return clFuzzyMatcher::kCharLower;
+    }
+    return clFuzzyMatcher::kCharNonWord;
+}
+
+/// append `ch` encoded in UTF-8 to `str`, return the number of bytes added
+size_t append_utf8(std::string& str, wxChar ch)
+{
+    uint32_t cp = static_cast<uint32_t>(ch);
+    if(cp < 0x80) {
+        str.push_back(static_cast<char>(cp));
+        return 1;
+    } else if(cp < 0x800) {
+        str.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        str.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        return 2;
+    } else if(cp < 0x10000) {
+        str.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        str.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        return 3;
+    }
+    str.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    str.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    str.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    str.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    return 4;
+}
+
+int get_bonus(clFuzzyMatcher::eCharClass prev, clFuzzyMatcher::eCharClass cur)
+{
+    if(cur >= clFuzzyMatcher::kCharLower) {
+        // a word starts here
+        if(prev == clFuzzyMatcher::kCharWhitespace) {
+            return BONUS_BOUNDARY_WHITE;
+        } else if(prev == clFuzzyMatcher::kCharDelimiter) {
+            return BONUS_BOUNDARY_DELIMITER;
+        } else if(prev == clFuzzyMatcher::kCharNonWord) {
+            return BONUS_BOUNDARY;
+        }
+    }
+
+    if((prev == clFuzzyMatcher::kCharLower && cur == clFuzzyMatcher::kCharUpper) ||
+       (prev != clFuzzyMatcher::kCharDigit && cur == clFuzzyMatcher::kCharDigit)) {
+        return BONUS_CAMEL;
+    }
+
+    switch(cur) {
+    case clFuzzyMatcher::kCharNonWord:
+    case clFuzzyMatcher::kCharDelimiter:
+        return BONUS_NON_WORD;
+    case clFuzzyMatcher::kCharWhitespace:
+        return BONUS_BOUNDARY_WHITE;
+    default:
+        return 0;
+    }
+}
+
+void to_terms(const wxString& query, std::vector<std::string>& terms)
+{
+    wxArrayString words = ::wxStringTokenize(query, " \t", wxTOKEN_STRTOK);
+    terms.reserve(words.size());
+    for(const wxString& word : words) {
+        clFuzzyMatcher::Entry entry;
+        clFuzzyMatcher::Prepare(word, entry);
+        terms.push_back(std::move(entry.text));
+    }
+}
+} // namespace
+
+clFuzzyMatcher::clFuzzyMatcher() {}
+
+clFuzzyMatcher::~clFuzzyMatcher() {}
+
+void clFuzzyMatcher::Prepare(const wxString& str, Entry& entry)
+{
+    entry.text.clear();
+    entry.classes.clear();
+    entry.text.reserve(str.length());
+    entry.classes.reserve(str.length());
+    for(wxString::const_iterator iter = str.begin(); iter != str.end(); ++iter) {
+        wxChar ch = *iter;
+        eCharClass char_class = get_char_class(ch);
+        size_t bytes = append_utf8(entry.text, wxTolower(ch));
+        entry.classes.insert(entry.classes.end(), bytes, char_class);
+    }
+}
+
+bool clFuzzyMatcher::Score(const std::string& term, const Entry& entry, int* score)
+{
+    const std::string& text = entry.text;
+    if(term.empty()) {
+        *score = 0;
+        return true;
+    }
+
+    // find the first occurrence of the term, then walk backward from its end to find the shortest match ending there
+    size_t pidx = 0;
+    size_t end = std::string::npos;
+    for(size_t i = 0; i < text.size(); ++i) {
+        if(text[i] == term[pidx] && ++pidx == term.size()) {
+            end = i;
+            break;
+        }
+    }
+
+    if(end == std::string::npos) {
+        return false;
+    }
+
+    size_t start = end;
+    pidx = term.size() - 1;
+    for(size_t i = end + 1; i-- > 0;) {
+        if(text[i] == term[pidx]) {
+            if(pidx == 0) {
+                start = i;
+                break;
+            }
+            --pidx;
+        }
+    }
+
+    int result = 0;
+    int consecutive = 0;
+    int first_bonus = 0;
+    bool in_gap = false;
+    eCharClass prev_class = start > 0 ? entry.classes[start - 1] : kCharWhitespace;
+    pidx = 0;
+    for(size_t i = start; i <= end; ++i) {
+        eCharClass cur_class = entry.classes[i];
+        if(pidx < term.size() && text[i] == term[pidx]) {
+            int bonus = get_bonus(prev_class, cur_class);
+            if(consecutive == 0) {
+                first_bonus = bonus;
+            } else {
+                // a chunk of consecutive characters gets the bonus of its first character
+                if(bonus >= BONUS_BOUNDARY && bonus > first_bonus) {
+                    first_bonus = bonus;
+                }
+                bonus = std::max({ bonus, first_bonus, BONUS_CONSECUTIVE });
+            }
+            result += SCORE_MATCH + (pidx == 0 ? bonus * BONUS_FIRST_CHAR_MULTIPLIER : bonus);
+            in_gap = false;
+            ++consecutive;
+            ++pidx;
+        } else {
+            result += in_gap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            in_gap = true;
+            consecutive = 0;
+            first_bonus = 0;
+        }
+        prev_class = cur_class;
+    }
+    *score = result;
+    return true;
+}
+
+void clFuzzyMatcher::Add(const wxString& entry)
+{
+    m_entries.emplace_back();
+    Prepare(entry, m_entries.back());
+    m_hasLastMatches = false;
+}
+
+void clFuzzyMatcher::Clear()
+{
+    m_entries.clear();
+    m_lastQuery.clear();
+    m_lastMatches.clear();
+    m_hasLastMatches = false;
+}
+
+void clFuzzyMatcher::DoSearch(const std::vector<std::string>& terms, const std::vector<uint32_t>* candidates,
+                              std::vector<Match>& matches) const
+{
+    size_t count = candidates ? candidates->size() : m_entries.size();
+    auto search_range = [&](size_t first, size_t last, std::vector<Match>& result) {
+        for(size_t i = first; i < last; ++i) {
+            size_t index = candidates ? (*candidates)[i] : i;
+            const Entry& entry = m_entries[index];
+            int total = 0;
+            bool matched = true;
+            for(const std::string& term : terms) {
+                int score = 0;
+                if(!Score(term, entry, &score)) {
+                    matched = false;
+                    break;
+                }
+                total += score;
+            }
+
+            if(matched) {
+                Match match;
+                match.index = index;
+                match.score = total;
+                result.push_back(match);
+            }
+        }
+    };
+
+    size_t num_workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          (count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    if(count < PARALLEL_THRESHOLD || num_workers <= 1) {
+        search_range(0, count, matches);
+        return;
+    }
+
+    // each chunk has its own results, so the matches remain sorted by index once concatenated
+    std::vector<std::vector<Match>> results((count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    std::atomic_size_t next{ 0 };
+    auto worker = [&]() {
+        while(true) {
+            size_t chunk = next.fetch_add(1);
+            if(chunk >= results.size()) {
+                break;
+            }
+            size_t first = chunk * CHUNK_SIZE;
+            search_range(first, std::min(first + CHUNK_SIZE, count), results[chunk]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers);
+    for(size_t i = 0; i < num_workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    for(auto& thr : threads) {
+        thr.join();
+    }
+
+    for(const auto& result : results) {
+        matches.insert(matches.end(), result.begin(), result.end());
+    }
+}
+
+size_t clFuzzyMatcher::Search(const wxString& query, size_t limit, std::vector<Match>& matches)
+{
+    matches.clear();
+    std::vector<std::string> terms;
+    to_terms(query, terms);
+    if(terms.empty()) {
+        m_hasLastMatches = false;
+        size_t count = (limit == 0) ? m_entries.size() : std::min(limit, m_entries.size());
+        matches.resize(count);
+        for(size_t i = 0; i < count; ++i) {
+            matches[i].index = i;
+        }
+        return m_entries.size();
+    }
+
+    // a longer version of the previous query can only match a subset of its matches
+    const std::vector<uint32_t>* candidates = nullptr;
+    if(m_hasLastMatches && query.StartsWith(m_lastQuery)) {
+        candidates = &m_lastMatches;
+    }
+
+    std::vector<Match> all_matches;
+    DoSearch(terms, candidates, all_matches);
+
+    m_lastQuery = query;
+    m_lastMatches.clear();
+    m_lastMatches.reserve(all_matches.size());
+    for(const Match& match : all_matches) {
+        m_lastMatches.push_back(static_cast<uint32_t>(match.index));
+    }
+    m_hasLastMatches = true;
+
+    // best score first, then the shortest entry, then the original order
+    auto compare = [this](const Match& a, const Match& b) {
+        if(a.score != b.score) {
+            return a.score > b.score;
+        }
+        size_t len_a = m_entries[a.index].text.size();
+        size_t len_b = m_entries[b.index].text.size();
+        if(len_a != len_b) {
+            return len_a < len_b;
+        }
+        return a.index < b.index;
+    };
+
+    size_t count = all_matches.size();
+    if(limit > 0 && limit < count) {
+        std::partial_sort(all_matches.begin(), all_matches.begin() + limit, all_matches.end(), compare);
+        all_matches.resize(limit);
+    } else {
+        std::sort(all_matches.begin(), all_matches.end(), compare);
+    }
+    matches.swap(all_matches);
+    return count;
+}
@@ -0,0 +1,98 @@
+#ifndef CLFUZZYMATCHER_HPP
+#define CLFUZZYMATCHER_HPP
+
+#include "codelite_exports.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <wx/string.h>
+
+/**
+ * @brief rank a list of strings against a fuzzy query, fzf style
+ *
+ * A query is a list of space separated terms, an entry matches if it contains the characters of every term, in
+ * order (case insensitive). Matches are scored: consecutive characters and characters found at the start of a word
+ * (after a delimiter, camelCase humps, digits) score higher, gaps are penalised.
+ *
+ * The entries are converted once into UTF-8 in lower case, with the class of each character (lower, upper, digit,
+ * delimiter) kept aside for the word boundary bonuses. When the query is the previous query with more characters
+ * appended (the user is typing), only the previous matches are searched again. Large lists are searched by
+ * multiple threads.
+ *
+ * The class is not thread safe, it is meant to be owned by a dialog (GotoAnything, open resource, workspace symbols)
+ */
+class WXDLLIMPEXP_CL clFuzzyMatcher
+{
+public:
+    struct Match {
+        size_t index = 0;
+        int score = 0;
+    };
+
+    enum eCharClass : uint8_t {
+        kCharNonWord,
+        kCharDelimiter,
+        kCharWhitespace,
+        kCharLower,
+        kCharUpper,
+        kCharDigit,
+    };
+
+    struct Entry {
+        // the entry in UTF-8, lower case
+        std::string text;
+        // the class of each byte of `text`, computed before the case conversion
+        std::vector<eCharClass> classes;
+    };
+
+private:
+    std::vector<Entry> m_entries;
+    // the last query and the indexes of all the entries it matched, in ascending order
+    wxString m_lastQuery;
+    std::vector<uint32_t> m_lastMatches;
+    bool m_hasLastMatches = false;
+
+protected:
+    void DoSearch(const std::vector<std::string>& terms, const std::vector<uint32_t>* candidates,
+                  std::vector<Match>& matches) const;
+
+public:
+    clFuzzyMatcher();
+    ~clFuzzyMatcher();
+
+    /**
+     * @brief add an entry, its index is the number of entries added before it
+     */
+    void Add(const wxString& entry);
+
+    /**
+     * @brief remove all the entries
+     */
+    void Clear();
+
+    /**
+     * @brief return the number of entries
+     */
+    size_t GetCount() const { return m_entries.size(); }
+
+    /**
+     * @brief search the entries matching `query` and return the `limit` best ones in `matches`, the best first
+     * (0 means no limit). An empty query matches all the entries, in their original order
+     * @return the number of entries that matched the query, including those beyond `limit`
+     */
+    size_t Search(const wxString& query, size_t limit, std::vector<Match>& matches);
+
+    /**
+     * @brief convert `str` into the form used for matching
+     */
+    static void Prepare(const wxString& str, Entry& entry);
+
+    /**
+     * @brief score a single entry against a (lower case, UTF-8) query term
+     * @return false if `term` does not match `entry`
+     */
+    static bool Score(const std::string& term, const Entry& entry, int* score);
+};
+
+#endif // CLFUZZYMATCHER_HPP
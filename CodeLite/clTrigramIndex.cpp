@@ -0,0 +1,721 @@
+#include "clTrigramIndex.hpp"
+
+#include "file_logger.h"
+#include "fileutils.h"
+#include "worker_thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <sys/stat.h>
+#include <wx/filename.h>
+#include <wx/stopwatch.h>
+
+namespace
+{
+// Bump this whenever the file format changes
+const char INDEX_MAGIC[] = "CLTRIGRAM\x03";
+constexpr size_t INDEX_MAGIC_LEN = sizeof(INDEX_MAGIC) - 1;
+
+// Files larger than this are not indexed (and are always searched)
+constexpr size_t MAX_INDEXED_FILE_SIZE = 16 << 20;
+
+// Compact the posting lists once at least this many (and at least half of the) entries are deleted
+constexpr size_t COMPACT_THRESHOLD = 1000;
+
+// The index is saved by the indexer at most once per interval (and when it is closed)
+constexpr auto SAVE_INTERVAL = std::chrono::seconds(60);
+
+// A file modified less than this before it is indexed is not trusted: on file systems with a coarse time stamp, an
+// edit that keeps its size may not change the modification time
+constexpr int64_t MTIME_GRANULARITY_NS = 2000000000LL;
+
+// The flags stored with each file entry
+constexpr char FILE_FLAG_ALWAYS_SEARCH = 0x01;
+constexpr char FILE_FLAG_DELETED = 0x02;
+
+inline uint32_t fold(char ch)
+{
+    unsigned char uch = static_cast<unsigned char>(ch);
+    return (uch >= 'A' && uch <= 'Z') ? (uch | 0x20) : uch;
+}
+
+/// return the modification time (in nanoseconds) and the size of `path`
+bool stat_file(const wxString& path, int64_t* mtime, size_t* size)
+{
+    struct stat buff;
+    const wxCharBuffer cname = path.mb_str(wxConvUTF8);
+    if (::stat(cname.data(), &buff) < 0) {
+        return false;
+    }
+#if defined(__WXMSW__)
+    *mtime = static_cast<int64_t>(buff.st_mtime) * 1000000000LL;
+#elif defined(__WXOSX__)
+    *mtime = static_cast<int64_t>(buff.st_mtimespec.tv_sec) * 1000000000LL + buff.st_mtimespec.tv_nsec;
+#else
+    *mtime = static_cast<int64_t>(buff.st_mtim.tv_sec) * 1000000000LL + buff.st_mtim.tv_nsec;
+#endif
+    *size = buff.st_size;
+    return true;
+}
+
+void write_varint(std::string& buffer, uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+bool read_varint(const std::string& buffer, size_t& offset, uint64_t* value)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && offset < buffer.size(); shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(buffer[offset++]);
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct clTrigramIndexRequest : public ThreadRequest {
+    enum eType {
+        kIndex,
+        kRemove,
+    };
+    eType type = kIndex;
+    wxArrayString files;
+};
+} // namespace
+
+class clTrigramIndexThread : public WorkerThread
+{
+    clTrigramIndex* m_index = nullptr;
+    std::chrono::steady_clock::time_point m_lastSave = std::chrono::steady_clock::now();
+
+public:
+    clTrigramIndexThread(clTrigramIndex* index)
+        : m_index(index)
+    {
+    }
+    ~clTrigramIndexThread() override {}
+
+    void ProcessRequest(ThreadRequest* request) override
+    {
+        FileLogger::RegisterThread(wxThread::GetCurrentId(), "Trigram Indexer");
+        clTrigramIndexRequest* req = static_cast<clTrigramIndexRequest*>(request);
+        switch (req->type) {
+        case clTrigramIndexRequest::kIndex:
+            m_index->DoIndexFiles(req->files);
+            break;
+        case clTrigramIndexRequest::kRemove:
+            m_index->DoRemoveFiles(req->files);
+            break;
+        }
+
+        // saving rewrites the whole file: batch the changes of the requests received in the meantime,
+        // Close() saves what is left
+        auto now = std::chrono::steady_clock::now();
+        if (!m_index->IsShutdown() && now - m_lastSave >= SAVE_INTERVAL) {
+            m_index->DoSave();
+            m_lastSave = now;
+        }
+    }
+};
+
+clTrigramIndex::clTrigramIndex() {}
+
+clTrigramIndex::~clTrigramIndex() { Close(); }
+
+clTrigramIndex& clTrigramIndex::Get()
+{
+    static clTrigramIndex index;
+    return index;
+}
+
+void clTrigramIndex::Open(const wxString& filepath)
+{
+    Close();
+
+    m_shutdown.store(false);
+    DoLoad(filepath);
+
+    m_thread = new clTrigramIndexThread(this);
+    m_thread->Start(WXTHREAD_MIN_PRIORITY);
+}
+
+void clTrigramIndex::Close()
+{
+    if (m_thread) {
+        // let the indexer abort the current request
+        m_shutdown.store(true);
+        m_thread->Stop();
+        wxDELETE(m_thread);
+    }
+
+    DoSave();
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    DoClear();
+    m_filepath.clear();
+}
+
+bool clTrigramIndex::IsOpened() const
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    return !m_filepath.empty();
+}
+
+size_t clTrigramIndex::GetFilesCount() const
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    return m_ids.size();
+}
+
+void clTrigramIndex::IndexFilesAsync(const wxArrayString& files)
+{
+    if (!m_thread || files.empty()) {
+        return;
+    }
+    clTrigramIndexRequest* req = new clTrigramIndexRequest();
+    req->type = clTrigramIndexRequest::kIndex;
+    req->files = files;
+    m_thread->Add(req);
+}
+
+void clTrigramIndex::RemoveFilesAsync(const wxArrayString& files)
+{
+    if (!m_thread || files.empty()) {
+        return;
+    }
+    clTrigramIndexRequest* req = new clTrigramIndexRequest();
+    req->type = clTrigramIndexRequest::kRemove;
+    req->files = files;
+    m_thread->Add(req);
+}
+
+void clTrigramIndex::DoClear()
+{
+    m_files.clear();
+    m_ids.clear();
+    m_postings.clear();
+    m_deletedCount = 0;
+    m_dirty = false;
+}
+
+void clTrigramIndex::GetTrigrams(const char* content, size_t len, std::vector<uint32_t>& trigrams)
+{
+    trigrams.clear();
+    if (len < 3) {
+        return;
+    }
+
+    trigrams.reserve(len - 2);
+    uint32_t trigram = (fold(content[0]) << 8) | fold(content[1]);
+    for (size_t i = 2; i < len; ++i) {
+        trigram = ((trigram << 8) | fold(content[i])) & 0xFFFFFF;
+        trigrams.push_back(trigram);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+void clTrigramIndex::DoIndexFiles(const wxArrayString& files)
+{
+    wxStopWatch sw;
+    size_t count = 0;
+    std::string content;
+    std::vector<uint32_t> trigrams;
+    for (const wxString& file : files) {
+        if (IsShutdown()) {
+            break;
+        }
+
+        int64_t mtime = 0;
+        size_t size = 0;
+        if (!stat_file(file, &mtime, &size)) {
+            continue;
+        }
+
+        {
+            // skip files that did not change since the last time they were indexed
+            std::lock_guard<std::mutex> lk{ m_mutex };
+            auto iter = m_ids.find(file);
+            if (iter != m_ids.end() && m_files[iter->second].mtime == mtime && m_files[iter->second].size == size) {
+                continue;
+            }
+        }
+
+        FileEntry entry;
+        entry.path = file;
+        entry.mtime = mtime;
+        entry.size = size;
+        trigrams.clear();
+        if (size > MAX_INDEXED_FILE_SIZE) {
+            entry.always_search = true;
+        } else if (FileUtils::ReadFileContentRaw(file, content)) {
+            GetTrigrams(content.data(), content.size(), trigrams);
+        } else {
+            continue;
+        }
+
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+        if (now - mtime < MTIME_GRANULARITY_NS) {
+            // the file may still be edited within the same time stamp: search it until it is indexed again
+            entry.mtime = 0;
+        }
+
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        auto iter = m_ids.find(file);
+        if (iter != m_ids.end()) {
+            m_files[iter->second].deleted = true;
+            ++m_deletedCount;
+        }
+
+        // ids are always increasing, so the posting lists remain sorted
+        uint32_t id = m_files.size();
+        m_files.push_back(entry);
+        m_ids[file] = id;
+        for (uint32_t trigram : trigrams) {
+            m_postings[trigram].push_back(id);
+        }
+        m_dirty = true;
+        ++count;
+    }
+
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    DoCompactIfNeeded();
+    clDEBUG() << "Trigram index: indexed" << count << "files in" << sw.Time() << "ms." << m_ids.size()
+              << "files in the index" << endl;
+}
+
+void clTrigramIndex::DoRemoveFiles(const wxArrayString& files)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    for (const wxString& file : files) {
+        auto iter = m_ids.find(file);
+        if (iter == m_ids.end()) {
+            continue;
+        }
+        m_files[iter->second].deleted = true;
+        ++m_deletedCount;
+        m_ids.erase(iter);
+        m_dirty = true;
+    }
+    DoCompactIfNeeded();
+}
+
+void clTrigramIndex::DoCompactIfNeeded()
+{
+    if (m_deletedCount >= COMPACT_THRESHOLD && m_deletedCount * 2 >= m_files.size()) {
+        DoCompact();
+    }
+}
+
+void clTrigramIndex::DoCompact()
+{
+    if (m_deletedCount == 0) {
+        return;
+    }
+
+    // renumber the live files, keeping their relative order so the posting lists remain sorted
+    constexpr uint32_t INVALID_ID = (uint32_t)-1;
+    std::vector<uint32_t> new_ids(m_files.size(), INVALID_ID);
+    std::vector<FileEntry> files;
+    files.reserve(m_files.size() - m_deletedCount);
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        if (m_files[i].deleted) {
+            continue;
+        }
+        new_ids[i] = files.size();
+        files.push_back(std::move(m_files[i]));
+    }
+
+    for (auto iter = m_postings.begin(); iter != m_postings.end();) {
+        std::vector<uint32_t>& ids = iter->second;
+        size_t count = 0;
+        for (uint32_t id : ids) {
+            if (new_ids[id] != INVALID_ID) {
+                ids[count++] = new_ids[id];
+            }
+        }
+        if (count == 0) {
+            iter = m_postings.erase(iter);
+        } else {
+            ids.resize(count);
+            ids.shrink_to_fit();
+            ++iter;
+        }
+    }
+
+    m_files.swap(files);
+    m_ids.clear();
+    m_ids.reserve(m_files.size());
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        m_ids.insert({ m_files[i].path, (uint32_t)i });
+    }
+    m_deletedCount = 0;
+}
+
+bool clTrigramIndex::DoLoad(const wxString& filepath)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    DoClear();
+    m_filepath = filepath;
+
+    std::string buffer;
+    if (!wxFileName::FileExists(filepath) || !FileUtils::ReadFileContentRaw(filepath, buffer)) {
+        return false;
+    }
+
+    if (buffer.compare(0, INDEX_MAGIC_LEN, INDEX_MAGIC) != 0) {
+        clWARNING() << "Trigram index:" << filepath << "has an unknown format. Ignoring it" << endl;
+        return false;
+    }
+
+    size_t offset = INDEX_MAGIC_LEN;
+    uint64_t files_count = 0;
+    bool ok = read_varint(buffer, offset, &files_count);
+    for (uint64_t i = 0; ok && i < files_count; ++i) {
+        uint64_t len = 0, mtime = 0, size = 0;
+        ok = read_varint(buffer, offset, &len) && (offset + len + 1 <= buffer.size());
+        if (!ok) {
+            break;
+        }
+
+        FileEntry entry;
+        entry.path = wxString::FromUTF8(buffer.data() + offset, len);
+        offset += len;
+        char flags = buffer[offset++];
+        entry.always_search = (flags & FILE_FLAG_ALWAYS_SEARCH) != 0;
+        entry.deleted = (flags & FILE_FLAG_DELETED) != 0;
+        ok = read_varint(buffer, offset, &mtime) && read_varint(buffer, offset, &size);
+        entry.mtime = static_cast<int64_t>(mtime);
+        entry.size = static_cast<size_t>(size);
+        if (entry.deleted) {
+            // kept until the next compaction: the posting lists still refer to it
+            ++m_deletedCount;
+        } else {
+            m_ids.insert({ entry.path, (uint32_t)m_files.size() });
+        }
+        m_files.push_back(std::move(entry));
+    }
+
+    uint64_t postings_count = 0;
+    ok = ok && read_varint(buffer, offset, &postings_count);
+    for (uint64_t i = 0; ok && i < postings_count; ++i) {
+        uint64_t trigram = 0, count = 0;
+        ok = read_varint(buffer, offset, &trigram) && read_varint(buffer, offset, &count) && count <= m_files.size();
+        if (!ok) {
+            break;
+        }
+
+        std::vector<uint32_t>& ids = m_postings[(uint32_t)trigram];
+        ids.reserve(count);
+        uint64_t id = 0;
+        for (uint64_t j = 0; ok && j < count; ++j) {
+            uint64_t delta = 0;
+            ok = read_varint(buffer, offset, &delta);
+            id += delta;
+            ok = ok && id < m_files.size();
+            ids.push_back((uint32_t)id);
+        }
+    }
+
+    if (!ok) {
+        clWARNING() << "Trigram index:" << filepath << "is corrupted. Ignoring it" << endl;
+        DoClear();
+        return false;
+    }
+    clDEBUG() << "Trigram index: loaded" << m_files.size() << "files from" << filepath << endl;
+    return true;
+}
+
+bool clTrigramIndex::DoSave()
+{
+    std::string buffer;
+    wxFileName fn;
+    {
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        if (!m_dirty || m_filepath.empty()) {
+            return true;
+        }
+
+        buffer.append(INDEX_MAGIC, INDEX_MAGIC_LEN);
+        write_varint(buffer, m_files.size());
+        for (const FileEntry& entry : m_files) {
+            const wxScopedCharBuffer path = entry.path.ToUTF8();
+            write_varint(buffer, path.length());
+            buffer.append(path.data(), path.length());
+            char flags = 0;
+            if (entry.always_search) {
+                flags |= FILE_FLAG_ALWAYS_SEARCH;
+            }
+            if (entry.deleted) {
+                flags |= FILE_FLAG_DELETED;
+            }
+            buffer.push_back(flags);
+            write_varint(buffer, static_cast<uint64_t>(entry.mtime));
+            write_varint(buffer, entry.size);
+        }
+
+        write_varint(buffer, m_postings.size());
+        for (const auto& [trigram, ids] : m_postings) {
+            write_varint(buffer, trigram);
+            write_varint(buffer, ids.size());
+            uint32_t prev = 0;
+            for (uint32_t id : ids) {
+                write_varint(buffer, id - prev);
+                prev = id;
+            }
+        }
+        m_dirty = false;
+        fn = wxFileName(m_filepath);
+    }
+
+    fn.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    if (!FileUtils::WriteFileContentRaw(fn, buffer)) {
+        clWARNING() << "Trigram index: failed to write" << fn.GetFullPath() << endl;
+        return false;
+    }
+    return true;
+}
+
+bool clTrigramIndex::Filter(wxArrayString& files, const std::vector<wxString>& literals, bool case_sensitive) const
+{
+    // collect the trigrams that every matching file must contain
+    std::vector<uint32_t> required;
+    std::vector<uint32_t> trigrams;
+    for (const wxString& literal : literals) {
+        std::vector<std::string> parts;
+        if (case_sensitive) {
+            parts.push_back(literal.ToStdString(wxConvUTF8));
+        } else {
+            // only ASCII letters are folded in the index
+            std::string part;
+            for (wxChar ch : literal) {
+                if (ch < 0x80) {
+                    part.push_back(static_cast<char>(ch));
+                } else {
+                    parts.push_back(part);
+                    part.clear();
+                }
+            }
+            parts.push_back(part);
+        }
+
+        for (const std::string& part : parts) {
+            GetTrigrams(part.data(), part.length(), trigrams);
+            required.insert(required.end(), trigrams.begin(), trigrams.end());
+        }
+    }
+
+    if (required.empty()) {
+        return false;
+    }
+    std::sort(required.begin(), required.end());
+    required.erase(std::unique(required.begin(), required.end()), required.end());
+
+    struct PruneCandidate {
+        size_t index;
+        int64_t mtime;
+        size_t size;
+    };
+    std::vector<PruneCandidate> prune_candidates;
+    {
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        if (m_filepath.empty() || m_ids.empty()) {
+            return false;
+        }
+
+        // intersect the posting lists, shortest first
+        std::vector<const std::vector<uint32_t>*> lists;
+        lists.reserve(required.size());
+        for (uint32_t trigram : required) {
+            auto iter = m_postings.find(trigram);
+            if (iter == m_postings.end()) {
+                // no indexed file has this trigram
+                lists.clear();
+                break;
+            }
+            lists.push_back(&iter->second);
+        }
+
+        std::vector<uint32_t> matches;
+        if (!lists.empty()) {
+            std::sort(lists.begin(), lists.end(),
+                      [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) { return a->size() < b->size(); });
+            matches = *lists[0];
+            std::vector<uint32_t> tmp;
+            for (size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+                tmp.clear();
+                std::set_intersection(matches.begin(), matches.end(), lists[i]->begin(), lists[i]->end(),
+                                      std::back_inserter(tmp));
+                matches.swap(tmp);
+            }
+        }
+
+        for (size_t i = 0; i < files.size(); ++i) {
+            auto iter = m_ids.find(files.Item(i));
+            if (iter == m_ids.end()) {
+                continue;
+            }
+            const FileEntry& entry = m_files[iter->second];
+            if (entry.always_search || std::binary_search(matches.begin(), matches.end(), iter->second)) {
+                continue;
+            }
+            prune_candidates.push_back({ i, entry.mtime, entry.size });
+        }
+    }
+
+    // only prune files that did not change since they were indexed
+    std::vector<bool> prune(files.size(), false);
+    size_t pruned_count = 0;
+    for (const PruneCandidate& candidate : prune_candidates) {
+        int64_t mtime = 0;
+        size_t size = 0;
+        if (candidate.mtime != 0 && stat_file(files.Item(candidate.index), &mtime, &size) &&
+            mtime == candidate.mtime && size == candidate.size) {
+            prune[candidate.index] = true;
+            ++pruned_count;
+        }
+    }
+
+    if (pruned_count) {
+        wxArrayString kept;
+        kept.reserve(files.size() - pruned_count);
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (!prune[i]) {
+                kept.Add(files.Item(i));
+            }
+        }
+        files.swap(kept);
+    }
+    clDEBUG() << "Trigram index: skipping" << pruned_count << "files," << files.size() << "files left to scan"
+              << endl;
+    return true;
+}
+
+std::vector<wxString> clTrigramIndex::GetRegexLiterals(const wxString& re)
+{
+    // "***=" prefix: the rest of the expression is a literal string
+    if (re.StartsWith("***=")) {
+        return { re.Mid(4) };
+    }
+
+    std::vector<wxString> literals;
+    wxString current;
+    auto flush = [&]() {
+        if (current.length() >= 3) {
+            literals.push_back(current);
+        }
+        current.clear();
+    };
+
+    size_t i = re.StartsWith("***:") ? 4 : 0;
+    int depth = 0;
+    while (i < re.length()) {
+        wxChar ch = re[i];
+        switch (ch) {
+        case '\\': {
+            if (i + 1 >= re.length()) {
+                return literals;
+            }
+            wxChar next = re[i + 1];
+            i += 2;
+            if (!wxIsalnum(next)) {
+                // an escaped literal
+                if (depth == 0) {
+                    current << next;
+                }
+            } else {
+                // class escape, back reference or a character code: skip any trailing digits
+                flush();
+                while (i < re.length() && wxIsxdigit(re[i]) && (next == 'x' || next == 'u' || next == 'U' ||
+                                                                wxIsdigit(next))) {
+                    ++i;
+                }
+            }
+            continue;
+        }
+        case '[': {
+            // skip the bracket expression, a leading ']' is part of it
+            flush();
+            ++i;
+            if (i < re.length() && re[i] == '^') {
+                ++i;
+            }
+            if (i < re.length() && re[i] == ']') {
+                ++i;
+            }
+            while (i < re.length() && re[i] != ']') {
+                wxChar next = (i + 1 < re.length()) ? re[i + 1] : 0;
+                if (re[i] == '[' && (next == ':' || next == '=' || next == '.')) {
+                    // a character class, an equivalence class or a collating element: skip to its
+                    // closing ":]", "=]" or ".]", which may contain a ']'
+                    size_t close = re.find(wxString() << next << ']', i + 2);
+                    if (close == wxString::npos) {
+                        return {};
+                    }
+                    i = close + 2;
+                } else {
+                    i += (re[i] == '\\') ? 2 : 1;
+                }
+            }
+            if (i >= re.length()) {
+                // unterminated bracket expression
+                return {};
+            }
+            ++i;
+            continue;
+        }
+        case '(':
+            flush();
+            ++depth;
+            break;
+        case ')':
+            flush();
+            --depth;
+            break;
+        case '|':
+            if (depth == 0) {
+                // a match needs only one of the branches
+                return {};
+            }
+            break;
+        case '*':
+        case '?':
+        case '{':
+            // the previous character is optional
+            if (!current.empty()) {
+                current.RemoveLast();
+            }
+            flush();
+            if (ch == '{') {
+                while (i < re.length() && re[i] != '}') {
+                    ++i;
+                }
+            }
+            break;
+        case '+':
+        case '.':
+        case '^':
+        case '$':
+            flush();
+            break;
+        default:
+            if (depth == 0) {
+                current << ch;
+            }
+            break;
+        }
+        ++i;
+    }
+    flush();
+    return literals;
+}
@@ -0,0 +1,123 @@
+#ifndef CLTRIGRAMINDEX_HPP
+#define CLTRIGRAMINDEX_HPP
+
+#include "codelite_exports.h"
+#include "wxStringHash.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <wx/arrstr.h>
+#include <wx/string.h>
+
+class clTrigramIndexThread;
+
+/**
+ * @brief an on-disk index of the trigrams (3 byte sequences) found in a set of files
+ *
+ * The index is used by the find-in-files to skip files that can not contain the searched
+ * string without opening them. Trigrams are computed over the raw file bytes, with ASCII letters
+ * folded to lower case, so a single index serves both case sensitive and insensitive searches.
+ *
+ * Each indexed file keeps its modification time and size: a file that changed since it was indexed,
+ * or that was never indexed, is never filtered out. So a stale index only costs speed, not matches.
+ *
+ * Indexing is done by a background thread, all the public methods are thread safe
+ */
+class WXDLLIMPEXP_CL clTrigramIndex
+{
+public:
+    struct FileEntry {
+        wxString path;
+        // modification time, in nanoseconds. 0 when the file was indexed too close to its last modification for the
+        // time stamp to tell a later edit apart: such an entry is never trusted
+        int64_t mtime = 0;
+        size_t size = 0;
+        // the file was too big to be indexed, always search it
+        bool always_search = false;
+        bool deleted = false;
+    };
+
+private:
+    mutable std::mutex m_mutex;
+    wxString m_filepath;
+    std::vector<FileEntry> m_files;
+    std::unordered_map<wxString, uint32_t> m_ids;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_postings;
+    size_t m_deletedCount = 0;
+    bool m_dirty = false;
+    clTrigramIndexThread* m_thread = nullptr;
+    std::atomic_bool m_shutdown{ false };
+
+    friend class clTrigramIndexThread;
+
+protected:
+    void DoClear();
+    void DoCompact();
+    void DoCompactIfNeeded();
+    void DoIndexFiles(const wxArrayString& files);
+    void DoRemoveFiles(const wxArrayString& files);
+    bool DoLoad(const wxString& filepath);
+    bool DoSave();
+    bool IsShutdown() const { return m_shutdown.load(); }
+
+public:
+    clTrigramIndex();
+    ~clTrigramIndex();
+
+    static clTrigramIndex& Get();
+
+    /**
+     * @brief open the index stored in `filepath` (the file is created on the first save)
+     * and start the background indexer thread
+     */
+    void Open(const wxString& filepath);
+
+    /**
+     * @brief stop the indexer thread, save the index and clear it
+     */
+    void Close();
+
+    /**
+     * @brief is the index opened?
+     */
+    bool IsOpened() const;
+
+    /**
+     * @brief queue `files` for indexing. Files that did not change since they were indexed are skipped
+     */
+    void IndexFilesAsync(const wxArrayString& files);
+
+    /**
+     * @brief queue `files` for removal from the index
+     */
+    void RemoveFilesAsync(const wxArrayString& files);
+
+    /**
+     * @brief keep only the entries of `files` that may contain all of `literals`
+     * Files that are not indexed or that were modified since they were indexed are always kept
+     * @param case_sensitive when false, non ASCII characters in `literals` are ignored
+     * @return true if the index was used to filter the list
+     */
+    bool Filter(wxArrayString& files, const std::vector<wxString>& literals, bool case_sensitive) const;
+
+    /**
+     * @brief return the literal strings that every match of the regular expression `re` must contain
+     * This is a conservative extraction, an empty list means "no constraints"
+     */
+    static std::vector<wxString> GetRegexLiterals(const wxString& re);
+
+    /**
+     * @brief compute the sorted list of unique trigrams found in `content`
+     */
+    static void GetTrigrams(const char* content, size_t len, std::vector<uint32_t>& trigrams);
+
+    /**
+     * @brief return the number of files known to the index
+     */
+    size_t GetFilesCount() const;
+};
+
+#endif // CLTRIGRAMINDEX_HPP
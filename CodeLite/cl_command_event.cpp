@@ -25,6 +25,8 @@
 
 #include "cl_command_event.h"
 
+#include "StringUtils.h"
+
 clCommandEvent::clCommandEvent(wxEventType commandType, int winid)
     : wxCommandEvent(commandType, winid)
 {
@@ -170,6 +172,15 @@ clProcessEvent::clProcessEvent(wxEventType commandType, int winid)
 {
 }
 
+const wxString& clProcessEvent::GetOutput() const
+{
+    if(m_decodeOutput) {
+        m_output = StringUtils::FromStdString(GetStringRaw());
+        m_decodeOutput = false;
+    }
+    return m_output;
+}
+
 // --------------------------------------------------------------
 // Compiler event
 // --------------------------------------------------------------
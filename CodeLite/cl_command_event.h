@@ -616,7 +616,8 @@ using clGotoEventFunction = void (wxEvtHandler::*)(clGotoEvent&);
 class IProcess;
 class WXDLLIMPEXP_CL clProcessEvent : public clCommandEvent
 {
-    wxString m_output;
+    mutable wxString m_output;
+    mutable bool m_decodeOutput = false;
     IProcess* m_process = nullptr;
 
 public:
@@ -626,10 +627,24 @@ public:
     ~clProcessEvent() override = default;
     wxEvent* Clone() const override { return new clProcessEvent(*this); }
 
-    void SetOutput(const wxString& output) { this->m_output = output; }
+    void SetOutput(const wxString& output)
+    {
+        this->m_output = output;
+        this->m_decodeOutput = false;
+    }
     void SetProcess(IProcess* process) { this->m_process = process; }
-    const wxString& GetOutput() const { return m_output; }
+    const wxString& GetOutput() const;
     void SetOutputRaw(const std::string& output) { SetStringRaw(output); }
+    /**
+     * @brief set the raw output only. It is converted into wxString (GetOutput()) on first access, so
+     * handlers that only need the raw bytes never pay for the conversion
+     */
+    void SetOutputRawOnly(const std::string& output)
+    {
+        SetStringRaw(output);
+        this->m_output.clear();
+        this->m_decodeOutput = true;
+    }
     const std::string& GetOutputRaw() const { return GetStringRaw(); }
     IProcess* GetProcess() { return m_process; }
 };
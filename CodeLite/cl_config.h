@@ -97,6 +97,8 @@ public:
 #define kConfigTabsPaneSortAlphabetically "TabsPaneSortAlphabetically"
 #define kConfigFileExplorerBookmarks "FileExplorerBookmarks"
 #define kRealPathResolveSymlinks "RealPathResolveSymlinks"
+#define kConfigFindInFilesUseIndex "FindInFilesUseIndex"
+#define kConfigFindInFilesMaxResults "FindInFilesMaxResults"
 
 class WXDLLIMPEXP_CL clConfig
 {
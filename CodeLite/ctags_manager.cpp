@@ -33,12 +33,16 @@
 #include "codelite_events.h"
 #include "database/tags_storage_sqlite3.h"
 #include "event_notifier.h"
+#include "file_logger.h"
 #include "fileextmanager.h"
+#include "fileutils.h"
 #include "precompiled_header.h"
 
 #include <algorithm>
+#include <atomic>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <wx/app.h>
 #include <wx/busyinfo.h>
 #include <wx/file.h>
@@ -513,6 +517,48 @@ wxString TagsManager::DoReplaceMacros(const wxString& name)
     return _name;
 }
 
+namespace
+{
+// files are handed to the worker threads in chunks of this size
+constexpr size_t FILES_CHUNK_SIZE = 64;
+
+/// call `func(i)` for every i in [0, count) using all the available cores
+template <typename Func> void parallel_for(size_t count, Func func)
+{
+    size_t num_workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          (count + FILES_CHUNK_SIZE - 1) / FILES_CHUNK_SIZE);
+    if(num_workers <= 1) {
+        for(size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic_size_t next{ 0 };
+    auto worker = [&]() {
+        while(true) {
+            size_t first = next.fetch_add(FILES_CHUNK_SIZE);
+            if(first >= count) {
+                break;
+            }
+            size_t last = std::min(first + FILES_CHUNK_SIZE, count);
+            for(size_t i = first; i < last; ++i) {
+                func(i);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers);
+    for(size_t i = 0; i < num_workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    for(auto& thr : threads) {
+        thr.join();
+    }
+}
+} // namespace
+
 void TagsManager::FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITagsStoragePtr db)
 {
     std::vector<FileEntryPtr> files_entries;
@@ -523,27 +569,67 @@ void TagsManager::FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITags
         files_set.insert(strFiles.Item(i));
     }
 
-    for(size_t i = 0; i < files_entries.size(); i++) {
-        const FileEntryPtr& fe = files_entries.at(i);
+    // the files that exist in both lists
+    std::vector<const FileEntry*> candidates;
+    candidates.reserve(files_entries.size());
+    for(const FileEntryPtr& fe : files_entries) {
+        if(files_set.count(fe->GetFile())) {
+            candidates.push_back(fe.get());
+        }
+    }
 
-        // does the file exist in both lists?
-        std::unordered_set<wxString>::iterator iter = files_set.find(fe->GetFile());
-        if(iter != files_set.end()) {
-            // get the actual modification time of the file from the disk
-            struct stat buff;
-            int modified(0);
+    enum eFileState : char {
+        kUnchanged,         // the file was not modified since it was tagged
+        kSameContent,       // the file was touched, but its content did not change
+        kModified,          // re-tag the file
+    };
+
+    // stat (and if needed, hash) the files in parallel
+    std::vector<eFileState> states(candidates.size(), kModified);
+    parallel_for(candidates.size(), [&](size_t i) {
+        const FileEntry* fe = candidates[i];
+        // get the actual modification time and size of the file from the disk
+        struct stat buff;
+        const wxCharBuffer cname = _C(fe->GetFile());
+        if(stat(cname.data(), &buff) != 0) {
+            // can't tell, keep the previous behavior: do not re-tag it
+            states[i] = kUnchanged;
+            return;
+        }
 
-            const wxCharBuffer cname = _C((*iter));
-            if(stat(cname.data(), &buff) == 0) {
-                modified = (int)buff.st_mtime;
-            }
+        long long size = (long long)buff.st_size;
+        bool same_size = fe->GetSize() < 0 || fe->GetSize() == size;
+        if(same_size && fe->GetLastRetaggedTimestamp() >= (int)buff.st_mtime) {
+            states[i] = kUnchanged;
+            return;
+        }
 
-            // if the timestamp from the database < then the actual timestamp, re-tag the file
-            if(fe->GetLastRetaggedTimestamp() >= modified) {
-                files_set.erase(iter);
-            }
+        // the file was touched (e.g. by a branch switch) - compare the content hash
+        if(fe->GetContentHash() == 0 || fe->GetSize() != size) {
+            return;
+        }
+        uint64_t hash = 0;
+        if(FileUtils::GetContentHash(fe->GetFile(), &hash) && hash == fe->GetContentHash()) {
+            states[i] = kSameContent;
+        }
+    });
+
+    // the content did not change: update the timestamp so the next check will not need to hash these files
+    size_t same_content_count = 0;
+    time_t update_time = time(nullptr);
+    db->Begin();
+    for(size_t i = 0; i < candidates.size(); ++i) {
+        if(states[i] == kModified) {
+            continue;
+        }
+        files_set.erase(candidates[i]->GetFile());
+        if(states[i] == kSameContent) {
+            db->UpdateFileEntry(candidates[i]->GetFile(), (int)update_time);
+            ++same_content_count;
         }
     }
+    db->Commit();
+    clDEBUG() << same_content_count << "files were modified without changing their content" << endl;
 
     // copy back the files to the array
     strFiles.Clear();
@@ -553,6 +639,32 @@ void TagsManager::FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITags
     }
 }
 
+void TagsManager::MarkFilesParsed(const std::vector<wxString>& files, ITagsStoragePtr db)
+{
+    struct FileInfo {
+        uint64_t hash = 0;
+        long long size = -1;
+    };
+
+    std::vector<FileInfo> infos(files.size());
+    parallel_for(files.size(), [&](size_t i) {
+        size_t size = 0;
+        if(FileUtils::GetContentHash(files[i], &infos[i].hash, &size)) {
+            infos[i].size = (long long)size;
+        }
+    });
+
+    // update the files table in the database
+    // we do this here, since some files might not yield tags
+    // but we still want to mark them as "parsed"
+    time_t update_time = time(nullptr);
+    db->Begin();
+    for(size_t i = 0; i < files.size(); ++i) {
+        db->InsertFileEntry(files[i], (int)update_time, infos[i].size, infos[i].hash);
+    }
+    db->Commit();
+}
+
 void TagsManager::GetDereferenceOperator(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
     std::vector<std::pair<wxString, int>> derivationList;
@@ -312,6 +312,12 @@ public:
      */
     void FilterNonNeededFilesForRetaging(wxArrayString& strFiles, ITagsStoragePtr db);
 
+    /**
+     * @brief update the files table after `files` were tagged: store their timestamp, size and content hash
+     * (used by FilterNonNeededFilesForRetaging() to skip files that were touched without being modified)
+     */
+    void MarkFilesParsed(const std::vector<wxString>& files, ITagsStoragePtr db);
+
     /**
      * @brief insert functionBody into clsname. This function will search for best location
      * to place the function body. set visibility to 0 for 'public' function, 1 for 'protected' and 2 for private
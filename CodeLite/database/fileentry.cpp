@@ -30,6 +30,8 @@ FileEntry::FileEntry()
 		: m_id                   (wxNOT_FOUND)
 		, m_file                 (wxEmptyString)
 		, m_lastRetaggedTimestamp((int)time(NULL))
+		, m_size                 (-1)
+		, m_contentHash          (0)
 {
 }
 
@@ -26,6 +26,7 @@
 #ifndef __fileentry__
 #define __fileentry__
 
+#include <cstdint>
 #include <memory>
 #include <wx/string.h>
 
@@ -34,6 +35,8 @@ class FileEntry
 	long      m_id;
 	wxString  m_file;
 	int       m_lastRetaggedTimestamp;
+	long long m_size;        ///< size of the file when it was tagged, -1 if unknown
+	uint64_t  m_contentHash; ///< hash of the file content when it was tagged, 0 if unknown
 
 public:
 	FileEntry();
@@ -50,6 +53,10 @@ public:
 	int GetLastRetaggedTimestamp() const { return m_lastRetaggedTimestamp; }
 	void SetId(long id) { this->m_id = id; }
 	long GetId() const { return m_id; }
+	void SetSize(long long size) { this->m_size = size; }
+	long long GetSize() const { return m_size; }
+	void SetContentHash(uint64_t contentHash) { this->m_contentHash = contentHash; }
+	uint64_t GetContentHash() const { return m_contentHash; }
 };
 using FileEntryPtr = std::unique_ptr<FileEntry>;
 
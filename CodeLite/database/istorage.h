@@ -74,6 +74,21 @@ public:
      */
     virtual void ClearCache() = 0;
 
+    /**
+     * @brief clear the cached lookups that are affected by a change in `files`.
+     * By default, the entire cache is cleared
+     */
+    virtual void ClearCache(const wxStringSet_t& files)
+    {
+        wxUnusedVar(files);
+        ClearCache();
+    }
+
+    /**
+     * @brief return the cache counters (hits, misses etc), for logging purposes
+     */
+    virtual wxString GetCacheStatistics() const { return wxEmptyString; }
+
     /**
      * Return the currently opened database.
      * @return Currently open database
@@ -205,9 +220,12 @@ public:
     /**
      * @brief insert entry by file name
      * @param filename
+     * @param size the file size, -1 if unknown
+     * @param contentHash the file content hash (see FileUtils::GetContentHash), 0 if unknown
      * @return
      */
-    virtual int InsertFileEntry(const wxString& filename, int timestamp) = 0;
+    virtual int InsertFileEntry(const wxString& filename, int timestamp, long long size = -1,
+                                uint64_t contentHash = 0) = 0;
 
     /**
      * @brief update file entry using file name as key
@@ -0,0 +1,586 @@
+#include "tags_storage_memory_index.h"
+
+#include "file_logger.h"
+#include "tags_storage_sqlite3.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <wx/filename.h>
+
+namespace
+{
+// the new names are merged into the main (sorted) array once there are more than this, or more than a quarter
+// of the main array
+constexpr size_t NAMES_DELTA_MIN_SIZE = 16 * 1024;
+// the deleted rows are dropped once there are more than this, and more than a quarter of the live rows
+constexpr size_t COMPACT_MIN_DELETED = 64 * 1024;
+} // namespace
+
+TagsStorageMemoryIndex::TagsStorageMemoryIndex() { DoClear(); }
+
+TagsStorageMemoryIndex::~TagsStorageMemoryIndex() {}
+
+void TagsStorageMemoryIndex::DoClear()
+{
+    m_strings.clear();
+    m_stringIds.clear();
+    for(auto& column : m_columns) {
+        column.clear();
+    }
+    m_lines.clear();
+    m_deleted.clear();
+    m_deletedCount = 0;
+    m_names.clear();
+    m_namesDelta.clear();
+    m_children.clear();
+    m_paths.clear();
+    m_files.clear();
+
+    // string id 0 is the empty string
+    DoIntern(wxEmptyString);
+}
+
+uint32_t TagsStorageMemoryIndex::DoIntern(const wxString& str)
+{
+    auto where = m_stringIds.insert({ str, static_cast<uint32_t>(m_strings.size()) });
+    if(where.second) {
+        m_strings.push_back(str);
+    }
+    return where.first->second;
+}
+
+bool TagsStorageMemoryIndex::DoFindString(const wxString& str, uint32_t* id) const
+{
+    auto iter = m_stringIds.find(str);
+    if(iter == m_stringIds.end()) {
+        return false;
+    }
+    *id = iter->second;
+    return true;
+}
+
+uint32_t TagsStorageMemoryIndex::DoAddRow(const RowValues& values, int line)
+{
+    uint32_t row = static_cast<uint32_t>(m_lines.size());
+    for(size_t col = 0; col < values.size(); ++col) {
+        m_columns[col].push_back(DoIntern(values[col]));
+    }
+    m_columns[COL_NAME_LOWER].push_back(DoIntern(values[COL_NAME].Lower()));
+    m_lines.push_back(line);
+    m_deleted.push_back(0);
+    return row;
+}
+
+void TagsStorageMemoryIndex::DoDeleteRow(uint32_t row)
+{
+    if(!m_deleted[row]) {
+        m_deleted[row] = 1;
+        ++m_deletedCount;
+    }
+}
+
+void TagsStorageMemoryIndex::DoDeleteFile(const wxString& file)
+{
+    uint32_t file_id = 0;
+    if(!DoFindString(file, &file_id)) {
+        return;
+    }
+
+    auto iter = m_files.find(file_id);
+    if(iter == m_files.end()) {
+        return;
+    }
+
+    // the rows remain in the other indexes until the next compaction, the lookups skip them
+    for(uint32_t row : iter->second) {
+        DoDeleteRow(row);
+    }
+    m_files.erase(iter);
+}
+
+bool TagsStorageMemoryIndex::DoIsNameLess(uint32_t a, uint32_t b) const
+{
+    uint32_t name_a = m_columns[COL_NAME_LOWER][a];
+    uint32_t name_b = m_columns[COL_NAME_LOWER][b];
+    if(name_a != name_b) {
+        int cmp = m_strings[name_a].compare(m_strings[name_b]);
+        if(cmp != 0) {
+            return cmp < 0;
+        }
+    }
+    return a < b;
+}
+
+void TagsStorageMemoryIndex::DoSortByName(Rows& rows) const
+{
+    std::sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b) { return DoIsNameLess(a, b); });
+}
+
+void TagsStorageMemoryIndex::DoMergeByName(Rows& rows, const Rows& sorted_rows) const
+{
+    size_t middle = rows.size();
+    rows.insert(rows.end(), sorted_rows.begin(), sorted_rows.end());
+    std::inplace_merge(rows.begin(), rows.begin() + middle, rows.end(),
+                       [this](uint32_t a, uint32_t b) { return DoIsNameLess(a, b); });
+}
+
+void TagsStorageMemoryIndex::DoIndexRows(Rows& rows)
+{
+    // skip the rows that were replaced by a later row of the same batch
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [this](uint32_t row) { return m_deleted[row] != 0; }),
+               rows.end());
+    if(rows.empty()) {
+        return;
+    }
+
+    std::unordered_map<uint32_t, Rows> children;
+    for(uint32_t row : rows) {
+        m_files[m_columns[COL_FILE][row]].push_back(row);
+        m_paths[m_columns[COL_PATH][row]].push_back(row);
+        children[m_columns[COL_SCOPE][row]].push_back(row);
+    }
+
+    for(auto& vt : children) {
+        DoSortByName(vt.second);
+        DoMergeByName(m_children[vt.first], vt.second);
+    }
+
+    DoSortByName(rows);
+    DoMergeByName(m_namesDelta, rows);
+    if(m_namesDelta.size() > std::max(NAMES_DELTA_MIN_SIZE, m_names.size() / 4)) {
+        DoMergeByName(m_names, m_namesDelta);
+        m_namesDelta.clear();
+    }
+    DoCompactIfNeeded();
+}
+
+void TagsStorageMemoryIndex::DoRebuild()
+{
+    m_names.clear();
+    m_namesDelta.clear();
+    m_children.clear();
+    m_paths.clear();
+    m_files.clear();
+
+    m_names.reserve(m_lines.size() - m_deletedCount);
+    for(uint32_t row = 0; row < m_lines.size(); ++row) {
+        if(m_deleted[row]) {
+            continue;
+        }
+        m_names.push_back(row);
+        m_files[m_columns[COL_FILE][row]].push_back(row);
+        m_paths[m_columns[COL_PATH][row]].push_back(row);
+        m_children[m_columns[COL_SCOPE][row]].push_back(row);
+    }
+
+    DoSortByName(m_names);
+    for(auto& vt : m_children) {
+        DoSortByName(vt.second);
+    }
+}
+
+void TagsStorageMemoryIndex::DoCompactIfNeeded()
+{
+    size_t live_count = m_lines.size() - m_deletedCount;
+    if(m_deletedCount < COMPACT_MIN_DELETED || m_deletedCount < live_count / 4) {
+        return;
+    }
+
+    // copy the live rows, and the strings they use, into a fresh storage
+    std::vector<wxString> strings;
+    std::array<std::vector<uint32_t>, COL_COUNT> columns;
+    std::vector<int> lines;
+    std::vector<char> deleted;
+    strings.swap(m_strings);
+    columns.swap(m_columns);
+    lines.swap(m_lines);
+    deleted.swap(m_deleted);
+    DoClear();
+
+    for(auto& column : m_columns) {
+        column.reserve(live_count);
+    }
+    m_lines.reserve(live_count);
+    m_deleted.reserve(live_count);
+
+    for(size_t row = 0; row < lines.size(); ++row) {
+        if(deleted[row]) {
+            continue;
+        }
+        for(size_t col = 0; col < COL_COUNT; ++col) {
+            m_columns[col].push_back(DoIntern(strings[columns[col][row]]));
+        }
+        m_lines.push_back(lines[row]);
+        m_deleted.push_back(0);
+    }
+    DoRebuild();
+    clDEBUG() << "Tags index compacted:" << m_lines.size() << "tags," << m_strings.size() << "strings" << endl;
+}
+
+TagEntryPtr TagsStorageMemoryIndex::DoCreateTag(uint32_t row) const
+{
+    TagEntryPtr tag(new TagEntry());
+    tag->SetId(row + 1);
+    tag->SetName(DoGetString(row, COL_NAME));
+    tag->SetFile(DoGetString(row, COL_FILE));
+    tag->SetLine(m_lines[row]);
+    tag->SetKind(DoGetString(row, COL_KIND));
+    tag->SetAccess(DoGetString(row, COL_ACCESS));
+    tag->SetSignature(DoGetString(row, COL_SIGNATURE));
+    tag->SetPattern(DoGetString(row, COL_PATTERN));
+    tag->SetParent(DoGetString(row, COL_PARENT));
+    tag->SetInherits(DoGetString(row, COL_INHERITS));
+    tag->SetPath(DoGetString(row, COL_PATH));
+    tag->SetTypename(DoGetString(row, COL_TYPEREF));
+    tag->SetScope(DoGetString(row, COL_SCOPE));
+    tag->SetTemplateDefinition(DoGetString(row, COL_TEMPLATE_DEFINITION));
+    tag->SetTagProperties(DoGetString(row, COL_TAG_PROPERTIES));
+    tag->SetMacrodef(DoGetString(row, COL_MACRODEF));
+    return tag;
+}
+
+void TagsStorageMemoryIndex::DoCollectRows(const Rows& rows, const wxArrayString& kinds, size_t limit,
+                                           std::vector<TagEntryPtr>& tags) const
+{
+    std::unordered_set<uint32_t> kind_ids;
+    if(!kinds.empty()) {
+        DoGetKindIds(kinds, kind_ids);
+        if(kind_ids.empty()) {
+            return;
+        }
+    }
+
+    size_t count = 0;
+    for(uint32_t row : rows) {
+        if(m_deleted[row] || (!kinds.empty() && kind_ids.count(m_columns[COL_KIND][row]) == 0)) {
+            continue;
+        }
+
+        tags.push_back(DoCreateTag(row));
+        if(++count == limit) {
+            break;
+        }
+    }
+}
+
+void TagsStorageMemoryIndex::DoGetKindIds(const wxArrayString& kinds, std::unordered_set<uint32_t>& ids) const
+{
+    for(const wxString& kind : kinds) {
+        uint32_t id = 0;
+        if(DoFindString(kind, &id)) {
+            ids.insert(id);
+        }
+    }
+}
+
+size_t TagsStorageMemoryIndex::DoCollectNames(const Rows& rows, const wxString& name, bool partial,
+                                              bool case_insensitive, const std::unordered_set<uint32_t>* kinds,
+                                              size_t limit, std::vector<TagEntryPtr>& tags) const
+{
+    wxString lower_name = name.Lower();
+    auto iter = rows.begin();
+    if(!name.empty()) {
+        iter = std::lower_bound(rows.begin(), rows.end(), lower_name, [this](uint32_t row, const wxString& key) {
+            return DoGetString(row, COL_NAME_LOWER).compare(key) < 0;
+        });
+    }
+
+    size_t count = 0;
+    for(; iter != rows.end(); ++iter) {
+        uint32_t row = *iter;
+        if(!name.empty()) {
+            // the rows are sorted by their lower case name: stop at the first one that does not match
+            const wxString& row_lower_name = DoGetString(row, COL_NAME_LOWER);
+            if(partial) {
+                if(!row_lower_name.StartsWith(lower_name)) {
+                    break;
+                }
+                if(!case_insensitive && !DoGetString(row, COL_NAME).StartsWith(name)) {
+                    continue;
+                }
+            } else {
+                if(row_lower_name != lower_name) {
+                    break;
+                }
+                if(DoGetString(row, COL_NAME) != name) {
+                    continue;
+                }
+            }
+        }
+
+        if(m_deleted[row] || (kinds && kinds->count(m_columns[COL_KIND][row]) == 0)) {
+            continue;
+        }
+
+        tags.push_back(DoCreateTag(row));
+        if(++count == limit) {
+            break;
+        }
+    }
+    return count;
+}
+
+void TagsStorageMemoryIndex::Load(TagsStorageSQLite* db)
+{
+    std::unique_lock<std::shared_mutex> lk{ m_mutex };
+    DoClear();
+
+    try {
+        wxSQLite3ResultSet rs = db->Query("select * from tags order by ID");
+        RowValues values;
+        while(rs.NextRow()) {
+            values[COL_NAME] = rs.GetString(1);
+            values[COL_FILE] = rs.GetString(2);
+            values[COL_KIND] = rs.GetString(4);
+            values[COL_ACCESS] = rs.GetString(5);
+            values[COL_SIGNATURE] = rs.GetString(6);
+            values[COL_PATTERN] = rs.GetString(7);
+            values[COL_PARENT] = rs.GetString(8);
+            values[COL_INHERITS] = rs.GetString(9);
+            values[COL_PATH] = rs.GetString(10);
+            values[COL_TYPEREF] = rs.GetString(11);
+            values[COL_SCOPE] = rs.GetString(12);
+            values[COL_TEMPLATE_DEFINITION] = rs.GetString(13);
+            values[COL_TAG_PROPERTIES] = rs.GetString(14);
+            values[COL_MACRODEF] = rs.GetString(15);
+            DoAddRow(values, rs.GetInt(3));
+        }
+    } catch (const wxSQLite3Exception& e) {
+        clWARNING() << "Failed to load the tags index." << e.GetMessage() << endl;
+    }
+
+    DoRebuild();
+    clDEBUG() << "Tags index loaded:" << m_lines.size() << "tags," << m_strings.size() << "strings" << endl;
+}
+
+void TagsStorageMemoryIndex::Store(const std::vector<TagEntryPtr>& tags)
+{
+    std::unique_lock<std::shared_mutex> lk{ m_mutex };
+
+    // the batch replaces the tags of its files
+    wxStringSet_t files;
+    for(const auto& tag : tags) {
+        files.insert(tag->GetFile());
+    }
+    for(const wxString& file : files) {
+        DoDeleteFile(file);
+    }
+
+    // the TAGS table has a unique index on these columns: a tag replaces the previous one with the same values
+    std::map<std::array<uint32_t, 6>, uint32_t> unique_rows;
+    Rows rows;
+    rows.reserve(tags.size());
+
+    RowValues values;
+    for(const auto& tag : tags) {
+        // we dont store local variables
+        if(!tag->IsOk() || tag->IsLocalVariable()) {
+            continue;
+        }
+
+        values[COL_NAME] = tag->GetName();
+        values[COL_FILE] = wxFileName(tag->GetFile()).GetFullPath();
+        values[COL_KIND] = tag->GetKind();
+        values[COL_ACCESS] = tag->GetAccess();
+        values[COL_SIGNATURE] = tag->GetSignature();
+        values[COL_PATTERN] = tag->GetPattern();
+        values[COL_PARENT] = tag->GetParent();
+        values[COL_INHERITS] = tag->GetInheritsAsString();
+        values[COL_PATH] = tag->GetPath();
+        values[COL_TYPEREF] = tag->GetTypename();
+        values[COL_SCOPE] = tag->GetScope();
+        values[COL_TEMPLATE_DEFINITION] = tag->GetTemplateDefinition();
+        values[COL_TAG_PROPERTIES] = tag->GetTagProperties();
+        values[COL_MACRODEF] = tag->GetMacrodef();
+        uint32_t row = DoAddRow(values, tag->GetLine());
+
+        std::array<uint32_t, 6> key;
+        key[0] = m_columns[COL_FILE][row];
+        key[1] = m_columns[COL_KIND][row];
+        key[2] = m_columns[COL_PATH][row];
+        key[3] = m_columns[COL_SIGNATURE][row];
+        key[4] = m_columns[COL_TYPEREF][row];
+        key[5] = m_columns[COL_TEMPLATE_DEFINITION][row];
+        auto where = unique_rows.insert({ key, row });
+        if(!where.second) {
+            DoDeleteRow(where.first->second);
+            where.first->second = row;
+        }
+        rows.push_back(row);
+    }
+    DoIndexRows(rows);
+}
+
+void TagsStorageMemoryIndex::DeleteFile(const wxString& file)
+{
+    std::unique_lock<std::shared_mutex> lk{ m_mutex };
+    DoDeleteFile(file);
+    DoCompactIfNeeded();
+}
+
+void TagsStorageMemoryIndex::Clear()
+{
+    std::unique_lock<std::shared_mutex> lk{ m_mutex };
+    DoClear();
+}
+
+size_t TagsStorageMemoryIndex::GetCount() const
+{
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    return m_lines.size() - m_deletedCount;
+}
+
+void TagsStorageMemoryIndex::GetTagsByName(const wxString& name, bool partial, bool case_insensitive, size_t limit,
+                                           std::vector<TagEntryPtr>& tags) const
+{
+    if(name.empty()) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    size_t count = DoCollectNames(m_names, name, partial, case_insensitive, nullptr, limit, tags);
+    if(limit == 0 || count < limit) {
+        DoCollectNames(m_namesDelta, name, partial, case_insensitive, nullptr, limit == 0 ? 0 : limit - count, tags);
+    }
+}
+
+void TagsStorageMemoryIndex::GetChildren(const wxString& scope, const wxString& name, bool partial,
+                                         bool case_insensitive, const wxArrayString& kinds, size_t limit,
+                                         std::vector<TagEntryPtr>& tags) const
+{
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    uint32_t scope_id = 0;
+    if(!DoFindString(scope, &scope_id)) {
+        return;
+    }
+
+    auto iter = m_children.find(scope_id);
+    if(iter == m_children.end()) {
+        return;
+    }
+
+    std::unordered_set<uint32_t> kind_ids;
+    if(!kinds.empty()) {
+        DoGetKindIds(kinds, kind_ids);
+        if(kind_ids.empty()) {
+            return;
+        }
+    }
+    DoCollectNames(iter->second, name, partial, case_insensitive, kinds.empty() ? nullptr : &kind_ids, limit, tags);
+}
+
+void TagsStorageMemoryIndex::GetTagsByPath(const wxString& path, const wxArrayString& kinds, size_t limit,
+                                           std::vector<TagEntryPtr>& tags) const
+{
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    uint32_t path_id = 0;
+    if(!DoFindString(path, &path_id)) {
+        return;
+    }
+
+    auto iter = m_paths.find(path_id);
+    if(iter != m_paths.end()) {
+        DoCollectRows(iter->second, kinds, limit, tags);
+    }
+}
+
+void TagsStorageMemoryIndex::GetTagsByFile(const wxString& file, const wxArrayString& kinds,
+                                           std::vector<TagEntryPtr>& tags) const
+{
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    uint32_t file_id = 0;
+    if(!DoFindString(file, &file_id)) {
+        return;
+    }
+
+    auto iter = m_files.find(file_id);
+    if(iter != m_files.end()) {
+        DoCollectRows(iter->second, kinds, 0, tags);
+    }
+}
+
+void TagsStorageMemoryIndex::GetTagsByKind(const wxArrayString& kinds, std::vector<TagEntryPtr>& tags) const
+{
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    std::unordered_set<uint32_t> kind_ids;
+    DoGetKindIds(kinds, kind_ids);
+    if(kind_ids.empty()) {
+        return;
+    }
+
+    const auto& kinds_column = m_columns[COL_KIND];
+    for(uint32_t row = 0; row < m_lines.size(); ++row) {
+        if(!m_deleted[row] && kind_ids.count(kinds_column[row])) {
+            tags.push_back(DoCreateTag(row));
+        }
+    }
+}
+
+void TagsStorageMemoryIndex::GetTagsByPartName(const wxString& partname, size_t limit,
+                                               std::vector<TagEntryPtr>& tags) const
+{
+    if(partname.empty()) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    wxString lower_partname = partname.Lower();
+    size_t count = 0;
+    for(const Rows* rows : { &m_names, &m_namesDelta }) {
+        // the rows are sorted by name, test each name once
+        uint32_t last_name = 0;
+        bool last_match = false;
+        for(uint32_t row : *rows) {
+            uint32_t name = m_columns[COL_NAME_LOWER][row];
+            if(name != last_name) {
+                last_name = name;
+                last_match = m_strings[name].Contains(lower_partname);
+            }
+
+            if(!last_match || m_deleted[row]) {
+                continue;
+            }
+
+            tags.push_back(DoCreateTag(row));
+            if(++count == limit) {
+                return;
+            }
+        }
+    }
+}
+
+void TagsStorageMemoryIndex::GetTagsByPathParts(const wxArrayString& parts, size_t limit,
+                                                std::vector<TagEntryPtr>& tags) const
+{
+    if(parts.empty()) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lk{ m_mutex };
+    std::vector<wxString> lower_parts;
+    lower_parts.reserve(parts.size());
+    for(const wxString& part : parts) {
+        lower_parts.push_back(part.Lower());
+    }
+
+    size_t count = 0;
+    for(const auto& vt : m_paths) {
+        wxString lower_path = m_strings[vt.first].Lower();
+        bool match = std::all_of(lower_parts.begin(), lower_parts.end(),
+                                 [&lower_path](const wxString& part) { return lower_path.Contains(part); });
+        if(!match) {
+            continue;
+        }
+
+        for(uint32_t row : vt.second) {
+            if(m_deleted[row]) {
+                continue;
+            }
+            tags.push_back(DoCreateTag(row));
+            if(++count == limit) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,194 @@
+#ifndef TAGS_STORAGE_MEMORY_INDEX_H
+#define TAGS_STORAGE_MEMORY_INDEX_H
+
+#include "codelite_exports.h"
+#include "entry.h"
+#include "macros.h"
+#include "wxStringHash.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <wx/arrstr.h>
+
+class TagsStorageSQLite;
+
+/**
+ * @class TagsStorageMemoryIndex
+ * @brief an in-memory copy of the TAGS table, used by TagsStorageSQLite to answer the tags lookups without SQL.
+ *
+ * The strings are interned and the tags are kept column by column (struct of arrays): a tag is a row number and
+ * each column holds the id of its value in the strings pool. The rows are indexed by:
+ * - name: sorted by the lower case name for (case insensitive) prefix searches
+ * - scope: the children of each path, sorted by name
+ * - path and file
+ *
+ * Removed tags are only marked as deleted, the index is compacted once they pile up. New rows are first merged into
+ * a small sorted array of names which is merged into the main one when it grows, so updating the index after each
+ * parsed batch does not re-sort all the names.
+ *
+ * The index can be shared between threads: the lookups share a read lock, Load(), Store() and DeleteFile() take the
+ * write lock
+ */
+class WXDLLIMPEXP_CL TagsStorageMemoryIndex
+{
+public:
+    typedef std::shared_ptr<TagsStorageMemoryIndex> Ptr_t;
+
+private:
+    enum eColumn {
+        COL_NAME,
+        COL_FILE,
+        COL_KIND,
+        COL_ACCESS,
+        COL_SIGNATURE,
+        COL_PATTERN,
+        COL_PARENT,
+        COL_INHERITS,
+        COL_PATH,
+        COL_TYPEREF,
+        COL_SCOPE,
+        COL_TEMPLATE_DEFINITION,
+        COL_TAG_PROPERTIES,
+        COL_MACRODEF,
+        // not a TAGS column: the name in lower case, used for sorting
+        COL_NAME_LOWER,
+        COL_COUNT,
+    };
+
+    // the values of a row, as stored in the TAGS table (excluding COL_NAME_LOWER)
+    typedef std::array<wxString, COL_NAME_LOWER> RowValues;
+    typedef std::vector<uint32_t> Rows;
+
+    mutable std::shared_mutex m_mutex;
+
+    // strings pool
+    std::vector<wxString> m_strings;
+    std::unordered_map<wxString, uint32_t> m_stringIds;
+
+    // the tags
+    std::array<std::vector<uint32_t>, COL_COUNT> m_columns;
+    std::vector<int> m_lines;
+    std::vector<char> m_deleted;
+    size_t m_deletedCount = 0;
+
+    // the indexes
+    Rows m_names;
+    Rows m_namesDelta;
+    std::unordered_map<uint32_t, Rows> m_children;
+    std::unordered_map<uint32_t, Rows> m_paths;
+    std::unordered_map<uint32_t, Rows> m_files;
+
+protected:
+    uint32_t DoIntern(const wxString& str);
+    bool DoFindString(const wxString& str, uint32_t* id) const;
+    const wxString& DoGetString(uint32_t row, eColumn column) const { return m_strings[m_columns[column][row]]; }
+
+    uint32_t DoAddRow(const RowValues& values, int line);
+    void DoDeleteRow(uint32_t row);
+    void DoDeleteFile(const wxString& file);
+    bool DoIsNameLess(uint32_t a, uint32_t b) const;
+    void DoSortByName(Rows& rows) const;
+    void DoMergeByName(Rows& rows, const Rows& sorted_rows) const;
+    void DoIndexRows(Rows& rows);
+    void DoRebuild();
+    void DoCompactIfNeeded();
+    void DoClear();
+
+    /**
+     * @brief add the rows of `rows` (sorted by name) matching `name` to `tags`. An empty `name` matches all the rows.
+     * Return the number of tags added, at most `limit`
+     */
+    size_t DoCollectNames(const Rows& rows, const wxString& name, bool partial, bool case_insensitive,
+                          const std::unordered_set<uint32_t>* kinds, size_t limit,
+                          std::vector<TagEntryPtr>& tags) const;
+    /**
+     * @brief add the rows of `rows` of one of `kinds` (all the rows if `kinds` is empty) to `tags`
+     */
+    void DoCollectRows(const Rows& rows, const wxArrayString& kinds, size_t limit,
+                       std::vector<TagEntryPtr>& tags) const;
+    void DoGetKindIds(const wxArrayString& kinds, std::unordered_set<uint32_t>& ids) const;
+    TagEntryPtr DoCreateTag(uint32_t row) const;
+
+public:
+    TagsStorageMemoryIndex();
+    ~TagsStorageMemoryIndex();
+
+    /**
+     * @brief replace the content of the index with the tags stored in `db`
+     */
+    void Load(TagsStorageSQLite* db);
+
+    /**
+     * @brief store a batch of tags. Like TagsStorageSQLite::Store(), the batch replaces all the tags of
+     * the files it contains
+     */
+    void Store(const std::vector<TagEntryPtr>& tags);
+
+    /**
+     * @brief remove all the tags of `file`
+     */
+    void DeleteFile(const wxString& file);
+
+    /**
+     * @brief remove all the tags
+     */
+    void Clear();
+
+    /**
+     * @brief return the number of tags in the index
+     */
+    size_t GetCount() const;
+
+    // -----------------------------------------------------------------------------
+    // Lookups. A `limit` of 0 means no limit. The matching tags are appended to `tags`
+    // -----------------------------------------------------------------------------
+
+    /**
+     * @brief return the tags named `name` (case sensitive) or starting with `name` if `partial` is true.
+     * Prefix matches are case insensitive if `case_insensitive` is true
+     */
+    void GetTagsByName(const wxString& name, bool partial, bool case_insensitive, size_t limit,
+                       std::vector<TagEntryPtr>& tags) const;
+
+    /**
+     * @brief return the tags whose scope is `scope`, ordered by name. When `name` is not empty, only tags matching
+     * it (see GetTagsByName()) are returned. When `kinds` is not empty, only tags of these kinds are returned
+     */
+    void GetChildren(const wxString& scope, const wxString& name, bool partial, bool case_insensitive,
+                     const wxArrayString& kinds, size_t limit, std::vector<TagEntryPtr>& tags) const;
+
+    /**
+     * @brief return the tags with the given path, ordered by their id. When `kinds` is not empty, only tags of
+     * these kinds are returned
+     */
+    void GetTagsByPath(const wxString& path, const wxArrayString& kinds, size_t limit,
+                       std::vector<TagEntryPtr>& tags) const;
+
+    /**
+     * @brief return the tags found in `file`, ordered by their id. When `kinds` is not empty, only tags of these
+     * kinds are returned
+     */
+    void GetTagsByFile(const wxString& file, const wxArrayString& kinds, std::vector<TagEntryPtr>& tags) const;
+
+    /**
+     * @brief return the tags of the given kinds
+     */
+    void GetTagsByKind(const wxArrayString& kinds, std::vector<TagEntryPtr>& tags) const;
+
+    /**
+     * @brief return the tags whose name contains `partname` (case insensitive)
+     */
+    void GetTagsByPartName(const wxString& partname, size_t limit, std::vector<TagEntryPtr>& tags) const;
+
+    /**
+     * @brief return the tags whose path contains all of `parts` (case insensitive)
+     */
+    void GetTagsByPathParts(const wxArrayString& parts, size_t limit, std::vector<TagEntryPtr>& tags) const;
+};
+
+#endif // TAGS_STORAGE_MEMORY_INDEX_H
@@ -30,10 +30,168 @@
 #include "precompiled_header.h"
 
 #include <algorithm>
+#include <iterator>
 #include <unordered_set>
 #include <wx/longlong.h>
 #include <wx/tokenzr.h>
 
+namespace
+{
+// upper limit for the number of prepared statements kept per connection
+constexpr size_t MAX_CACHED_STATEMENTS = 200;
+
+// default limits of the lookups cache
+constexpr size_t CACHE_MAX_ENTRIES = 5000;
+constexpr size_t CACHE_MAX_BYTES = 64 * 1024 * 1024;
+// estimated size of the strings of a tag that are not accounted for explicitly (pattern, signature etc)
+constexpr size_t TAG_ENTRY_EXTRA_BYTES = 128;
+
+/// the SQL LIMIT of the in-memory index lookups: a non positive limit means no limit
+size_t index_limit(int limit) { return limit > 0 ? static_cast<size_t>(limit) : 0; }
+
+/// sort tags[from..] like an "order by <column>" clause would do. Only the "name" and "line" columns are supported
+void sort_tags(std::vector<TagEntryPtr>& tags, size_t from, const wxString& column, int order)
+{
+    bool by_name = column.CmpNoCase("name") == 0;
+    if(!by_name && column.CmpNoCase("line") != 0) {
+        return;
+    }
+
+    bool desc = order == ITagsStorage::OrderDesc;
+    std::stable_sort(tags.begin() + from, tags.end(), [by_name, desc](const TagEntryPtr& a, const TagEntryPtr& b) {
+        const TagEntryPtr& first = desc ? b : a;
+        const TagEntryPtr& second = desc ? a : b;
+        return by_name ? first->GetName() < second->GetName() : first->GetLine() < second->GetLine();
+    });
+}
+
+/// the kinds of the tags that can be used as a type
+const wxArrayString& type_kinds()
+{
+    static const wxArrayString kinds = []() {
+        wxArrayString arr;
+        arr.Add("class");
+        arr.Add("struct");
+        arr.Add("typedef");
+        return arr;
+    }();
+    return kinds;
+}
+
+/// reset a cached statement once we are done with it, so it does not keep a read transaction open
+class StatementResetter
+{
+    wxSQLite3Statement& m_statement;
+
+public:
+    StatementResetter(wxSQLite3Statement& statement)
+        : m_statement(statement)
+    {
+    }
+    ~StatementResetter()
+    {
+        try {
+            m_statement.Reset();
+        } catch (const wxSQLite3Exception&) {
+        }
+    }
+};
+} // namespace
+
+//-------------------------------------------------
+// clSqliteQuery
+//-------------------------------------------------
+clSqliteQuery& clSqliteQuery::Bind(const wxString& value)
+{
+    m_sql << "?";
+    Value v;
+    v.str_value = value;
+    m_values.push_back(std::move(v));
+    return *this;
+}
+
+clSqliteQuery& clSqliteQuery::Bind(int value)
+{
+    m_sql << "?";
+    Value v;
+    v.is_int = true;
+    v.int_value = value;
+    m_values.push_back(std::move(v));
+    return *this;
+}
+
+clSqliteQuery& clSqliteQuery::BindList(const wxArrayString& values)
+{
+    for(size_t i = 0; i < values.size(); ++i) {
+        if(i > 0) {
+            m_sql << ",";
+        }
+        Bind(values.Item(i));
+    }
+    return *this;
+}
+
+clSqliteQuery& clSqliteQuery::BindList(const std::vector<wxString>& values)
+{
+    for(size_t i = 0; i < values.size(); ++i) {
+        if(i > 0) {
+            m_sql << ",";
+        }
+        Bind(values[i]);
+    }
+    return *this;
+}
+
+wxString clSqliteQuery::GetCacheKey() const
+{
+    wxString key = m_sql;
+    for(const auto& v : m_values) {
+        key << "\x01";
+        if(v.is_int) {
+            key << v.int_value;
+        } else {
+            key << v.str_value;
+        }
+    }
+    return key;
+}
+
+void clSqliteQuery::BindTo(wxSQLite3Statement& statement) const
+{
+    for(size_t i = 0; i < m_values.size(); ++i) {
+        // parameters are 1 based
+        if(m_values[i].is_int) {
+            statement.Bind((int)i + 1, m_values[i].int_value);
+        } else {
+            statement.Bind((int)i + 1, m_values[i].str_value);
+        }
+    }
+}
+
+//-------------------------------------------------
+// clSqliteDB
+//-------------------------------------------------
+wxSQLite3Statement& clSqliteDB::GetPrepareStatement(const wxString& sql)
+{
+    auto iter = m_statements.find(sql);
+    if(iter != m_statements.end()) {
+        try {
+            iter->second.Reset();
+        } catch (const wxSQLite3Exception&) {
+            // Reset() reports the error of the previous execution, the statement itself is still usable
+        }
+        return iter->second;
+    }
+
+    // prepare it before touching the cache, PrepareStatement() throws for an invalid SQL
+    wxSQLite3Statement statement = PrepareStatement(sql);
+    if(m_statements.size() >= MAX_CACHED_STATEMENTS) {
+        m_statements.clear();
+    }
+    // the copy transfers the ownership of the statement to the cache
+    return m_statements.insert({ sql, statement }).first->second;
+}
+
 //-------------------------------------------------
 // Tags database class implementation
 //-------------------------------------------------
@@ -121,9 +279,18 @@ void TagsStorageSQLite::CreateSchema()
         m_db->ExecuteUpdate(sql);
 
         sql = wxT("create  table if not exists FILES (ID INTEGER PRIMARY KEY AUTOINCREMENT, file string, last_retagged "
-                  "integer);");
+                  "integer, size integer, hash integer);");
         m_db->ExecuteUpdate(sql);
 
+        // databases created by older versions do not have the size and hash columns
+        for(const wxString& column : { "size", "hash" }) {
+            try {
+                m_db->ExecuteUpdate(wxString() << "ALTER TABLE FILES ADD COLUMN " << column << " integer");
+            } catch (const wxSQLite3Exception&) {
+                // the column already exists
+            }
+        }
+
         sql = wxT("create  table if not exists MACROS (ID INTEGER PRIMARY KEY AUTOINCREMENT, file string, line "
                   "integer, name string, is_function_like int, replacement string, signature string);");
         m_db->ExecuteUpdate(sql);
@@ -250,7 +417,7 @@ void TagsStorageSQLite::Store(const std::vector<TagEntryPtr>& tags, bool auto_co
     try {
         // delete all tags owned by these files
         for(const wxString& file : files) {
-            DeleteByFileName({}, file, false);
+            DoDeleteFileTags(file);
         }
     } catch (const wxSQLite3Exception& e) {
         clWARNING() << "TagsStorageSQLite::Store() error:" << e.GetMessage() << endl;
@@ -269,6 +436,7 @@ void TagsStorageSQLite::Store(const std::vector<TagEntryPtr>& tags, bool auto_co
     } catch (const wxSQLite3Exception& e) {
         clWARNING() << "TagsStorageSQLite::Store(): failed to insert entires into the db." << e.GetMessage() << endl;
         SAFE_ROLLBACK_IF_NEEDED(auto_commit);
+        return;
     }
 
     // commit
@@ -280,6 +448,16 @@ void TagsStorageSQLite::Store(const std::vector<TagEntryPtr>& tags, bool auto_co
         SAFE_ROLLBACK_IF_NEEDED(auto_commit);
         return;
     }
+
+    // the index must only see the tags that made it into the database
+    IndexChange change;
+    change.tags = tags;
+    DoUpdateIndex(std::move(change), auto_commit);
+
+    // the cache must be cleared for any related tags, do it once for the whole batch
+    if(GetUseCache()) {
+        m_cache.Invalidate(files, tags);
+    }
 }
 
 void TagsStorageSQLite::SelectTagsByFile(const wxString& file, std::vector<TagEntryPtr>& tags, const wxFileName& path)
@@ -287,17 +465,23 @@ void TagsStorageSQLite::SelectTagsByFile(const wxString& file, std::vector<TagEn
     // Incase empty file path is provided, use the current file name
     wxFileName databaseFileName(path);
     path.IsOk() == false ? databaseFileName = m_fileName : databaseFileName = path;
+    if(m_index && databaseFileName == m_fileName) {
+        size_t count = tags.size();
+        m_index->GetTagsByFile(file, wxArrayString(), tags);
+        sort_tags(tags, count, "line", ITagsStorage::OrderAsc);
+        return;
+    }
     OpenDatabase(databaseFileName);
 
-    wxString query;
-    query << wxT("select * from tags where file='") << file << "' ";
+    clSqliteQuery query;
+    query.Append("select * from tags where file=").Bind(file).Append(" ");
     // #ifdef __WXMSW__
     //     // Under Windows, the file-crawler changes the file path
     //     // to lowercase. However, the database matches the file name
     //     // by case-sensitive
     //     query << "COLLATE NOCASE ";
     // #endif
-    query << wxT("order by line asc");
+    query.Append("order by line asc");
     DoFetchTags(query, tags);
 }
 
@@ -311,19 +495,72 @@ void TagsStorageSQLite::DeleteByFileName(const wxFileName& path, const wxString&
             m_db->Begin();
         }
 
-        wxString sql;
-        sql << "delete from tags where File='" << fileName << "'";
-        m_db->ExecuteUpdate(sql);
+        wxSQLite3Statement& statement = m_db->GetPrepareStatement("delete from tags where File=?");
+        statement.Bind(1, fileName);
+        statement.ExecuteUpdate();
         if(autoCommit)
             m_db->Commit();
+
+        IndexChange change;
+        change.deletedFile = fileName;
+        DoUpdateIndex(std::move(change), autoCommit);
     } catch (const wxSQLite3Exception& e) {
         wxUnusedVar(e);
         if(autoCommit) {
             m_db->Rollback();
         }
     }
+
     // also remove the file entry associated with this file
     DeleteFileEntry(fileName);
+    if(GetUseCache()) {
+        m_cache.Invalidate(wxStringSet_t{ fileName });
+    }
+}
+
+void TagsStorageSQLite::DoUpdateIndex(IndexChange&& change, bool committed)
+{
+    if(!m_index) {
+        return;
+    }
+
+    if(!committed) {
+        m_pendingIndexChanges.push_back(std::move(change));
+    } else if(!change.deletedFile.empty()) {
+        m_index->DeleteFile(change.deletedFile);
+    } else {
+        m_index->Store(change.tags);
+    }
+}
+
+void TagsStorageSQLite::Commit()
+{
+    std::vector<IndexChange> changes;
+    changes.swap(m_pendingIndexChanges);
+    try {
+        m_db->Commit();
+    } catch (const wxSQLite3Exception& e) {
+        wxUnusedVar(e);
+        return;
+    }
+
+    for(auto& change : changes) {
+        DoUpdateIndex(std::move(change), true);
+    }
+}
+
+void TagsStorageSQLite::Rollback()
+{
+    m_pendingIndexChanges.clear();
+    m_db->Rollback();
+}
+
+void TagsStorageSQLite::DoDeleteFileTags(const wxString& fileName)
+{
+    wxSQLite3Statement& statement = m_db->GetPrepareStatement("delete from tags where File=?");
+    statement.Bind(1, fileName);
+    statement.ExecuteUpdate();
+    DeleteFileEntry(fileName);
 }
 
 wxSQLite3ResultSet TagsStorageSQLite::Query(const wxString& sql, const wxFileName& path)
@@ -355,7 +592,7 @@ const bool TagsStorageSQLite::IsOpen() const { return m_db->IsOpen(); }
 void TagsStorageSQLite::GetFilesForCC(const wxString& userTyped, wxArrayString& matches)
 {
     try {
-        wxString query;
+        clSqliteQuery query;
         wxString tmpName(userTyped);
 
         // Files are kept in native format in the database
@@ -364,13 +601,15 @@ void TagsStorageSQLite::GetFilesForCC(const wxString& userTyped, wxArrayString&
         tmpName.Replace("\\", "/");
         tmpName.Replace("/", wxString() << wxFILE_SEP_PATH);
         tmpName.Replace(wxT("_"), wxT("^_"));
-        query << wxT("select * from files where file like '%%") << tmpName << wxT("%%' ESCAPE '^' ")
-              << wxT("order by file");
+        query.Append("select * from files where file like ").Bind("%" + tmpName + "%");
+        query.Append(" ESCAPE '^' order by file");
 
         wxString pattern = userTyped;
         pattern.Replace("\\", "/");
 
-        wxSQLite3ResultSet res = m_db->ExecuteQuery(query);
+        wxSQLite3Statement& statement = DoPrepare(query);
+        StatementResetter resetter(statement);
+        wxSQLite3ResultSet res = statement.ExecuteQuery();
         while(res.NextRow()) {
             // Keep the part from where the user typed and until the end of the file name
             wxString matchedFile = res.GetString(1);
@@ -393,19 +632,22 @@ void TagsStorageSQLite::GetFiles(const wxString& partialName, std::vector<FileEn
     try {
         bool match_path = (!partialName.IsEmpty() && partialName.Last() == wxFileName::GetPathSeparator());
 
-        wxString query;
+        clSqliteQuery query;
         wxString tmpName(partialName);
         tmpName.Replace(wxT("_"), wxT("^_"));
-        query << wxT("select * from files where file like '%%") << tmpName << wxT("%%' ESCAPE '^' ")
-              << wxT("order by file");
+        query.Append("select * from files where file like ").Bind("%" + tmpName + "%");
+        query.Append(" ESCAPE '^' order by file");
 
-        wxSQLite3ResultSet res = m_db->ExecuteQuery(query);
+        wxSQLite3Statement& statement = DoPrepare(query);
+        StatementResetter resetter(statement);
+        wxSQLite3ResultSet res = statement.ExecuteQuery();
         while(res.NextRow()) {
 
             FileEntryPtr fe(new FileEntry());
             fe->SetId(res.GetInt(0));
             fe->SetFile(res.GetString(1));
             fe->SetLastRetaggedTimestamp(res.GetInt(2));
+            FileEntryFromSQLite3ResultSet(res, *fe);
 
             wxFileName fileName(fe->GetFile());
             wxString match = match_path ? fileName.GetFullPath() : fileName.GetFullName();
@@ -431,8 +673,9 @@ void TagsStorageSQLite::GetFiles(const wxString& partialName, std::vector<FileEn
 void TagsStorageSQLite::GetFiles(std::vector<FileEntryPtr>& files)
 {
     try {
-        wxString query(wxT("select * from files order by file"));
-        wxSQLite3ResultSet res = m_db->ExecuteQuery(query);
+        wxSQLite3Statement& statement = m_db->GetPrepareStatement("select * from files order by file");
+        StatementResetter resetter(statement);
+        wxSQLite3ResultSet res = statement.ExecuteQuery();
 
         // Pre allocate a reasonable amount of entries
         files.reserve(5000);
@@ -442,6 +685,7 @@ void TagsStorageSQLite::GetFiles(std::vector<FileEntryPtr>& files)
             fe->SetId(res.GetInt(0));
             fe->SetFile(res.GetString(1));
             fe->SetLastRetaggedTimestamp(res.GetInt(2));
+            FileEntryFromSQLite3ResultSet(res, *fe);
 
             files.push_back(std::move(fe));
         }
@@ -453,6 +697,14 @@ void TagsStorageSQLite::GetFiles(std::vector<FileEntryPtr>& files)
     }
 }
 
+void TagsStorageSQLite::FileEntryFromSQLite3ResultSet(wxSQLite3ResultSet& rs, FileEntry& entry)
+{
+    // columns: ID, file, last_retagged, size, hash
+    int columns = rs.GetColumnCount();
+    entry.SetSize((columns > 3 && !rs.IsNull(3)) ? rs.GetInt64(3).GetValue() : -1);
+    entry.SetContentHash((columns > 4 && !rs.IsNull(4)) ? static_cast<uint64_t>(rs.GetInt64(4).GetValue()) : 0);
+}
+
 void TagsStorageSQLite::PPTokenFromSQlite3ResultSet(wxSQLite3ResultSet& rs, PPToken& token)
 {
     // set the name
@@ -496,18 +748,31 @@ TagEntry* TagsStorageSQLite::FromSQLite3ResultSet(wxSQLite3ResultSet& rs)
     return entry;
 }
 
-void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags)
+wxSQLite3Statement& TagsStorageSQLite::DoPrepare(const clSqliteQuery& query)
 {
-    if(GetUseCache() && m_cache.Get(sql, tags)) {
-        return;
+    wxSQLite3Statement& statement = m_db->GetPrepareStatement(query.GetSQL());
+    query.BindTo(statement);
+    return statement;
+}
+
+void TagsStorageSQLite::DoFetchTags(const clSqliteQuery& query, std::vector<TagEntryPtr>& tags)
+{
+    wxString cache_key;
+    if(GetUseCache()) {
+        cache_key = query.GetCacheKey();
+        if(m_cache.Get(cache_key, tags)) {
+            return;
+        }
     }
 
-    LOG_IF_TRACE { clDEBUG1() << "Fetching from disk:" << sql << clEndl; }
+    LOG_IF_TRACE { clDEBUG1() << "Fetching from disk:" << query.GetSQL() << clEndl; }
     tags.reserve(1000);
 
+    bool reopen_db = false;
     try {
-        wxSQLite3ResultSet ex_rs;
-        ex_rs = Query(sql);
+        wxSQLite3Statement& statement = DoPrepare(query);
+        StatementResetter resetter(statement);
+        wxSQLite3ResultSet ex_rs = statement.ExecuteQuery();
 
         // add results from external database to the workspace database
         while(ex_rs.NextRow()) {
@@ -516,34 +781,46 @@ void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr
             // conver the path to be real path
             tags.push_back(tag);
         }
-        ex_rs.Finalize();
     } catch (const wxSQLite3Exception& e) {
         LOG_IF_DEBUG
         {
             clDEBUG() << "SQLite exception!" << endl;
             clDEBUG() << e.GetMessage() << endl;
         }
+        reopen_db = e.GetMessage().Contains("disk I/O error");
+    }
+
+    if(reopen_db) {
+        ReOpenDatabase();
     }
 
     LOG_IF_TRACE { clDEBUG1() << "Fetching from disk...done" << tags.size() << "matches found" << clEndl; }
     if(GetUseCache()) {
-        m_cache.Store(sql, tags);
+        m_cache.Store(cache_key, tags);
     }
 }
 
-void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds)
+void TagsStorageSQLite::DoFetchTags(const clSqliteQuery& query, std::vector<TagEntryPtr>& tags,
+                                    const wxArrayString& kinds)
 {
-    if(GetUseCache() && m_cache.Get(sql, kinds, tags))
-        return;
+    wxString cache_key;
+    if(GetUseCache()) {
+        cache_key = query.GetCacheKey();
+        if(m_cache.Get(cache_key, kinds, tags)) {
+            return;
+        }
+    }
 
     wxStringSet_t set_kinds;
     set_kinds.insert(kinds.begin(), kinds.end());
     tags.reserve(1000);
 
-    LOG_IF_TRACE { clDEBUG1() << "Fetching from disk:" << sql << endl; }
+    LOG_IF_TRACE { clDEBUG1() << "Fetching from disk:" << query.GetSQL() << endl; }
+    bool reopen_db = false;
     try {
-        wxSQLite3ResultSet ex_rs;
-        ex_rs = Query(sql);
+        wxSQLite3Statement& statement = DoPrepare(query);
+        StatementResetter resetter(statement);
+        wxSQLite3ResultSet ex_rs = statement.ExecuteQuery();
 
         // add results from external database to the workspace database
         while(ex_rs.NextRow()) {
@@ -557,7 +834,6 @@ void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr
                 tags.push_back(tag);
             }
         }
-        ex_rs.Finalize();
 
     } catch (const wxSQLite3Exception& e) {
         LOG_IF_DEBUG
@@ -565,10 +841,16 @@ void TagsStorageSQLite::DoFetchTags(const wxString& sql, std::vector<TagEntryPtr
             clDEBUG() << e.GetMessage() << endl;
             clDEBUG() << "SQLite exception!" << endl;
         }
+        reopen_db = e.GetMessage().Contains("disk I/O error");
     }
+
+    if(reopen_db) {
+        ReOpenDatabase();
+    }
+
     LOG_IF_TRACE { clDEBUG1() << "Fetching from disk...done" << tags.size() << "matches found" << endl; }
     if(GetUseCache()) {
-        m_cache.Store(sql, kinds, tags);
+        m_cache.Store(cache_key, kinds, tags);
     }
 }
 
@@ -578,55 +860,75 @@ void TagsStorageSQLite::GetTagsByScopeAndName(const wxString& scope, const wxStr
     if(name.IsEmpty())
         return;
 
-    wxString sql;
-    sql << wxT("select * from tags where ");
+    if(m_index) {
+        wxString index_scope = scope.IsEmpty() ? wxString(wxT("<global>")) : scope;
+        m_index->GetChildren(index_scope, name, partialNameAllowed, m_enableCaseInsensitive, wxArrayString(),
+                             index_limit(GetSingleSearchLimit()), tags);
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where ");
 
     // did we get scope?
     if(scope.IsEmpty() || scope == wxT("<global>")) {
-        sql << wxT("ID IN (select tag_id from global_tags where ");
-        DoAddNamePartToQuery(sql, name, partialNameAllowed, false);
-        sql << wxT(" ) ");
+        query.Append("ID IN (select tag_id from global_tags where ");
+        DoAddNamePartToQuery(query, name, partialNameAllowed, false);
+        query.Append(" ) ");
 
     } else {
-        sql << " scope = '" << scope << "' ";
-        DoAddNamePartToQuery(sql, name, partialNameAllowed, true);
+        query.Append(" scope = ").Bind(scope).Append(" ");
+        DoAddNamePartToQuery(query, name, partialNameAllowed, true);
     }
 
-    sql << wxT(" LIMIT ") << this->GetSingleSearchLimit();
+    query.Append(" LIMIT ").Bind(GetSingleSearchLimit());
 
     // get get the tags
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByScope(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
+    if(m_index) {
+        m_index->GetChildren(scope, wxEmptyString, false, false, wxArrayString(), index_limit(GetSingleSearchLimit()),
+                             tags);
+        return;
+    }
+
+    clSqliteQuery query;
 
     // Build the SQL statement
-    sql << wxT("select * from tags where scope='") << scope << wxT("' ORDER BY NAME limit ") << GetSingleSearchLimit();
+    query.Append("select * from tags where scope=").Bind(scope).Append(" ORDER BY NAME limit ");
+    query.Bind(GetSingleSearchLimit());
 
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByKind(const wxArrayString& kinds, const wxString& orderingColumn, int order,
                                       std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where kind in (");
-    for(size_t i = 0; i < kinds.GetCount(); i++) {
-        sql << wxT("'") << kinds.Item(i) << wxT("',");
+    if(kinds.empty()) {
+        return;
+    }
+
+    if(m_index) {
+        size_t count = tags.size();
+        m_index->GetTagsByKind(kinds, tags);
+        sort_tags(tags, count, orderingColumn, order);
+        return;
     }
-    sql.RemoveLast();
-    sql << wxT(") ");
+
+    clSqliteQuery query;
+    query.Append("select * from tags where kind in (").BindList(kinds).Append(") ");
 
     if(orderingColumn.IsEmpty() == false) {
-        sql << wxT("order by ") << orderingColumn;
+        query.Append(" order by ").Append(orderingColumn);
         switch(order) {
         case ITagsStorage::OrderAsc:
-            sql << wxT(" ASC");
+            query.Append(" ASC");
             break;
         case ITagsStorage::OrderDesc:
-            sql << wxT(" DESC");
+            query.Append(" DESC");
             break;
         case ITagsStorage::OrderNone:
         default:
@@ -634,7 +936,7 @@ void TagsStorageSQLite::GetTagsByKind(const wxArrayString& kinds, const wxString
         }
     }
 
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByPath(const wxArrayString& path, std::vector<TagEntryPtr>& tags)
@@ -642,25 +944,29 @@ void TagsStorageSQLite::GetTagsByPath(const wxArrayString& path, std::vector<Tag
     if(path.empty())
         return;
 
-    wxString sql;
-
-    sql << wxT("select * from tags where path IN(");
-    for(size_t i = 0; i < path.GetCount(); i++) {
-        sql << wxT("'") << path.Item(i) << wxT("',");
+    if(m_index) {
+        for(const wxString& p : path) {
+            m_index->GetTagsByPath(p, wxArrayString(), 0, tags);
+        }
+        return;
     }
-    sql.RemoveLast();
-    sql << wxT(")");
-    DoFetchTags(sql, tags);
+
+    clSqliteQuery query;
+    query.Append("select * from tags where path IN(").BindList(path).Append(")");
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByNameAndParent(const wxString& name, const wxString& parent,
                                                std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where name='") << name << wxT("' LIMIT ") << GetSingleSearchLimit();
-
     std::vector<TagEntryPtr> tmpResults;
-    DoFetchTags(sql, tmpResults);
+    if(m_index) {
+        m_index->GetTagsByName(name, false, false, index_limit(GetSingleSearchLimit()), tmpResults);
+    } else {
+        clSqliteQuery query;
+        query.Append("select * from tags where name=").Bind(name).Append(" LIMIT ").Bind(GetSingleSearchLimit());
+        DoFetchTags(query, tmpResults);
+    }
 
     // Filter by parent
     for(size_t i = 0; i < tmpResults.size(); i++) {
@@ -677,17 +983,30 @@ void TagsStorageSQLite::GetTagsByKindAndPath(const wxArrayString& kinds, const w
         return;
     }
 
-    wxString sql;
-    sql << wxT("select * from tags where path='") << path << wxT("' LIMIT ") << GetSingleSearchLimit();
+    if(m_index) {
+        m_index->GetTagsByPath(path, kinds, index_limit(GetSingleSearchLimit()), tags);
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where path=").Bind(path).Append(" LIMIT ").Bind(GetSingleSearchLimit());
 
-    DoFetchTags(sql, tags, kinds);
+    DoFetchTags(query, tags, kinds);
 }
 
 void TagsStorageSQLite::GetTagsByFileAndLine(const wxString& file, int line, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where file='") << file << wxT("' and line=") << line << wxT(" ");
-    DoFetchTags(sql, tags);
+    if(m_index) {
+        std::vector<TagEntryPtr> file_tags;
+        m_index->GetTagsByFile(file, wxArrayString(), file_tags);
+        std::copy_if(file_tags.begin(), file_tags.end(), std::back_inserter(tags),
+                     [line](const TagEntryPtr& tag) { return tag->GetLine() == line; });
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where file=").Bind(file).Append(" and line=").Bind(line);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByKindAndFile(const wxArrayString& kind, const wxString& fileName,
@@ -697,36 +1016,38 @@ void TagsStorageSQLite::GetTagsByKindAndFile(const wxArrayString& kind, const wx
         return;
     }
 
-    wxString sql;
-    sql << wxT("select * from tags where file='") << fileName << wxT("' and kind in (");
-
-    for(size_t i = 0; i < kind.GetCount(); i++) {
-        sql << wxT("'") << kind.Item(i) << wxT("',");
+    if(m_index) {
+        size_t count = tags.size();
+        m_index->GetTagsByFile(fileName, kind, tags);
+        sort_tags(tags, count, orderingColumn, order);
+        return;
     }
-    sql.RemoveLast();
-    sql << wxT(")");
+
+    clSqliteQuery query;
+    query.Append("select * from tags where file=").Bind(fileName).Append(" and kind in (");
+    query.BindList(kind).Append(")");
 
     if(orderingColumn.IsEmpty() == false) {
-        sql << wxT("order by ") << orderingColumn;
+        query.Append(" order by ").Append(orderingColumn);
         switch(order) {
         case ITagsStorage::OrderAsc:
-            sql << wxT(" ASC");
+            query.Append(" ASC");
             break;
         case ITagsStorage::OrderDesc:
-            sql << wxT(" DESC");
+            query.Append(" DESC");
             break;
         case ITagsStorage::OrderNone:
         default:
             break;
         }
     }
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 }
 
 int TagsStorageSQLite::DeleteFileEntry(const wxString& filename)
 {
     try {
-        wxSQLite3Statement statement = m_db->GetPrepareStatement(wxT("DELETE FROM FILES WHERE FILE=?"));
+        wxSQLite3Statement& statement = m_db->GetPrepareStatement(wxT("DELETE FROM FILES WHERE FILE=?"));
         statement.Bind(1, filename);
         statement.ExecuteUpdate();
 
@@ -738,13 +1059,25 @@ int TagsStorageSQLite::DeleteFileEntry(const wxString& filename)
     return TagOk;
 }
 
-int TagsStorageSQLite::InsertFileEntry(const wxString& filename, int timestamp)
+int TagsStorageSQLite::InsertFileEntry(const wxString& filename, int timestamp, long long size,
+                                       uint64_t contentHash)
 {
     try {
-        wxSQLite3Statement statement =
-            m_db->GetPrepareStatement(wxT("INSERT OR REPLACE INTO FILES VALUES(NULL, ?, ?)"));
+        wxSQLite3Statement& statement = m_db->GetPrepareStatement(
+            wxT("INSERT OR REPLACE INTO FILES (file, last_retagged, size, hash) VALUES(?, ?, ?, ?)"));
         statement.Bind(1, filename);
         statement.Bind(2, timestamp);
+        if(size < 0) {
+            statement.BindNull(3);
+        } else {
+            statement.Bind(3, wxLongLong(size));
+        }
+        if(contentHash == 0) {
+            statement.BindNull(4);
+        } else {
+            // stored as a signed 64 bit integer
+            statement.Bind(4, wxLongLong(static_cast<wxLongLong_t>(contentHash)));
+        }
         statement.ExecuteUpdate();
 
     } catch (const wxSQLite3Exception& exc) {
@@ -756,7 +1089,7 @@ int TagsStorageSQLite::InsertFileEntry(const wxString& filename, int timestamp)
 int TagsStorageSQLite::UpdateFileEntry(const wxString& filename, int timestamp)
 {
     try {
-        wxSQLite3Statement statement =
+        wxSQLite3Statement& statement =
             m_db->GetPrepareStatement(wxT("UPDATE OR REPLACE FILES SET last_retagged=? WHERE file=?"));
         statement.Bind(1, timestamp);
         statement.Bind(2, filename);
@@ -774,13 +1107,9 @@ int TagsStorageSQLite::DoInsertTagEntry(const TagEntry& tag)
     if(!tag.IsOk())
         return TagOk;
 
-    // does not matter if we insert or update, the cache must be cleared for any related tags
-    if(GetUseCache()) {
-        ClearCache();
-    }
-
+    // the results cache is cleared by the caller (once per batch, see Store())
     try {
-        wxSQLite3Statement statement = m_db->GetPrepareStatement(
+        wxSQLite3Statement& statement = m_db->GetPrepareStatement(
             wxT("INSERT OR REPLACE INTO TAGS VALUES (NULL, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
         statement.Bind(1, tag.GetName());
         statement.Bind(2, wxFileName(tag.GetFile()).GetFullPath());
@@ -806,7 +1135,7 @@ int TagsStorageSQLite::DoInsertTagEntry(const TagEntry& tag)
 
 bool TagsStorageSQLite::IsTypeAndScopeExist(wxString& typeName, wxString& scope)
 {
-    wxString sql;
+    clSqliteQuery query;
     wxString strippedName;
     wxString secondScope;
     wxString bestScope;
@@ -822,8 +1151,6 @@ bool TagsStorageSQLite::IsTypeAndScopeExist(wxString& typeName, wxString& scope)
     if(strippedName.IsEmpty())
         return false;
 
-    sql << wxT("select scope,parent from tags where name='") << strippedName
-        << wxT("' and kind in ('class', 'struct', 'typedef') LIMIT 50");
     int foundOther(0);
     wxString scopeFounded;
     wxString parentFounded;
@@ -833,29 +1160,52 @@ bool TagsStorageSQLite::IsTypeAndScopeExist(wxString& typeName, wxString& scope)
 
     parent = tmpScope.AfterLast(wxT(':'));
 
-    try {
-        wxSQLite3ResultSet rs = Query(sql);
-        while(rs.NextRow()) {
+    // the scope and parent of the types named `strippedName`
+    std::vector<std::pair<wxString, wxString>> candidates;
+    if(m_index) {
+        std::vector<TagEntryPtr> tags;
+        m_index->GetTagsByName(strippedName, false, false, 0, tags);
+        for(const auto& tag : tags) {
+            if(candidates.size() == 50) {
+                break;
+            }
+            if(type_kinds().Index(tag->GetKind()) != wxNOT_FOUND) {
+                candidates.push_back({ tag->GetScope(), tag->GetParent() });
+            }
+        }
 
-            scopeFounded = rs.GetString(0);
-            parentFounded = rs.GetString(1);
+    } else {
+        query.Append("select scope,parent from tags where name=").Bind(strippedName);
+        query.Append(" and kind in ('class', 'struct', 'typedef') LIMIT 50");
+        try {
+            wxSQLite3Statement& statement = DoPrepare(query);
+            StatementResetter resetter(statement);
+            wxSQLite3ResultSet rs = statement.ExecuteQuery();
+            while(rs.NextRow()) {
+                candidates.push_back({ rs.GetString(0), rs.GetString(1) });
+            }
 
-            if(scopeFounded == tmpScope) {
-                // exact match
-                scope = scopeFounded;
-                typeName = strippedName;
-                return true;
+        } catch (const wxSQLite3Exception& e) {
+            wxUnusedVar(e);
+        }
+    }
 
-            } else if(parentFounded == parent) {
-                bestScope = scopeFounded;
+    for(const auto& candidate : candidates) {
+        scopeFounded = candidate.first;
+        parentFounded = candidate.second;
 
-            } else {
-                foundOther++;
-            }
-        }
+        if(scopeFounded == tmpScope) {
+            // exact match
+            scope = scopeFounded;
+            typeName = strippedName;
+            return true;
 
-    } catch (const wxSQLite3Exception& e) {
-        wxUnusedVar(e);
+        } else if(parentFounded == parent) {
+            bestScope = scopeFounded;
+
+        } else {
+            foundOther++;
+        }
     }
 
     // if we reached here, it means we did not find any exact match
@@ -881,12 +1231,20 @@ void TagsStorageSQLite::GetTagsByScopesAndKind(const wxArrayString& scopes, cons
 
     // fetch from the scopes, in-order (i.e. first scope tags and so on)
     for(const wxString& scope : scopes) {
-        wxString sql;
-        sql << "select * from tags where scope = '" << scope << "' ORDER BY NAME";
-        DoAddLimitPartToQuery(sql, tags);
+        if(m_index) {
+            m_index->GetChildren(scope, wxEmptyString, false, false, kinds, DoGetLimit(tags), tags);
+            if((GetSingleSearchLimit() > 0) && (static_cast<int>(tags.size()) > GetSingleSearchLimit())) {
+                break;
+            }
+            continue;
+        }
+
+        clSqliteQuery query;
+        query.Append("select * from tags where scope = ").Bind(scope).Append(" ORDER BY NAME");
+        DoAddLimitPartToQuery(query, tags);
 
         std::vector<TagEntryPtr> scope_results;
-        DoFetchTags(sql, scope_results, kinds);
+        DoFetchTags(query, scope_results, kinds);
         tags.reserve(tags.size() + scope_results.size());
         tags.insert(tags.end(), scope_results.begin(), scope_results.end());
         if((GetSingleSearchLimit() > 0) && (static_cast<int>(tags.size()) > GetSingleSearchLimit())) {
@@ -900,9 +1258,14 @@ void TagsStorageSQLite::GetTagsByPath(const wxString& path, std::vector<TagEntry
     if(path.empty())
         return;
 
-    wxString sql;
-    sql << wxT("select * from tags where path ='") << path << wxT("' LIMIT ") << limit;
-    DoFetchTags(sql, tags);
+    if(m_index) {
+        m_index->GetTagsByPath(path, wxArrayString(), index_limit(limit), tags);
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where path =").Bind(path).Append(" LIMIT ").Bind(limit);
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetTagsByScopeAndName(const wxArrayString& scope, const wxString& name, bool partialNameAllowed,
@@ -924,20 +1287,27 @@ void TagsStorageSQLite::GetTagsByScopeAndName(const wxArrayString& scope, const
         GetTagsByScopeAndName(wxString(wxT("<global>")), name, partialNameAllowed, tags);
     }
 
-    if(scopes.IsEmpty() == false) {
-        wxString sql;
-        sql << wxT("select * from tags where scope in(");
-
-        for(size_t i = 0; i < scopes.GetCount(); i++) {
-            sql << wxT("'") << scopes.Item(i) << wxT("',");
+    if(scopes.IsEmpty() == false && m_index) {
+        // the limit applies to all the scopes, like the single query below
+        size_t limit = DoGetLimit(tags);
+        size_t count = tags.size();
+        for(const wxString& s : scopes) {
+            size_t found = tags.size() - count;
+            if(found >= limit) {
+                break;
+            }
+            m_index->GetChildren(s, name, partialNameAllowed, m_enableCaseInsensitive, wxArrayString(), limit - found,
+                                 tags);
         }
-        sql.RemoveLast();
-        sql << wxT(") ");
 
-        DoAddNamePartToQuery(sql, name, partialNameAllowed, true);
-        DoAddLimitPartToQuery(sql, tags);
+    } else if(scopes.IsEmpty() == false) {
+        clSqliteQuery query;
+        query.Append("select * from tags where scope in(").BindList(scopes).Append(") ");
+
+        DoAddNamePartToQuery(query, name, partialNameAllowed, true);
+        DoAddLimitPartToQuery(query, tags);
         // get get the tags
-        DoFetchTags(sql, tags);
+        DoFetchTags(query, tags);
     }
 }
 
@@ -948,32 +1318,28 @@ void TagsStorageSQLite::GetTagsByScopeAndKind(const wxString& scope, const wxArr
         return;
     }
 
-    wxString sql;
-    sql << "select * from tags where scope='" << scope << "' ";
+    if(m_index) {
+        m_index->GetChildren(scope, filter, true, true, kinds, index_limit(GetSingleSearchLimit()), tags);
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where scope=").Bind(scope).Append(" ");
     if(!filter.empty()) {
-        sql << "and name LIKE '" << filter << "%%' ESCAPE '^' ";
+        query.Append("and name LIKE ").Bind(filter + "%").Append(" ESCAPE '^' ");
     }
 
     if(!kinds.empty()) {
-        sql << " and KIND IN(";
-        wxString kinds_buffer;
-        for(const wxString& kind : kinds) {
-            if(!kinds_buffer.empty()) {
-                kinds_buffer << ",";
-            }
-            kinds_buffer << "'" << kind << "'";
-        }
-        kinds_buffer << ") ";
-        sql << kinds_buffer;
+        query.Append(" and KIND IN(").BindList(kinds).Append(") ");
     }
 
-    sql << " LIMIT " << GetSingleSearchLimit();
-    DoFetchTags(sql, tags);
+    query.Append(" LIMIT ").Bind(GetSingleSearchLimit());
+    DoFetchTags(query, tags);
 }
 
 bool TagsStorageSQLite::IsTypeAndScopeExistLimitOne(const wxString& typeName, const wxString& scope)
 {
-    wxString sql;
+    clSqliteQuery query;
     wxString path;
 
     // Build the path
@@ -981,11 +1347,19 @@ bool TagsStorageSQLite::IsTypeAndScopeExistLimitOne(const wxString& typeName, co
         path << scope << wxT("::");
 
     path << typeName;
-    sql << wxT("select ID from tags where path='") << path
-        << wxT("' and kind in ('class', 'struct', 'typedef') LIMIT 1");
+    if(m_index) {
+        std::vector<TagEntryPtr> tags;
+        m_index->GetTagsByPath(path, type_kinds(), 1, tags);
+        return !tags.empty();
+    }
+
+    query.Append("select ID from tags where path=").Bind(path);
+    query.Append(" and kind in ('class', 'struct', 'typedef') LIMIT 1");
 
     try {
-        wxSQLite3ResultSet rs = Query(sql);
+        wxSQLite3Statement& statement = DoPrepare(query);
+        StatementResetter resetter(statement);
+        wxSQLite3ResultSet rs = statement.ExecuteQuery();
         if(rs.NextRow()) {
             return true;
         }
@@ -998,25 +1372,51 @@ bool TagsStorageSQLite::IsTypeAndScopeExistLimitOne(const wxString& typeName, co
 
 void TagsStorageSQLite::GetDereferenceOperator(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where scope ='") << scope << wxT("' and name like 'operator%->%' LIMIT 1");
-    DoFetchTags(sql, tags);
+    if(m_index) {
+        DoGetOperator(scope, "->", tags);
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where scope =").Bind(scope).Append(" and name like 'operator%->%' LIMIT 1");
+    DoFetchTags(query, tags);
 }
 
 void TagsStorageSQLite::GetSubscriptOperator(const wxString& scope, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << wxT("select * from tags where scope ='") << scope << wxT("' and name like 'operator%[%]%' LIMIT 1");
-    DoFetchTags(sql, tags);
+    if(m_index) {
+        DoGetOperator(scope, "[", tags);
+        return;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where scope =").Bind(scope).Append(" and name like 'operator%[%]%' LIMIT 1");
+    DoFetchTags(query, tags);
+}
+
+void TagsStorageSQLite::DoGetOperator(const wxString& scope, const wxString& op, std::vector<TagEntryPtr>& tags)
+{
+    std::vector<TagEntryPtr> operators;
+    m_index->GetChildren(scope, "operator", true, true, wxArrayString(), 0, operators);
+    for(const auto& tag : operators) {
+        if(tag->GetName().Mid(8).Contains(op)) {
+            tags.push_back(tag);
+            return;
+        }
+    }
 }
 
 //---------------------------------------------------------------------
 //-----------------------------TagsStorageSQLiteCache -----------------
 //---------------------------------------------------------------------
 
-TagsStorageSQLiteCache::TagsStorageSQLiteCache() {}
+TagsStorageSQLiteCache::TagsStorageSQLiteCache()
+    : m_maxEntries(CACHE_MAX_ENTRIES)
+    , m_maxBytes(CACHE_MAX_BYTES)
+{
+}
 
-TagsStorageSQLiteCache::~TagsStorageSQLiteCache() { m_cache.clear(); }
+TagsStorageSQLiteCache::~TagsStorageSQLiteCache() { Clear(); }
 
 bool TagsStorageSQLiteCache::Get(const wxString& sql, std::vector<TagEntryPtr>& tags) { return DoGet(sql, tags); }
 
@@ -1033,7 +1433,19 @@ bool TagsStorageSQLiteCache::Get(const wxString& sql, const wxArrayString& kind,
 
 void TagsStorageSQLiteCache::Store(const wxString& sql, const std::vector<TagEntryPtr>& tags) { DoStore(sql, tags); }
 
-void TagsStorageSQLiteCache::Clear() { m_cache.clear(); }
+void TagsStorageSQLiteCache::Clear()
+{
+    DoClearEntries();
+    m_fileSymbols.clear();
+}
+
+void TagsStorageSQLiteCache::DoClearEntries()
+{
+    m_cache.clear();
+    m_lru.clear();
+    m_filesIndex.clear();
+    m_bytes = 0;
+}
 
 void TagsStorageSQLiteCache::Store(const wxString& sql, const wxArrayString& kind, const std::vector<TagEntryPtr>& tags)
 {
@@ -1049,34 +1461,167 @@ bool TagsStorageSQLiteCache::DoGet(const wxString& key, std::vector<TagEntryPtr>
 {
     auto iter = m_cache.find(key);
     if(iter != m_cache.end()) {
+        // mark it as the most recently used entry
+        m_lru.splice(m_lru.begin(), m_lru, iter->second);
+
         // Append the results to the output tags
-        tags.reserve(tags.size() + iter->second.size());
-        tags.insert(tags.end(), iter->second.begin(), iter->second.end());
+        const auto& cached_tags = iter->second->tags;
+        tags.reserve(tags.size() + cached_tags.size());
+        tags.insert(tags.end(), cached_tags.begin(), cached_tags.end());
+        ++m_hits;
         return true;
     }
+    ++m_misses;
     return false;
 }
 
 void TagsStorageSQLiteCache::DoStore(const wxString& key, const std::vector<TagEntryPtr>& tags)
 {
-    if(m_cache.count(key)) {
-        m_cache.erase(key);
+    auto iter = m_cache.find(key);
+    if(iter != m_cache.end()) {
+        DoErase(iter);
     }
 
     // avoid storing entries with __anon entries
     // since these tags will change their anonymous space
     // each time we save the file
-    bool can_cache = true;
+    Entry entry;
+    entry.key = key;
+    entry.bytes = sizeof(Entry) + key.length() * sizeof(wxChar);
     for(auto tag : tags) {
         if(tag->GetScope().StartsWith("__anon")) {
-            can_cache = false;
-            break;
+            return;
+        }
+        entry.files.insert(tag->GetFile());
+        // an estimate: the object itself and its main strings
+        entry.bytes += sizeof(TagEntry) + TAG_ENTRY_EXTRA_BYTES +
+                       (tag->GetName().length() + tag->GetPath().length() + tag->GetFile().length() +
+                        tag->GetScope().length()) *
+                           sizeof(wxChar);
+    }
+    entry.tags = tags;
+
+    m_bytes += entry.bytes;
+    for(const wxString& file : entry.files) {
+        m_filesIndex[file].insert(key);
+    }
+    m_lru.push_front(std::move(entry));
+    m_cache.insert({ key, m_lru.begin() });
+    DoShrink();
+}
+
+void TagsStorageSQLiteCache::DoErase(std::unordered_map<wxString, std::list<Entry>::iterator>::iterator iter)
+{
+    auto entry_iter = iter->second;
+    for(const wxString& file : entry_iter->files) {
+        auto index_iter = m_filesIndex.find(file);
+        if(index_iter == m_filesIndex.end()) {
+            continue;
+        }
+        index_iter->second.erase(entry_iter->key);
+        if(index_iter->second.empty()) {
+            m_filesIndex.erase(index_iter);
+        }
+    }
+    m_bytes -= entry_iter->bytes;
+    m_cache.erase(iter);
+    m_lru.erase(entry_iter);
+}
+
+void TagsStorageSQLiteCache::DoShrink()
+{
+    while(!m_lru.empty() && (m_cache.size() > m_maxEntries || m_bytes > m_maxBytes)) {
+        DoErase(m_cache.find(m_lru.back().key));
+        ++m_evictions;
+    }
+}
+
+void TagsStorageSQLiteCache::Invalidate(const wxStringSet_t& files, const std::vector<TagEntryPtr>& tags)
+{
+    // an order independent hash of the symbols of each file. The lines and patterns are left out: moving
+    // a symbol does not change the lookups it matches
+    std::unordered_map<wxString, size_t> symbols;
+    std::hash<wxString> hasher;
+    for(const auto& tag : tags) {
+        if(tag->IsLocalVariable()) {
+            continue;
+        }
+        wxString symbol;
+        symbol << tag->GetName() << "\x01" << tag->GetKind() << "\x01" << tag->GetScope() << "\x01" << tag->GetPath()
+               << "\x01" << tag->GetParent() << "\x01" << tag->GetInheritsAsString() << "\x01" << tag->GetTypename()
+               << "\x01" << tag->GetSignature() << "\x01" << tag->GetAccess() << "\x01"
+               << tag->GetTemplateDefinition() << "\x01" << tag->GetTagProperties() << "\x01" << tag->GetMacrodef();
+        symbols[tag->GetFile()] += hasher(symbol);
+    }
+
+    bool symbols_changed = false;
+    for(const wxString& file : files) {
+        auto iter = symbols.find(file);
+        if(iter == symbols.end()) {
+            // the file defines no symbol now: its removed tags are handled by the per file eviction below
+            m_fileSymbols.erase(file);
+            continue;
         }
+
+        auto old_iter = m_fileSymbols.find(file);
+        if(old_iter == m_fileSymbols.end() || old_iter->second != iter->second) {
+            symbols_changed = true;
+        }
+        m_fileSymbols[file] = iter->second;
     }
 
-    if(can_cache) {
-        m_cache.insert({ key, tags });
+    if(symbols_changed) {
+        m_invalidations += m_cache.size();
+        DoClearEntries();
+        return;
     }
+    DoEvictFiles(files);
+}
+
+void TagsStorageSQLiteCache::Invalidate(const wxStringSet_t& files)
+{
+    for(const wxString& file : files) {
+        m_fileSymbols.erase(file);
+    }
+    DoEvictFiles(files);
+}
+
+void TagsStorageSQLiteCache::DoEvictFiles(const wxStringSet_t& files)
+{
+    // collect the keys first, DoErase() modifies the index
+    wxStringSet_t keys;
+    for(const wxString& file : files) {
+        auto iter = m_filesIndex.find(file);
+        if(iter != m_filesIndex.end()) {
+            keys.insert(iter->second.begin(), iter->second.end());
+        }
+    }
+
+    for(const wxString& key : keys) {
+        auto iter = m_cache.find(key);
+        if(iter != m_cache.end()) {
+            DoErase(iter);
+            ++m_invalidations;
+        }
+    }
+}
+
+void TagsStorageSQLiteCache::SetLimits(size_t maxEntries, size_t maxBytes)
+{
+    m_maxEntries = maxEntries;
+    m_maxBytes = maxBytes;
+    DoShrink();
+}
+
+wxString TagsStorageSQLiteCache::GetStatistics() const
+{
+    size_t lookups = m_hits + m_misses;
+    wxString stats;
+    stats << "entries: " << m_cache.size() << "/" << m_maxEntries << ", size: " << (m_bytes / 1024) << "/"
+          << (m_maxBytes / 1024) << "KB, hits: " << m_hits << ", misses: " << m_misses
+          << ", hit ratio: " << (lookups ? (m_hits * 100 / lookups) : 0) << "%, evictions: " << m_evictions
+          << ", invalidations: " << m_invalidations;
+    return stats;
 }
 
 void TagsStorageSQLite::ClearCache()
@@ -1085,13 +1630,31 @@ void TagsStorageSQLite::ClearCache()
     m_cache.Clear();
 }
 
+void TagsStorageSQLite::ClearCache(const wxStringSet_t& files)
+{
+    if(!m_index) {
+        // we can't tell whether the symbols of these files changed
+        m_cache.Clear();
+        return;
+    }
+
+    std::vector<TagEntryPtr> tags;
+    for(const wxString& file : files) {
+        m_index->GetTagsByFile(file, wxArrayString(), tags);
+    }
+    m_cache.Invalidate(files, tags);
+}
+
+wxString TagsStorageSQLite::GetCacheStatistics() const { return m_cache.GetStatistics(); }
+
 PPToken TagsStorageSQLite::GetMacro(const wxString& name)
 {
     PPToken token;
     try {
-        wxString sql;
-        sql << wxT("select * from MACROS where name = '") << name << wxT("'");
-        wxSQLite3ResultSet res = m_db->ExecuteQuery(sql);
+        wxSQLite3Statement& statement = m_db->GetPrepareStatement("select * from MACROS where name = ?");
+        StatementResetter resetter(statement);
+        statement.Bind(1, name);
+        wxSQLite3ResultSet res = statement.ExecuteQuery();
         if(res.NextRow()) {
             PPTokenFromSQlite3ResultSet(res, token);
             return token;
@@ -1111,32 +1674,38 @@ void TagsStorageSQLite::GetTagsByName(const wxString& prefix, std::vector<TagEnt
         if(prefix.IsEmpty())
             return;
 
-        wxString sql;
-        sql << wxT("select * from tags where ");
-        DoAddNamePartToQuery(sql, prefix, !exactMatch, false);
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+        if(m_index) {
+            m_index->GetTagsByName(prefix, !exactMatch, m_enableCaseInsensitive, DoGetLimit(tags), tags);
+            return;
+        }
+
+        clSqliteQuery query;
+        query.Append("select * from tags where ");
+        DoAddNamePartToQuery(query, prefix, !exactMatch, false);
+        DoAddLimitPartToQuery(query, tags);
+        DoFetchTags(query, tags);
 
     } catch (const wxSQLite3Exception& e) {
         clDEBUG() << e.GetMessage() << endl;
     }
 }
 
-void TagsStorageSQLite::DoAddNamePartToQuery(wxString& sql, const wxString& name, bool partial, bool prependAnd)
+void TagsStorageSQLite::DoAddNamePartToQuery(clSqliteQuery& query, const wxString& name, bool partial,
+                                             bool prependAnd)
 {
     if(name.empty())
         return;
     if(prependAnd) {
-        sql << wxT(" AND ");
+        query.Append(" AND ");
     }
 
     if(m_enableCaseInsensitive) {
         wxString tmpName(name);
         tmpName.Replace(wxT("_"), wxT("^_"));
         if(partial) {
-            sql << wxT(" name LIKE '") << tmpName << wxT("%%' ESCAPE '^' ");
+            query.Append(" name LIKE ").Bind(tmpName + "%").Append(" ESCAPE '^' ");
         } else {
-            sql << wxT(" name ='") << name << wxT("' ");
+            query.Append(" name =").Bind(name).Append(" ");
         }
     } else {
         // Don't use LIKE
@@ -1148,20 +1717,25 @@ void TagsStorageSQLite::DoAddNamePartToQuery(wxString& sql, const wxString& name
 
         // add the name condition
         if(partial) {
-            sql << wxT(" name >= '") << from << wxT("' AND  name < '") << until << wxT("'");
+            query.Append(" name >= ").Bind(from).Append(" AND  name < ").Bind(until);
         } else {
-            sql << wxT(" name ='") << name << wxT("' ");
+            query.Append(" name =").Bind(name).Append(" ");
         }
     }
 }
 
-void TagsStorageSQLite::DoAddLimitPartToQuery(wxString& sql, const std::vector<TagEntryPtr>& tags)
+void TagsStorageSQLite::DoAddLimitPartToQuery(clSqliteQuery& query, const std::vector<TagEntryPtr>& tags)
+{
+    // the limit is bound as a value, so all the variations of the query share the same statement
+    query.Append(" LIMIT ").Bind((int)DoGetLimit(tags));
+}
+
+size_t TagsStorageSQLite::DoGetLimit(const std::vector<TagEntryPtr>& tags) const
 {
     if(tags.size() >= (size_t)GetSingleSearchLimit()) {
-        sql << wxT(" LIMIT 1 ");
-    } else {
-        sql << wxT(" LIMIT ") << (size_t)GetSingleSearchLimit() - tags.size();
+        return 1;
     }
+    return (size_t)GetSingleSearchLimit() - tags.size();
 }
 
 TagEntryPtr TagsStorageSQLite::GetTagsByNameLimitOne(const wxString& name)
@@ -1171,12 +1745,15 @@ TagEntryPtr TagsStorageSQLite::GetTagsByNameLimitOne(const wxString& name)
             return NULL;
 
         std::vector<TagEntryPtr> tags;
-        wxString sql;
-        sql << wxT("select * from tags where ");
-        DoAddNamePartToQuery(sql, name, false, false);
-        sql << wxT(" LIMIT 1 ");
-
-        DoFetchTags(sql, tags);
+        if(m_index) {
+            m_index->GetTagsByName(name, false, false, 1, tags);
+        } else {
+            clSqliteQuery query;
+            query.Append("select * from tags where ");
+            DoAddNamePartToQuery(query, name, false, false);
+            query.Append(" LIMIT 1 ");
+            DoFetchTags(query, tags);
+        }
         if(tags.size() == 1)
             return tags.at(0);
         else
@@ -1194,13 +1771,18 @@ void TagsStorageSQLite::GetTagsByPartName(const wxString& partname, std::vector<
         if(partname.IsEmpty())
             return;
 
+        if(m_index) {
+            m_index->GetTagsByPartName(partname, DoGetLimit(tags), tags);
+            return;
+        }
+
         wxString tmpName(partname);
         tmpName.Replace(wxT("_"), wxT("^_"));
 
-        wxString sql;
-        sql << wxT("select * from tags where name like '%%") << tmpName << wxT("%%' ESCAPE '^' ");
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+        clSqliteQuery query;
+        query.Append("select * from tags where name like ").Bind("%" + tmpName + "%").Append(" ESCAPE '^' ");
+        DoAddLimitPartToQuery(query, tags);
+        DoFetchTags(query, tags);
 
     } catch (const wxSQLite3Exception& e) {
         clDEBUG() << e.GetMessage() << endl;
@@ -1215,25 +1797,32 @@ const wxString& TagsStorageSQLite::GetVersion() const
 
 void TagsStorageSQLite::GetTagsByPartName(const wxArrayString& parts, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
+    clSqliteQuery query;
     try {
         if(parts.IsEmpty()) {
             return;
         }
 
-        wxString filterQuery = "where ";
+        if(m_index) {
+            m_index->GetTagsByPathParts(parts, DoGetLimit(tags), tags);
+            return;
+        }
+
+        query.Append("select * from tags where ");
         for(size_t i = 0; i < parts.size(); ++i) {
             wxString tmpName = parts.Item(i);
             tmpName.Replace(wxT("_"), wxT("^_"));
-            filterQuery << "path like '%%" << tmpName << "%%' " << ((i == (parts.size() - 1)) ? "" : "AND ");
+            query.Append("path like ").Bind("%" + tmpName + "%").Append(" ESCAPE '^' ");
+            if(i != (parts.size() - 1)) {
+                query.Append("AND ");
+            }
         }
 
-        sql << "select * from tags " << filterQuery << " ESCAPE '^' ";
-        DoAddLimitPartToQuery(sql, tags);
-        DoFetchTags(sql, tags);
+        DoAddLimitPartToQuery(query, tags);
+        DoFetchTags(query, tags);
 
     } catch (const wxSQLite3Exception& e) {
-        clWARNING() << sql << ":" << e.GetMessage() << clEndl;
+        clWARNING() << query.GetSQL() << ":" << e.GetMessage() << clEndl;
     }
 }
 
@@ -1256,6 +1845,7 @@ void TagsStorageSQLite::ReOpenDatabase()
     }
 
     clDEBUG() << "Open is called for file:" << m_fileName;
+    m_db = new clSqliteDB();
     try {
         // First time we open the db
         m_db->Open(m_fileName.GetFullPath());
@@ -1273,22 +1863,26 @@ void TagsStorageSQLite::GetTagsByPathAndKind(const wxString& path, std::vector<T
     if(path.empty())
         return;
 
-    wxString sql;
-
-    sql << "select * from tags where path='" << path << "'";
-    if(!kinds.empty()) {
-        sql << " and kind in (";
+    if(m_index) {
+        wxArrayString kinds_arr;
         for(const wxString& kind : kinds) {
-            sql << "'" << kind << "',";
+            kinds_arr.Add(kind);
         }
-        sql.RemoveLast();
-        sql << ")";
+        m_index->GetTagsByPath(path, kinds_arr, index_limit(limit), tags);
+        return;
+    }
+
+    clSqliteQuery query;
+
+    query.Append("select * from tags where path=").Bind(path);
+    if(!kinds.empty()) {
+        query.Append(" and kind in (").BindList(kinds).Append(")");
     }
     // to avoid any kind of specialization, sort the entries by DBid
-    sql << " order by ID asc";
-    sql << " limit " << limit;
-    LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << sql << endl; }
-    DoFetchTags(sql, tags);
+    query.Append(" order by ID asc");
+    query.Append(" limit ").Bind(limit);
+    LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << query.GetSQL() << endl; }
+    DoFetchTags(query, tags);
 }
 
 TagEntryPtr TagsStorageSQLite::GetScope(const wxString& filename, int line_number)
@@ -1296,13 +1890,37 @@ TagEntryPtr TagsStorageSQLite::GetScope(const wxString& filename, int line_numbe
     if(filename.empty() || line_number == wxNOT_FOUND)
         return nullptr;
 
-    wxString sql;
-    sql << "select * from tags where file='" << filename << "' and line <= " << line_number
-        << " and name NOT LIKE '__anon%' and KIND IN ('function', 'class', 'struct', 'namespace') order by line desc "
-           "limit 1";
-    LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << sql << endl; }
+    if(m_index) {
+        static const wxArrayString scope_kinds = []() {
+            wxArrayString arr;
+            arr.Add("function");
+            arr.Add("class");
+            arr.Add("struct");
+            arr.Add("namespace");
+            return arr;
+        }();
+
+        std::vector<TagEntryPtr> file_tags;
+        m_index->GetTagsByFile(filename, scope_kinds, file_tags);
+        TagEntryPtr scope;
+        for(const auto& tag : file_tags) {
+            if(tag->GetLine() > line_number || tag->GetName().StartsWith("__anon")) {
+                continue;
+            }
+            if(!scope || tag->GetLine() >= scope->GetLine()) {
+                scope = tag;
+            }
+        }
+        return scope;
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where file=").Bind(filename).Append(" and line <= ").Bind(line_number);
+    query.Append(" and name NOT LIKE '__anon%' and KIND IN ('function', 'class', 'struct', 'namespace') order by "
+                 "line desc limit 1");
+    LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << query.GetSQL() << endl; }
     std::vector<TagEntryPtr> tags;
-    DoFetchTags(sql, tags);
+    DoFetchTags(query, tags);
 
     if(tags.size() == 1) {
         return tags[0];
@@ -1317,27 +1935,63 @@ size_t TagsStorageSQLite::GetFileScopedTags(const wxString& filepath, const wxSt
         return 0;
 
     // get anoymous tags first
-    wxString sql;
     std::vector<TagEntryPtr> tags_1;
     std::vector<TagEntryPtr> tags_2;
-    sql << "select * from tags where file='" << filepath << "' and scope like '__anon%'";
-    if(!name.empty()) {
-        sql << " and name like '" << name << "%'";
-    }
-    LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << sql << endl; }
-    tags_1.reserve(100);
-    DoFetchTags(sql, tags_1, kinds);
+    if(m_index) {
+        static const wxArrayString static_kinds = []() {
+            wxArrayString arr;
+            arr.Add("member");
+            arr.Add("variable");
+            arr.Add("class");
+            arr.Add("struct");
+            arr.Add("enum");
+            return arr;
+        }();
+
+        // the LIKE prefix match of the query below is case insensitive
+        wxString lower_name = name.Lower();
+        auto name_matches = [&lower_name](const TagEntryPtr& tag) {
+            return lower_name.empty() || tag->GetName().Lower().StartsWith(lower_name);
+        };
+
+        std::vector<TagEntryPtr> file_tags;
+        m_index->GetTagsByFile(filepath, wxArrayString(), file_tags);
+        for(const auto& tag : file_tags) {
+            if(!name_matches(tag)) {
+                continue;
+            }
+            if(tag->GetScope().Lower().StartsWith("__anon") && kinds.Index(tag->GetKind()) != wxNOT_FOUND) {
+                tags_1.push_back(tag);
+            }
+            if(static_kinds.Index(tag->GetKind()) != wxNOT_FOUND) {
+                tags_2.push_back(tag);
+            }
+        }
+    } else {
+        {
+            clSqliteQuery query;
+            query.Append("select * from tags where file=").Bind(filepath).Append(" and scope like '__anon%'");
+            if(!name.empty()) {
+                query.Append(" and name like ").Bind(name + "%");
+            }
+            LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << query.GetSQL() << endl; }
+            tags_1.reserve(100);
+            DoFetchTags(query, tags_1, kinds);
+        }
 
-    // get static members
-    sql.Clear();
-    sql << "select * from tags where file='" << filepath
-        << "' and kind in ('member','variable','class','struct','enum')";
-    if(!name.empty()) {
-        sql << " and name like '" << name << "%'";
+        // get static members
+        {
+            clSqliteQuery query;
+            query.Append("select * from tags where file=").Bind(filepath);
+            query.Append(" and kind in ('member','variable','class','struct','enum')");
+            if(!name.empty()) {
+                query.Append(" and name like ").Bind(name + "%");
+            }
+            LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << query.GetSQL() << endl; }
+            tags_2.reserve(100);
+            DoFetchTags(query, tags_2);
+        }
     }
-    LOG_IF_TRACE { clDEBUG1() << "Running SQL:" << sql << endl; }
-    tags_2.reserve(100);
-    DoFetchTags(sql, tags_2);
 
     // filter duplicate
     tags.reserve(tags_2.size() + tags_1.size());
@@ -1364,17 +2018,40 @@ size_t TagsStorageSQLite::GetFileScopedTags(const wxString& filepath, const wxSt
 
 size_t TagsStorageSQLite::GetParameters(const wxString& function_path, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
-    sql << "select * from tags where kind = 'parameter' and scope = '" << function_path << "' order by ID asc";
-    DoFetchTags(sql, tags);
+    if(m_index) {
+        DoGetChildrenById(function_path, "parameter", tags);
+        return tags.size();
+    }
+
+    clSqliteQuery query;
+    query.Append("select * from tags where kind = 'parameter' and scope = ").Bind(function_path);
+    query.Append(" order by ID asc");
+    DoFetchTags(query, tags);
     return tags.size();
 }
 
 size_t TagsStorageSQLite::GetLambdas(const wxString& parent_function, std::vector<TagEntryPtr>& tags)
 {
-    wxString sql;
+    if(m_index) {
+        DoGetChildrenById(parent_function, "function", tags);
+        return tags.size();
+    }
+
+    clSqliteQuery query;
     // assuming `parent_function` is a function, this will return all the lambda children
-    sql << "select * from tags where kind = 'function' and scope = '" << parent_function << "' order by ID asc";
-    DoFetchTags(sql, tags);
+    query.Append("select * from tags where kind = 'function' and scope = ").Bind(parent_function);
+    query.Append(" order by ID asc");
+    DoFetchTags(query, tags);
     return tags.size();
 }
+
+void TagsStorageSQLite::DoGetChildrenById(const wxString& scope, const wxString& kind, std::vector<TagEntryPtr>& tags)
+{
+    wxArrayString kinds;
+    kinds.Add(kind);
+
+    size_t count = tags.size();
+    m_index->GetChildren(scope, wxEmptyString, false, false, kinds, 0, tags);
+    std::sort(tags.begin() + count, tags.end(),
+              [](const TagEntryPtr& a, const TagEntryPtr& b) { return a->GetId() < b->GetId(); });
+}
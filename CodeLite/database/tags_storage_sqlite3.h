@@ -29,10 +29,14 @@
 #include "entry.h"
 #include "fileentry.h"
 #include "istorage.h"
+#include "macros.h"
 #include "tag_tree.h"
+#include "tags_storage_memory_index.h"
 #include "wxStringHash.h"
 
+#include <list>
 #include <unordered_map>
+#include <vector>
 #include <wx/filename.h>
 #include <wx/wxsqlite3.h>
 
@@ -74,6 +78,8 @@
  * | id           | Number | ID
  * | file         | String | Full path of the file
  * | last_retagged| Number | Timestamp for the last time this file was retagged
+ * | size         | Number | The file size when it was retagged (NULL if unknown)
+ * | hash         | Number | xxHash64 of the file content when it was retagged (NULL if unknown)
  *
  * Table Name: MACROS
  *
@@ -91,13 +97,46 @@
  * @ingroup CodeLite
  */
 
-class TagsStorageSQLiteCache
+/**
+ * @brief a bounded LRU cache for the results of the tags lookups.
+ * Every entry records the files its tags came from, so storing or deleting the tags of a file
+ * evicts only the entries that reference that file. A new tag can be a match for any lookup, so
+ * the whole cache is cleared when the symbols defined by a file change (see Invalidate())
+ */
+class WXDLLIMPEXP_CL TagsStorageSQLiteCache
 {
-    std::unordered_map<wxString, std::vector<TagEntryPtr>> m_cache;
+    struct Entry {
+        wxString key;
+        std::vector<TagEntryPtr> tags;
+        wxStringSet_t files;
+        size_t bytes = 0;
+    };
+
+    // most recently used entry first
+    std::list<Entry> m_lru;
+    std::unordered_map<wxString, std::list<Entry>::iterator> m_cache;
+    // file -> keys of the entries holding tags from that file
+    std::unordered_map<wxString, wxStringSet_t> m_filesIndex;
+    // file -> a hash of the symbols it defines, ignoring their position in the file
+    std::unordered_map<wxString, size_t> m_fileSymbols;
+
+    size_t m_maxEntries;
+    size_t m_maxBytes;
+    size_t m_bytes = 0;
+
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+    size_t m_evictions = 0;
+    size_t m_invalidations = 0;
 
 protected:
     bool DoGet(const wxString& key, std::vector<TagEntryPtr>& tags);
     void DoStore(const wxString& key, const std::vector<TagEntryPtr>& tags);
+    void DoErase(std::unordered_map<wxString, std::list<Entry>::iterator>::iterator iter);
+    void DoShrink();
+    void DoClearEntries();
+    // evict the entries holding tags from one of `files`
+    void DoEvictFiles(const wxStringSet_t& files);
 
 public:
     TagsStorageSQLiteCache();
@@ -108,6 +147,86 @@ public:
     void Store(const wxString& sql, const std::vector<TagEntryPtr>& tags);
     void Store(const wxString& sql, const wxArrayString& kind, const std::vector<TagEntryPtr>& tags);
     void Clear();
+
+    /**
+     * @brief evict the entries affected by the deletion of the tags of `files`
+     */
+    void Invalidate(const wxStringSet_t& files);
+
+    /**
+     * @brief evict the entries affected by the tags of `files` being replaced with `tags`. When the symbols
+     * defined by one of the files changed (or were never seen before), the whole cache is cleared: a new symbol
+     * can be a match for any lookup. Otherwise (e.g. only the lines changed) only the entries referencing
+     * `files` are evicted
+     */
+    void Invalidate(const wxStringSet_t& files, const std::vector<TagEntryPtr>& tags);
+
+    /**
+     * @brief set the cache limits. The least recently used entries are evicted once
+     * either the number of entries or their (estimated) memory size exceeds its limit
+     */
+    void SetLimits(size_t maxEntries, size_t maxBytes);
+
+    /**
+     * @brief return the cache counters (size, hits, misses, evictions) formatted for the log
+     */
+    wxString GetStatistics() const;
+};
+
+/**
+ * @brief a parameterized SQL query. The SQL text contains '?' placeholders and the values are kept aside,
+ * so the same SQL text (and its prepared statement) can be reused for different values
+ */
+class WXDLLIMPEXP_CL clSqliteQuery
+{
+    struct Value {
+        bool is_int = false;
+        int int_value = 0;
+        wxString str_value;
+    };
+
+    wxString m_sql;
+    std::vector<Value> m_values;
+
+public:
+    clSqliteQuery() {}
+    ~clSqliteQuery() {}
+
+    /**
+     * @brief append raw SQL text. Never pass user values here, use one of the Bind() methods instead
+     */
+    clSqliteQuery& Append(const wxString& sql)
+    {
+        m_sql << sql;
+        return *this;
+    }
+
+    /**
+     * @brief append a placeholder ("?") and remember its value
+     */
+    clSqliteQuery& Bind(const wxString& value);
+    clSqliteQuery& Bind(int value);
+
+    /**
+     * @brief append a comma separated list of placeholders ("?,?,?"), one per value
+     */
+    clSqliteQuery& BindList(const wxArrayString& values);
+    clSqliteQuery& BindList(const std::vector<wxString>& values);
+
+    /**
+     * @brief the SQL text, used as the key of the prepared statements cache
+     */
+    const wxString& GetSQL() const { return m_sql; }
+
+    /**
+     * @brief a key that identifies this query including its values (for caching the results)
+     */
+    wxString GetCacheKey() const;
+
+    /**
+     * @brief bind the values to a statement that was prepared from GetSQL()
+     */
+    void BindTo(wxSQLite3Statement& statement) const;
 };
 
 class WXDLLIMPEXP_CL clSqliteDB : public wxSQLite3Database
@@ -122,42 +241,85 @@ public:
 
     void Close()
     {
+        // the statements must be finalized before the database is closed
+        m_statements.clear();
         if(IsOpen())
             wxSQLite3Database::Close();
-
-        m_statements.clear();
     }
 
-    wxSQLite3Statement GetPrepareStatement(const wxString& sql) { return wxSQLite3Database::PrepareStatement(sql); }
+    /**
+     * @brief return a prepared statement for `sql`. Statements are prepared once per connection
+     * and reused: the returned statement is reset and ready to be bound.
+     * The reference is valid until the next call to GetPrepareStatement() or Close()
+     */
+    wxSQLite3Statement& GetPrepareStatement(const wxString& sql);
 };
 
 class WXDLLIMPEXP_CL TagsStorageSQLite : public ITagsStorage
 {
     clSqliteDB* m_db;
     TagsStorageSQLiteCache m_cache;
+    TagsStorageMemoryIndex::Ptr_t m_index;
+
+    // a change of the memory index: the tags of `deletedFile` are removed or `tags` are stored
+    struct IndexChange {
+        wxString deletedFile;
+        std::vector<TagEntryPtr> tags;
+    };
+    // the changes made inside a transaction opened by the caller, applied to the index once it is committed
+    std::vector<IndexChange> m_pendingIndexChanges;
 
 private:
+    /**
+     * @brief apply `change` to the memory index, or keep it until Commit() if it was made inside a transaction
+     * opened by the caller (`committed` is false)
+     */
+    void DoUpdateIndex(IndexChange&& change, bool committed);
     /**
      * @brief fetch tags from the database
-     * @param sql
+     * @param query
      * @param tags
      */
-    void DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags);
+    void DoFetchTags(const clSqliteQuery& query, std::vector<TagEntryPtr>& tags);
 
     /**
-     * @brief
-     * @param sql
+     * @brief fetch tags from the database, keep only tags of the given kinds
+     * @param query
      * @param tags
      */
-    void DoFetchTags(const wxString& sql, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds);
+    void DoFetchTags(const clSqliteQuery& query, std::vector<TagEntryPtr>& tags, const wxArrayString& kinds);
+
+    /**
+     * @brief return the cached prepared statement for `query` with its values bound
+     */
+    wxSQLite3Statement& DoPrepare(const clSqliteQuery& query);
 
-    void DoAddNamePartToQuery(wxString& sql, const wxString& name, bool partial, bool prependAnd);
-    void DoAddLimitPartToQuery(wxString& sql, const std::vector<TagEntryPtr>& tags);
+    void DoAddNamePartToQuery(clSqliteQuery& query, const wxString& name, bool partial, bool prependAnd);
+    void DoAddLimitPartToQuery(clSqliteQuery& query, const std::vector<TagEntryPtr>& tags);
+    /**
+     * @brief the number of tags a lookup can still add to `tags` (see DoAddLimitPartToQuery())
+     */
+    size_t DoGetLimit(const std::vector<TagEntryPtr>& tags) const;
     int DoInsertTagEntry(const TagEntry& tag);
+    /**
+     * @brief delete the tags of `fileName` and its file entry. Unlike DeleteByFileName(), the cache is left
+     * untouched and errors are thrown to the caller
+     */
+    void DoDeleteFileTags(const wxString& fileName);
+
+    /**
+     * @brief index lookups: the first operator of `scope` whose name contains `op`
+     */
+    void DoGetOperator(const wxString& scope, const wxString& op, std::vector<TagEntryPtr>& tags);
+    /**
+     * @brief index lookups: the children of `scope` of the given kind, ordered by id
+     */
+    void DoGetChildrenById(const wxString& scope, const wxString& kind, std::vector<TagEntryPtr>& tags);
 
 public:
     static TagEntry* FromSQLite3ResultSet(wxSQLite3ResultSet& rs);
     static void PPTokenFromSQlite3ResultSet(wxSQLite3ResultSet& rs, PPToken& token);
+    static void FileEntryFromSQLite3ResultSet(wxSQLite3ResultSet& rs, FileEntry& entry);
 
 public:
     /**
@@ -205,7 +367,9 @@ public:
 
     /**
      * store list of tags to store. The list is considered complete and all files
-     * affected will be erased from the db first
+     * affected will be erased from the db first.
+     * The whole batch is written using the same (cached) prepared statements and the
+     * results cache is cleared once per batch
      */
     void Store(const std::vector<TagEntryPtr>& tags, bool auto_commit = true);
 
@@ -260,19 +424,12 @@ public:
     /**
      * Commit transaction.
      */
-    void Commit()
-    {
-        try {
-            m_db->Commit();
-        } catch (const wxSQLite3Exception& e) {
-            wxUnusedVar(e);
-        }
-    }
+    void Commit();
 
     /**
      * Rollback transaction.
      */
-    void Rollback() { return m_db->Rollback(); }
+    void Rollback();
 
     /**
      * Test whether the database is opened
@@ -444,9 +601,12 @@ public:
     /**
      * @brief insert entry by file name
      * @param filename
+     * @param size the file size, -1 if unknown
+     * @param contentHash the file content hash, 0 if unknown
      * @return
      */
-    virtual int InsertFileEntry(const wxString& filename, int timestamp);
+    virtual int InsertFileEntry(const wxString& filename, int timestamp, long long size = -1,
+                                uint64_t contentHash = 0);
 
     /**
      * @brief update file entry using file name as key
@@ -477,6 +637,25 @@ public:
      */
     virtual void ClearCache();
 
+    /**
+     * @brief evict the cached results affected by the tags of `files` being replaced by another connection.
+     * The new tags are read from the memory index, without one the whole cache is cleared
+     */
+    virtual void ClearCache(const wxStringSet_t& files);
+
+    /**
+     * @brief return the lookups cache counters, for logging
+     */
+    virtual wxString GetCacheStatistics() const;
+
+    /**
+     * @brief answer the tags lookups from `index` instead of the TAGS table. The index is kept up to date by
+     * Store() and DeleteByFileName() once their changes are committed, it must be loaded
+     * (TagsStorageMemoryIndex::Load()) by the caller. Pass nullptr to query the database again
+     */
+    void SetMemoryIndex(TagsStorageMemoryIndex::Ptr_t index) { m_index = index; }
+    TagsStorageMemoryIndex::Ptr_t GetMemoryIndex() const { return m_index; }
+
     /**
      * @brief
      * @param name
@@ -27,7 +27,12 @@
 
 #include "cl_standard_paths.h"
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <wx/crt.h>
 #include <wx/filename.h>
 #include <wx/log.h>
@@ -40,6 +45,214 @@ wxString FileLogger::m_logfile;
 std::unordered_map<wxThreadIdType, wxString> FileLogger::m_threads;
 wxCriticalSection FileLogger::m_cs;
 
+namespace
+{
+// stop queueing log messages (and count them as dropped) once that many bytes are waiting to be written
+constexpr size_t LOG_QUEUE_MAX_BYTES = 16 * 1024 * 1024;
+// once the log file reaches this size, it is renamed to <log>.1 and a new file is started
+constexpr size_t LOG_FILE_MAX_SIZE = 50 * 1024 * 1024;
+
+// bumped whenever the threads names table changes, so threads can cache their name
+std::atomic_size_t threads_generation{ 1 };
+
+/**
+ * @brief write the log messages from a dedicated thread.
+ * Producers push their messages into a lock-free (LIFO) list which the writer thread
+ * takes as a whole, restores the order and appends to the log file it keeps open
+ */
+class LogWriter
+{
+    struct Node {
+        Node* next = nullptr;
+        std::string text;
+    };
+
+    std::atomic<Node*> m_head{ nullptr };
+    std::atomic_size_t m_pendingBytes{ 0 };
+    std::atomic_size_t m_dropped{ 0 };
+    std::atomic_bool m_shutdown{ false };
+    std::thread* m_thread = nullptr;
+
+    // the members below are protected by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    wxString m_filename;
+    FILE* m_fp = nullptr;
+    size_t m_fileSize = 0;
+
+protected:
+    void Run()
+    {
+        while (true) {
+            Node* list = m_head.exchange(nullptr, std::memory_order_acquire);
+            if (list == nullptr) {
+                if (m_shutdown.load()) {
+                    break;
+                }
+                std::unique_lock<std::mutex> lk{ m_mutex };
+                m_cv.wait_for(lk, std::chrono::milliseconds(100),
+                              [this]() { return m_shutdown.load() || m_head.load() != nullptr; });
+                continue;
+            }
+            std::lock_guard<std::mutex> lk{ m_mutex };
+            WriteList(list);
+        }
+    }
+
+    /// write the list of nodes and free it. Must be called with m_mutex locked
+    void WriteList(Node* list)
+    {
+        // the list is in reverse order
+        Node* head = nullptr;
+        while (list) {
+            Node* next = list->next;
+            list->next = head;
+            head = list;
+            list = next;
+        }
+
+        size_t dropped = m_dropped.exchange(0);
+        if (dropped) {
+            std::string message = "[" + wxDateTime::Now().FormatISOTime().ToStdString() + " WRN] " +
+                                  std::to_string(dropped) + " log messages were dropped (logger overloaded)\n";
+            Write(message);
+        }
+
+        while (head) {
+            Node* next = head->next;
+            Write(head->text);
+            m_pendingBytes.fetch_sub(head->text.length());
+            delete head;
+            head = next;
+        }
+
+        if (m_fp) {
+            fflush(m_fp);
+        }
+    }
+
+    /// Must be called with m_mutex locked
+    void Write(const std::string& text)
+    {
+        if (m_fp == nullptr) {
+            if (m_filename.empty()) {
+                return;
+            }
+            m_fp = wxFopen(m_filename, "a+");
+            if (m_fp == nullptr) {
+                return;
+            }
+            fseek(m_fp, 0, SEEK_END);
+            long size = ftell(m_fp);
+            m_fileSize = size > 0 ? size : 0;
+        }
+
+        fwrite(text.data(), 1, text.length(), m_fp);
+        m_fileSize += text.length();
+        if (m_fileSize >= LOG_FILE_MAX_SIZE) {
+            // rotate the file, we keep a single backup
+            fclose(m_fp);
+            m_fp = nullptr;
+            wxString backup = m_filename + ".1";
+            if (wxFileExists(backup)) {
+                wxRemoveFile(backup);
+            }
+            wxRenameFile(m_filename, backup);
+        }
+    }
+
+    void CloseFile()
+    {
+        if (m_fp) {
+            fclose(m_fp);
+            m_fp = nullptr;
+        }
+    }
+
+public:
+    LogWriter() { m_thread = new std::thread(&LogWriter::Run, this); }
+
+    void SetFile(const wxString& filename)
+    {
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        CloseFile();
+        m_filename = filename;
+    }
+
+    void Push(std::string&& text)
+    {
+        if (m_shutdown.load()) {
+            // the writer thread is gone, write it ourself
+            std::lock_guard<std::mutex> lk{ m_mutex };
+            Write(text);
+            if (m_fp) {
+                fflush(m_fp);
+            }
+            return;
+        }
+
+        size_t len = text.length();
+        if (m_pendingBytes.fetch_add(len) + len > LOG_QUEUE_MAX_BYTES) {
+            m_pendingBytes.fetch_sub(len);
+            m_dropped.fetch_add(1);
+            return;
+        }
+
+        Node* node = new Node();
+        node->text = std::move(text);
+        Node* head = m_head.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!m_head.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+        if (head == nullptr) {
+            // the writer might be sleeping
+            m_cv.notify_one();
+        }
+    }
+
+    /// stop the writer thread and write the remaining messages
+    void Stop()
+    {
+        if (m_shutdown.exchange(true)) {
+            return;
+        }
+        m_cv.notify_one();
+        m_thread->join();
+        wxDELETE(m_thread);
+
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        Node* list = m_head.exchange(nullptr);
+        if (list) {
+            WriteList(list);
+        }
+    }
+};
+
+LogWriter& GetWriter()
+{
+    // never deleted: log messages may be written by static objects destructors.
+    // The thread is stopped by FileLogger::CloseLog(), after that messages are written synchronously
+    static LogWriter* writer = new LogWriter();
+    return *writer;
+}
+
+/**
+ * @brief return the time of the day as "HH:MM:SS". Formatting it is relatively expensive and it changes
+ * once per second, so it is cached per thread
+ */
+const wxString& GetTimeOfDay(time_t seconds)
+{
+    thread_local time_t cached_seconds = 0;
+    thread_local wxString cached_time;
+    if (seconds != cached_seconds || cached_time.empty()) {
+        cached_seconds = seconds;
+        cached_time = wxDateTime(seconds).FormatISOTime();
+    }
+    return cached_time;
+}
+} // namespace
+
 FileLogger::FileLogger(int verbosity, const char* filename, int line_number)
     : m_logEntryVerbosity(verbosity)
     , m_fp(nullptr)
@@ -133,9 +346,12 @@ void FileLogger::OpenLog(const wxString& fullName, int verbosity)
     logfile.AppendDir("logs");
     logfile.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
     m_logfile = logfile.GetFullPath();
+    GetWriter().SetFile(m_logfile);
     SetGlobalLogVerbosity(verbosity);
 }
 
+void FileLogger::CloseLog() { GetWriter().Stop(); }
+
 void FileLogger::AddLogLine(const wxArrayString& arr, int verbosity)
 {
     for (size_t i = 0; i < arr.GetCount(); ++i) {
@@ -149,11 +365,11 @@ void FileLogger::Flush()
     if (m_buffer.IsEmpty()) {
         return;
     }
-    wxFFile fp(m_logfile, "a+");
-    if (fp.IsOpened()) {
-        fp.Write(m_buffer + wxT("\n"), wxConvUTF8);
-        fp.Close();
-    }
+
+    // hand the message to the writer thread
+    m_buffer << wxT("\n");
+    const wxScopedCharBuffer cb = m_buffer.mb_str(wxConvUTF8);
+    GetWriter().Push(std::string(cb.data(), cb.length()));
     m_buffer.Clear();
 }
 
@@ -164,10 +380,12 @@ wxString FileLogger::Prefix(int verbosity)
     }
 
     const auto now = std::chrono::system_clock::now().time_since_epoch();
-    const int ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count() % 1000;
-    const wxString msStr = wxString::Format(wxT("%03d"), ms);
+    const long long now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    const int ms = now_ms % 1000;
     wxString prefix;
-    prefix << wxT("[") << wxDateTime::Now().FormatISOTime() << wxT(":") << msStr;
+    prefix.reserve(64);
+    prefix << wxT("[") << GetTimeOfDay(now_ms / 1000) << wxT(":") << (wxChar)(wxT('0') + ms / 100)
+           << (wxChar)(wxT('0') + (ms / 10) % 10) << (wxChar)(wxT('0') + ms % 10);
     switch (verbosity) {
     case System:
         prefix << wxT(" SYS]");
@@ -203,12 +421,18 @@ wxString FileLogger::GetCurrentThreadName()
     if (wxThread::IsMain()) {
         return "Main";
     }
-    wxCriticalSectionLocker locker(m_cs);
-    std::unordered_map<wxThreadIdType, wxString>::iterator iter = m_threads.find(wxThread::GetCurrentId());
-    if (iter != m_threads.end()) {
-        return iter->second;
+
+    // the name is cached per thread, until the threads table changes
+    thread_local size_t generation = 0;
+    thread_local wxString name;
+    size_t current_generation = threads_generation.load();
+    if (generation != current_generation) {
+        wxCriticalSectionLocker locker(m_cs);
+        std::unordered_map<wxThreadIdType, wxString>::iterator iter = m_threads.find(wxThread::GetCurrentId());
+        name = (iter != m_threads.end()) ? iter->second : wxString();
+        generation = current_generation;
     }
-    return "";
+    return name;
 }
 
 void FileLogger::RegisterThread(wxThreadIdType id, const wxString& name)
@@ -219,6 +443,7 @@ void FileLogger::RegisterThread(wxThreadIdType id, const wxString& name)
         m_threads.erase(iter);
     }
     m_threads[id] = name;
+    threads_generation.fetch_add(1);
 }
 
 void FileLogger::UnRegisterThread(wxThreadIdType id)
@@ -228,4 +453,5 @@ void FileLogger::UnRegisterThread(wxThreadIdType id)
     if (iter != m_threads.end()) {
         m_threads.erase(iter);
     }
+    threads_generation.fetch_add(1);
 }
@@ -98,6 +98,12 @@ public:
      */
     static void OpenLog(const wxString& fullName, int verbosity);
 
+    /**
+     * @brief stop the writer thread and write the pending messages. Messages logged afterwards are written
+     * synchronously. Call this from the application shutdown path (e.g. wxApp::OnExit())
+     */
+    static void CloseLog();
+
     FileLogger& operator<<(FileLoggerFunction f)
     {
         Flush();
@@ -268,7 +274,8 @@ public:
     }
 
     /**
-     * @brief flush the logger content
+     * @brief flush the logger content. The log file is written by a dedicated thread, so this does not block
+     * on I/O. If the writer falls too much behind, messages are dropped (and their number is logged)
      */
     void Flush();
 
@@ -194,6 +194,28 @@ bool FileUtils::ReadFileContent(const wxFileName& fn, wxString& data, const wxMB
     return true;
 }
 
+bool FileUtils::ReadFileContentRaw(const wxString& filepath, std::string& data)
+{
+    wxFFile fp(filepath, "rb");
+    if (!fp.IsOpened()) {
+        clERROR() << "failed to open file:" << filepath << "for read-binary" << endl;
+        return false;
+    }
+
+    size_t len = fp.Length();
+    data.resize(len);
+    if (len == 0) {
+        return true;
+    }
+
+    if (fp.Read(&data[0], len) != len) {
+        clERROR() << "Failed to read file:" << filepath << endl;
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
 void FileUtils::OpenFileExplorerAndSelect(const wxFileName& filename)
 {
 #ifdef __WXMSW__
@@ -922,6 +944,94 @@ bool cksum(const std::string& file, size_t* checksum)
     *checksum = crc;
     return true;
 }
+
+// xxHash64 (https://github.com/Cyan4973/xxHash), one shot version
+constexpr uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t xxh_rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t xxh_read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t xxh_read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t xxhash64(const unsigned char* p, size_t len, uint64_t seed = 0)
+{
+    const unsigned char* end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        const unsigned char* limit = end - 32;
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        do {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh_merge_round(h, v1);
+        h = xxh_merge_round(h, v2);
+        h = xxh_merge_round(h, v3);
+        h = xxh_merge_round(h, v4);
+    } else {
+        h = seed + XXH_PRIME64_5;
+    }
+
+    h += (uint64_t)len;
+    while (p + 8 <= end) {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)xxh_read32(p) * XXH_PRIME64_1;
+        h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * XXH_PRIME64_5;
+        h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
 } // namespace
 
 bool FileUtils::GetChecksum(const wxString& filepath, size_t* checksum)
@@ -929,6 +1039,32 @@ bool FileUtils::GetChecksum(const wxString& filepath, size_t* checksum)
     return cksum(ToStdString(filepath), checksum);
 }
 
+bool FileUtils::GetContentHash(const wxString& filepath, uint64_t* hash, size_t* size)
+{
+    FILE* fp = fopen(ToStdString(filepath).c_str(), "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    std::string content;
+    char buf[BUFLEN];
+    size_t bytes_read;
+    while ((bytes_read = fread(buf, 1, BUFLEN, fp)) > 0) {
+        content.append(buf, bytes_read);
+    }
+    bool ok = ferror(fp) == 0;
+    fclose(fp);
+    if (!ok) {
+        return false;
+    }
+
+    *hash = xxhash64(reinterpret_cast<const unsigned char*>(content.data()), content.length());
+    if (size) {
+        *size = content.length();
+    }
+    return true;
+}
+
 bool FileUtils::IsBinaryExecutable(const wxString& filename)
 {
 #ifdef __WXMSW__
@@ -29,6 +29,7 @@
 #include "codelite_exports.h"
 #include "macros.h"
 
+#include <cstdint>
 #include <wx/filename.h>
 #include <wx/log.h>
 
@@ -58,6 +59,12 @@ public:
 public:
     static bool ReadFileContent(const wxFileName& fn, wxString& data, const wxMBConv& conv = wxConvUTF8);
 
+    /**
+     * @brief read the file content as-is, without any conversion, into `data`
+     * `data` is resized to the file size, so callers may reuse the same buffer across calls
+     */
+    static bool ReadFileContentRaw(const wxString& filepath, std::string& data);
+
     /**
      * @brief attempt to read up to bufferSize from the beginning of file
      */
@@ -316,6 +323,12 @@ public:
      */
     static bool GetChecksum(const wxString& filepath, size_t* checksum);
 
+    /**
+     * @brief calculate a fast (non cryptographic) 64 bit hash of the file content (xxHash64)
+     * @param size [output] if not null, set to the size of the file content
+     */
+    static bool GetContentHash(const wxString& filepath, uint64_t* hash, size_t* size = nullptr);
+
     /**
      * @brief convert any string into a valid filename while allowing only alphanum + '_' + '-' + '.'
      * example: "/12d#$file.exe" -> "_12d__file.exe"
@@ -42,6 +42,7 @@
 
 #include <memory>
 #include <stdio.h>
+#include <string>
 #include <wx/tokenzr.h>
 #ifdef __WXMSW__
 #include <wx/msw/private.h>
@@ -521,6 +522,71 @@ wxString ProcUtils::SafeExecuteCommand(const wxString& command)
     return strOut;
 }
 
+void ProcUtils::SafeExecuteCommandWithCallback(const wxString& command,
+                                               const std::function<void(const wxString&)>& on_line)
+{
+    // split `buffer` into lines and pass the complete ones to the callback
+    auto consume_lines = [&](std::string& buffer, bool flush) {
+        size_t start = 0;
+        size_t where = buffer.find('\n');
+        while (where != std::string::npos) {
+            size_t len = where - start;
+            if (len > 0 && buffer[where - 1] == '\r') {
+                --len;
+            }
+            on_line(wxString::FromUTF8(buffer.data() + start, len));
+            start = where + 1;
+            where = buffer.find('\n', start);
+        }
+        buffer.erase(0, start);
+        if (flush && !buffer.empty()) {
+            on_line(wxString::FromUTF8(buffer.data(), buffer.length()));
+            buffer.clear();
+        }
+    };
+
+    std::string buffer;
+#ifdef __WXMSW__
+    wxString errMsg;
+    LOG_IF_TRACE { clDEBUG1() << "executing process:" << command << endl; }
+    std::unique_ptr<WinProcess> proc{ WinProcess::Execute(command, errMsg) };
+    if (!proc) {
+        return;
+    }
+
+    wxString tmpbuf;
+    bool alive = true;
+    while (alive) {
+        alive = proc->IsAlive();
+        tmpbuf.Clear();
+        // once the process terminated, read the remainder of its output
+        while (proc->Read(tmpbuf) && !tmpbuf.empty()) {
+            buffer.append(tmpbuf.ToStdString(wxConvUTF8));
+            tmpbuf.Clear();
+            consume_lines(buffer, false);
+        }
+        if (alive) {
+            wxThread::Sleep(1);
+        }
+    }
+    proc->Cleanup();
+#else
+    FILE* fp = popen(command.mb_str(wxConvUTF8), "r");
+    if (!fp) {
+        return;
+    }
+
+    char chunk[64 * 1024];
+    size_t bytes_read = 0;
+    while ((bytes_read = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        buffer.append(chunk, bytes_read);
+        consume_lines(buffer, false);
+    }
+    pclose(fp);
+#endif
+    consume_lines(buffer, true);
+}
+
 wxString ProcUtils::GrepCommandOutput(const std::vector<wxString>& cmd, const wxString& find_what)
 {
     IProcess::Ptr_t proc(::CreateAsyncProcess(nullptr, cmd, IProcessCreateDefault | IProcessCreateSync));
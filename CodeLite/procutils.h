@@ -26,6 +26,7 @@
 
 #include "codelite_exports.h"
 
+#include <functional>
 #include <map>
 #include <set>
 #include <vector>
@@ -115,6 +116,14 @@ public:
      */
     static wxString SafeExecuteCommand(const wxString& command);
 
+    /**
+     * @brief execute a command and pass its output to `on_line`, one line at a time (without the line terminator),
+     * as it is produced. Unlike SafeExecuteCommand, the output is never buffered as a whole.
+     * This function is safe to be called from secondary thread
+     */
+    static void SafeExecuteCommandWithCallback(const wxString& command,
+                                               const std::function<void(const wxString&)>& on_line);
+
     /**
      * @brief execute command and execute the callback on each line until the callback returns true
      */
@@ -25,6 +25,7 @@
 #include "search_thread.h"
 
 #include "clFilesCollector.h"
+#include "clTrigramIndex.hpp"
 #include "clWildMatch.hpp"
 #include "dirtraverser.h"
 #include "file_logger.h"
@@ -32,8 +33,14 @@
 #include "macros.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <set>
+#include <string_view>
+#include <thread>
 #include <wx/dir.h>
 #include <wx/event.h>
 #include <wx/fontmap.h>
@@ -66,9 +73,137 @@ namespace
 {
 bool is_word_char(wxChar ch) { return ch == '_' || wxIsalnum(ch); }
 
-// Minumum of 10ms between events that this thread is sending to the main thread
-constexpr long MIN_SEND_INTERVAL_MS = 1;
-size_t send_count = 0;
+// Buffered results are sent to the owner once there are this many of them, or when
+// MIN_SEND_INTERVAL_MS passed since the last batch was sent
+constexpr size_t RESULTS_BATCH_SIZE = 500;
+constexpr long MIN_SEND_INTERVAL_MS = 50;
+
+// Maximum number of results posted to the owner and not consumed yet. Beyond this, the
+// search waits for the owner (up to PENDING_RESULTS_TIMEOUT, or until the search is stopped)
+constexpr size_t MAX_PENDING_RESULTS = 5000;
+constexpr std::chrono::milliseconds PENDING_RESULTS_TIMEOUT{ 2000 };
+
+// Patterns (the matching line) longer than this are truncated
+constexpr size_t MAX_PATTERN_LENGTH = 500;
+
+// Number of files a worker claims at once in parallel mode. Small enough
+// to keep the workers balanced and the in-order delivery window tight
+constexpr size_t PARALLEL_CHUNK_SIZE = 8;
+
+// Below this number of files, the parallel search is not worth the threads
+constexpr size_t PARALLEL_MIN_FILES = 64;
+
+// How far the workers may get ahead of the results delivery. Bounds the memory held
+// by results that were found but not delivered yet
+constexpr size_t PARALLEL_MAX_FILES_AHEAD = 512;
+
+// Files bigger than this are left to FileUtils::ReadFileContent (which refuses them)
+constexpr size_t MAX_RAW_SEARCH_FILE_SIZE = 100 << 20;
+
+bool is_ascii(const wxString& str)
+{
+    for (wxChar ch : str) {
+        if (ch >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline char ascii_lower(char ch) { return (ch >= 'A' && ch <= 'Z') ? (ch | 0x20) : ch; }
+
+/// Find the first occurrence of `needle` in the range [begin, end)
+/// When `icase` is true, `needle` is expected to be lower case ASCII
+const char* find_bytes(const char* begin, const char* end, std::string_view needle, bool icase)
+{
+    size_t count = end - begin;
+    if (count < needle.length()) {
+        return nullptr;
+    }
+
+    if (!icase) {
+        // string_view::find scans for the first byte with memchr
+        size_t where = std::string_view{ begin, count }.find(needle);
+        return where == std::string_view::npos ? nullptr : begin + where;
+    }
+
+    // scan for both cases of the first byte, then compare the remainder
+    char first_lower = needle[0];
+    char first_upper = (first_lower >= 'a' && first_lower <= 'z') ? (first_lower & ~0x20) : first_lower;
+    const char* last = end - needle.length() + 1; // one past the last possible match start
+    auto find_byte = [last](const char* from, char ch) -> const char* {
+        return from < last ? static_cast<const char*>(::memchr(from, ch, last - from)) : nullptr;
+    };
+
+    // the next occurrence of each case of the first byte. Only the one consumed by
+    // a failed comparison is searched again, so each byte is scanned once per case
+    const char* next_lower = find_byte(begin, first_lower);
+    const char* next_upper = (first_upper != first_lower) ? find_byte(begin, first_upper) : nullptr;
+    while (next_lower || next_upper) {
+        bool is_lower = next_upper == nullptr || (next_lower && next_lower < next_upper);
+        const char* candidate = is_lower ? next_lower : next_upper;
+
+        size_t i = 1;
+        for (; i < needle.length(); ++i) {
+            if (ascii_lower(candidate[i]) != needle[i]) {
+                break;
+            }
+        }
+        if (i == needle.length()) {
+            return candidate;
+        }
+
+        if (is_lower) {
+            next_lower = find_byte(candidate + 1, first_lower);
+        } else {
+            next_upper = find_byte(candidate + 1, first_upper);
+        }
+    }
+    return nullptr;
+}
+
+/// Return the number of wxString characters the UTF-8 range [begin, end) decodes into
+size_t count_utf8_chars(const char* begin, const char* end)
+{
+    size_t count = 0;
+    for (const char* p = begin; p < end; ++p) {
+        unsigned char ch = *p;
+        // skip continuation bytes
+        count += (ch & 0xC0) != 0x80;
+        if constexpr (sizeof(wchar_t) == 2) {
+            // 4 bytes sequences are stored as surrogate pairs
+            count += ch >= 0xF0;
+        }
+    }
+    return count;
+}
+
+/// Return the pattern to keep for a matching line
+SearchSharedString make_pattern(const wxString& line)
+{
+    return std::make_shared<const wxString>(line.length() > MAX_PATTERN_LENGTH ? line.Mid(0, MAX_PATTERN_LENGTH)
+                                                                               : line);
+}
+
+/// Split the find string into the searched string and its pipe filters
+void split_find_string(const SearchData* data, wxString& findString, wxArrayString& filters)
+{
+    findString = data->GetFindString();
+    filters.clear();
+    if (data->IsEnablePipeSupport() && data->GetFindString().Find('|') != wxNOT_FOUND) {
+        findString = data->GetFindString().BeforeFirst('|');
+
+        wxString filtersString = data->GetFindString().AfterFirst('|');
+        filters = ::wxStringTokenize(filtersString, "|", wxTOKEN_STRTOK);
+    }
+}
+
+// The result of scanning a single file by a worker thread
+struct FileSearchSlot {
+    SearchResultList results;
+    bool scanned = false;
+    bool done = false;
+};
 
 } // namespace
 
@@ -92,6 +227,8 @@ SearchData& SearchData::Copy(const SearchData& other)
     m_files.clear();
     m_files.reserve(other.m_files.size());
     m_file_scanner_flags = other.m_file_scanner_flags;
+    m_maxResults = other.m_maxResults;
+    m_resumeFrom = other.m_resumeFrom;
     for (size_t i = 0; i < other.m_files.size(); ++i) {
         m_files.Add(other.m_files.Item(i).c_str());
     }
@@ -104,6 +241,7 @@ SearchData& SearchData::Copy(const SearchData& other)
 
 SearchThread::SearchThread()
     : WorkerThread()
+    , m_throttle(std::make_shared<SearchResultsThrottle>())
     , m_reExpr(wxT(""))
 {
     m_stopWatch.Start();
@@ -111,6 +249,19 @@ SearchThread::SearchThread()
 
 SearchThread::~SearchThread() {}
 
+void SearchThread::CompileRegex(wxRegEx& re, const wxString& expr, bool matchCase)
+{
+#ifndef __WXMAC__
+    int flags = wxRE_ADVANCED;
+#else
+    int flags = wxRE_DEFAULT;
+#endif
+
+    if (!matchCase)
+        flags |= wxRE_ICASE;
+    re.Compile(expr, flags);
+}
+
 wxRegEx& SearchThread::GetRegex(const wxString& expr, bool matchCase)
 {
     if (m_reExpr == expr && matchCase == m_matchCase) {
@@ -118,15 +269,7 @@ wxRegEx& SearchThread::GetRegex(const wxString& expr, bool matchCase)
     } else {
         m_reExpr = expr;
         m_matchCase = matchCase;
-#ifndef __WXMAC__
-        int flags = wxRE_ADVANCED;
-#else
-        int flags = wxRE_DEFAULT;
-#endif
-
-        if (!matchCase)
-            flags |= wxRE_ICASE;
-        m_regex.Compile(m_reExpr, flags);
+        CompileRegex(m_regex, m_reExpr, m_matchCase);
     }
     return m_regex;
 }
@@ -138,6 +281,8 @@ void SearchThread::ProcessRequest(ThreadRequest* req)
     FileLogger::RegisterThread(wxThread::GetCurrentId(), "Search Thread");
     wxStopWatch sw;
     m_summary = SearchSummary();
+    // results from a previous search that are still pending are accounted by the previous throttle
+    std::atomic_store(&m_throttle, std::make_shared<SearchResultsThrottle>());
     DoSearchFiles(req);
     m_summary.SetElapsedTime(sw.Time());
 
@@ -227,6 +372,16 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
     StopSearch(false);
     wxArrayString fileList;
     GetFiles(data, fileList);
+    FilterFilesByIndex(data, fileList);
+
+    if (!data->GetResumeFrom().empty()) {
+        // continue a previous search: skip the files that were already searched (the list is sorted)
+        size_t first = 0;
+        while (first < fileList.size() && fileList.Item(first).CmpNoCase(data->GetResumeFrom()) < 0) {
+            ++first;
+        }
+        fileList.RemoveAt(0, first);
+    }
 
     wxStopWatch sw;
 
@@ -242,6 +397,26 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
         }
     }
 
+#if wxUSE_GUI
+    // wxFontMapper is not thread safe: resolve the encoding once, before starting the workers
+    wxFontEncoding encoding = wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str());
+#else
+    wxFontEncoding encoding = wxFONTENCODING_SYSTEM;
+#endif
+
+    size_t num_workers = std::max(1u, std::thread::hardware_concurrency());
+    if (data->IsParallelSearch() && num_workers > 1 && fileList.size() >= PARALLEL_MIN_FILES) {
+        if (!DoParallelSearchFiles(fileList, data, encoding)) {
+            // Send cancel event
+            SendEvent(wxEVT_SEARCH_THREAD_SEARCHCANCELED, data->GetOwner());
+            StopSearch(false);
+        }
+        return;
+    }
+
+    if (data->IsRegularExpression()) {
+        GetRegex(data->GetFindString(), data->IsMatchCase());
+    }
     for (size_t i = 0; i < fileList.Count(); i++) {
         m_summary.SetNumFileScanned((int)i + 1);
 
@@ -252,58 +427,247 @@ void SearchThread::DoSearchFiles(ThreadRequest* req)
             StopSearch(false);
             break;
         }
-        DoSearchFile(fileList.Item(i), data);
+        SearchResultList results;
+        bool scanned = DoSearchFile(fileList.Item(i), data, encoding, m_regex, results);
+        if (!DoDeliverFileResults(i, fileList, scanned, results, data)) {
+            break;
+        }
     }
 }
 
-bool SearchThread::TestStopSearch()
+void SearchThread::FilterFilesByIndex(const SearchData* data, wxArrayString& files)
 {
-    bool stop = false;
-    {
-        wxCriticalSectionLocker locker(m_cs);
-        stop = m_stopSearch;
+    if (!clTrigramIndex::Get().IsOpened()) {
+        return;
+    }
+
+#if wxUSE_GUI
+    // the index is built from the raw file bytes
+    if (wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str()) != wxFONTENCODING_UTF8) {
+        return;
+    }
+
+    std::vector<wxString> literals;
+    if (data->IsRegularExpression()) {
+        literals = clTrigramIndex::GetRegexLiterals(data->GetFindString());
+    } else {
+        wxString findString;
+        wxArrayString filters;
+        split_find_string(data, findString, filters);
+        literals.push_back(findString);
+        literals.insert(literals.end(), filters.begin(), filters.end());
+    }
+    clTrigramIndex::Get().Filter(files, literals, data->IsMatchCase());
+#else
+    wxUnusedVar(data);
+    wxUnusedVar(files);
+#endif
+}
+
+bool SearchThread::DoParallelSearchFiles(const wxArrayString& files, const SearchData* data,
+                                         wxFontEncoding encoding)
+{
+    const size_t count = files.size();
+    const size_t num_workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                (count + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE);
+    clDEBUG() << "Searching" << count << "files using" << num_workers << "threads" << endl;
+
+    std::vector<FileSearchSlot> slots(count);
+    std::atomic_size_t next_file{ 0 };
+    std::atomic_size_t delivered{ 0 };
+    std::atomic_bool limit_reached{ false };
+    std::mutex slots_mutex;
+    std::condition_variable slot_done;
+    std::condition_variable slot_delivered;
+
+    auto should_stop = [&]() { return limit_reached.load() || TestStopSearch(); };
+
+    auto worker = [&]() {
+        // wxRegEx keeps the last match state, so each worker needs its own copy
+        wxRegEx re;
+        if (data->IsRegularExpression()) {
+            CompileRegex(re, data->GetFindString(), data->IsMatchCase());
+        }
+
+        while (!should_stop()) {
+            // do not get too far ahead of the delivery (which waits for the owner to consume the results)
+            if (next_file.load() >= delivered.load() + PARALLEL_MAX_FILES_AHEAD) {
+                std::unique_lock<std::mutex> lk{ slots_mutex };
+                slot_delivered.wait_for(lk, std::chrono::milliseconds(50));
+                continue;
+            }
+
+            // claim the next chunk of files. Idle workers keep grabbing chunks
+            // until the list is exhausted, so a worker stuck on a large file
+            // does not hold back the others
+            size_t first = next_file.fetch_add(PARALLEL_CHUNK_SIZE);
+            if (first >= count) {
+                break;
+            }
+            size_t last = std::min(first + PARALLEL_CHUNK_SIZE, count);
+            for (size_t i = first; i < last && !should_stop(); ++i) {
+                SearchResultList results;
+                bool scanned = DoSearchFile(files.Item(i), data, encoding, re, results);
+                {
+                    std::lock_guard<std::mutex> lk{ slots_mutex };
+                    slots[i].results.swap(results);
+                    slots[i].scanned = scanned;
+                    slots[i].done = true;
+                }
+                slot_done.notify_one();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    // deliver the results in the file list order
+    bool cancelled = false;
+    for (size_t i = 0; i < count; ++i) {
+        SearchResultList results;
+        bool scanned = false;
+        {
+            std::unique_lock<std::mutex> lk{ slots_mutex };
+            // StopSearch() is called from another thread without notifying us,
+            // so wake up periodically to check for cancellation
+            while (!slots[i].done && !TestStopSearch()) {
+                slot_done.wait_for(lk, std::chrono::milliseconds(50));
+            }
+            if (!slots[i].done) {
+                cancelled = true;
+                break;
+            }
+            results.swap(slots[i].results);
+            scanned = slots[i].scanned;
+        }
+        m_summary.SetNumFileScanned((int)i + 1);
+        bool more = DoDeliverFileResults(i, files, scanned, results, data);
+        delivered.store(i + 1);
+        slot_delivered.notify_all();
+        if (!more) {
+            // stop the workers
+            limit_reached.store(true);
+            break;
+        }
+    }
+
+    for (auto& t : workers) {
+        t.join();
+    }
+    return !cancelled;
+}
+
+bool SearchThread::DoDeliverFileResults(size_t fileIndex, const wxArrayString& files, bool scanned,
+                                        SearchResultList& results, const SearchData* data)
+{
+    if (!scanned) {
+        m_summary.GetFailedFiles().Add(files.Item(fileIndex));
+
+    } else if (!results.empty()) {
+        m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + (int)results.size());
+        if (m_results.empty()) {
+            m_results.swap(results);
+        } else {
+            m_results.insert(m_results.end(), results.begin(), results.end());
+        }
     }
-    return stop;
+
+    bool limit_reached =
+        data->GetMaxResults() > 0 && (size_t)m_summary.GetNumMatchesFound() >= data->GetMaxResults();
+
+    // batch the results: posting an event per file floods the owner on broad searches
+    if (!m_results.empty() && (limit_reached || m_results.size() >= RESULTS_BATCH_SIZE ||
+                               (m_stopWatch.Time() - m_msPassed) >= MIN_SEND_INTERVAL_MS)) {
+        SendEvent(wxEVT_SEARCH_THREAD_MATCHFOUND, data->GetOwner());
+    }
+
+    if (limit_reached) {
+        if (fileIndex + 1 < files.size()) {
+            m_summary.SetResumeFrom(files.Item(fileIndex + 1));
+        }
+        return false;
+    }
+    return true;
 }
 
+bool SearchThread::TestStopSearch() { return m_stopSearch.load(); }
+
 void SearchThread::StopSearch(bool stop)
 {
-    wxCriticalSectionLocker locker(m_cs);
-    m_stopSearch = stop;
+    m_stopSearch.store(stop);
+    if (stop) {
+        // do not leave the search thread waiting for the owner to consume the results
+        std::atomic_load(&m_throttle)->Interrupt();
+    }
 }
 
-void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data)
+bool SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data, wxFontEncoding encoding,
+                                wxRegEx& re, SearchResultList& results)
 {
     // Process single lines
     int lineNumber = 1;
     if (!wxFileName::FileExists(fileName)) {
-        return;
+        return true;
     }
 
     // ignore binary executables
     if (FileUtils::IsBinaryExecutable(fileName)) {
-        return;
+        return true;
     }
 
     size_t size = FileUtils::GetFileSize(fileName);
     if (size == 0) {
-        return;
+        return true;
+    }
+
+    // simple search: split the find string from its pipe filters
+    wxString findString;
+    wxArrayString filters;
+    if (!data->IsRegularExpression()) {
+        split_find_string(data, findString, filters);
+        if (!data->IsMatchCase()) {
+            for (size_t i = 0; i < filters.size(); ++i) {
+                filters.Item(i).MakeLower();
+            }
+        }
+
+        // Dont search for empty strings
+        if (findString.empty()) {
+            return true;
+        }
+
+        if (!data->IsMatchCase()) {
+            findString.MakeLower();
+        }
     }
-    wxString fileData;
-    fileData.Alloc(size);
+
+    FileStrings strings;
+    strings.fileName = std::make_shared<const wxString>(fileName);
+    strings.findWhat = std::make_shared<const wxString>(data->GetFindString());
 
 #if wxUSE_GUI
     // support for other encoding
-    wxFontEncoding enc = wxFontMapper::GetEncodingFromName(data->GetEncoding().c_str());
-    wxCSConv fontEncConv(enc);
+    if (!data->IsRegularExpression() && encoding == wxFONTENCODING_UTF8 && size <= MAX_RAW_SEARCH_FILE_SIZE &&
+        DoSearchFileRaw(strings, data, findString, filters, results)) {
+        return true;
+    }
+
+    wxString fileData;
+    fileData.Alloc(size);
+    wxCSConv fontEncConv(encoding);
     if (!FileUtils::ReadFileContent(fileName, fileData, fontEncConv)) {
-        m_summary.GetFailedFiles().Add(fileName);
-        return;
+        return false;
     }
 #else
+    wxUnusedVar(encoding);
+    wxString fileData;
+    fileData.Alloc(size);
     if (!FileUtils::ReadFileContent(fileName, fileData, wxConvLibc)) {
-        m_summary.GetFailedFiles().Add(fileName);
-        return;
+        return false;
     }
 #endif
     wxArrayString lines = ::wxStringTokenize(fileData, wxT("\n"), wxTOKEN_RET_EMPTY_ALL);
@@ -313,57 +677,101 @@ void SearchThread::DoSearchFile(const wxString& fileName, const SearchData* data
         // regular expression search
         for (const wxString& line : lines) {
             // Read the next line
-            DoSearchLineRE(line, lineNumber, lineOffset, fileName, data);
+            DoSearchLineRE(line, lineNumber, lineOffset, strings, data, re, results);
             lineOffset += line.Length() + 1;
             lineNumber++;
         }
     } else {
-        // simple search
-        wxString findString;
-        wxArrayString filters;
-        findString = data->GetFindString();
-        if (data->IsEnablePipeSupport()) {
-            if (data->GetFindString().Find('|') != wxNOT_FOUND) {
-                findString = data->GetFindString().BeforeFirst('|');
-
-                wxString filtersString = data->GetFindString().AfterFirst('|');
-                filters = ::wxStringTokenize(filtersString, "|", wxTOKEN_STRTOK);
-                if (!data->IsMatchCase()) {
-                    for (size_t i = 0; i < filters.size(); ++i) {
-                        filters.Item(i).MakeLower();
-                    }
-                }
-            }
+        for (const wxString& line : lines) {
+            DoSearchLine(line, lineNumber, lineOffset, strings, data, findString, filters, results);
+            lineOffset += line.Length() + 1;
+            lineNumber++;
         }
+    }
+    return true;
+}
 
-        // Dont search for empty strings
-        if (findString.empty()) {
-            return;
+bool SearchThread::DoSearchFileRaw(const FileStrings& strings,
+                                   const SearchData* data,
+                                   const wxString& findWhat,
+                                   const wxArrayString& filters,
+                                   SearchResultList& results)
+{
+    bool icase = !data->IsMatchCase();
+    if (icase && !is_ascii(findWhat)) {
+        // case folding of non ASCII characters is left to wxString
+        return false;
+    }
+
+    const wxScopedCharBuffer needle_buffer = findWhat.ToUTF8();
+    std::string_view needle{ needle_buffer.data(), needle_buffer.length() };
+    if (needle.empty()) {
+        return false;
+    }
+
+    // the buffer is re-used between calls made on the same thread
+    thread_local std::string buffer;
+    if (!FileUtils::ReadFileContentRaw(*strings.fileName, buffer)) {
+        // let the default path report the failure
+        return false;
+    }
+
+    const size_t results_count = results.size();
+    const char* begin = buffer.data();
+    const char* end = begin + buffer.size();
+
+    // line number and character offset of `counted`. Both are advanced lazily,
+    // only when a matching line is found
+    const char* counted = begin;
+    int lineNumber = 1;
+    int lineOffset = 0;
+
+    const char* p = begin;
+    while (p < end) {
+        const char* hit = find_bytes(p, end, needle, icase);
+        if (hit == nullptr) {
+            break;
         }
 
-        if (!data->IsMatchCase()) {
-            findString.MakeLower();
+        // the boundaries of the line containing the match
+        const char* line_start = hit;
+        while (line_start > p && line_start[-1] != '\n') {
+            --line_start;
         }
-        for (const wxString& line : lines) {
-            DoSearchLine(line, lineNumber, lineOffset, fileName, data, findString, filters);
-            lineOffset += line.Length() + 1;
-            lineNumber++;
+        const char* line_end = static_cast<const char*>(::memchr(hit, '\n', end - hit));
+        if (line_end == nullptr) {
+            line_end = end;
         }
-    }
 
-    if (m_results.empty() == false) {
-        SendEvent(wxEVT_SEARCH_THREAD_MATCHFOUND, data->GetOwner());
+        lineNumber += (int)std::count(counted, line_start, '\n');
+        lineOffset += (int)count_utf8_chars(counted, line_start);
+        counted = line_start;
+
+        wxString line = wxString::FromUTF8(line_start, line_end - line_start);
+        if (line.empty()) {
+            // not a valid UTF-8 line, fallback to the default search
+            results.resize(results_count);
+            return false;
+        }
+        DoSearchLine(line, lineNumber, lineOffset, strings, data, findWhat, filters, results);
+        p = line_end + 1;
     }
+    return true;
 }
 
-void SearchThread::DoSearchLineRE(
-    const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName, const SearchData* data)
+void SearchThread::DoSearchLineRE(const wxString& line,
+                                  const int lineNum,
+                                  const int lineOffset,
+                                  const FileStrings& strings,
+                                  const SearchData* data,
+                                  wxRegEx& re,
+                                  SearchResultList& results)
 {
-    wxRegEx& re = GetRegex(data->GetFindString(), data->IsMatchCase());
     size_t col = 0;
     int iCorrectedCol = 0;
     int iCorrectedLen = 0;
     wxString modLine = line;
+    SearchSharedString pattern;
     if (re.IsValid()) {
         while (re.Matches(modLine)) {
             size_t start, len;
@@ -379,12 +787,16 @@ void SearchThread::DoSearchLineRE(
             result.SetColumnInChars((int)col);
             result.SetColumn(iCorrectedCol);
             result.SetLineNumber(lineNum);
-            result.SetPattern(line);
-            result.SetFileName(fileName);
+            if (!pattern) {
+                // all the matches of this line share the pattern
+                pattern = make_pattern(line);
+            }
+            result.SetPattern(pattern);
+            result.SetFileName(strings.fileName);
             result.SetLenInChars((int)len);
             result.SetLen(iCorrectedLen);
             result.SetFlags(data->m_flags);
-            result.SetFindWhat(data->GetFindString());
+            result.SetFindWhat(strings.findWhat);
             wxArrayString regexCaptures;
             for (size_t i = 0; i < re.GetMatchCount(); ++i) {
                 regexCaptures.Add(re.GetMatch(modLine, i));
@@ -392,8 +804,7 @@ void SearchThread::DoSearchLineRE(
             result.SetRegexCaptures(regexCaptures);
 
             // Make sure our match is not on a comment
-            m_results.push_back(result);
-            m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + 1);
+            results.push_back(result);
 
             col += len;
 
@@ -408,10 +819,11 @@ void SearchThread::DoSearchLineRE(
 void SearchThread::DoSearchLine(const wxString& line,
                                 const int lineNum,
                                 const int lineOffset,
-                                const wxString& fileName,
+                                const FileStrings& strings,
                                 const SearchData* data,
                                 const wxString& findWhat,
-                                const wxArrayString& filters)
+                                const wxArrayString& filters,
+                                SearchResultList& results)
 {
     wxString modLine = line;
 
@@ -423,6 +835,7 @@ void SearchThread::DoSearchLine(const wxString& line,
     int col = 0;
     int iCorrectedCol = 0;
     int iCorrectedLen = 0;
+    SearchSharedString pattern;
     while (pos != wxNOT_FOUND) {
         pos = modLine.Find(findWhat);
         if (pos != wxNOT_FOUND) {
@@ -477,16 +890,18 @@ void SearchThread::DoSearchLine(const wxString& line,
             result.SetColumnInChars(col);
             result.SetColumn(iCorrectedCol);
             result.SetLineNumber(lineNum);
-            // Dont use match pattern larger than 500 chars
-            result.SetPattern(line.length() > 500 ? line.Mid(0, 500) : line);
-            result.SetFileName(fileName);
+            if (!pattern) {
+                // all the matches of this line share the pattern
+                pattern = make_pattern(line);
+            }
+            result.SetPattern(pattern);
+            result.SetFileName(strings.fileName);
             result.SetLenInChars((int)findWhat.Length());
             result.SetLen(iCorrectedLen);
-            result.SetFindWhat(data->GetFindString());
+            result.SetFindWhat(strings.findWhat);
             result.SetFlags(data->m_flags);
 
-            m_results.push_back(result);
-            m_summary.SetNumMatchesFound(m_summary.GetNumMatchesFound() + 1);
+            results.push_back(result);
 
             if (!AdjustLine(modLine, pos, findWhat)) {
                 break;
@@ -515,9 +930,17 @@ void SearchThread::SendEvent(wxEventType type, wxEvtHandler* owner)
 
     wxCommandEvent event(type, GetId());
     if (type == wxEVT_SEARCH_THREAD_MATCHFOUND) {
-        // match found and we scanned 10 files
-        event.SetClientData(new SearchResultList(m_results));
-        m_results.clear();
+        // do not flood the owner: wait for it to consume the results we already sent
+        auto stop = [this]() { return TestStopSearch() || TestDestroy(); };
+        if (!m_throttle->Wait(MAX_PENDING_RESULTS, stop, PENDING_RESULTS_TIMEOUT) && !stop()) {
+            clDEBUG() << "Search results are not consumed, sending more results anyway" << endl;
+        }
+
+        SearchResultList* results = new SearchResultList();
+        results->swap(m_results);
+        results->SetThrottle(m_throttle);
+        event.SetClientData(results);
+        m_msPassed = m_stopWatch.Time();
         SEND_ST_EVENT();
 
     } else if ((type == wxEVT_SEARCH_THREAD_SEARCHEND) || (type == wxEVT_SEARCH_THREAD_SEARCHCANCELED)) {
@@ -525,7 +948,10 @@ void SearchThread::SendEvent(wxEventType type, wxEvtHandler* owner)
         // the summary event
         if (m_results.empty() == false) {
             wxCommandEvent evt(wxEVT_SEARCH_THREAD_MATCHFOUND, GetId());
-            evt.SetClientData(new SearchResultList(m_results));
+            SearchResultList* results = new SearchResultList();
+            results->swap(m_results);
+            results->SetThrottle(m_throttle);
+            evt.SetClientData(results);
             if (owner) {
                 wxPostEvent(owner, evt);
             } else if (m_notifiedWindow) {
@@ -537,13 +963,6 @@ void SearchThread::SendEvent(wxEventType type, wxEvtHandler* owner)
         event.SetClientData(type == wxEVT_SEARCH_THREAD_SEARCHEND ? new SearchSummary(m_summary) : nullptr);
         SEND_ST_EVENT();
     }
-    // to avoid flooding the UI with search events, sleep for 1ms after each
-    // send_event call
-    ++send_count;
-    if (send_count >= 10) {
-        wxThread::Sleep(1);
-        send_count = 0;
-    }
 }
 
 void SearchThread::FilterFiles(wxArrayString& files, const SearchData* data)
@@ -580,14 +999,20 @@ SearchThread* SearchThreadST::Get()
     return gs_SearchThread;
 }
 
+const wxString& SearchResult::EmptyString()
+{
+    static const wxString empty;
+    return empty;
+}
+
 JSONItem SearchResult::ToJSON() const
 {
     JSONItem json = JSONItem::createObject();
-    json.addProperty("file", m_fileName);
+    json.addProperty("file", GetFileName());
     json.addProperty("line", m_lineNumber);
     json.addProperty("col", m_column);
     json.addProperty("pos", m_position);
-    json.addProperty("pattern", m_pattern);
+    json.addProperty("pattern", GetPattern());
     json.addProperty("len", m_len);
     json.addProperty("flags", m_flags);
     json.addProperty("columnInChars", m_columnInChars);
@@ -601,8 +1026,8 @@ void SearchResult::FromJSON(const JSONItem& json)
     m_position = json.namedObject("pos").toInt(m_position);
     m_column = json.namedObject("col").toInt(m_column);
     m_lineNumber = json.namedObject("line").toInt(m_lineNumber);
-    m_pattern = json.namedObject("pattern").toString(m_pattern);
-    m_fileName = json.namedObject("file").toString(m_fileName);
+    SetPattern(json.namedObject("pattern").toString(GetPattern()));
+    SetFileName(json.namedObject("file").toString(GetFileName()));
     m_len = json.namedObject("len").toInt(m_len);
     m_flags = json.namedObject("flags").toSize_t(m_flags);
     m_columnInChars = json.namedObject("columnInChars").toInt(m_columnInChars);
@@ -619,6 +1044,7 @@ JSONItem SearchSummary::ToJSON() const
     json.addProperty("failedFiles", m_failedFiles);
     json.addProperty("findWhat", m_findWhat);
     json.addProperty("replaceWith", m_replaceWith);
+    json.addProperty("resumeFrom", m_resumeFrom);
     return json;
 }
 
@@ -630,4 +1056,62 @@ void SearchSummary::FromJSON(const JSONItem& json)
     m_failedFiles = json.namedObject("failedFiles").toArrayString();
     m_findWhat = json.namedObject("findWhat").toString();
     m_replaceWith = json.namedObject("replaceWith").toString();
+    m_resumeFrom = json.namedObject("resumeFrom").toString();
+}
+
+void SearchResultsThrottle::Add(size_t count)
+{
+    std::lock_guard<std::mutex> lk{ m_mutex };
+    m_pending += count;
+}
+
+void SearchResultsThrottle::Release(size_t count)
+{
+    {
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        m_pending -= std::min(count, m_pending);
+    }
+    m_cv.notify_all();
+}
+
+void SearchResultsThrottle::Interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lk{ m_mutex };
+        m_interrupted = true;
+    }
+    m_cv.notify_all();
+}
+
+bool SearchResultsThrottle::Wait(size_t limit, const std::function<bool()>& stop, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lk{ m_mutex };
+    while (m_pending >= limit) {
+        if (m_interrupted || stop() || std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        // wake up periodically to check `stop`
+        m_cv.wait_for(lk, std::chrono::milliseconds(50));
+    }
+    return true;
+}
+
+SearchResultList::~SearchResultList()
+{
+    if (m_throttle) {
+        m_throttle->Release(m_throttled);
+    }
+}
+
+void SearchResultList::SetThrottle(std::shared_ptr<SearchResultsThrottle> throttle)
+{
+    if (m_throttle) {
+        m_throttle->Release(m_throttled);
+    }
+    m_throttle = std::move(throttle);
+    m_throttled = size();
+    if (m_throttle) {
+        m_throttle->Add(m_throttled);
+    }
 }
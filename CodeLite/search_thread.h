@@ -32,12 +32,19 @@
 #include "worker_thread.h"
 #include "wxStringHash.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <functional>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <wx/event.h>
 #include <wx/filename.h>
+#include <wx/fontenc.h>
 #include <wx/regex.h>
 #include <wx/stopwatch.h>
 #include <wx/string.h>
@@ -62,6 +69,7 @@ enum {
     wxSD_COLOUR_COMMENTS = 0x00000100,
     wxSD_WILDCARD = 0x00000200,
     wxSD_ENABLE_PIPE_SUPPORT = 0x00000400,
+    wxSD_PARALLEL_SEARCH = 0x00000800,
 };
 
 class WXDLLIMPEXP_CL SearchData : public ThreadRequest
@@ -77,6 +85,8 @@ class WXDLLIMPEXP_CL SearchData : public ThreadRequest
     wxString m_encoding;
     wxArrayString m_excludePatterns;
     size_t m_file_scanner_flags = clFilesScanner::SF_DONT_FOLLOW_SYMLINKS | clFilesScanner::SF_EXCLUDE_HIDDEN_DIRS;
+    size_t m_maxResults = 0;
+    wxString m_resumeFrom;
     friend class SearchThread;
 
 private:
@@ -113,9 +123,22 @@ public:
     //------------------------------------------
     size_t GetFileScannerFlags() const { return m_file_scanner_flags; }
     void SetFileScannerFlags(size_t flags) { m_file_scanner_flags = flags; }
+    /**
+     * @brief stop the search (at a file boundary) once `maxResults` matches were found. 0 means no limit
+     */
+    void SetMaxResults(size_t maxResults) { m_maxResults = maxResults; }
+    size_t GetMaxResults() const { return m_maxResults; }
+    /**
+     * @brief skip the files that are sorted before `file`. Used to continue a search that
+     * reached its results limit (see SearchSummary::GetResumeFrom())
+     */
+    void SetResumeFrom(const wxString& file) { m_resumeFrom = file; }
+    const wxString& GetResumeFrom() const { return m_resumeFrom; }
     bool IsMatchCase() const { return m_flags & wxSD_MATCHCASE ? true : false; }
     bool IsEnablePipeSupport() const { return m_flags & wxSD_ENABLE_PIPE_SUPPORT; }
     void SetEnablePipeSupport(bool b) { SetOption(wxSD_ENABLE_PIPE_SUPPORT, b); }
+    bool IsParallelSearch() const { return m_flags & wxSD_PARALLEL_SEARCH; }
+    void SetParallelSearch(bool b) { SetOption(wxSD_PARALLEL_SEARCH, b); }
     bool IsMatchWholeWord() const { return m_flags & wxSD_MATCHWHOLEWORD ? true : false; }
     bool IsRegularExpression() const { return m_flags & wxSD_REGULAREXPRESSION ? true : false; }
     const wxArrayString& GetRootDirs() const { return m_rootDirs; }
@@ -157,21 +180,28 @@ public:
 //------------------------------------------
 // class containing the search result
 //------------------------------------------
+// The pattern line, file name and find string are shared: all the matches found in a
+// file share the same file name instance and all the matches of a line share the same pattern
+typedef std::shared_ptr<const wxString> SearchSharedString;
+
 class WXDLLIMPEXP_CL SearchResult : public wxObject
 {
-    wxString m_pattern;
+    SearchSharedString m_pattern;
     int m_position;
     int m_lineNumber;
     int m_column;
-    wxString m_fileName;
+    SearchSharedString m_fileName;
     int m_len;
-    wxString m_findWhat;
+    SearchSharedString m_findWhat;
     size_t m_flags;
     int m_columnInChars;
     int m_lenInChars;
     wxString m_scope;
     wxArrayString m_regexCaptures;
 
+    static const wxString& EmptyString();
+    static const wxString& GetString(const SearchSharedString& str) { return str ? *str : EmptyString(); }
+
 public:
     // ctor-dtor, copy constructor and assignment operator
     SearchResult() {}
@@ -187,10 +217,10 @@ public:
         m_position = rhs.m_position;
         m_column = rhs.m_column;
         m_lineNumber = rhs.m_lineNumber;
-        m_pattern = rhs.m_pattern.c_str();
-        m_fileName = rhs.m_fileName.c_str();
+        m_pattern = rhs.m_pattern;
+        m_fileName = rhs.m_fileName;
         m_len = rhs.m_len;
-        m_findWhat = rhs.m_findWhat.c_str();
+        m_findWhat = rhs.m_findWhat;
         m_flags = rhs.m_flags;
         m_columnInChars = rhs.m_columnInChars;
         m_lenInChars = rhs.m_lenInChars;
@@ -209,25 +239,28 @@ public:
 
     size_t GetFlags() const { return m_flags; }
 
-    void SetPattern(const wxString& pat) { m_pattern = pat.c_str(); }
+    void SetPattern(const wxString& pat) { m_pattern = std::make_shared<const wxString>(pat.c_str()); }
+    void SetPattern(const SearchSharedString& pat) { m_pattern = pat; }
     void SetPosition(int position) { m_position = position; }
     void SetLineNumber(int line) { m_lineNumber = line; }
     void SetColumn(int col) { m_column = col; }
-    void SetFileName(const wxString& fileName) { m_fileName = fileName.c_str(); }
+    void SetFileName(const wxString& fileName) { m_fileName = std::make_shared<const wxString>(fileName.c_str()); }
+    void SetFileName(const SearchSharedString& fileName) { m_fileName = fileName; }
 
     int GetPosition() const { return m_position; }
     int GetLineNumber() const { return m_lineNumber; }
     int GetColumn() const { return m_column; }
-    const wxString& GetPattern() const { return m_pattern; }
-    const wxString& GetFileName() const { return m_fileName; }
+    const wxString& GetPattern() const { return GetString(m_pattern); }
+    const wxString& GetFileName() const { return GetString(m_fileName); }
 
     void SetLen(int len) { this->m_len = len; }
     int GetLen() const { return m_len; }
 
     // Setters
-    void SetFindWhat(const wxString& findWhat) { this->m_findWhat = findWhat.c_str(); }
+    void SetFindWhat(const wxString& findWhat) { m_findWhat = std::make_shared<const wxString>(findWhat.c_str()); }
+    void SetFindWhat(const SearchSharedString& findWhat) { m_findWhat = findWhat; }
     // Getters
-    const wxString& GetFindWhat() const { return m_findWhat; }
+    const wxString& GetFindWhat() const { return GetString(m_findWhat); }
 
     void SetColumnInChars(int col) { this->m_columnInChars = col; }
     int GetColumnInChars() const { return m_columnInChars; }
@@ -259,7 +292,63 @@ public:
     }
 };
 
-typedef std::vector<SearchResult> SearchResultList;
+/**
+ * @brief counts the search results that were posted to the owner and not consumed yet,
+ * allowing the search thread to wait for the owner to catch up
+ */
+class WXDLLIMPEXP_CL SearchResultsThrottle
+{
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    size_t m_pending = 0;
+    bool m_interrupted = false;
+
+public:
+    void Add(size_t count);
+    void Release(size_t count);
+
+    /**
+     * @brief wake up the thread waiting in Wait() and make all the following waits return immediately
+     */
+    void Interrupt();
+
+    /**
+     * @brief wait until less than `limit` results are pending
+     * @param stop checked periodically, stop waiting when it returns true
+     * @param timeout stop waiting after this period, in case the owner does not consume the results
+     * @return true if the number of pending results is below `limit`, false when interrupted, stopped or timed out
+     */
+    bool Wait(size_t limit, const std::function<bool()>& stop, std::chrono::milliseconds timeout);
+};
+
+/**
+ * @brief a batch of search results, as posted with the wxEVT_SEARCH_THREAD_MATCHFOUND event.
+ * Deleting the batch marks its results as consumed
+ */
+class WXDLLIMPEXP_CL SearchResultList : public std::vector<SearchResult>
+{
+    std::shared_ptr<SearchResultsThrottle> m_throttle;
+    size_t m_throttled = 0;
+
+public:
+    SearchResultList() {}
+    // copies are not accounted by the throttle
+    SearchResultList(const SearchResultList& other)
+        : std::vector<SearchResult>(other)
+    {
+    }
+    SearchResultList& operator=(const SearchResultList& other)
+    {
+        std::vector<SearchResult>::operator=(other);
+        return *this;
+    }
+    ~SearchResultList();
+
+    /**
+     * @brief account the current results in `throttle` until this batch is deleted
+     */
+    void SetThrottle(std::shared_ptr<SearchResultsThrottle> throttle);
+};
 
 class WXDLLIMPEXP_CL SearchSummary : public wxObject
 {
@@ -269,6 +358,7 @@ class WXDLLIMPEXP_CL SearchSummary : public wxObject
     wxArrayString m_failedFiles;
     wxString m_findWhat;
     wxString m_replaceWith;
+    wxString m_resumeFrom;
 
 public:
     SearchSummary()
@@ -293,6 +383,7 @@ public:
         m_failedFiles = rhs.m_failedFiles;
         m_findWhat = rhs.m_findWhat;
         m_replaceWith = rhs.m_replaceWith;
+        m_resumeFrom = rhs.m_resumeFrom;
         return *this;
     }
 
@@ -305,6 +396,13 @@ public:
     const wxString& GetReplaceWith() const { return m_replaceWith; }
     const wxArrayString& GetFailedFiles() const { return m_failedFiles; }
     wxArrayString& GetFailedFiles() { return m_failedFiles; }
+    /**
+     * @brief when the search stopped because it reached its results limit, the first file that was not searched.
+     * Pass it to SearchData::SetResumeFrom() to search the remaining files
+     */
+    void SetResumeFrom(const wxString& file) { m_resumeFrom = file; }
+    const wxString& GetResumeFrom() const { return m_resumeFrom; }
+    bool IsLimitReached() const { return !m_resumeFrom.empty(); }
 
     int GetNumFileScanned() const { return m_fileScanned; }
     int GetNumMatchesFound() const { return m_matchesFound; }
@@ -345,12 +443,12 @@ class WXDLLIMPEXP_CL SearchThread : public WorkerThread
     friend class SearchThreadST;
     wxString m_wordChars;
     SearchResultList m_results;
-    bool m_stopSearch;
+    std::atomic_bool m_stopSearch{ false };
     SearchSummary m_summary;
+    std::shared_ptr<SearchResultsThrottle> m_throttle;
     wxString m_reExpr;
     wxRegEx m_regex;
     bool m_matchCase;
-    wxCriticalSection m_cs;
     wxStopWatch m_stopWatch;
     long m_msPassed = 0;
 
@@ -390,6 +488,12 @@ private:
      */
     void GetFiles(const SearchData* data, wxArrayString& files);
 
+    /**
+     * Remove from `files` the files that the workspace trigram index (when opened)
+     * knows can not contain a match
+     */
+    void FilterFilesByIndex(const SearchData* data, wxArrayString& files);
+
     // Test to see if user asked to cancel the search
     bool TestStopSearch();
 
@@ -399,16 +503,54 @@ private:
      */
     void DoSearchFiles(ThreadRequest* data);
 
-    // Perform search on a single file
-    void DoSearchFile(const wxString& fileName, const SearchData* data);
+    /**
+     * Scan `files` using a pool of worker threads. Workers claim chunks of the
+     * file list on demand while this thread delivers the matches to the owner
+     * in the original file order
+     * \return false if the search was cancelled
+     */
+    bool DoParallelSearchFiles(const wxArrayString& files, const SearchData* data, wxFontEncoding encoding);
+
+    /**
+     * Collect the results of files[fileIndex] into the summary and post the buffered results to the owner
+     * when enough of them were collected
+     * \return false if the results limit was reached and the search should stop
+     */
+    bool DoDeliverFileResults(size_t fileIndex, const wxArrayString& files, bool scanned, SearchResultList& results,
+                              const SearchData* data);
+
+    // The strings shared by all the results of a single file
+    struct FileStrings {
+        SearchSharedString fileName;
+        SearchSharedString findWhat;
+    };
+
+    // Perform search on a single file. Returns false if the file could not be read
+    // This method does not touch any member and can be called from multiple threads. `encoding`
+    // is resolved by the caller: wxFontMapper is not thread safe
+    static bool DoSearchFile(const wxString& fileName, const SearchData* data, wxFontEncoding encoding, wxRegEx& re,
+                             SearchResultList& results);
+
+    /**
+     * Plain text search directly on the raw UTF-8 bytes of the file. Only lines
+     * containing a match are converted into wxString and passed to DoSearchLine
+     * \return false if the file can not be handled here and the caller should do a full search
+     */
+    static bool DoSearchFileRaw(const FileStrings& strings, const SearchData* data, const wxString& findWhat,
+                                const wxArrayString& filters, SearchResultList& results);
 
     // Perform search on a line
-    void DoSearchLine(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
-                      const SearchData* data, const wxString& findWhat, const wxArrayString& filters);
+    static void DoSearchLine(const wxString& line, const int lineNum, const int lineOffset,
+                             const FileStrings& strings, const SearchData* data, const wxString& findWhat,
+                             const wxArrayString& filters, SearchResultList& results);
 
     // Perform search on a line using regular expression
-    void DoSearchLineRE(const wxString& line, const int lineNum, const int lineOffset, const wxString& fileName,
-                        const SearchData* data);
+    static void DoSearchLineRE(const wxString& line, const int lineNum, const int lineOffset,
+                               const FileStrings& strings, const SearchData* data, wxRegEx& re,
+                               SearchResultList& results);
+
+    // Compile the regex expression for the search data into `re`
+    static void CompileRegex(wxRegEx& re, const wxString& expr, bool matchCase);
 
     // Send an event to the notified window
     void SendEvent(wxEventType type, wxEvtHandler* owner);
@@ -417,7 +559,7 @@ private:
     wxRegEx& GetRegex(const wxString& expr, bool matchCase);
 
     // Internal function
-    bool AdjustLine(wxString& line, int& pos, const wxString& findString);
+    static bool AdjustLine(wxString& line, int& pos, const wxString& findString);
 
     // filter 'files' according to the files spec
     void FilterFiles(wxArrayString& files, const SearchData* data);
@@ -29,14 +29,201 @@
 #include "cl_standard_paths.h"
 #include "file_logger.h"
 
+#include <algorithm>
 #include <atomic>
+#include <deque>
 #include <libssh/sftp.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <vector>
 #include <wx/ffile.h>
 #include <wx/filefn.h>
 #include <wx/tokenzr.h>
 
+namespace
+{
+// the size of a single read or write request
+constexpr size_t SFTP_CHUNK_SIZE = 65536;
+// the number of read or write requests kept in flight for a single file: the transfer of a file waits for one round
+// trip per SFTP_MAX_PENDING_REQUESTS chunks, instead of one round trip per chunk
+constexpr size_t SFTP_MAX_PENDING_REQUESTS = 16;
+
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+typedef sftp_aio read_request_t;
+
+/// return the size of the requests, within the limits announced by the server
+size_t get_chunk_size(sftp_session sftp, bool write)
+{
+    size_t chunk_size = SFTP_CHUNK_SIZE;
+    sftp_limits_t limits = sftp_limits(sftp);
+    if (limits) {
+        uint64_t max_length = write ? limits->max_write_length : limits->max_read_length;
+        if (max_length > 0 && max_length < chunk_size) {
+            chunk_size = max_length;
+        }
+        sftp_limits_free(limits);
+    }
+    return chunk_size;
+}
+
+bool begin_read(sftp_file file, size_t len, read_request_t* request)
+{
+    return sftp_aio_begin_read(file, len, request) != SSH_ERROR;
+}
+
+wxInt64 wait_read(sftp_file file, read_request_t* request, void* buffer, size_t len)
+{
+    wxUnusedVar(file);
+    return sftp_aio_wait_read(request, buffer, len);
+}
+#else
+typedef uint32_t read_request_t;
+
+size_t get_chunk_size(sftp_session sftp, bool write)
+{
+    wxUnusedVar(sftp);
+    wxUnusedVar(write);
+    return SFTP_CHUNK_SIZE;
+}
+
+bool begin_read(sftp_file file, size_t len, read_request_t* request)
+{
+    int id = sftp_async_read_begin(file, len);
+    if (id < 0) {
+        return false;
+    }
+    *request = id;
+    return true;
+}
+
+wxInt64 wait_read(sftp_file file, read_request_t* request, void* buffer, size_t len)
+{
+    return sftp_async_read(file, buffer, len, *request);
+}
+#endif
+
+/// read `size` bytes from `file` into `buffer`, keeping several read requests in flight. Return the number of bytes
+/// read
+wxInt64 pipelined_read(sftp_session sftp, sftp_file file, wxInt64 size, wxMemoryBuffer& buffer)
+{
+    struct request {
+        read_request_t id;
+        size_t len;
+    };
+
+    const size_t chunk_size = get_chunk_size(sftp, false);
+    std::deque<request> pending;
+    char* data = (char*)buffer.GetAppendBuf(size);
+    wxInt64 bytes_read = 0;
+    wxInt64 bytes_requested = 0;
+
+    // the replies of the requests issued so far must be consumed before the next requests
+    auto drain = [&]() {
+        std::vector<char> discard(chunk_size);
+        for (auto& r : pending) {
+            wait_read(file, &r.id, discard.data(), r.len);
+        }
+        pending.clear();
+    };
+
+    while (bytes_read < size) {
+        while (pending.size() < SFTP_MAX_PENDING_REQUESTS && bytes_requested < size) {
+            request r;
+            r.len = (size_t)std::min<wxInt64>(chunk_size, size - bytes_requested);
+            if (!begin_read(file, r.len, &r.id)) {
+                break;
+            }
+            pending.push_back(r);
+            bytes_requested += r.len;
+        }
+
+        if (pending.empty()) {
+            break;
+        }
+
+        request r = pending.front();
+        pending.pop_front();
+        wxInt64 nbytes = wait_read(file, &r.id, data + bytes_read, r.len);
+        if (nbytes <= 0) {
+            break;
+        }
+
+        bytes_read += nbytes;
+        if ((size_t)nbytes < r.len) {
+            // a short read: the pending requests were issued for the wrong offsets. Drop them and carry on from the
+            // current offset
+            drain();
+            if (sftp_seek64(file, bytes_read) < 0) {
+                break;
+            }
+            bytes_requested = bytes_read;
+        }
+    }
+
+    drain();
+    buffer.UngetAppendBuf(bytes_read);
+    return bytes_read;
+}
+
+/// write `size` bytes to `file`, keeping several write requests in flight
+bool pipelined_write(sftp_session sftp, sftp_file file, const char* data, wxInt64 size)
+{
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+    struct request {
+        sftp_aio aio;
+        size_t len;
+    };
+
+    const size_t chunk_size = get_chunk_size(sftp, true);
+    std::deque<request> pending;
+    wxInt64 bytes_requested = 0;
+    bool success = true;
+    while (success && (bytes_requested < size || !pending.empty())) {
+        while (pending.size() < SFTP_MAX_PENDING_REQUESTS && bytes_requested < size) {
+            request r;
+            r.len = (size_t)std::min<wxInt64>(chunk_size, size - bytes_requested);
+            if (sftp_aio_begin_write(file, data + bytes_requested, r.len, &r.aio) == SSH_ERROR) {
+                success = false;
+                break;
+            }
+            pending.push_back(r);
+            bytes_requested += r.len;
+        }
+
+        if (pending.empty()) {
+            break;
+        }
+
+        request r = pending.front();
+        pending.pop_front();
+        if (sftp_aio_wait_write(&r.aio) != (ssize_t)r.len) {
+            success = false;
+        }
+    }
+
+    // consume the replies of the requests still in flight
+    for (auto& r : pending) {
+        sftp_aio_wait_write(&r.aio);
+    }
+    return success;
+#else
+    // no asynchronous writes before libssh 0.11
+    wxUnusedVar(sftp);
+    wxInt64 bytes_left = size;
+    while (bytes_left > 0) {
+        wxInt64 chunk_size = std::min<wxInt64>(SFTP_CHUNK_SIZE, bytes_left);
+        wxInt64 bytes_written = sftp_write(file, data, chunk_size);
+        if (bytes_written < 0) {
+            return false;
+        }
+        bytes_left -= bytes_written;
+        data += bytes_written;
+    }
+    return true;
+#endif
+}
+} // namespace
+
 class SFTPDirCloser
 {
     sftp_dir m_dir;
@@ -154,7 +341,7 @@ void clSFTP::Write(const wxMemoryBuffer& fileContent, const wxString& remotePath
         throw clException("SFTP is not initialized");
     }
 
-    static size_t counter = 0;
+    static std::atomic_size_t counter{ 0 };
     int access_type = O_WRONLY | O_CREAT | O_TRUNC;
     sftp_file file;
     wxString tmpRemoteFile = remotePath;
@@ -168,21 +355,11 @@ void clSFTP::Write(const wxMemoryBuffer& fileContent, const wxString& remotePath
                           sftp_get_error(m_sftp));
     }
 
-    char* p = (char*)fileContent.GetData();
-    const int maxChunkSize = 65536;
-    wxInt64 bytesLeft = fileContent.GetDataLen();
-
-    while (bytesLeft > 0) {
-        wxInt64 chunkSize = bytesLeft > maxChunkSize ? maxChunkSize : bytesLeft;
-        wxInt64 bytesWritten = sftp_write(file, p, chunkSize);
-        if (bytesWritten < 0) {
-            sftp_close(file);
-            throw clException(wxString() << _("Can't write data to file: ") << tmpRemoteFile << ". "
-                                         << ssh_get_error(m_ssh->GetSession()),
-                              sftp_get_error(m_sftp));
-        }
-        bytesLeft -= bytesWritten;
-        p += bytesWritten;
+    if (!pipelined_write(m_sftp, file, (const char*)fileContent.GetData(), fileContent.GetDataLen())) {
+        sftp_close(file);
+        throw clException(wxString() << _("Can't write data to file: ") << tmpRemoteFile << ". "
+                                     << ssh_get_error(m_ssh->GetSession()),
+                          sftp_get_error(m_sftp));
     }
     sftp_close(file);
 
@@ -284,29 +461,19 @@ SFTPAttribute::Ptr_t clSFTP::Read(const wxString& remotePath, wxMemoryBuffer& bu
 
     SFTPAttribute::Ptr_t fileAttr = Stat(remotePath);
     if (!fileAttr) {
+        sftp_close(file);
         throw clException(wxString() << _("Could not stat file:") << remotePath << ". "
                                      << ssh_get_error(m_ssh->GetSession()),
                           sftp_get_error(m_sftp));
     }
     wxInt64 fileSize = fileAttr->GetSize();
-    if (fileSize == 0)
+    if (fileSize == 0) {
+        sftp_close(file);
         return fileAttr;
-
-    // Allocate buffer for the file content
-    char pBuffer[65536]; // buffer
+    }
 
     // Read the entire file content
-    wxInt64 bytesLeft = fileSize;
-    wxInt64 bytesRead = 0;
-    while (bytesLeft > 0) {
-        wxInt64 nbytes = sftp_read(file, pBuffer, sizeof(pBuffer));
-        if (nbytes <= 0) {
-            break; // we will throw later
-        }
-        bytesRead += nbytes;
-        bytesLeft -= nbytes;
-        buffer.AppendData(pBuffer, nbytes);
-    }
+    wxInt64 bytesRead = pipelined_read(m_sftp, file, fileSize, buffer);
 
     if (bytesRead != fileSize) {
         sftp_close(file);
@@ -624,7 +791,7 @@ wxString clSFTP::ExecuteCommand(const wxString& command)
     return result;
 }
 
-bool clSFTP::GetChecksum(const wxString& remoteFile, size_t* checksum)
+bool clSFTP::GetChecksum(const wxString& remoteFile, size_t* checksum, size_t* size)
 {
     wxString command;
     command << "cksum " << remoteFile;
@@ -640,6 +807,15 @@ bool clSFTP::GetChecksum(const wxString& remoteFile, size_t* checksum)
             return false;
         }
         *checksum = ck;
+
+        // followed by the file size
+        if (size) {
+            unsigned long long file_size;
+            if (parts.size() < 2 || !parts[1].ToULongLong(&file_size)) {
+                return false;
+            }
+            *size = file_size;
+        }
         return true;
     } catch (const clException& e) {
         clWARNING() << e.What() << endl;
@@ -97,9 +97,10 @@ public:
 
     /**
      * @brief return checksum of a remote file
+     * @param size [output] when not null, set to the size of the remote file, in bytes
      * @throws clException
      */
-    bool GetChecksum(const wxString& remoteFile, size_t* checksum);
+    bool GetChecksum(const wxString& remoteFile, size_t* checksum, size_t* size = nullptr);
 
     /**
      * @brief write the content of local file into a remote file
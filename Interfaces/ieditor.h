@@ -116,6 +116,22 @@ public:
      */
     virtual wxUint64 GetModificationCount() const = 0;
 
+    /**
+     * @brief return the ID of the last text change (insertion or deletion) made to the editor.
+     * IDs are unique across all the editors
+     */
+    virtual wxUint64 GetLastTextChangeId() const = 0;
+
+    /**
+     * @brief collect the text changes made to the editor after the change `since_id` (a value returned earlier by
+     * GetLastTextChangeId()). The ranges are 0 based line / character positions and each change applies to the text as
+     * it was after the previous change
+     * @return false if the changes are no longer available (e.g. `since_id` is too old, or belongs to another editor),
+     * in this case the caller should use the entire editor text instead
+     */
+    virtual bool GetTextChangesSince(wxUint64 since_id,
+                                     std::vector<LSP::TextDocumentContentChangeEvent>& changes) const = 0;
+
     /**
      * @brief return the current editor content
      */
@@ -0,0 +1,10 @@
+#include "EditorPlaceholder.hpp"
+
+EditorPlaceholder::EditorPlaceholder(wxWindow* parent, const TabInfo& tab_info, const wxFileName& filename)
+    : wxPanel(parent)
+    , m_tabInfo(tab_info)
+    , m_fileName(filename)
+{
+}
+
+EditorPlaceholder::~EditorPlaceholder() {}
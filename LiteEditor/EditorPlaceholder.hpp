@@ -0,0 +1,27 @@
+#ifndef EDITORPLACEHOLDER_HPP
+#define EDITORPLACEHOLDER_HPP
+
+#include "serialized_object.h"
+
+#include <wx/filename.h>
+#include <wx/panel.h>
+
+/**
+ * @brief a notebook page standing for an editor that was restored from the session but not loaded yet.
+ * It only keeps the tab session info (path, first visible line, bookmarks, folds). MainBook replaces it with
+ * a clEditor when the tab is selected or when its file is looked up (FindEditor(), OpenFile())
+ */
+class EditorPlaceholder : public wxPanel
+{
+    TabInfo m_tabInfo;
+    wxFileName m_fileName;
+
+public:
+    EditorPlaceholder(wxWindow* parent, const TabInfo& tab_info, const wxFileName& filename);
+    virtual ~EditorPlaceholder();
+
+    const TabInfo& GetTabInfo() const { return m_tabInfo; }
+    const wxFileName& GetFileName() const { return m_fileName; }
+};
+
+#endif // EDITORPLACEHOLDER_HPP
@@ -0,0 +1,135 @@
+#include "SearchIndexManager.hpp"
+
+#include "clTrigramIndex.hpp"
+#include "clWorkspaceManager.h"
+#include "cl_config.h"
+#include "codelite_events.h"
+#include "event_notifier.h"
+#include "file_logger.h"
+
+#include <wx/filename.h>
+
+namespace
+{
+/// Return all the paths carried by a file system event
+wxArrayString get_event_paths(const clFileSystemEvent& event)
+{
+    wxArrayString paths = event.GetPaths();
+    if (!event.GetPath().empty()) {
+        paths.Add(event.GetPath());
+    }
+    return paths;
+}
+} // namespace
+
+SearchIndexManager::SearchIndexManager()
+{
+    EventNotifier::Get()->Bind(wxEVT_WORKSPACE_LOADED, &SearchIndexManager::OnWorkspaceLoaded, this);
+    EventNotifier::Get()->Bind(wxEVT_WORKSPACE_CLOSED, &SearchIndexManager::OnWorkspaceClosed, this);
+    EventNotifier::Get()->Bind(wxEVT_WORKSPACE_FILES_SCANNED, &SearchIndexManager::OnWorkspaceFilesScanned, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_SAVED, &SearchIndexManager::OnFileSaved, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_CREATED, &SearchIndexManager::OnFilesCreated, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_DELETED, &SearchIndexManager::OnFilesDeleted, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_RENAMED, &SearchIndexManager::OnFileRenamed, this);
+    EventNotifier::Get()->Bind(wxEVT_FILES_MODIFIED_REPLACE_IN_FILES, &SearchIndexManager::OnFilesModified, this);
+    EventNotifier::Get()->Bind(wxEVT_FILE_SYSTEM_UPDATED, &SearchIndexManager::OnFileSystemUpdated, this);
+}
+
+SearchIndexManager::~SearchIndexManager()
+{
+    EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_LOADED, &SearchIndexManager::OnWorkspaceLoaded, this);
+    EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_CLOSED, &SearchIndexManager::OnWorkspaceClosed, this);
+    EventNotifier::Get()->Unbind(wxEVT_WORKSPACE_FILES_SCANNED, &SearchIndexManager::OnWorkspaceFilesScanned, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_SAVED, &SearchIndexManager::OnFileSaved, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_CREATED, &SearchIndexManager::OnFilesCreated, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_DELETED, &SearchIndexManager::OnFilesDeleted, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_RENAMED, &SearchIndexManager::OnFileRenamed, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILES_MODIFIED_REPLACE_IN_FILES, &SearchIndexManager::OnFilesModified, this);
+    EventNotifier::Get()->Unbind(wxEVT_FILE_SYSTEM_UPDATED, &SearchIndexManager::OnFileSystemUpdated, this);
+    clTrigramIndex::Get().Close();
+}
+
+bool SearchIndexManager::IsEnabled() const { return clConfig::Get().Read(kConfigFindInFilesUseIndex, false); }
+
+void SearchIndexManager::IndexWorkspaceFiles()
+{
+    if (!clTrigramIndex::Get().IsOpened() || !clWorkspaceManager::Get().IsWorkspaceOpened()) {
+        return;
+    }
+
+    // files that did not change since they were indexed are skipped by the indexer
+    wxArrayString files;
+    clWorkspaceManager::Get().GetWorkspace()->GetWorkspaceFiles(files);
+    clTrigramIndex::Get().IndexFilesAsync(files);
+}
+
+void SearchIndexManager::OnWorkspaceLoaded(clWorkspaceEvent& event)
+{
+    event.Skip();
+    clTrigramIndex::Get().Close();
+
+    if (!IsEnabled() || !clWorkspaceManager::Get().IsWorkspaceOpened() ||
+        clWorkspaceManager::Get().GetWorkspace()->IsRemote()) {
+        return;
+    }
+
+    wxFileName index_file(clWorkspaceManager::Get().GetWorkspace()->GetDir(), "search.idx");
+    index_file.AppendDir(".codelite");
+    clDEBUG() << "Opening find-in-files index:" << index_file.GetFullPath() << endl;
+    clTrigramIndex::Get().Open(index_file.GetFullPath());
+    IndexWorkspaceFiles();
+}
+
+void SearchIndexManager::OnWorkspaceClosed(clWorkspaceEvent& event)
+{
+    event.Skip();
+    clTrigramIndex::Get().Close();
+}
+
+void SearchIndexManager::OnWorkspaceFilesScanned(clWorkspaceEvent& event)
+{
+    event.Skip();
+    IndexWorkspaceFiles();
+}
+
+void SearchIndexManager::OnFileSystemUpdated(clFileSystemEvent& event)
+{
+    event.Skip();
+    IndexWorkspaceFiles();
+}
+
+void SearchIndexManager::OnFileSaved(clCommandEvent& event)
+{
+    event.Skip();
+    wxArrayString files;
+    files.Add(event.GetFileName());
+    clTrigramIndex::Get().IndexFilesAsync(files);
+}
+
+void SearchIndexManager::OnFilesCreated(clFileSystemEvent& event)
+{
+    event.Skip();
+    clTrigramIndex::Get().IndexFilesAsync(get_event_paths(event));
+}
+
+void SearchIndexManager::OnFilesModified(clFileSystemEvent& event)
+{
+    event.Skip();
+    clTrigramIndex::Get().IndexFilesAsync(get_event_paths(event));
+}
+
+void SearchIndexManager::OnFilesDeleted(clFileSystemEvent& event)
+{
+    event.Skip();
+    clTrigramIndex::Get().RemoveFilesAsync(get_event_paths(event));
+}
+
+void SearchIndexManager::OnFileRenamed(clFileSystemEvent& event)
+{
+    event.Skip();
+    wxArrayString old_files, new_files;
+    old_files.Add(event.GetPath());
+    new_files.Add(event.GetNewpath());
+    clTrigramIndex::Get().RemoveFilesAsync(old_files);
+    clTrigramIndex::Get().IndexFilesAsync(new_files);
+}
@@ -0,0 +1,35 @@
+#ifndef SEARCHINDEXMANAGER_HPP
+#define SEARCHINDEXMANAGER_HPP
+
+#include "clFileSystemEvent.h"
+#include "clWorkspaceEvent.hpp"
+#include "cl_command_event.h"
+
+#include <wx/event.h>
+
+/**
+ * @brief keeps the workspace trigram index (used by the find-in-files to skip files) in sync with the workspace
+ * The index is stored in the workspace private folder and is enabled with the `kConfigFindInFilesUseIndex` option
+ */
+class SearchIndexManager : public wxEvtHandler
+{
+protected:
+    bool IsEnabled() const;
+    void IndexWorkspaceFiles();
+
+    void OnWorkspaceLoaded(clWorkspaceEvent& event);
+    void OnWorkspaceClosed(clWorkspaceEvent& event);
+    void OnWorkspaceFilesScanned(clWorkspaceEvent& event);
+    void OnFileSaved(clCommandEvent& event);
+    void OnFilesCreated(clFileSystemEvent& event);
+    void OnFilesDeleted(clFileSystemEvent& event);
+    void OnFileRenamed(clFileSystemEvent& event);
+    void OnFilesModified(clFileSystemEvent& event);
+    void OnFileSystemUpdated(clFileSystemEvent& event);
+
+public:
+    SearchIndexManager();
+    virtual ~SearchIndexManager();
+};
+
+#endif // SEARCHINDEXMANAGER_HPP
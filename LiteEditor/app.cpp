@@ -782,7 +782,11 @@ void CodeLiteApp::ProcessCommandLineParams()
     }
 }
 
-int CodeLiteApp::OnExit() { return 0; }
+int CodeLiteApp::OnExit()
+{
+    FileLogger::CloseLog();
+    return 0;
+}
 
 bool CodeLiteApp::CopySettings(const wxString& destDir, wxString& installPath)
 {
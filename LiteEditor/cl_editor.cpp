@@ -426,6 +426,21 @@ void GetLineMarginColours(wxStyledTextCtrl* ctrl, wxColour* bg_colour, wxColour*
     }
 }
 
+// keep enough text changes for the LSP plugin to sync incrementally, it falls back to the full text otherwise
+constexpr size_t MAX_TEXT_CHANGES = 1000;
+constexpr size_t MAX_TEXT_CHANGES_BYTES = 1024 * 1024;
+
+/// the length of `ch` in UTF-16 code units, the unit of the LSP positions. Where wxString is UTF-16 (MSW), the
+/// characters outside the BMP are already made of 2 surrogates
+inline int utf16_length(const wxUniChar& ch) { return ch.GetValue() > 0xFFFF ? 2 : 1; }
+
+/// text change IDs are unique across all editors
+wxUint64 NextTextChangeId()
+{
+    static wxUint64 last_id = 0;
+    return ++last_id;
+}
+
 /// Check to see if we have a .clang-format file in the workspace folder. If we do, read the
 /// IndentWidth property
 
@@ -444,6 +459,8 @@ clEditor::clEditor(wxWindow* parent)
     , m_isDragging(false)
     , m_modifyTime(0)
     , m_modificationCount(0)
+    , m_textChangesBaseId(NextTextChangeId())
+    , m_lastTextChangeId(m_textChangesBaseId)
     , m_isVisible(true)
     , m_hyperLinkIndicatroStart(wxNOT_FOUND)
     , m_hyperLinkIndicatroEnd(wxNOT_FOUND)
@@ -4626,6 +4643,7 @@ void clEditor::OnChange(wxStyledTextEvent& event)
     }
 
     if (isInsert || isDelete) {
+        DoRecordTextChange(isInsert, event.GetPosition(), event.GetText());
 
         if (!GetReloadingFile() && !isUndo && !isRedo) {
             CLCommand::Ptr_t currentOpen = GetCommandsProcessor().GetOpenCommand();
@@ -6094,6 +6112,74 @@ void clEditor::SetSemanticTokens(const wxString& classes,
     Colourise(0, wxSTC_INVALID_POSITION);
 }
 
+void clEditor::DoRecordTextChange(bool isInsert, int pos, const wxString& text)
+{
+    // the text before `pos` is not affected by the change, so the start position is valid in the text before
+    // the change
+    int line = LineFromPosition(pos);
+    int start_char = 0;
+    for (const wxUniChar& ch : GetTextRange(PositionFromLine(line), pos)) {
+        start_char += utf16_length(ch);
+    }
+    LSP::Position start(line, start_char);
+    LSP::Position end = start;
+
+    TextChange textChange;
+    if (isInsert) {
+        textChange.change.SetText(text);
+    } else {
+        // the end of the deleted range, computed from the deleted text
+        int end_line = start.GetLine();
+        int end_char = start.GetCharacter();
+        for (const wxUniChar& ch : text) {
+            if (ch == '\n') {
+                ++end_line;
+                end_char = 0;
+            } else {
+                end_char += utf16_length(ch);
+            }
+        }
+        end.SetLine(end_line);
+        end.SetCharacter(end_char);
+    }
+    textChange.change.SetRange(LSP::Range(start, end));
+    textChange.id = NextTextChangeId();
+    m_lastTextChangeId = textChange.id;
+
+    m_textChangesBytes += textChange.change.GetText().length();
+    m_textChanges.push_back(std::move(textChange));
+    while (!m_textChanges.empty() &&
+           (m_textChanges.size() > MAX_TEXT_CHANGES || m_textChangesBytes > MAX_TEXT_CHANGES_BYTES)) {
+        m_textChangesBaseId = m_textChanges.front().id;
+        m_textChangesBytes -= m_textChanges.front().change.GetText().length();
+        m_textChanges.pop_front();
+    }
+}
+
+bool clEditor::GetTextChangesSince(wxUint64 since_id, std::vector<LSP::TextDocumentContentChangeEvent>& changes) const
+{
+    if (since_id == m_lastTextChangeId) {
+        return true;
+    }
+
+    auto iter = m_textChanges.begin();
+    if (since_id != m_textChangesBaseId) {
+        // the IDs are sorted
+        iter = std::lower_bound(m_textChanges.begin(), m_textChanges.end(), since_id,
+                                [](const TextChange& textChange, wxUint64 id) { return textChange.id < id; });
+        if (iter == m_textChanges.end() || iter->id != since_id) {
+            return false;
+        }
+        ++iter;
+    }
+
+    changes.reserve(changes.size() + std::distance(iter, m_textChanges.end()));
+    for (; iter != m_textChanges.end(); ++iter) {
+        changes.push_back(iter->change);
+    }
+    return true;
+}
+
 int clEditor::GetColumnInChars(int pos)
 {
     int line = LineFromPosition(pos);
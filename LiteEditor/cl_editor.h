@@ -42,6 +42,7 @@
 #include "stringhighlighterjob.h"
 
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <unordered_map>
 #include <vector>
@@ -774,6 +775,10 @@ public:
      */
     wxUint64 GetModificationCount() const override { return m_modificationCount; }
 
+    wxUint64 GetLastTextChangeId() const override { return m_lastTextChangeId; }
+    bool GetTextChangesSince(wxUint64 since_id,
+                             std::vector<LSP::TextDocumentContentChangeEvent>& changes) const override;
+
     /**
      * @brief run through the file content and update colours for the
      * functions / locals
@@ -1015,6 +1020,7 @@ private:
     void DrawLineNumbers(bool force);
     void UpdateLineNumberMarginWidth();
     void DoUpdateTLWTitle(bool raise);
+    void DoRecordTextChange(bool isInsert, int pos, const wxString& text);
     void DoWrapPrevSelectionWithChars(wxChar first, wxChar last);
     int GetFirstSingleLineCommentPos(int from, int commentStyle);
     void DoSelectRange(const LSP::Range& range, bool center_line);
@@ -1120,6 +1126,15 @@ private:
     bool m_isDragging;
     time_t m_modifyTime;
     wxUint64 m_modificationCount;
+    // the recent text changes, used for incremental document sync (LSP)
+    struct TextChange {
+        wxUint64 id = 0;
+        LSP::TextDocumentContentChangeEvent change;
+    };
+    std::deque<TextChange> m_textChanges;
+    size_t m_textChangesBytes = 0;
+    wxUint64 m_textChangesBaseId = 0; // the ID of the change that precedes m_textChanges.front()
+    wxUint64 m_lastTextChangeId = 0;
     std::map<int, wxString> m_customCmds;
     bool m_isVisible;
     int m_hyperLinkIndicatroStart;
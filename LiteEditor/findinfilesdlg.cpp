@@ -29,6 +29,7 @@
 #include "StringUtils.h"
 #include "clFilesCollector.h"
 #include "clWorkspaceManager.h"
+#include "cl_config.h"
 #include "dirpicker.h"
 #include "event_notifier.h"
 #include "findresultstab.h"
@@ -192,6 +193,9 @@ void FindInFilesDialog::DoSearch()
     SearchData data = DoGetSearchData();
     // direct results to the 'Search' tab
     data.SetOwner(m_handler ? m_handler : clMainFrame::Get()->GetOutputPane()->GetFindResultsTab());
+    // keep the UI responsive on broad searches, the rest of the results are fetched on demand.
+    // Replace needs all the matches, so the limit is set here only
+    data.SetMaxResults(clConfig::Get().Read(kConfigFindInFilesMaxResults, 50000));
 
     // check to see if we require to save the files
     DoSaveOpenFiles();
@@ -229,6 +233,7 @@ SearchData FindInFilesDialog::DoGetSearchData()
     data.SetSkipStrings(flags & wxFRD_SKIP_STRINGS);
     data.SetColourComments(flags & wxFRD_COLOUR_COMMENTS);
     data.SetEnablePipeSupport(flags & wxFRD_ENABLE_PIPE_SUPPORT);
+    data.SetParallelSearch(true);
 
     size_t search_flags = clFilesScanner::SF_DEFAULT;
     if (m_checkBoxFollowSymlinks->IsChecked()) {
@@ -111,6 +111,7 @@ void FindResultsTab::Clear()
     m_matchInfo.clear();
     m_indicators.clear();
     m_searchTitle.clear();
+    m_resumeLine = wxNOT_FOUND;
     OutputTabWindow::Clear();
     m_styler->Reset();
 }
@@ -129,9 +130,16 @@ void FindResultsTab::OnFindInFiles(wxCommandEvent& e)
 void FindResultsTab::OnSearchStart(wxCommandEvent& e)
 {
     m_searchInProgress = true;
+    SearchData* data = (SearchData*)e.GetClientData();
+    if(data && !data->GetResumeFrom().empty()) {
+        // continuing the previous search: append the results to the current ones
+        m_resumeLine = wxNOT_FOUND;
+        wxDELETE(data);
+        return;
+    }
+
     Clear();
     SetStyles(m_sci);
-    SearchData* data = (SearchData*)e.GetClientData();
     if(data) {
         m_searchData = *data;
         m_searchTitle = data->GetFindString();
@@ -197,6 +205,13 @@ void FindResultsTab::OnSearchEnded(wxCommandEvent& e)
     // did the page closed before the search ended?
     AppendLine(summary->GetMessage() + wxT("\n"));
 
+    if(summary->IsLimitReached()) {
+        m_resumeSearchData = m_searchData;
+        m_resumeSearchData.SetResumeFrom(summary->GetResumeFrom());
+        m_resumeLine = m_sci->GetLineCount() - 1;
+        AppendLine(_("====== Results limit reached, double click this line to search the remaining files ======\n"));
+    }
+
     if(m_tb->FindById(XRCID("scroll_on_output")) && m_tb->FindById(XRCID("scroll_on_output"))->IsToggled()) {
         m_sci->GotoLine(0);
     }
@@ -255,6 +270,14 @@ void FindResultsTab::OnMouseDClick(wxStyledTextEvent& e)
     int clickedLine = wxNOT_FOUND;
     m_styler->HitTest(m_sci, e, clickedLine);
 
+    if(clickedLine != wxNOT_FOUND && clickedLine == m_resumeLine) {
+        // search the files that were skipped when the results limit was reached
+        if(!m_searchInProgress) {
+            SearchThreadST::Get()->PerformSearch(m_resumeSearchData);
+        }
+        return;
+    }
+
     // Did we clicked on a togglable line?
     int toggleLine = m_styler->TestToggle(m_sci, e);
     if(toggleLine != wxNOT_FOUND) {
@@ -496,6 +519,7 @@ void FindResultsTab::LoadSearch(const History& h)
     m_searchData = h.searchData;
     m_matchInfo = h.matchInfo;
     m_searchTitle = h.title;
+    m_resumeLine = wxNOT_FOUND;
     m_sci->SetEditable(true);
     m_sci->ClearAll();
     m_sci->SetText(h.text);
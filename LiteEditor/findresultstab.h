@@ -50,6 +50,9 @@ protected:
     std::vector<int> m_indicators;
     bool m_searchInProgress;
     bool m_searchEventsConnected = false;
+    // the line that continues a search that reached its results limit and the search to run
+    int m_resumeLine = wxNOT_FOUND;
+    SearchData m_resumeSearchData;
 
     struct History {
         wxString title;
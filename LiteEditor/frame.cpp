@@ -33,6 +33,7 @@
 #include "FileSystemWorkspace/clFileSystemWorkspace.hpp"
 #include "Notebook.h"
 #include "NotebookNavigationDlg.h"
+#include "SearchIndexManager.hpp"
 #include "SideBar.hpp"
 #include "StdToWX.h"
 #include "SwitchToWorkspaceDlg.h"
@@ -774,6 +775,7 @@ clMainFrame::clMainFrame(
 clMainFrame::~clMainFrame()
 {
     wxDELETE(m_singleInstanceThread);
+    wxDELETE(m_searchIndexManager);
     wxDELETE(m_webUpdate);
 
 #ifndef __WXMSW__ // show the main panel
@@ -903,6 +905,9 @@ void clMainFrame::Construct()
     SearchThreadST::Get()->SetNotifyWindow(EventNotifier::Get());
     SearchThreadST::Get()->Start(WXTHREAD_MIN_PRIORITY);
 
+    // Keep the find-in-files index in sync with the workspace
+    m_searchIndexManager = new SearchIndexManager();
+
     // Create the single instance thread
     m_singleInstanceThread = new clSingleInstanceThread();
     m_singleInstanceThread->Start();
@@ -2234,10 +2239,14 @@ void clMainFrame::OnFileSaveTabGroup(wxCommandEvent& WXUNUSED(event))
 
     SaveTabGroupDlg dlg(this, previousgroups);
 
+    // the file tabs, including the restored tabs that were not loaded yet (see MainBook::CreateSession())
     wxArrayString filepaths;
-    const auto editors = GetMainBook()->GetAllEditors();
-    for (size_t i = 0; i < editors.size(); ++i) {
-        filepaths.Add(editors[i]->GetFileName().GetFullPath());
+    clTab::Vec_t tabs;
+    GetMainBook()->GetAllTabs(tabs);
+    for (const clTab& tab : tabs) {
+        if (tab.isFile) {
+            filepaths.Add(tab.filename.GetFullPath());
+        }
     }
     dlg.SetListTabs(filepaths);
 
@@ -75,6 +75,7 @@ class FileExplorer;
 class OutputTabWindow;
 class DockablePaneMenuManager;
 class MyMenuBar;
+class SearchIndexManager;
 
 //--------------------------------
 // Helper class
@@ -133,6 +134,7 @@ class clMainFrame : public wxFrame
     wxStringSet_t m_coreToolbars;
     clStatusBar* m_statusBar;
     clSingleInstanceThread* m_singleInstanceThread;
+    SearchIndexManager* m_searchIndexManager = nullptr;
     bool m_toggleToolBar;
 
     // Printing
@@ -24,6 +24,7 @@
 //////////////////////////////////////////////////////////////////////////////
 #include "mainbook.h"
 
+#include "EditorPlaceholder.hpp"
 #include "FilesModifiedDlg.h"
 #include "NotebookNavigationDlg.h"
 #include "WelcomePage.h"
@@ -66,6 +67,46 @@ wxString create_platform_filepath(const wxString& fullpath)
 #endif
 }
 
+/// return a callback that restores the caret and scroll position of a restored tab
+std::function<void(IEditor*)> create_restore_position_callback(const TabInfo& ti)
+{
+    int first_visible_line = ti.GetFirstVisibleLine();
+    int current_line = ti.GetCurrentLine();
+    return [first_visible_line, current_line](IEditor* editor) {
+        auto ctrl = editor->GetCtrl();
+        ctrl->SetFirstVisibleLine(first_visible_line);
+        editor->SetCaretAt(ctrl->PositionFromLine(current_line));
+    };
+}
+
+/// return a callback that applies the session info of a restored tab once its editor is visible on screen
+std::function<void(IEditor*)> create_restore_tab_callback(const TabInfo& ti, bool is_selected,
+                                                          bool restore_position = true)
+{
+    std::function<void(IEditor*)> restore_position_cb;
+    if (restore_position) {
+        restore_position_cb = create_restore_position_callback(ti);
+    }
+    wxArrayString bookmarks = ti.GetBookmarks();
+    std::vector<int> folds = ti.GetCollapsedFolds();
+    return [restore_position_cb, is_selected, bookmarks, folds](IEditor* editor) {
+        auto ctrl = editor->GetCtrl();
+        if (restore_position_cb) {
+            restore_position_cb(editor);
+        }
+
+        clEditor* cl_editor = dynamic_cast<clEditor*>(ctrl);
+        if (cl_editor) {
+            cl_editor->LoadMarkersFromArray(bookmarks);
+            cl_editor->LoadCollapsedFoldsFromArray(folds);
+        }
+
+        if (is_selected) {
+            editor->SetActive();
+        }
+    };
+}
+
 int FrameTimerId = wxNewId();
 // return the wxBORDER_SIMPLE that matches the current application theme
 wxBorder get_border_simple_theme_aware_bit()
@@ -206,8 +247,13 @@ void MainBook::OnMouseDClick(wxBookCtrlEvent& e)
 void MainBook::OnPageClosing(wxBookCtrlEvent& e)
 {
     e.Skip();
-    clEditor* editor = dynamic_cast<clEditor*>(m_book->GetPage(e.GetSelection()));
-    if (editor) {
+    wxWindow* page = m_book->GetPage(e.GetSelection());
+    clEditor* editor = dynamic_cast<clEditor*>(page);
+    if (dynamic_cast<EditorPlaceholder*>(page)) {
+        // not loaded: nothing to save and nobody knows about this editor yet
+        return;
+
+    } else if (editor) {
         if (AskUserToSave(editor)) {
             SendCmdEvent(wxEVT_EDITOR_CLOSING, (IEditor*)editor);
         } else {
@@ -352,38 +398,31 @@ void MainBook::DoRestoreSession(const SessionEntry& session)
     size_t sel = session.GetSelectedTab();
     clEditor* active_editor = nullptr;
     const auto& vTabInfoArr = session.GetTabInfoArr();
+
+    // Only the selected tab is loaded now, the other tabs are placeholders that are replaced with an editor
+    // when they are selected or when their file is needed. Files that can not be restored lazily (e.g. remote
+    // files that need to be downloaded first) are opened as before
+    m_reloadingDoRaise = false; // Raise() only the selected editor, once all the tabs were added
     for (size_t i = 0; i < vTabInfoArr.size(); i++) {
         const TabInfo& ti = vTabInfoArr[i];
-        int first_visible_line = ti.GetFirstVisibleLine();
-        int current_line = ti.GetCurrentLine();
-        const wxArrayString& bookmarks = ti.GetBookmarks();
-        const std::vector<int>& folds = ti.GetCollapsedFolds();
-
         bool is_selected = sel == i;
-        m_reloadingDoRaise = (i == vTabInfoArr.size() - 1); // Raise() when opening only the last editor
-
-        /// prepare a callback to be executed once the file is visible on screen
-        auto cb = [first_visible_line, current_line, is_selected, bookmarks, folds](IEditor* editor) {
-            auto ctrl = editor->GetCtrl();
-            ctrl->SetFirstVisibleLine(first_visible_line);
-            editor->SetCaretAt(ctrl->PositionFromLine(current_line));
-
-            clEditor* cl_editor = dynamic_cast<clEditor*>(ctrl);
-            if (cl_editor) {
-                cl_editor->LoadMarkersFromArray(bookmarks);
-                cl_editor->LoadCollapsedFoldsFromArray(folds);
-            }
+        if (!is_selected && DoAddPlaceholder(ti)) {
+            continue;
+        }
 
-            if (is_selected) {
-                editor->SetActive();
-            }
-        };
-        auto editor = OpenFileAsync(ti.GetFileName(), std::move(cb));
-        if (sel == i) {
+        auto editor = OpenFileAsync(ti.GetFileName(), create_restore_tab_callback(ti, is_selected));
+        if (is_selected) {
             active_editor = editor;
         }
     }
-    SelectPage(active_editor);
+    m_reloadingDoRaise = true;
+
+    if (active_editor) {
+        SelectPage(active_editor);
+    } else {
+        // the selected tab could not be restored, load the current page instead
+        SelectPage(m_book->GetCurrentPage());
+    }
 
 #if MAINBOOK_AUIBOOK
     // now that all the pages have been loaded into the book, ensure that our Ctrl-TAB window
@@ -423,10 +462,14 @@ void MainBook::GetAllTabs(clTab::Vec_t& tabs)
         t.window = tabInfo->GetWindow();
 
         clEditor* editor = dynamic_cast<clEditor*>(t.window);
+        EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(t.window);
         if (editor) {
             t.isFile = true;
             t.isModified = editor->GetModify();
             t.filename = editor->GetFileName();
+        } else if (placeholder) {
+            t.isFile = true;
+            t.filename = placeholder->GetFileName();
         }
         tabs.push_back(t);
     }
@@ -456,6 +499,8 @@ int MainBook::FindEditorIndexByFullPath(const wxString& fullpath)
 
     for (size_t i = 0; i < m_book->GetPageCount(); ++i) {
         clEditor* editor = dynamic_cast<clEditor*>(m_book->GetPage(i));
+        EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(m_book->GetPage(i));
+        wxString editorFile;
         if (editor) {
             // are we a remote path?
             if (editor->IsRemoteFile()) {
@@ -463,35 +508,43 @@ int MainBook::FindEditorIndexByFullPath(const wxString& fullpath)
                     editor->GetRemoteData()->GetLocalPath() == fullpath) {
                     return i;
                 }
-            } else {
-                // local path
-                wxString unixStyleFile(FileUtils::RealPath(editor->GetFileName().GetFullPath()));
-                wxString nativeFile(unixStyleFile);
+                continue;
+            }
+            editorFile = editor->GetFileName().GetFullPath();
+
+        } else if (placeholder) {
+            // a restored tab that was not loaded yet, placeholders are always local files
+            editorFile = placeholder->GetFileName().GetFullPath();
+
+        } else {
+            continue;
+        }
+
+        // local path
+        wxString unixStyleFile(FileUtils::RealPath(editorFile));
+        wxString nativeFile(unixStyleFile);
 #ifdef __WXMSW__
-                unixStyleFile.Replace(wxT("\\"), wxT("/"));
+        unixStyleFile.Replace(wxT("\\"), wxT("/"));
 #endif
 
 #ifdef __WXGTK__
-                // On Unix files are case sensitive
-                if (nativeFile.Cmp(fullpath) == 0 || unixStyleFile.Cmp(fullpath) == 0 ||
-                    unixStyleFile.Cmp(fileNameDest) == 0)
+        // On Unix files are case sensitive
+        if (nativeFile.Cmp(fullpath) == 0 || unixStyleFile.Cmp(fullpath) == 0 || unixStyleFile.Cmp(fileNameDest) == 0)
 #else
-                // Compare in no case sensitive manner
-                if (nativeFile.CmpNoCase(fullpath) == 0 || unixStyleFile.CmpNoCase(fullpath) == 0)
+        // Compare in no case sensitive manner
+        if (nativeFile.CmpNoCase(fullpath) == 0 || unixStyleFile.CmpNoCase(fullpath) == 0)
 #endif
-                {
-                    return i;
-                }
+        {
+            return i;
+        }
 
 #if defined(__WXGTK__)
-                // Try again, dereferencing the editor fpath
-                wxString editorDest = FileUtils::RealPath(unixStyleFile, true);
-                if (editorDest.Cmp(fullpath) == 0 || editorDest.Cmp(fileNameDest) == 0) {
-                    return i;
-                }
-#endif
-            }
+        // Try again, dereferencing the editor fpath
+        wxString editorDest = FileUtils::RealPath(unixStyleFile, true);
+        if (editorDest.Cmp(fullpath) == 0 || editorDest.Cmp(fileNameDest) == 0) {
+            return i;
         }
+#endif
     }
     return wxNOT_FOUND;
 }
@@ -499,10 +552,26 @@ int MainBook::FindEditorIndexByFullPath(const wxString& fullpath)
 clEditor* MainBook::FindEditor(const wxString& fileName)
 {
     int index = FindEditorIndexByFullPath(fileName);
-    if (index != wxNOT_FOUND) {
-        return dynamic_cast<clEditor*>(m_book->GetPage(index));
+    if (index == wxNOT_FOUND) {
+        return nullptr;
+    }
+
+    // the file was restored from the session but not loaded yet: load it now
+    EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(m_book->GetPage(index));
+    if (placeholder) {
+        return DoLoadPlaceholder(placeholder);
+    }
+    return dynamic_cast<clEditor*>(m_book->GetPage(index));
+}
+
+bool MainBook::CloseEditor(const wxString& fileName)
+{
+    int index = FindEditorIndexByFullPath(fileName);
+    if (index == wxNOT_FOUND) {
+        return false;
     }
-    return nullptr;
+    // do not load a placeholder just to close it
+    return ClosePage(m_book->GetPage(index));
 }
 
 wxWindow* MainBook::FindPage(const wxString& text)
@@ -513,6 +582,11 @@ wxWindow* MainBook::FindPage(const wxString& text)
             return editor;
         }
 
+        EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(m_book->GetPage(i));
+        if (placeholder && FileUtils::RealPath(placeholder->GetFileName().GetFullPath()).CmpNoCase(text) == 0) {
+            return placeholder;
+        }
+
         if (m_book->GetPageText(i) == text) {
             return m_book->GetPage(i);
         }
@@ -732,6 +806,13 @@ clEditor* MainBook::OpenFile(const wxString& file_name,
         }
     }
 
+    if (position != wxNOT_FOUND || lineno != wxNOT_FOUND) {
+        // the caller moves the caret: a restored tab loaded in the background must not jump back to its session
+        // position once it becomes visible
+        m_restorePositionTable.erase(
+            create_platform_filepath(FileUtils::RealPath(editor->GetFileName().GetFullPath(), true)));
+    }
+
     if (position != wxNOT_FOUND) {
         editor->SetEnsureCaretIsVisible(position, preserveSelection);
         editor->SetLineVisible(editor->LineFromPosition(position));
@@ -784,6 +865,12 @@ bool MainBook::AddBookPage(
 
 bool MainBook::SelectPage(wxWindow* win)
 {
+    EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(win);
+    if (placeholder) {
+        // select the loaded editor instead
+        win = DoLoadPlaceholder(placeholder);
+    }
+
     if (win == nullptr) {
         return false;
     }
@@ -1012,6 +1099,19 @@ bool MainBook::CloseAllButThis(wxWindow* page)
         }
         ClosePage(editor, true);
     }
+
+    // and the restored tabs that were never loaded
+    std::vector<wxWindow*> placeholders;
+    for (size_t i = 0; i < m_book->GetPageCount(); ++i) {
+        wxWindow* win = m_book->GetPage(i);
+        if (win != page && dynamic_cast<EditorPlaceholder*>(win)) {
+            placeholders.push_back(win);
+        }
+    }
+
+    for (wxWindow* placeholder : placeholders) {
+        ClosePage(placeholder);
+    }
     return true;
 }
 
@@ -1240,7 +1340,11 @@ void MainBook::OnPageChanged(wxBookCtrlEvent& e)
     int newSel = e.GetSelection();
     if (newSel != wxNOT_FOUND && m_reloadingDoRaise) {
         wxWindow* win = m_book->GetPage((size_t)newSel);
-        if (win) {
+        EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(win);
+        if (placeholder) {
+            // a restored tab was selected: replace it with its editor, once the notebook is done with this event
+            CallAfter(&MainBook::DoLoadPlaceholderByPath, placeholder->GetFileName().GetFullPath());
+        } else if (win) {
             SelectPage(win);
         }
     }
@@ -1350,42 +1454,53 @@ FilesModifiedDlg* MainBook::GetFilesModifiedDlg()
 
 void MainBook::CreateSession(SessionEntry& session, wxArrayInt* excludeArr)
 {
-    std::vector<clEditor*> editors = GetAllEditors();
-
-    // Remove editors which belong to the SFTP
-    std::vector<clEditor*> editorsTmp;
-    for (clEditor* editor : editors) {
-        IEditor* ieditor = dynamic_cast<IEditor*>(editor);
-        if (ieditor->GetClientData("sftp") == NULL) {
-            editorsTmp.push_back(editor);
+    // The file tabs, in the notebook order: the editors and the restored tabs that were not loaded yet
+    // (`excludeArr` is indexed by this list, see GetAllTabs())
+    std::vector<wxWindow*> pages;
+    for (size_t i = 0; i < m_book->GetPageCount(); i++) {
+        wxWindow* page = m_book->GetPage(i);
+        if (dynamic_cast<clEditor*>(page) || dynamic_cast<EditorPlaceholder*>(page)) {
+            pages.push_back(page);
         }
     }
 
-    editors.swap(editorsTmp);
-
     session.SetSelectedTab(0);
     std::vector<TabInfo> vTabInfoArr;
-    for (size_t i = 0; i < editors.size(); i++) {
+    for (size_t i = 0; i < pages.size(); i++) {
 
         if (excludeArr && (excludeArr->GetCount() > i) && (!excludeArr->Item(i))) {
             // If we're saving only selected editors, and this isn't one of them...
             continue;
         }
 
-        if (editors[i] == GetActiveEditor()) {
+        EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(pages[i]);
+        if (placeholder) {
+            // keep the session info it was restored with
+            vTabInfoArr.push_back(placeholder->GetTabInfo());
+            continue;
+        }
+
+        // Skip editors which belong to the SFTP
+        clEditor* editor = dynamic_cast<clEditor*>(pages[i]);
+        IEditor* ieditor = dynamic_cast<IEditor*>(editor);
+        if (ieditor->GetClientData("sftp") != NULL) {
+            continue;
+        }
+
+        if (editor == GetActiveEditor()) {
             session.SetSelectedTab(vTabInfoArr.size());
         }
         TabInfo oTabInfo;
-        oTabInfo.SetFileName(editors[i]->GetFileName().GetFullPath());
-        oTabInfo.SetFirstVisibleLine(editors[i]->GetFirstVisibleLine());
-        oTabInfo.SetCurrentLine(editors[i]->GetCurrentLine());
+        oTabInfo.SetFileName(editor->GetFileName().GetFullPath());
+        oTabInfo.SetFirstVisibleLine(editor->GetFirstVisibleLine());
+        oTabInfo.SetCurrentLine(editor->GetCurrentLine());
 
         wxArrayString astrBookmarks;
-        editors[i]->StoreMarkersToArray(astrBookmarks);
+        editor->StoreMarkersToArray(astrBookmarks);
         oTabInfo.SetBookmarks(astrBookmarks);
 
         std::vector<int> folds;
-        editors[i]->StoreCollapsedFoldsToArray(folds);
+        editor->StoreCollapsedFoldsToArray(folds);
         oTabInfo.SetCollapsedFolds(folds);
 
         vTabInfoArr.push_back(oTabInfo);
@@ -1779,6 +1894,85 @@ clEditor* MainBook::OpenFileAsync(const wxString& file_name, std::function<void(
     return editor;
 }
 
+bool MainBook::DoAddPlaceholder(const TabInfo& tab_info)
+{
+    wxFileName fileName(FileUtils::RealPath(tab_info.GetFileName()));
+    fileName.MakeAbsolute();
+    if (!fileName.FileExists() || FileExtManager::GetType(fileName.GetFullPath()) == FileExtManager::TypeBmp ||
+        FindEditorIndexByFullPath(fileName.GetFullPath()) != wxNOT_FOUND) {
+        return false;
+    }
+
+    EditorPlaceholder* placeholder = new EditorPlaceholder(m_book, tab_info, fileName);
+    AddBookPage(placeholder, CreateLabel(fileName, false), fileName.GetFullPath(), wxNOT_FOUND, false, wxNOT_FOUND);
+    return true;
+}
+
+clEditor* MainBook::DoLoadPlaceholder(EditorPlaceholder* placeholder)
+{
+    int index = m_book->GetPageIndex(placeholder);
+    if (index == wxNOT_FOUND) {
+        return nullptr;
+    }
+
+    // the placeholder is deleted below
+    TabInfo tab_info = placeholder->GetTabInfo();
+    wxFileName fileName = placeholder->GetFileName();
+    bool is_selected = m_book->GetSelection() == index;
+    clDEBUG() << "Loading restored tab:" << fileName.GetFullPath() << endl;
+
+    wxString filePath = fileName.GetFullPath();
+    wxString projName = ManagerST::Get()->GetProjectNameByFile(filePath);
+
+    clEditor* editor = new clEditor(m_book);
+    editor->Create(projName, fileName);
+
+    {
+        // swap the pages without notifying anyone
+#if MAINBOOK_AUIBOOK
+        clAuiBookEventsDisabler events_disabler{ m_book };
+#endif
+        clWindowUpdateLocker locker{ m_book };
+        bool reloadingDoRaise = m_reloadingDoRaise;
+        m_reloadingDoRaise = false;
+
+        AddBookPage(editor, m_book->GetPageText(index), fileName.GetFullPath(), wxNOT_FOUND, false, index);
+        m_book->RemovePage(index + 1, false);
+        placeholder->Destroy();
+        if (is_selected) {
+            m_book->ChangeSelection(index);
+        }
+        m_reloadingDoRaise = reloadingDoRaise;
+    }
+
+    editor->SetSyntaxHighlight();
+    ManagerST::Get()->GetBreakpointsMgr()->RefreshBreakpointsForEditor(editor);
+    MarkEditorReadOnly(editor);
+
+    m_recentFiles.AddFileToHistory(fileName.GetFullPath());
+    clConfig::Get().AddRecentFile(fileName.GetFullPath());
+
+    // apply the session info once the editor is visible on screen. The position is kept aside, OpenFile() drops it
+    // when it moves the caret
+    wxString real_path = FileUtils::RealPath(editor->GetFileName().GetFullPath(), true);
+    m_restorePositionTable[create_platform_filepath(real_path)] = create_restore_position_callback(tab_info);
+    push_callback(create_restore_tab_callback(tab_info, false, false), real_path);
+    return editor;
+}
+
+void MainBook::DoLoadPlaceholderByPath(const wxString& fullpath)
+{
+    int index = FindEditorIndexByFullPath(fullpath);
+    if (index == wxNOT_FOUND) {
+        return;
+    }
+
+    EditorPlaceholder* placeholder = dynamic_cast<EditorPlaceholder*>(m_book->GetPage(index));
+    if (placeholder && m_book->GetSelection() == index) {
+        SelectPage(placeholder);
+    }
+}
+
 void MainBook::push_callback(std::function<void(IEditor*)>&& callback, const wxString& fullpath)
 {
     // register a callback for this insert
@@ -1810,6 +2004,13 @@ void MainBook::execute_callbacks_for_file(const wxString& fullpath)
     IEditor* editor = FindEditor(fullpath);
     CHECK_PTR_RET(editor);
 
+    auto iter = m_restorePositionTable.find(key);
+    if (iter != m_restorePositionTable.end()) {
+        auto restore_position = std::move(iter->second);
+        m_restorePositionTable.erase(iter);
+        restore_position(editor);
+    }
+
     for (auto& callback : V) {
         callback(editor);
     }
@@ -40,6 +40,7 @@
 #include <wx/panel.h>
 
 class FilesModifiedDlg;
+class EditorPlaceholder;
 
 class IEditor;
 class MessagePane;
@@ -62,6 +63,9 @@ private:
     WelcomePage* m_welcomePage = nullptr;
     QuickFindBar* m_findBar;
     std::unordered_map<wxString, CallbackVec_t> m_callbacksTable;
+    // restored tabs loaded in the background: the session position to apply once they are visible, unless the
+    // caret was moved to another location in the meantime
+    std::unordered_map<wxString, std::function<void(IEditor*)>> m_restorePositionTable;
     bool m_initDone = false;
 
 private:
@@ -124,6 +128,19 @@ private:
     int FindEditorIndexByFullPath(const wxString& fullpath);
     void DoRestoreSession(const SessionEntry& entry);
 
+    /**
+     * @brief add a tab that loads `tab_info` only when it is first needed
+     * @return false if the file can not be restored lazily (e.g. it does not exist locally)
+     */
+    bool DoAddPlaceholder(const TabInfo& tab_info);
+
+    /**
+     * @brief replace `placeholder` with a loaded editor, at the same position. The editor is not activated.
+     * The session position is restored once the editor is visible, unless OpenFile() moves the caret before that
+     */
+    clEditor* DoLoadPlaceholder(EditorPlaceholder* placeholder);
+    void DoLoadPlaceholderByPath(const wxString& fullpath);
+
 public:
     MainBook(wxWindow* parent);
     virtual ~MainBook();
@@ -188,7 +205,10 @@ public:
     void GetAllTabs(clTab::Vec_t& tabs);
 
     clEditor* FindEditor(const wxString& fileName);
-    bool CloseEditor(const wxString& fileName) { return ClosePage(FindEditor(fileName)); }
+    /**
+     * @brief close the tab of `fileName`. A restored tab that was not loaded yet is closed without loading it
+     */
+    bool CloseEditor(const wxString& fileName);
 
     wxWindow* GetCurrentPage();
     int GetCurrentPageIndex();
@@ -327,7 +327,8 @@ void OpenWindowsPanel::AppendEditor(const clTab& tab)
     }
 
     bool saved_before = false;
-    auto editor = clGetManager()->FindEditor(tab.filename.GetFullPath());
+    // use the tab window rather than FindEditor(), which would load the restored tabs that were not loaded yet
+    auto editor = dynamic_cast<IEditor*>(tab.window);
     saved_before = editor && editor->GetCtrl()->CanUndo();
     MarkItemModified(item, is_modified, saved_before);
 }
@@ -461,7 +462,7 @@ wxVariant OpenWindowsPanel::PrepareValue(const clTab& tab, bool* isModified)
     title = GetDisplayName(tab);
 
     if(tab.isFile) {
-        auto i_editor = clGetManager()->FindEditor(tab.filename.GetFullPath());
+        auto i_editor = dynamic_cast<IEditor*>(tab.window);
         if(i_editor) {
             editor = i_editor->GetCtrl();
         }
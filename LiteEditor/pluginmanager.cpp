@@ -25,6 +25,7 @@
 #include "pluginmanager.h"
 
 #include "BuildTab.hpp"
+#include "JSON.h"
 #include "Keyboard/clKeyboardManager.h"
 #include "SideBar.hpp"
 #include "StdToWX.h"
@@ -57,7 +58,9 @@
 #include "sessionmanager.h"
 #include "workspacetab.h"
 
+#include <chrono>
 #include <memory>
+#include <unordered_map>
 #include <wx/dir.h>
 #include <wx/filename.h>
 #include <wx/log.h>
@@ -70,6 +73,64 @@ namespace
 const wxString SIDEBAR = PANE_LEFT_SIDEBAR;
 const wxString SECONDARY_SIDEBAR = PANE_RIGHT_SIDEBAR;
 const wxString BOTTOM_BAR = PANE_OUTPUT;
+
+typedef std::chrono::steady_clock::time_point time_point_t;
+
+long elapsed_us(const time_point_t& start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// a plugin library, loaded and with its entry points resolved before the plugin is constructed
+struct PreloadedPlugin {
+    std::unique_ptr<clDynamicLibrary> dl;
+    GET_PLUGIN_INFO_FUNC info_func = nullptr;
+    GET_PLUGIN_INTERFACE_VERSION_FUNC version_func = nullptr;
+    GET_PLUGIN_CREATE_FUNC create_func = nullptr;
+    bool loaded = false;
+    wxString error;
+    PluginLoadTimes times;
+};
+
+/// load the plugin libraries and resolve their entry points, recording the time spent on each step.
+/// This runs on the main thread: the dynamic loader holds its lock for the whole of dlopen() (mapping, relocations
+/// and static initialisers), so loading from several threads does not overlap any of the work
+void preload_plugins(std::vector<PreloadedPlugin>& plugins)
+{
+    for (PreloadedPlugin& plugin : plugins) {
+        auto start = std::chrono::steady_clock::now();
+        plugin.dl.reset(new clDynamicLibrary());
+        plugin.loaded = plugin.dl->Load(plugin.times.file);
+        plugin.times.dlopen = elapsed_us(start);
+        if (!plugin.loaded) {
+            plugin.error = plugin.dl->GetError();
+            continue;
+        }
+
+        bool success = false;
+        start = std::chrono::steady_clock::now();
+        plugin.info_func = (GET_PLUGIN_INFO_FUNC)plugin.dl->GetSymbol(wxT("GetPluginInfo"), &success);
+        if (!success) {
+            plugin.info_func = nullptr;
+        }
+
+        plugin.version_func =
+            (GET_PLUGIN_INTERFACE_VERSION_FUNC)plugin.dl->GetSymbol(wxT("GetPluginInterfaceVersion"), &success);
+        if (!success) {
+            plugin.version_func = nullptr;
+            plugin.error = plugin.dl->GetError();
+        }
+
+        plugin.create_func = (GET_PLUGIN_CREATE_FUNC)plugin.dl->GetSymbol(wxT("CreatePlugin"), &success);
+        if (!success) {
+            plugin.create_func = nullptr;
+            if (plugin.error.empty()) {
+                plugin.error = plugin.dl->GetError();
+            }
+        }
+        plugin.times.symbols = elapsed_us(start);
+    }
+}
 } // namespace
 
 PluginManager* PluginManager::Get()
@@ -124,6 +185,11 @@ PluginManager::PluginManager()
 
 void PluginManager::Load()
 {
+    auto load_start = std::chrono::steady_clock::now();
+    m_loadTimes.clear();
+    m_loadTotalTime = 0;
+    m_preloadTime = 0;
+
     wxString ext;
 #if defined(__WXGTK__)
     ext = wxT("so");
@@ -166,9 +232,10 @@ void PluginManager::Load()
 
         // Sort the plugins by A-Z
         std::sort(files.begin(), files.end());
-        for (size_t i = 0; i < files.GetCount(); i++) {
 
-            wxString fileName(files.Item(i));
+        std::vector<PreloadedPlugin> preloaded;
+        preloaded.reserve(files.size());
+        for (const wxString& fileName : files) {
 #ifdef __WXGTK__
             wxFileName fnDLL(fileName);
             if (fnDLL.GetFullName().StartsWith("lib")) {
@@ -176,42 +243,56 @@ void PluginManager::Load()
                 continue;
             }
 #endif
+            preloaded.emplace_back();
+            preloaded.back().times.file = fileName;
+            preloaded.back().times.name = wxFileName(fileName).GetName();
+        }
 
-            clDynamicLibrary* dl = new clDynamicLibrary();
-            if (!dl->Load(fileName)) {
+        // load all the libraries first, the plugins are then constructed in order
+        auto preload_start = std::chrono::steady_clock::now();
+        preload_plugins(preloaded);
+        m_preloadTime = elapsed_us(preload_start);
+
+        std::unordered_map<IPlugin*, size_t> pluginTimes;
+        for (PreloadedPlugin& preloadedPlugin : preloaded) {
+            PluginLoadTimes& times = preloadedPlugin.times;
+            const wxString& fileName = times.file;
+            std::unique_ptr<clDynamicLibrary> dl = std::move(preloadedPlugin.dl);
+            if (!preloadedPlugin.loaded) {
                 clERROR() << "Failed to load plugin's dll" << fileName << endl;
-                if (!dl->GetError().IsEmpty()) {
-                    clERROR() << dl->GetError() << endl;
+                if (!preloadedPlugin.error.IsEmpty()) {
+                    clERROR() << preloadedPlugin.error << endl;
                 }
-                wxDELETE(dl);
+                times.status = "failed to load the library";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
-            bool success(false);
-            GET_PLUGIN_INFO_FUNC pfnGetPluginInfo = (GET_PLUGIN_INFO_FUNC)dl->GetSymbol(wxT("GetPluginInfo"), &success);
-            if (!success) {
-                wxDELETE(dl);
+            GET_PLUGIN_INFO_FUNC pfnGetPluginInfo = preloadedPlugin.info_func;
+            if (!pfnGetPluginInfo) {
+                times.status = "not a plugin";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
             // load the plugin version method
             // if the methods does not exist, handle it as if it has value of 100 (lowest version API)
             int interface_version(100);
-            GET_PLUGIN_INTERFACE_VERSION_FUNC pfnInterfaceVersion =
-                (GET_PLUGIN_INTERFACE_VERSION_FUNC)dl->GetSymbol(wxT("GetPluginInterfaceVersion"), &success);
-            if (success) {
+            GET_PLUGIN_INTERFACE_VERSION_FUNC pfnInterfaceVersion = preloadedPlugin.version_func;
+            if (pfnInterfaceVersion) {
                 interface_version = pfnInterfaceVersion();
             } else {
                 clWARNING() << "Failed to find GetPluginInterfaceVersion() in dll" << fileName << endl;
-                if (!dl->GetError().IsEmpty()) {
-                    clWARNING() << dl->GetError() << endl;
+                if (!preloadedPlugin.error.IsEmpty()) {
+                    clWARNING() << preloadedPlugin.error << endl;
                 }
             }
 
             if (interface_version != PLUGIN_INTERFACE_VERSION) {
                 clWARNING() << "Version interface mismatch error for plugin:" << fileName
                             << ". Found:" << interface_version << "Expected:" << PLUGIN_INTERFACE_VERSION << endl;
-                wxDELETE(dl);
+                times.status = "interface version mismatch";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
@@ -220,6 +301,7 @@ void PluginManager::Load()
 
             wxString pname = pluginInfo->GetName();
             m_installedPlugins.insert({ pname, *pluginInfo });
+            times.name = pname;
 
             pname.MakeLower().Trim().Trim(false);
 
@@ -227,7 +309,8 @@ void PluginManager::Load()
             if (pp == CodeLiteApp::PP_FromList && allowedPlugins.Index(pname) == wxNOT_FOUND) {
                 // Policy is set to 'from list' and this plugin does not match any plugins from
                 // the list, don't allow it to be loaded
-                wxDELETE(dl);
+                times.status = "not allowed by the command line";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
@@ -235,39 +318,51 @@ void PluginManager::Load()
             bool firstTimeLoading = (m_pluginsData.GetPlugins().count(pluginInfo->GetName()) == 0);
             if (firstTimeLoading && pluginInfo->HasFlag(PluginInfo::kDisabledByDefault)) {
                 m_pluginsData.DisablePlugin(pluginInfo->GetName());
-                wxDELETE(dl);
+                times.status = "disabled";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
             // Can we load it?
             if (!m_pluginsData.CanLoad(*pluginInfo)) {
                 clWARNING() << "Plugin:" << pluginInfo->GetName() << " is not enabled" << endl;
-                wxDELETE(dl);
+                times.status = "disabled";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
             // try and load the plugin
-            GET_PLUGIN_CREATE_FUNC pfn = (GET_PLUGIN_CREATE_FUNC)dl->GetSymbol(wxT("CreatePlugin"), &success);
-            if (!success) {
+            GET_PLUGIN_CREATE_FUNC pfn = preloadedPlugin.create_func;
+            if (!pfn) {
                 clWARNING() << "Failed to find CreatePlugin() in dll:" << fileName << endl;
-                if (!dl->GetError().IsEmpty()) {
-                    clWARNING() << dl->GetError() << endl;
+                if (!preloadedPlugin.error.IsEmpty()) {
+                    clWARNING() << preloadedPlugin.error << endl;
                 }
 
                 m_pluginsData.DisablePlugin(pluginInfo->GetName());
+                times.status = "CreatePlugin() not found";
+                m_loadTimes.push_back(times);
                 continue;
             }
 
             // Construct the plugin
+            auto start = std::chrono::steady_clock::now();
             IPlugin* plugin = pfn((IManager*)this);
+            times.create = elapsed_us(start);
             clDEBUG() << "Loaded plugin:" << plugin->GetLongName() << endl;
             m_plugins[plugin->GetShortName()] = plugin;
 
             // Load the toolbar
+            start = std::chrono::steady_clock::now();
             plugin->CreateToolBar(clMainFrame::Get()->GetPluginsToolBar());
+            times.ui = elapsed_us(start);
+
+            times.status = "loaded";
+            pluginTimes.insert({ plugin, m_loadTimes.size() });
+            m_loadTimes.push_back(times);
 
             // Keep the dynamic load library
-            m_dl.push_back(dl);
+            m_dl.push_back(dl.release());
         }
         clMainFrame::Get()->GetDockingManager().Update();
 
@@ -278,8 +373,12 @@ void PluginManager::Load()
         if (pluginsMenu && menuitem) {
             for (auto& vt : m_plugins) {
                 IPlugin* plugin = vt.second;
+                auto start = std::chrono::steady_clock::now();
                 plugin->SetPluginsMenu(pluginsMenu);
                 plugin->CreatePluginMenu(pluginsMenu);
+                if (pluginTimes.count(plugin)) {
+                    m_loadTimes[pluginTimes[plugin]].ui += elapsed_us(start);
+                }
             }
         }
 
@@ -287,6 +386,10 @@ void PluginManager::Load()
         conf.WriteItem(&m_pluginsData);
     }
 
+    m_loadTotalTime = elapsed_us(load_start);
+    clDEBUG() << "Plugins loaded in" << (m_loadTotalTime / 1000) << "ms" << endl;
+    SaveLoadReport();
+
     // Now that all the plugins are loaded, load from the configuration file
     // list of visible tabs
     static const wxArrayString DefaultArray = StdToWX::ToArrayString({ "NOT-FOUND" });
@@ -330,6 +433,45 @@ void PluginManager::Load()
     }
 }
 
+const PluginLoadTimes* PluginManager::GetLoadTimes(const wxString& name) const
+{
+    for (const auto& times : m_loadTimes) {
+        if (times.name == name) {
+            return &times;
+        }
+    }
+    return nullptr;
+}
+
+wxFileName PluginManager::GetLoadReportFile() const
+{
+    return wxFileName(clStandardPaths::Get().GetUserDataDir(), "plugins-startup.json");
+}
+
+void PluginManager::SaveLoadReport() const
+{
+    JSON root(cJSON_Object);
+    JSONItem report = root.toElement();
+    report.addProperty("total_us", m_loadTotalTime);
+    report.addProperty("preload_us", m_preloadTime);
+
+    JSONItem plugins = JSONItem::createArray("plugins");
+    for (const auto& times : m_loadTimes) {
+        JSONItem plugin = JSONItem::createObject();
+        plugin.addProperty("name", times.name);
+        plugin.addProperty("file", times.file);
+        plugin.addProperty("status", times.status);
+        plugin.addProperty("dlopen_us", times.dlopen);
+        plugin.addProperty("symbols_us", times.symbols);
+        plugin.addProperty("create_us", times.create);
+        plugin.addProperty("ui_us", times.ui);
+        plugin.addProperty("total_us", times.GetTotal());
+        plugins.arrayAppend(plugin);
+    }
+    report.append(plugins);
+    root.save(GetLoadReportFile());
+}
+
 IEditor* PluginManager::GetActiveEditor()
 {
     if (clMainFrame::Get() && clMainFrame::Get()->GetMainBook()) {
@@ -558,9 +700,7 @@ BuildSettingsConfig* PluginManager::GetBuildSettingsConfigManager() { return Bui
 bool PluginManager::ClosePage(const wxString& title) { return clMainFrame::Get()->GetMainBook()->ClosePage(title); }
 bool PluginManager::ClosePage(const wxFileName& filename)
 {
-    MainBook* book = clMainFrame::Get()->GetMainBook();
-    clEditor* editor = book->FindEditor(filename.GetFullPath());
-    return clMainFrame::Get()->GetMainBook()->ClosePage(editor);
+    return clMainFrame::Get()->GetMainBook()->CloseEditor(filename.GetFullPath());
 }
 
 wxWindow* PluginManager::FindPage(const wxString& text) { return clMainFrame::Get()->GetMainBook()->FindPage(text); }
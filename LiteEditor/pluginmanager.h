@@ -38,6 +38,7 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <wx/filename.h>
 #include <wx/string.h>
 #include <wx/treectrl.h>
 
@@ -50,6 +51,27 @@ class BitmapLoader;
 class clWorkspaceView;
 class clInfoBar;
 
+/**
+ * @brief the time spent loading a plugin at startup, in microseconds
+ */
+struct PluginLoadTimes {
+    /// the plugin name, or the file name if the library could not be queried
+    wxString name;
+    wxString file;
+    /// "loaded" or the reason the plugin was not loaded
+    wxString status;
+    /// loading the shared library (runs its static initialisers)
+    long dlopen = 0;
+    /// resolving the plugin entry points
+    long symbols = 0;
+    /// the CreatePlugin() call
+    long create = 0;
+    /// creating the toolbar and the menu of the plugin
+    long ui = 0;
+
+    long GetTotal() const { return dlopen + symbols + create + ui; }
+};
+
 class PluginManager : public IManager
 {
     std::map<wxString, IPlugin*> m_plugins;
@@ -60,11 +82,17 @@ class PluginManager : public IManager
     std::map<wxString, wxString> m_backticks;
     wxAuiManager* m_dockingManager;
     PluginInfo::PluginMap_t m_installedPlugins;
+    std::vector<PluginLoadTimes> m_loadTimes;
+    long m_loadTotalTime = 0;
+    long m_preloadTime = 0;
 
 private:
     PluginManager();
     virtual ~PluginManager();
 
+    /// write the startup report returned by GetLoadReport() as JSON
+    void SaveLoadReport() const;
+
 public:
     static PluginManager* Get();
 
@@ -77,6 +105,26 @@ public:
         this->m_installedPlugins = installedPlugins;
     }
     const PluginInfo::PluginMap_t& GetInstalledPlugins() const { return m_installedPlugins; }
+
+    /**
+     * \brief return the load times of the plugins found at startup, in their load order
+     */
+    const std::vector<PluginLoadTimes>& GetLoadTimes() const { return m_loadTimes; }
+
+    /**
+     * \brief return the load times of the plugin `name`, or nullptr if it was not found at startup
+     */
+    const PluginLoadTimes* GetLoadTimes(const wxString& name) const;
+
+    /**
+     * \brief return the time spent in Load(), in microseconds
+     */
+    long GetLoadTotalTime() const { return m_loadTotalTime; }
+
+    /**
+     * \brief the startup report, written by Load() into the user data folder
+     */
+    wxFileName GetLoadReportFile() const;
     /**
      * \brief return a map of all loaded plugins
      */
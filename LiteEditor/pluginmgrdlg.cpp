@@ -126,6 +126,25 @@ void PluginMgrDlg::CreateInfoPage(unsigned int index)
 
         WritePropertyLine(_("Is Loaded?"), plugins.CanLoad(info) ? _("Yes") : _("No"));
         m_richTextCtrl->Newline();
+
+        // the timings of the last startup
+        const PluginLoadTimes* times = PluginManager::Get()->GetLoadTimes(info.GetName());
+        if(times) {
+            auto to_ms = [](long us) { return us / 1000.0; };
+            WritePropertyLine(_("Startup"), times->status);
+            m_richTextCtrl->Newline();
+
+            wxString load_time;
+            load_time << wxString::Format("%.1f ms", to_ms(times->GetTotal()))
+                      << wxString::Format(_(" (library: %.1f, symbols: %.1f, construction: %.1f, UI: %.1f)"),
+                                          to_ms(times->dlopen), to_ms(times->symbols), to_ms(times->create),
+                                          to_ms(times->ui));
+            WritePropertyLine(_("Load time"), load_time);
+            m_richTextCtrl->Newline();
+
+            WritePropertyLine(_("Startup report"), PluginManager::Get()->GetLoadReportFile().GetFullPath());
+            m_richTextCtrl->Newline();
+        }
         m_richTextCtrl->Newline();
 
         m_richTextCtrl->BeginBold();
@@ -94,6 +94,11 @@ clFileSystemWorkspace::clFileSystemWorkspace(bool dummy)
         EventNotifier::Get()->Bind(wxEVT_DBG_UI_START, &clFileSystemWorkspace::OnDebug, this);
 
         EventNotifier::Get()->Bind(wxEVT_FILE_CREATED, &clFileSystemWorkspace::OnFileSystemUpdated, this);
+
+        // changes made to the workspace folder outside of CodeLite
+        m_watcher.SetOwner(this);
+        Bind(wxEVT_FILE_MODIFIED, &clFileSystemWorkspace::OnWatchedFilesModified, this);
+        Bind(wxEVT_FILE_NOT_FOUND, &clFileSystemWorkspace::OnWatchedFilesNotFound, this);
     }
 }
 
@@ -138,6 +143,10 @@ clFileSystemWorkspace::~clFileSystemWorkspace()
         EventNotifier::Get()->Unbind(wxEVT_DBG_UI_START, &clFileSystemWorkspace::OnDebug, this);
 
         EventNotifier::Get()->Unbind(wxEVT_FILE_CREATED, &clFileSystemWorkspace::OnFileSystemUpdated, this);
+
+        m_watcher.Clear();
+        Unbind(wxEVT_FILE_MODIFIED, &clFileSystemWorkspace::OnWatchedFilesModified, this);
+        Unbind(wxEVT_FILE_NOT_FOUND, &clFileSystemWorkspace::OnWatchedFilesNotFound, this);
     }
 }
 
@@ -190,29 +199,19 @@ void clFileSystemWorkspace::CacheFiles(bool force)
     if (!m_files.IsEmpty()) {
         m_files.Clear();
     }
+
+    wxStringSet_t excludeFolders = GetExcludeFoldersSet();
+
+    // watch the workspace folder, from now on the cache is updated incrementally.
+    // Start watching before scanning, so we don't miss changes done while scanning
+    m_watcher.Clear();
+    m_watcher.AddDirectory(GetDir(), excludeFolders);
+    m_watcher.Start();
+
     std::thread thr(
         [=](const wxString& rootFolder) {
             clFilesScanner fs;
             std::vector<wxString> files;
-            wxStringSet_t excludeFolders = { ".git/", ".svn/", ".codelite/", ".ctagsd/" };
-
-            wxString excludePaths = GetExcludeFolders();
-            wxArrayString paths = StringUtils::BuildArgv(excludePaths);
-            if (!paths.IsEmpty()) {
-                for (wxString& excludePath : paths) {
-                    excludePath.Trim().Trim(false);
-                    if (excludePath.EndsWith("/") || excludePath.EndsWith("\\")) {
-                        excludePath.RemoveLast();
-                    }
-                    if (excludePath.IsEmpty()) {
-                        continue;
-                    }
-
-                    wxFileName fnpath(excludePath, "");
-                    excludeFolders.insert(fnpath.GetPath());
-                }
-            }
-
             fs.Scan(rootFolder, files, GetFilesMask(), "", excludeFolders);
             clFileSystemEvent event(wxEVT_FS_SCAN_COMPLETED);
             wxArrayString arrfiles;
@@ -229,6 +228,27 @@ void clFileSystemWorkspace::CacheFiles(bool force)
     thr.detach();
 }
 
+wxStringSet_t clFileSystemWorkspace::GetExcludeFoldersSet() const
+{
+    wxStringSet_t excludeFolders = { ".git/", ".svn/", ".codelite/", ".ctagsd/" };
+
+    wxString excludePaths = GetExcludeFolders();
+    wxArrayString paths = StringUtils::BuildArgv(excludePaths);
+    for (wxString& excludePath : paths) {
+        excludePath.Trim().Trim(false);
+        if (excludePath.EndsWith("/") || excludePath.EndsWith("\\")) {
+            excludePath.RemoveLast();
+        }
+        if (excludePath.IsEmpty()) {
+            continue;
+        }
+
+        wxFileName fnpath(excludePath, "");
+        excludeFolders.insert(fnpath.GetPath());
+    }
+    return excludeFolders;
+}
+
 void clFileSystemWorkspace::OnBuildStarting(clBuildEvent& event)
 {
     event.Skip();
@@ -394,6 +414,9 @@ void clFileSystemWorkspace::DoClose()
     // Free the database
     TagsManagerST::Get()->CloseDatabase();
 
+    // Stop watching the workspace folder
+    m_watcher.Clear();
+
     m_isLoaded = false;
     m_showWelcomePage = true;
 
@@ -912,11 +935,67 @@ void clFileSystemWorkspace::OnSourceControlPulled(clSourceControlEvent& event)
     clDEBUG() << "Refreshing tree + re-parsing";
     GetView()->RefreshTree();
 
+    if (m_watcher.IsWatchingDirectories()) {
+        // the files cache was already updated by the watcher
+        Parse(false);
+        return;
+    }
+
     // Re-Cache the files and trigger a workspace parse
     CacheFiles(true);
 }
 
-void clFileSystemWorkspace::FileSystemUpdated() { CacheFiles(true); }
+void clFileSystemWorkspace::FileSystemUpdated()
+{
+    if (m_watcher.IsWatchingDirectories()) {
+        // the watcher reports the changes
+        return;
+    }
+    CacheFiles(true);
+}
+
+void clFileSystemWorkspace::OnWatchedFilesModified(clFileSystemEvent& event)
+{
+    if (!IsOpen()) {
+        return;
+    }
+
+    wxString mask = GetFilesMask();
+    size_t newFilesCount = 0;
+    for (const wxString& path : event.GetPaths()) {
+        if (path == GetDir()) {
+            // the watcher lost events, do a full rescan
+            CacheFiles(true);
+            return;
+        }
+
+        // we only care about new files
+        wxFileName fn(path);
+        if (m_files.Contains(fn) || !FileUtils::WildMatch(mask, fn)) {
+            continue;
+        }
+        m_files.Add(fn);
+        ++newFilesCount;
+    }
+
+    if (newFilesCount) {
+        clDEBUG() << "FSW:" << newFilesCount << "new files added to the workspace" << endl;
+        // Parse the newly added files
+        Parse(false);
+    }
+}
+
+void clFileSystemWorkspace::OnWatchedFilesNotFound(clFileSystemEvent& event)
+{
+    if (!IsOpen()) {
+        return;
+    }
+
+    size_t count = m_files.Remove(event.GetPaths());
+    if (count) {
+        clDEBUG() << "FSW:" << count << "files removed from the workspace" << endl;
+    }
+}
 
 void clFileSystemWorkspace::OnDebug(clDebugEvent& event)
 {
@@ -8,11 +8,13 @@
 #include "clDebuggerTerminal.h"
 #include "clFileCache.hpp"
 #include "clFileSystemEvent.h"
+#include "clFileSystemWatcher.h"
 #include "clFileSystemWorkspaceConfig.hpp"
 #include "clShellHelper.hpp"
 #include "cl_command_event.h"
 #include "codelite_exports.h"
 #include "compiler.h"
+#include "macros.h"
 
 #include <optional>
 #include <unordered_map>
@@ -39,9 +41,11 @@ class WXDLLIMPEXP_SDK clFileSystemWorkspace : public IWorkspace
     clBacktickCache::ptr_t m_backtickCache;
     clShellHelper m_shell_helper;
     std::optional<int> m_indentWidth{ std::nullopt };
+    clFileSystemWatcher m_watcher;
 
 protected:
     void CacheFiles(bool force = false);
+    wxStringSet_t GetExcludeFoldersSet() const;
     wxString GetTargetCommand(const wxString& target) const;
     void DoPrintBuildMessage(const wxString& message);
     clEnvList_t GetEnvList();
@@ -76,6 +80,8 @@ protected:
     void OnSourceControlPulled(clSourceControlEvent& event);
     void OnDebug(clDebugEvent& event);
     void OnFileSystemUpdated(clFileSystemEvent& event);
+    void OnWatchedFilesModified(clFileSystemEvent& event);
+    void OnWatchedFilesNotFound(clFileSystemEvent& event);
     void OnReloadWorkspace(clCommandEvent& event);
 
 protected:
@@ -184,7 +190,8 @@ public:
 
     /**
      * @brief call this to update the workspace once a file system changes.
-     * this method will re-cache the files + parse the workspace
+     * this method will re-cache the files + parse the workspace, unless the workspace folder is watched
+     * (in which case the files cache is already updated incrementally)
      * Note that this method does NOT update the UI in anyways.
      */
     void FileSystemUpdated();
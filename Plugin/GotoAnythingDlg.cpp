@@ -1,6 +1,5 @@
 #include "GotoAnythingDlg.h"
 
-#include "clAnagram.h"
 #include "codelite_events.h"
 #include "event_notifier.h"
 #include "file_logger.h"
@@ -9,11 +8,23 @@
 
 #include <wx/app.h>
 
+namespace
+{
+// the number of matches displayed while filtering
+constexpr size_t MAX_MATCHES = 250;
+} // namespace
+
 GotoAnythingDlg::GotoAnythingDlg(wxWindow* parent, const std::vector<clGotoEntry>& entries)
     : GotoAnythingBaseDlg(parent)
     , m_allEntries(entries)
 {
-    DoPopulate(m_allEntries);
+    for (const clGotoEntry& entry : m_allEntries) {
+        m_matcher.Add(entry.GetDesc());
+    }
+
+    std::vector<clFuzzyMatcher::Match> matches;
+    m_matcher.Search(wxEmptyString, 0, matches);
+    DoPopulate(matches);
 
     ::clSetDialogBestSizeAndPosition(this);
 }
@@ -49,19 +60,19 @@ void GotoAnythingDlg::OnEnter(wxCommandEvent& event)
     DoExecuteActionAndClose();
 }
 
-void GotoAnythingDlg::DoPopulate(const std::vector<clGotoEntry>& entries, const std::vector<int>& indexes)
+void GotoAnythingDlg::DoPopulate(const std::vector<clFuzzyMatcher::Match>& matches)
 {
     m_dvListCtrl->DeleteAllItems();
     m_dvListCtrl->Begin();
-    for (size_t i = 0; i < entries.size(); ++i) {
-        const clGotoEntry& entry = entries[i];
+    for (const clFuzzyMatcher::Match& match : matches) {
+        const clGotoEntry& entry = m_allEntries[match.index];
         wxVector<wxVariant> cols;
         cols.push_back(wxT("\u2022 ") + entry.GetDesc());
         cols.push_back(entry.GetKeyboardShortcut());
-        m_dvListCtrl->AppendItem(cols, indexes.empty() ? i : indexes[i]);
+        m_dvListCtrl->AppendItem(cols, match.index);
     }
     m_dvListCtrl->Commit();
-    if (!entries.empty()) {
+    if (!matches.empty()) {
         m_dvListCtrl->SelectRow(0);
     }
 }
@@ -98,25 +109,12 @@ void GotoAnythingDlg::ApplyFilter()
 
     // Update the last applied filter
     m_currentFilter = filter;
-    if (filter.IsEmpty()) {
-        DoPopulate(m_allEntries);
-    } else {
-
-        // Filter the list
-        clAnagram anagram(filter);
-        std::vector<clGotoEntry> matchedEntries;
-        std::vector<int> matchedEntriesIndex;
-        for (size_t i = 0; i < m_allEntries.size(); ++i) {
-            const clGotoEntry& entry = m_allEntries[i];
-            if (anagram.MatchesInOrder(entry.GetDesc())) {
-                matchedEntries.push_back(entry);
-                matchedEntriesIndex.push_back(i);
-            }
-        }
 
-        // And populate the list
-        DoPopulate(matchedEntries, matchedEntriesIndex);
-    }
+    // Rank the entries (the matcher only searches the previous matches while the filter grows)
+    // and display the best ones
+    std::vector<clFuzzyMatcher::Match> matches;
+    m_matcher.Search(filter, filter.IsEmpty() ? 0 : MAX_MATCHES, matches);
+    DoPopulate(matches);
 }
 
 void GotoAnythingDlg::OnItemActivated(wxDataViewEvent& event)
@@ -3,6 +3,7 @@
 
 #include "GotoAnythingBaseUI.h"
 #include "bitmap_loader.h"
+#include "clFuzzyMatcher.hpp"
 #include "clGotoAnythingManager.h"
 #include "clThemedListCtrl.h"
 #include "codelite_exports.h"
@@ -13,12 +14,13 @@ class WXDLLIMPEXP_SDK GotoAnythingDlg : public GotoAnythingBaseDlg
 {
     const std::vector<clGotoEntry>& m_allEntries;
     wxString m_currentFilter;
+    clFuzzyMatcher m_matcher;
     clThemedListCtrl::BitmapVec_t m_bitmaps;
 
 protected:
     virtual void OnItemActivated(wxDataViewEvent& event);
 
-    void DoPopulate(const std::vector<clGotoEntry>& entries, const std::vector<int>& indexes = std::vector<int>());
+    void DoPopulate(const std::vector<clFuzzyMatcher::Match>& matches);
     void DoExecuteActionAndClose();
     void ApplyFilter();
 
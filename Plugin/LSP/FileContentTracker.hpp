@@ -1,12 +1,10 @@
 #ifndef FILECONTENTTRACKER_HPP
 #define FILECONTENTTRACKER_HPP
 
-#include "LSP/basic_types.h"
 #include "codelite_exports.h"
 #include "macros.h"
 
-#include <map>
-#include <vector>
+#include <unordered_map>
 #include <wx/string.h>
 
 enum FileStateFlags {
@@ -15,16 +13,17 @@ enum FileStateFlags {
 
 struct WXDLLIMPEXP_SDK FileState {
     size_t flags = FILE_STATE_NONE;
-    wxString content;
+    // the ID of the last editor text change (IEditor::GetLastTextChangeId()) the server knows about
+    wxUint64 last_change_id = 0;
     wxString file_path;
 };
 
+/**
+ * @brief track the files opened in the language server and the editor state they were last synced to
+ */
 class WXDLLIMPEXP_SDK FileContentTracker
 {
-    std::vector<FileState> m_files;
-
-private:
-    bool find(const wxString& filepath, FileState** state);
+    std::unordered_map<wxString, FileState> m_files;
 
 public:
     FileContentTracker();
@@ -33,7 +32,7 @@ public:
     /**
      * @brief do we track `filepath`?
      */
-    bool exists(const wxString& filepath);
+    bool exists(const wxString& filepath) const;
     /**
      * @brief remove the file from the tracker
      * @param filepath
@@ -41,19 +40,14 @@ public:
     void erase(const wxString& filepath);
 
     /**
-     * @brief return the changes needed in order to change `before` into `after`
-     */
-    std::vector<LSP::TextDocumentContentChangeEvent> changes_from(const wxString& before, const wxString& after);
-
-    /**
-     * @brief update the content for `filepath`
+     * @brief update the last change ID sent to the server for `filepath`
      */
-    void update_content(const wxString& filepath, const wxString& content);
+    void update_last_change_id(const wxString& filepath, wxUint64 change_id);
 
     /**
-     * @brief return the last seen content for filepath
+     * @brief return the last change ID sent to the server for `filepath`
      */
-    bool get_last_content(const wxString& filepath, wxString* content);
+    bool get_last_change_id(const wxString& filepath, wxUint64* change_id) const;
     void clear() { m_files.clear(); }
 };
 
@@ -1,5 +1,6 @@
 #include "LanguageServerProtocol.h"
 
+#include "LSP/CancelRequestNotification.hpp"
 #include "LSP/CodeActionRequest.hpp"
 #include "LSP/CompletionRequest.h"
 #include "LSP/DidChangeTextDocumentRequest.h"
@@ -192,6 +193,10 @@ void LanguageServerProtocol::QueueMessage(LSP::MessageWithParams::Ptr_t request)
         if (request->GetMethod() == "textDocument/semanticTokens/full" ||
             request->GetMethod() == "textDocument/didOpen") {
             // store the request for later processing
+            if (request->As<LSP::Request>()) {
+                // nothing was sent yet, so there is nothing to cancel
+                m_pendingQueue.Supersede(request->As<LSP::Request>());
+            }
             m_pendingQueue.Push(request);
         }
         return;
@@ -201,6 +206,15 @@ void LanguageServerProtocol::QueueMessage(LSP::MessageWithParams::Ptr_t request)
     if (request->As<LSP::CompletionRequest>()) {
         m_lastCompletionRequestId = request->As<LSP::CompletionRequest>()->GetId();
     }
+
+    if (request->As<LSP::Request>()) {
+        // the server is still working on older requests that this one makes redundant, cancel them
+        for (int request_id : m_Queue.Supersede(request->As<LSP::Request>())) {
+            LSP_DEBUG() << GetLogPrefix() << "Cancelling request ID#" << request_id << "(superseded by"
+                        << request->GetMethod() << ")" << endl;
+            m_Queue.Push(LSP::MessageWithParams::MakeRequest(new LSP::CancelRequestNotification(request_id)));
+        }
+    }
     m_Queue.Push(request);
     ProcessQueue();
 }
@@ -259,7 +273,7 @@ bool LanguageServerProtocol::Start()
 void LanguageServerProtocol::DoClear()
 {
     m_filesTracker.clear();
-    m_outputBuffer.clear();
+    m_outputBuffer.Clear();
     m_state = kUnInitialized;
     m_initializeRequestID = wxNOT_FOUND;
     m_Queue.Clear();
@@ -383,58 +397,57 @@ void LanguageServerProtocol::FindDefinition(IEditor* editor)
 
     // If the editor is modified, we need to tell the LSP to reparse the source file
     wxString filename = GetEditorFilePath(editor);
-    wxString fileContent = editor->GetEditorText();
-    SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+    SendOpenOrChangeRequest(editor, GetLanguageId(editor));
 
     LSP::GotoDefinitionRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::GotoDefinitionRequest(
         GetEditorFilePath(editor), editor->GetCurrentLine(), editor->GetColumnInChars(editor->GetCurrentPosition())));
     QueueMessage(req);
 }
 
-void LanguageServerProtocol::SendOpenOrChangeRequest(IEditor* editor, const wxString& fileContent,
-                                                     const wxString& languageId)
+void LanguageServerProtocol::SendOpenOrChangeRequest(IEditor* editor, const wxString& languageId)
 {
     CHECK_PTR_RET(editor);
     wxString filename = GetEditorFilePath(editor);
+    wxUint64 lastChangeId = editor->GetLastTextChangeId();
 
-    wxString preContent;
-    if (m_filesTracker.exists(filename) && m_filesTracker.get_last_content(filename, &preContent)) {
+    wxUint64 syncedChangeId = 0;
+    if (m_filesTracker.get_last_change_id(filename, &syncedChangeId)) {
         // we already did "open" for this, see if there are changes to report back to the language server
-        auto changes = m_filesTracker.changes_from(preContent, fileContent);
-        if (changes.empty()) {
+        if (syncedChangeId == lastChangeId) {
             // everything is up-to-date
             LOG_IF_TRACE { LSP_TRACE() << GetLogPrefix() << "No changes detected in file:" << filename << endl; }
             return;
         }
 
         LSP_DEBUG() << "Sending textDocument/didChange request" << endl;
-        // we have changes, send "change request" - by default we construct this request with a single
-        // "text" field -> the entire document
-        LSP::DidChangeTextDocumentRequest::Ptr_t req =
-            LSP::MessageWithParams::MakeRequest(new LSP::DidChangeTextDocumentRequest(filename, fileContent));
-
-        // incremental changes are supported, send them
-        if (IsIncrementalChangeSupported()) {
-            // only send the changes
+        // incremental changes are supported, send the editor changes made since the last sync
+        std::vector<LSP::TextDocumentContentChangeEvent> changes;
+        if (IsIncrementalChangeSupported() && editor->GetTextChangesSince(syncedChangeId, changes)) {
             LSP_DEBUG() << "textDocument/didChange: using incremental changes:" << changes.size() << "changes" << endl;
+            LSP::DidChangeTextDocumentRequest::Ptr_t req =
+                LSP::MessageWithParams::MakeRequest(new LSP::DidChangeTextDocumentRequest(filename, wxEmptyString));
             req->GetParams()->As<LSP::DidChangeTextDocumentParams>()->SetContentChanges(changes);
+            QueueMessage(req);
         } else {
+            // send a "change request" with a single "text" field -> the entire document
             LSP_DEBUG() << "textDocument/didChange: using full change request" << endl;
+            LSP::DidChangeTextDocumentRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
+                new LSP::DidChangeTextDocumentRequest(filename, editor->GetEditorText()));
+            QueueMessage(req);
         }
-        QueueMessage(req);
     } else {
         LSP_DEBUG() << "Sending textDocument/didOpen request" << endl;
         // first time opening this file
-        LSP::DidOpenTextDocumentRequest::Ptr_t req =
-            LSP::MessageWithParams::MakeRequest(new LSP::DidOpenTextDocumentRequest(filename, fileContent, languageId));
+        LSP::DidOpenTextDocumentRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(
+            new LSP::DidOpenTextDocumentRequest(filename, editor->GetEditorText(), languageId));
         QueueMessage(req);
 
         // send a semantic request
         SendSemanticTokensRequest(editor);
     }
 
-    // update the content for the file
-    m_filesTracker.update_content(filename, fileContent);
+    // the server is now in sync with the editor
+    m_filesTracker.update_last_change_id(filename, lastChangeId);
 }
 
 void LanguageServerProtocol::SendCloseRequest(const wxString& filename)
@@ -458,7 +471,7 @@ void LanguageServerProtocol::SendSaveRequest(IEditor* editor, const wxString& fi
 
         // before sending the save request, send a change request
         LSP_DEBUG() << "Flushing changes before save" << endl;
-        SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+        SendOpenOrChangeRequest(editor, GetLanguageId(editor));
 
         LSP::CompletionRequest::Ptr_t req =
             LSP::MessageWithParams::MakeRequest(new LSP::DidSaveTextDocumentRequest(filename, fileContent));
@@ -546,8 +559,7 @@ void LanguageServerProtocol::OpenEditor(IEditor* editor)
     }
 
     if (editor && ShouldHandleFile(editor)) {
-        wxString fileContent = editor->GetEditorText();
-        SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+        SendOpenOrChangeRequest(editor, GetLanguageId(editor));
         SendSemanticTokensRequest(editor);
         // cache symbols
         DocumentSymbols(editor, LSP::DocumentSymbolsRequest::CONTEXT_QUICK_OUTLINE |
@@ -562,8 +574,7 @@ void LanguageServerProtocol::FunctionHelp(IEditor* editor)
     CHECK_COND_RET(ShouldHandleFile(editor));
 
     // If the editor is modified, we need to tell the LSP to reparse the source file
-    wxString fileContent = editor->GetEditorText();
-    SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+    SendOpenOrChangeRequest(editor, GetLanguageId(editor));
     const wxString& filename = GetEditorFilePath(editor);
     LSP::SignatureHelpRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::SignatureHelpRequest(
         filename, editor->GetCurrentLine(), editor->GetColumnInChars(editor->GetCurrentPosition())));
@@ -578,8 +589,7 @@ void LanguageServerProtocol::HoverTip(IEditor* editor)
 
     // If the editor is modified, we need to tell the LSP to reparse the source file
     const wxString& filename = GetEditorFilePath(editor);
-    wxString fileContent = editor->GetEditorText();
-    SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+    SendOpenOrChangeRequest(editor, GetLanguageId(editor));
 
     if (ShouldHandleFile(editor)) {
         int pos = editor->GetPosAtMousePointer();
@@ -598,8 +608,7 @@ void LanguageServerProtocol::CodeComplete(IEditor* editor, bool userTriggered)
     CHECK_PTR_RET(editor);
     CHECK_COND_RET(ShouldHandleFile(editor));
     // If the editor is modified, we need to tell the LSP to reparse the source file
-    wxString fileContent = editor->GetEditorText();
-    SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+    SendOpenOrChangeRequest(editor, GetLanguageId(editor));
 
     // Now request the for code completion
     SendCodeCompleteRequest(editor, editor->GetCurrentLine(), editor->GetColumnInChars(editor->GetCurrentPosition()),
@@ -611,22 +620,22 @@ void LanguageServerProtocol::ProcessQueue()
     if (m_Queue.IsEmpty()) {
         return;
     }
-    if (m_Queue.IsWaitingReponse()) {
-        LSP_DEBUG() << "LSP is busy, will not send message";
-        return;
-    }
-    LSP::MessageWithParams::Ptr_t req = m_Queue.Get();
     if (!IsRunning()) {
         LSP_DEBUG() << GetLogPrefix() << "is down.";
         return;
     }
 
-    // Write the message length as string of 10 bytes
-    m_network->Send(req->ToString());
-    m_Queue.SetWaitingReponse(true);
-    m_Queue.Pop();
-    if (!req->GetStatusMessage().IsEmpty()) {
-        clGetManager()->SetStatusMessage(req->GetStatusMessage(), 1);
+    // requests are not serialized: we do not wait for a response before sending the next message.
+    // Responses are matched to their requests by ID
+    while (!m_Queue.IsEmpty()) {
+        LSP::MessageWithParams::Ptr_t req = m_Queue.Get();
+        m_Queue.Pop();
+
+        // Write the message length as string of 10 bytes
+        m_network->Send(req->ToString());
+        if (!req->GetStatusMessage().IsEmpty()) {
+            clGetManager()->SetStatusMessage(req->GetStatusMessage(), 1);
+        }
     }
 }
 
@@ -652,8 +661,7 @@ void LanguageServerProtocol::FindDeclaration(IEditor* editor, bool for_add_missi
     CHECK_COND_RET(ShouldHandleFile(editor));
 
     // If the editor is modified, we need to tell the LSP to reparse the source file
-    wxString fileContent = editor->GetEditorText();
-    SendOpenOrChangeRequest(editor, fileContent, GetLanguageId(editor));
+    SendOpenOrChangeRequest(editor, GetLanguageId(editor));
 
     LSP_DEBUG() << GetLogPrefix() << "Sending GotoDeclarationRequest" << endl;
     LSP::GotoDeclarationRequest::Ptr_t req = LSP::MessageWithParams::MakeRequest(new LSP::GotoDeclarationRequest(
@@ -706,13 +714,12 @@ void LanguageServerProtocol::OnNetError(clCommandEvent& event)
 
 void LanguageServerProtocol::EventMainLoop(clCommandEvent& event)
 {
-    m_outputBuffer.append(event.GetStringRaw());
-    LSP_DEBUG() << "Received data from LSP server of size:" << m_outputBuffer.size() << "bytes" << endl;
+    m_outputBuffer.Append(event.GetStringRaw());
+    LSP_DEBUG() << "Received data from LSP server of size:" << m_outputBuffer.GetSize() << "bytes" << endl;
 
-    m_Queue.SetWaitingReponse(false);
-    while (!m_outputBuffer.empty()) {
+    while (!m_outputBuffer.IsEmpty()) {
         // attempt to consume a complete JSON payload from the aggregated network buffer
-        auto json = LSP::Message::GetJSONPayload(m_outputBuffer);
+        auto json = m_outputBuffer.Next();
         if (!json) {
             LOG_IF_TRACE { LSP_TRACE() << "Unable to read JSON payload" << endl; }
             LOG_IF_DEBUG
@@ -722,12 +729,12 @@ void LanguageServerProtocol::EventMainLoop(clCommandEvent& event)
                 // dump the output buffer into a file and continue
                 // we only dump 3 files per CodeLite session
                 static size_t dumps_count = 0;
-                if (dumps_count < 3 && (m_outputBuffer.size() > (1024 * 1024 * 1024))) {
+                if (dumps_count < 3 && (m_outputBuffer.GetSize() > (1024 * 1024 * 1024))) {
                     dumps_count++;
                     auto tmp_filename =
                         FileUtils::CreateTempFileName(clStandardPaths::Get().GetTempDir(), "cl_lsp", "txt");
-                    FileUtils::WriteFileContent(tmp_filename, m_outputBuffer);
-                    LSP_SYSTEM() << "Output buffer exceeds 1MB (" << m_outputBuffer.size() << "Bytes)" << endl;
+                    FileUtils::WriteFileContentRaw(tmp_filename, m_outputBuffer.GetContent());
+                    LSP_SYSTEM() << "Output buffer exceeds 1MB (" << m_outputBuffer.GetSize() << "Bytes)" << endl;
                     LSP_SYSTEM() << "Dumped m_outputBuffer into:" << tmp_filename.GetFullPath() << endl;
                 }
             }
@@ -918,6 +925,12 @@ void LanguageServerProtocol::HandleResponseError(LSP::ResponseMessage& response,
 {
     LSP_DEBUG() << GetLogPrefix() << "received an error message:" << response.ToString() << endl;
     LSP::ResponseError errMsg(response.ToString());
+    if (errMsg.GetErrorCode() == LSP::ResponseError::kErrorCodeRequestCancelled) {
+        // a reply to a request we cancelled (it was superseded by a newer one)
+        LSP_DEBUG() << GetLogPrefix() << "request ID#" << response.GetId() << "was cancelled" << endl;
+        return;
+    }
+
     switch (errMsg.GetErrorCode()) {
     case LSP::ResponseError::kErrorCodeInternalError:
     case LSP::ResponseError::kErrorCodeInvalidRequest: {
@@ -930,13 +943,14 @@ void LanguageServerProtocol::HandleResponseError(LSP::ResponseMessage& response,
         // Report this missing event
         LSPEvent eventMethodNotFound(wxEVT_LSP_METHOD_NOT_FOUND);
         eventMethodNotFound.SetServerName(GetName());
-        eventMethodNotFound.SetString(msg_ptr->GetMethod());
+        eventMethodNotFound.SetString(msg_ptr ? msg_ptr->GetMethod() : wxString());
         m_cluster->AddPendingEvent(eventMethodNotFound);
 
         // Log this message
         LSPEvent log_event(wxEVT_LSP_LOGMESSAGE);
         log_event.SetServerName(GetName());
-        log_event.SetMessage(_("Method: `") + msg_ptr->GetMethod() + _("` is not supported"));
+        log_event.SetMessage(_("Method: `") + (msg_ptr ? msg_ptr->GetMethod() : wxString()) +
+                             _("` is not supported"));
         log_event.SetLogMessageSeverity(LSP_LOG_WARNING); // warning
         m_cluster->AddPendingEvent(log_event);
 
@@ -959,7 +973,7 @@ void LanguageServerProtocol::HandleResponseError(LSP::ResponseMessage& response,
     }
 
     // finally, call the request handler
-    if (msg_ptr->As<LSP::Request>()) {
+    if (msg_ptr && msg_ptr->As<LSP::Request>()) {
         msg_ptr->As<LSP::Request>()->OnError(response, m_cluster);
     }
 }
@@ -1130,7 +1144,7 @@ void LanguageServerProtocol::SetStartedCallback(LSPOnConnectedCallback_t&& cb)
 
 void LSPRequestMessageQueue::Push(LSP::MessageWithParams::Ptr_t message)
 {
-    m_Queue.push(message);
+    m_Queue.push_back(message);
 
     // Messages of type 'Request' require responses from the server
     LSP::Request* req = message->As<LSP::Request>();
@@ -1142,9 +1156,8 @@ void LSPRequestMessageQueue::Push(LSP::MessageWithParams::Ptr_t message)
 void LSPRequestMessageQueue::Pop()
 {
     if (!m_Queue.empty()) {
-        m_Queue.pop();
+        m_Queue.pop_front();
     }
-    SetWaitingReponse(false);
 }
 
 LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::Get()
@@ -1157,22 +1170,55 @@ LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::Get()
 
 void LSPRequestMessageQueue::Clear()
 {
-    while (!m_Queue.empty()) {
-        m_Queue.pop();
-    }
-    SetWaitingReponse(false);
+    m_Queue.clear();
     m_pendingReplyMessages.clear();
 }
 
 void LSPRequestMessageQueue::Move(LSPRequestMessageQueue& other)
 {
-    while (!other.m_Queue.empty()) {
-        m_Queue.push(other.m_Queue.front());
-        other.m_Queue.pop();
+    m_Queue.insert(m_Queue.end(), other.m_Queue.begin(), other.m_Queue.end());
+    other.m_Queue.clear();
+
+    // the moved requests still expect replies
+    for (const auto& vt : other.m_pendingReplyMessages) {
+        m_pendingReplyMessages.insert(vt);
+    }
+    other.m_pendingReplyMessages.clear();
+}
+
+std::vector<int> LSPRequestMessageQueue::Supersede(const LSP::Request* request)
+{
+    std::vector<int> cancelled;
+    wxString key = request->GetSupersedeKey();
+    if (key.empty()) {
+        return cancelled;
     }
 
-    SetWaitingReponse(false);
-    m_pendingReplyMessages.clear();
+    auto is_superseded = [&](const LSP::MessageWithParams::Ptr_t& message) -> bool {
+        LSP::Request* req = message->As<LSP::Request>();
+        return req && req != request && req->GetSupersedeKey() == key;
+    };
+
+    // not sent yet: simply drop them
+    for (auto iter = m_Queue.begin(); iter != m_Queue.end();) {
+        if (is_superseded(*iter)) {
+            m_pendingReplyMessages.erase((*iter)->As<LSP::Request>()->GetId());
+            iter = m_Queue.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    // the remaining pending requests were already sent
+    for (auto iter = m_pendingReplyMessages.begin(); iter != m_pendingReplyMessages.end();) {
+        if (is_superseded(iter->second)) {
+            cancelled.push_back(iter->first);
+            iter = m_pendingReplyMessages.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    return cancelled;
 }
 
 LSP::MessageWithParams::Ptr_t LSPRequestMessageQueue::TakePendingReplyMessage(int msgid)
@@ -7,7 +7,9 @@
 #include "LSP/IPathConverter.hpp"
 #include "LSP/LSPEvent.h"
 #include "LSP/LSPNetwork.h"
+#include "LSP/MessageFramer.hpp"
 #include "LSP/MessageWithParams.h"
+#include "LSP/Request.h"
 #include "SocketAPI/clSocketClientAsync.h"
 #include "cl_command_event.h"
 #include "codelite_events.h"
@@ -16,9 +18,9 @@
 #include "macros.h"
 #include "wxStringHash.h"
 
+#include <deque>
 #include <functional>
 #include <map>
-#include <queue>
 #include <string>
 #include <unordered_map>
 #include <wx/arrstr.h>
@@ -30,9 +32,10 @@ typedef std::function<void()> LSPOnConnectedCallback_t;
 class IEditor;
 class WXDLLIMPEXP_SDK LSPRequestMessageQueue
 {
-    std::queue<LSP::MessageWithParams::Ptr_t> m_Queue;
+    // messages waiting to be sent
+    std::deque<LSP::MessageWithParams::Ptr_t> m_Queue;
+    // requests (sent or not) waiting for a reply, by request ID
     std::unordered_map<int, LSP::MessageWithParams::Ptr_t> m_pendingReplyMessages;
-    bool m_waitingReponse = false;
 
 public:
     LSPRequestMessageQueue() {}
@@ -44,8 +47,13 @@ public:
     LSP::MessageWithParams::Ptr_t Get();
     void Clear();
     bool IsEmpty() const { return m_Queue.empty(); }
-    void SetWaitingReponse(bool waitingReponse) { this->m_waitingReponse = waitingReponse; }
-    bool IsWaitingReponse() const { return m_waitingReponse; }
+
+    /**
+     * @brief forget the requests that are made redundant by `request` (see LSP::Request::GetSupersedeKey())
+     * Requests that were not sent yet are removed from the queue
+     * @return the IDs of the requests that were already sent, the caller should cancel them
+     */
+    std::vector<int> Supersede(const LSP::Request* request);
 
     /// move the content of `other` into `this` while consuming the `other` queue
     void Move(LSPRequestMessageQueue& other);
@@ -64,7 +72,7 @@ class WXDLLIMPEXP_SDK LanguageServerProtocol : public wxEvtHandler
     wxString m_initOptions;
     FileContentTracker m_filesTracker;
     wxStringSet_t m_languages;
-    std::string m_outputBuffer;
+    LSP::MessageFramer m_outputBuffer;
     wxString m_rootFolder;
     clEnvList_t m_env;
     LSPStartupInfo m_startupInfo;
@@ -122,6 +130,7 @@ protected:
     void DoClear();
     bool ShouldHandleFile(IEditor* editor) const;
     wxString GetLogPrefix() const;
+    // send all the queued messages, the server handles them concurrently
     void ProcessQueue();
     static wxString GetLanguageId(IEditor* editor);
     static wxString GetLanguageId(FileExtManager::FileType file_type);
@@ -134,7 +143,7 @@ protected:
     /**
      * @brief notify about file open
      */
-    void SendOpenOrChangeRequest(IEditor* editor, const wxString& fileContent, const wxString& languageId);
+    void SendOpenOrChangeRequest(IEditor* editor, const wxString& languageId);
 
     /**
      * @brief report a file-close notification
@@ -25,7 +25,6 @@
 #include "bitmap_loader.h"
 
 #include "Zip/clZipReader.h"
-#include "clFilesCollector.h"
 #include "clSystemSettings.h"
 #include "cl_standard_paths.h"
 #include "editor_config.h"
@@ -43,6 +42,8 @@
 #include <wx/dcscreen.h>
 #include <wx/dir.h>
 #include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
 #include <wx/msgdlg.h>
 #include <wx/settings.h>
 #include <wx/stdpaths.h>
@@ -52,6 +53,60 @@ namespace
 {
 std::unordered_map<wxString, wxBitmapBundle> DARK_THEME_BMPBUNLES;
 std::unordered_map<wxString, wxBitmapBundle> LIGHT_THEME_BMPBUNLES;
+
+// the size of the bitmaps returned by LoadBitmap (before DPI scaling)
+constexpr int BITMAP_SIZE = 16;
+
+wxFileName get_svg_file(const wxString& name, bool darkTheme)
+{
+    wxFileName svg_path{ clStandardPaths::Get().GetDataDir(), name + ".svg" };
+    svg_path.AppendDir("svgs");
+    svg_path.AppendDir(darkTheme ? "dark-theme" : "light-theme");
+    return svg_path;
+}
+
+/// the rasterized bitmaps are kept under <user-data>/cache/svgs/<theme>-<size>-<scale>/<name>-<svg-mtime>.png
+wxFileName get_cache_file(const wxString& name, bool darkTheme, double scale, time_t svg_mtime)
+{
+    wxString dirname;
+    dirname << (darkTheme ? "dark" : "light") << "-" << BITMAP_SIZE << "-" << (int)(scale * 100);
+
+    wxString fullname;
+    fullname << name << "-" << (long long)svg_mtime << ".png";
+
+    wxFileName cache_file{ clStandardPaths::Get().GetUserDataDir(), fullname };
+    cache_file.AppendDir("cache");
+    cache_file.AppendDir("svgs");
+    cache_file.AppendDir(dirname);
+    return cache_file;
+}
+
+/// remove the bitmaps rasterized from older versions of `name`, keeping `cache_file`
+void prune_cache_files(const wxString& name, const wxFileName& cache_file)
+{
+    wxDir dir(cache_file.GetPath());
+    if (!dir.IsOpened()) {
+        return;
+    }
+
+    wxString prefix = name + "-";
+    wxArrayString stale_files;
+    wxString filename;
+    bool cont = dir.GetFirst(&filename, prefix + "*.png", wxDIR_FILES);
+    while (cont) {
+        // only "<name>-<mtime>.png": the pattern also matches the files of another image named "<name>-<suffix>"
+        wxString mtime = filename.Mid(prefix.length()).BeforeLast('.');
+        if (filename != cache_file.GetFullName() && !mtime.empty() && mtime.IsNumber()) {
+            stale_files.Add(filename);
+        }
+        cont = dir.GetNext(&filename);
+    }
+
+    for (const wxString& stale_file : stale_files) {
+        clDEBUG() << "Removing stale bitmap cache file:" << stale_file << endl;
+        wxRemoveFile(wxFileName(cache_file.GetPath(), stale_file).GetFullPath());
+    }
+}
 }; // namespace
 
 BitmapLoader::~BitmapLoader() {}
@@ -69,11 +124,19 @@ const wxBitmap& BitmapLoader::LoadBitmap(const wxString& name, int requestedSize
     wxUnusedVar(requestedSize);
     wxString newName = name.AfterLast('/');
 
-    if (m_toolbarsBitmaps.count(newName) == 0) {
+    auto iter = m_toolbarsBitmaps.find(newName);
+    if (iter != m_toolbarsBitmaps.end()) {
+        return iter->second;
+    }
+
+    // the images are loaded on the first request
+    wxBitmap bmp;
+    if (m_missingBitmaps.count(newName) || !DoLoadBitmap(newName, &bmp)) {
+        m_missingBitmaps.insert(newName);
         LOG_IF_WARN { clWARNING() << "requested image:" << newName << "does not exist" << endl; }
         return wxNullBitmap;
     }
-    return m_toolbarsBitmaps.find(newName)->second;
+    return m_toolbarsBitmaps.insert({ newName, bmp }).first->second;
 }
 
 int BitmapLoader::GetMimeImageId(int type, bool disabled) { return GetMimeBitmaps().GetIndex(type, disabled); }
@@ -90,53 +153,76 @@ wxIcon BitmapLoader::GetIcon(const wxBitmap& bmp) const
     return icn;
 }
 
-void BitmapLoader::AddBitmapInternal(const wxBitmapBundle& bundle, const wxString& base_name)
+const wxBitmapBundle* BitmapLoader::DoLoadBundle(const wxString& name, bool darkTheme) const
 {
-    wxBitmap bmp = bundle.GetBitmapFor(wxTheApp->GetTopWindow());
-    if (bmp.IsOk()) {
-        m_toolbarsBitmaps.insert({ base_name, bmp });
+    auto bitmap_bundle_cache = GetBundles(darkTheme);
+    auto iter = bitmap_bundle_cache->find(name);
+    if (iter == bitmap_bundle_cache->end()) {
+        // parse the SVG file on the first request. Missing images are kept as an invalid bundle
+        wxBitmapBundle bmpbundle;
+        wxFileName svg_file = get_svg_file(name, darkTheme);
+        if (svg_file.FileExists()) {
+            bmpbundle = wxBitmapBundle::FromSVGFile(svg_file.GetFullPath(), wxSize(BITMAP_SIZE, BITMAP_SIZE));
+        }
+        iter = bitmap_bundle_cache->insert({ name, bmpbundle }).first;
     }
+    return iter->second.IsOk() ? &iter->second : nullptr;
 }
 
-void BitmapLoader::LoadSVGFiles(bool darkTheme)
+bool BitmapLoader::DoLoadBitmap(const wxString& name, wxBitmap* bmp)
 {
-    // Load the bitmaps based on the current theme background colour
-    wxFileName svg_path{ clStandardPaths::Get().GetDataDir(), wxEmptyString };
-    svg_path.AppendDir("svgs");
-    svg_path.AppendDir(darkTheme ? "dark-theme" : "light-theme");
-
-    if (!svg_path.DirExists()) {
-        clWARNING() << "Unable to load SVG images. Broken installation" << endl;
-        return;
+    wxFileName svg_file = get_svg_file(name, m_darkTheme);
+    if (!svg_file.FileExists()) {
+        return false;
     }
-    auto bitmap_bundle_cache = GetBundles(darkTheme);
 
-    // load the cache
-    if (bitmap_bundle_cache->empty()) {
-        clFilesScanner scanner;
-        clDEBUG() << "Loading SVG files from:" << svg_path.GetPath() << endl;
-        scanner.ScanWithCallbacks(svg_path.GetPath(), nullptr, [&](const wxArrayString& files) -> bool {
-            for (const wxString& filepath : files) {
-                auto bmpbundle = wxBitmapBundle::FromSVGFile(filepath, wxSize(16, 16));
-                if (bmpbundle.IsOk()) {
-                    bitmap_bundle_cache->insert({ wxFileName(filepath).GetName(), bmpbundle });
-                }
-            }
+    wxWindow* win = wxTheApp->GetTopWindow();
+    double scale = win ? win->GetDPIScaleFactor() : 1.0;
+    wxFileName cache_file =
+        get_cache_file(name, m_darkTheme, scale, FileUtils::GetFileModificationTime(svg_file));
+    if (cache_file.FileExists()) {
+        wxLogNull noLog;
+        if (bmp->LoadFile(cache_file.GetFullPath(), wxBITMAP_TYPE_PNG) && bmp->IsOk()) {
+            // the PNG does not carry the scale it was rasterized for, restore it so the bitmap keeps its logical size
+            bmp->SetScaleFactor(scale);
             return true;
-        });
+        }
+    }
+
+    const wxBitmapBundle* bundle = DoLoadBundle(name, m_darkTheme);
+    if (!bundle) {
+        return false;
+    }
+
+    *bmp = bundle->GetBitmapFor(win);
+    if (!bmp->IsOk()) {
+        return false;
+    }
+
+    // keep the rasterized bitmap for the next sessions. Write it to a temporary file first, so a partially written
+    // file is never loaded
+    wxLogNull noLog;
+    wxString tmpfile = cache_file.GetFullPath() + ".tmp";
+    if (!cache_file.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL) || !bmp->SaveFile(tmpfile, wxBITMAP_TYPE_PNG) ||
+        !wxRenameFile(tmpfile, cache_file.GetFullPath(), true)) {
+        clDEBUG() << "Failed to write bitmap cache file:" << cache_file.GetFullPath() << endl;
+        wxRemoveFile(tmpfile);
+    } else {
+        prune_cache_files(name, cache_file);
     }
+    return true;
 }
 
 void BitmapLoader::Initialize(bool darkTheme)
 {
-    LoadSVGFiles(darkTheme);
-    auto bitmap_bundle_cache = GetBundles(darkTheme);
-
+    // The images are loaded by LoadBitmap() when they are first requested
+    m_darkTheme = darkTheme;
     m_toolbarsBitmaps.clear();
-    m_toolbarsBitmaps.reserve(bitmap_bundle_cache->size());
+    m_missingBitmaps.clear();
 
-    for (const auto& vt : *bitmap_bundle_cache) {
-        AddBitmapInternal(vt.second, vt.first);
+    wxFileName svg_path = get_svg_file(wxEmptyString, darkTheme);
+    if (!svg_path.DirExists()) {
+        clWARNING() << "Unable to load SVG images. Broken installation" << endl;
     }
 
     // Create the mime-list
@@ -246,14 +332,8 @@ const wxBitmapBundle& BitmapLoader::GetBundle(const wxString& name) const
 {
     static wxBitmapBundle NullBundle;
     bool darkTheme = clSystemSettings::Get().IsDark();
-    auto bitmap_bundle_cache = GetBundles(darkTheme);
-
-    auto bundle = bitmap_bundle_cache->find(name);
-    if (bundle == bitmap_bundle_cache->end()) {
-        return NullBundle;
-    } else {
-        return bundle->second;
-    }
+    const wxBitmapBundle* bundle = DoLoadBundle(name, darkTheme);
+    return bundle ? *bundle : NullBundle;
 }
 
 //===---------------------------
@@ -358,18 +438,19 @@ clBitmaps& clBitmaps::Get()
 
 BitmapLoader* clBitmaps::GetLoader() { return m_activeBitmaps; }
 
-void clBitmaps::Initialise()
-{
-    m_darkBitmaps = new BitmapLoader(true);
-    m_lightBitmaps = new BitmapLoader(false);
-    SysColoursChanged();
-}
+void clBitmaps::Initialise() { SysColoursChanged(); }
 
 void clBitmaps::SysColoursChanged()
 {
     auto old_ptr = m_activeBitmaps;
     bool isDark = clSystemSettings::IsDark();
-    m_activeBitmaps = isDark ? m_darkBitmaps : m_lightBitmaps;
+
+    // a theme loader is only created when the theme is used
+    BitmapLoader*& loader = isDark ? m_darkBitmaps : m_lightBitmaps;
+    if (!loader) {
+        loader = new BitmapLoader(isDark);
+    }
+    m_activeBitmaps = loader;
 
     if (old_ptr != m_activeBitmaps) {
         // change was made, fire an event
@@ -548,13 +629,12 @@ const wxString& clBitmapList::GetBitmapName(size_t index) const
 
 bool BitmapLoader::GetIconBundle(const wxString& name, wxIconBundle* bundle)
 {
-    LoadSVGFiles(clSystemSettings::IsDark());
-    auto bundles = GetBundles(clSystemSettings::IsDark());
-    if (bundles->count(name) == 0) {
+    const wxBitmapBundle* bmp_bundle_ptr = DoLoadBundle(name, clSystemSettings::IsDark());
+    if (!bmp_bundle_ptr) {
         return false;
     }
 
-    const auto& bmp_bundle = bundles->find(name)->second;
+    const auto& bmp_bundle = *bmp_bundle_ptr;
     std::array<int, 5> sizes = { 24, 32, 64, 128, 256 };
     for (int size : sizes) {
         size = wxTheApp->GetTopWindow()->FromDIP(size);
@@ -31,6 +31,7 @@
 #include "fileextmanager.h"
 #include "wxStringHash.h"
 
+#include <unordered_set>
 #include <vector>
 #include <wx/bitmap.h>
 #include <wx/filename.h>
@@ -143,6 +144,8 @@ public:
 protected:
     wxFileName m_zipPath;
     std::unordered_map<wxString, wxBitmap> m_toolbarsBitmaps;
+    std::unordered_set<wxString> m_missingBitmaps;
+    bool m_darkTheme = false;
     std::unordered_map<wxString, wxString> m_manifest;
     std::unordered_map<int, int> m_fileIndexMap;
     clMimeBitmaps m_mimeBitmaps;
@@ -154,8 +157,6 @@ private:
     BitmapLoader(bool darkTheme);
     virtual ~BitmapLoader();
 
-    void AddBitmapInternal(const wxBitmapBundle& bundle, const wxString& base_name);
-
 public:
     clMimeBitmaps& GetMimeBitmaps() { return m_mimeBitmaps; }
     const clMimeBitmaps& GetMimeBitmaps() const { return m_mimeBitmaps; }
@@ -198,9 +199,20 @@ protected:
 
 private:
     void Initialize(bool darkTheme);
-    void LoadSVGFiles(bool darkTheme);
     std::unordered_map<wxString, wxBitmapBundle>* GetBundles(bool darkTheme) const;
 
+    /**
+     * @brief return the bundle of the SVG file `name`, parsing it on the first call
+     * @return nullptr if there is no such image
+     */
+    const wxBitmapBundle* DoLoadBundle(const wxString& name, bool darkTheme) const;
+
+    /**
+     * @brief load the bitmap `name` from the bitmaps cache (rasterized by a previous session) or from its SVG file
+     * The cache is stored in the user data directory and is keyed by theme, size, DPI scale and SVG modification time
+     */
+    bool DoLoadBitmap(const wxString& name, wxBitmap* bmp);
+
 public:
     const wxBitmap& LoadBitmap(const wxString& name, int requestedSize = 16);
     bool GetIconBundle(const wxString& name, wxIconBundle* bundle);
@@ -1,5 +1,7 @@
 #include "clFileCache.hpp"
 
+#include <algorithm>
+
 void clFileCache::Add(const wxFileName& fn)
 {
     if(Contains(fn)) {
@@ -9,6 +11,52 @@ void clFileCache::Add(const wxFileName& fn)
     m_filesSet.insert(fn.GetFullPath());
 }
 
+size_t clFileCache::Remove(const wxArrayString& paths)
+{
+    std::unordered_set<wxString> files;
+    std::vector<wxString> folders;
+    for(const wxString& path : paths) {
+        if(m_filesSet.count(path)) {
+            files.insert(path);
+        } else {
+            wxString folder = path;
+            if(!folder.EndsWith(wxFileName::GetPathSeparator())) {
+                folder << wxFileName::GetPathSeparator();
+            }
+            folders.push_back(folder);
+        }
+    }
+
+    if(files.empty() && folders.empty()) {
+        return 0;
+    }
+
+    size_t count = m_files.size();
+    auto should_remove = [&](const wxFileName& fn) -> bool {
+        wxString fullpath = fn.GetFullPath();
+        if(files.count(fullpath)) {
+            return true;
+        }
+        for(const wxString& folder : folders) {
+            if(fullpath.StartsWith(folder)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // single pass over the files
+    auto iter = std::remove_if(m_files.begin(), m_files.end(), [&](const wxFileName& fn) {
+        if(should_remove(fn)) {
+            m_filesSet.erase(fn.GetFullPath());
+            return true;
+        }
+        return false;
+    });
+    m_files.erase(iter, m_files.end());
+    return count - m_files.size();
+}
+
 void clFileCache::Clear()
 {
     m_filesSet.clear();
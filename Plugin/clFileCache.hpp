@@ -27,6 +27,13 @@ public:
 
     void Alloc(size_t size);
     void Add(const wxFileName& fn);
+
+    /**
+     * @brief remove `paths` from the cache. A path that is not a cached file is assumed to be a folder:
+     * all the cached files under it are removed
+     * @return the number of files removed
+     */
+    size_t Remove(const wxArrayString& paths);
     void Clear();
     bool Contains(const wxFileName& fn) const;
     size_t GetSize() const { return m_files.size(); }
@@ -276,6 +276,10 @@ void clRowEntry::InsertChild(clRowEntry* child, clRowEntry* prev)
         nodeBefore = prevSibling;
     }
     child->ConnectNodes(nodeBefore, nodeBefore->m_next);
+
+    m_childrenRowsCount += child->m_rowsCount;
+    m_childrenRowsDirty = true;
+    UpdateRowsCount();
 }
 
 void clRowEntry::AddChild(clRowEntry* child) { InsertChild(child, m_children.empty() ? nullptr : m_children.back()); }
@@ -306,15 +310,23 @@ void clRowEntry::DeleteChild(clRowEntry* child)
         next->m_prev = prev;
     }
     // Now disconnect this child from this node
+    bool removed = true;
     if (child == m_children.back()) { // Fast track for DeleteAllChildren().
         m_children.pop_back();
     } else {
         clRowEntry::Vec_t::iterator iter =
             std::find_if(m_children.begin(), m_children.end(), [&](clRowEntry* c) { return c == child; });
-        if (iter != m_children.end()) {
+        removed = (iter != m_children.end());
+        if (removed) {
             m_children.erase(iter);
         }
     }
+
+    if (removed) {
+        m_childrenRowsCount -= child->m_rowsCount;
+        m_childrenRowsDirty = true;
+        UpdateRowsCount();
+    }
     wxDELETE(child);
 }
 
@@ -340,15 +352,10 @@ void clRowEntry::GetNextItems(int count, clRowEntry::Vec_t& items, bool selfIncl
     if (!this->IsHidden() && selfIncluded) {
         items.push_back(this);
     }
-    clRowEntry* next = GetNext();
-    while (next) {
-        if (next->IsVisible() && !next->IsHidden()) {
-            items.push_back(next);
-        }
-        if ((int)items.size() == count) {
-            return;
-        }
-        next = next->GetNext();
+    clRowEntry* next = GetNextRow();
+    while (next && ((int)items.size() < count)) {
+        items.push_back(next);
+        next = next->GetNextRow();
     }
 }
 
@@ -357,19 +364,143 @@ void clRowEntry::GetPrevItems(int count, clRowEntry::Vec_t& items, bool selfIncl
     if (count <= 0) {
         return;
     }
-    items.reserve(count);
+
+    // collect the items in reverse order
+    clRowEntry::Vec_t prev_items;
+    prev_items.reserve(count);
     if (!this->IsHidden() && selfIncluded) {
-        items.insert(items.begin(), this);
+        prev_items.push_back(this);
+    }
+    clRowEntry* prev = GetPrevRow();
+    while (prev && ((int)prev_items.size() < count)) {
+        prev_items.push_back(prev);
+        prev = prev->GetPrevRow();
+    }
+    items.insert(items.begin(), prev_items.rbegin(), prev_items.rend());
+}
+
+clRowEntry* clRowEntry::GetCollapsedParent() const
+{
+    clRowEntry* collapsed = nullptr;
+    for (clRowEntry* parent = GetParent(); parent; parent = parent->GetParent()) {
+        if (!parent->IsExpanded()) {
+            collapsed = parent;
+        }
     }
+    return collapsed;
+}
+
+clRowEntry* clRowEntry::GetNextRow() const
+{
+    // if this item is not displayed, continue after its topmost collapsed parent
+    const clRowEntry* item = GetCollapsedParent();
+    if (!item) {
+        item = this;
+    }
+
+    // skip the children of a collapsed item
+    if (item != this || !IsExpanded()) {
+        while (item->HasChildren()) {
+            item = item->GetLastChild();
+        }
+    }
+    return item->GetNext();
+}
+
+clRowEntry* clRowEntry::GetPrevRow() const
+{
+    // if this item is not displayed, the previous row is its topmost collapsed parent
+    clRowEntry* collapsed = GetCollapsedParent();
+    if (collapsed) {
+        return collapsed;
+    }
+
     clRowEntry* prev = GetPrev();
-    while (prev) {
-        if (prev->IsVisible() && !prev->IsHidden()) {
-            items.insert(items.begin(), prev);
+    if (!prev) {
+        return nullptr;
+    }
+
+    // the previous item is not displayed if it is inside a collapsed item
+    collapsed = prev->GetCollapsedParent();
+    if (collapsed) {
+        prev = collapsed;
+    }
+    return prev->IsHidden() ? nullptr : prev;
+}
+
+void clRowEntry::UpdateRowsCount()
+{
+    clRowEntry* item = this;
+    while (item) {
+        int rows_count = (item->IsHidden() ? 0 : 1) + (item->IsExpanded() ? item->m_childrenRowsCount : 0);
+        int delta = rows_count - item->m_rowsCount;
+        item->m_rowsCount = rows_count;
+
+        clRowEntry* parent = item->GetParent();
+        if (delta == 0 || !parent) {
+            break;
         }
-        if ((int)items.size() == count) {
-            return;
+        parent->m_childrenRowsCount += delta;
+        parent->m_childrenRowsDirty = true;
+        item = parent;
+    }
+}
+
+void clRowEntry::UpdateChildrenRows()
+{
+    if (!m_childrenRowsDirty) {
+        return;
+    }
+
+    m_childrenRows.resize(m_children.size());
+    int rows = 0;
+    for (size_t i = 0; i < m_children.size(); ++i) {
+        m_childrenRows[i] = rows;
+        m_children[i]->m_indexInParent = i;
+        rows += m_children[i]->m_rowsCount;
+    }
+    m_childrenRowsDirty = false;
+}
+
+int clRowEntry::GetRowIndex()
+{
+    // sum the rows displayed before this item in each of its parents
+    int index = 0;
+    clRowEntry* item = this;
+    clRowEntry* parent = GetParent();
+    while (parent) {
+        parent->UpdateChildrenRows();
+        // the rows of a collapsed item children are not displayed
+        index = parent->IsExpanded() ? (index + parent->m_childrenRows[item->m_indexInParent]) : 0;
+        index += parent->IsHidden() ? 0 : 1;
+        item = parent;
+        parent = parent->GetParent();
+    }
+    return index;
+}
+
+clRowEntry* clRowEntry::GetRowAt(int index)
+{
+    if (index < 0 || index >= m_rowsCount) {
+        return nullptr;
+    }
+
+    clRowEntry* item = this;
+    while (true) {
+        if (!item->IsHidden()) {
+            if (index == 0) {
+                return item;
+            }
+            --index;
         }
-        prev = prev->GetPrev();
+
+        // the row is in one of the children (the item is expanded, otherwise its rows count is 1).
+        // Find the last child that starts at, or before, `index`
+        item->UpdateChildrenRows();
+        const std::vector<int>& rows = item->m_childrenRows;
+        size_t child_index = std::upper_bound(rows.begin(), rows.end(), index) - rows.begin() - 1;
+        index -= rows[child_index];
+        item = item->m_children[child_index];
     }
 }
 
@@ -405,6 +536,7 @@ bool clRowEntry::SetExpanded(bool b)
     if (IsHidden()) {
         // Hidden node do not fire events
         SetFlag(kNF_Expanded, b);
+        UpdateRowsCount();
         return true;
     }
 
@@ -422,6 +554,7 @@ bool clRowEntry::SetExpanded(bool b)
     }
 
     SetFlag(kNF_Expanded, b);
+    UpdateRowsCount();
     m_model->NodeExpanded(this, b);
     return true;
 }
@@ -879,6 +1012,7 @@ void clRowEntry::SetHidden(bool b)
     } else {
         m_indentsCount = 0;
     }
+    UpdateRowsCount();
 }
 
 int clRowEntry::CalcItemWidth(wxDC& dc, int rowHeight, size_t col)
@@ -70,6 +70,15 @@ protected:
     clRowEntry* m_next = nullptr;
     clRowEntry* m_prev = nullptr;
     int m_indentsCount = 0;
+    // the number of rows displayed for this subtree (this item included, unless hidden) and for the children
+    int m_rowsCount = 1;
+    int m_childrenRowsCount = 0;
+    // m_childrenRows[i] is the number of rows displayed for the children before m_children[i]. It is rebuilt on
+    // demand, after the children were changed
+    std::vector<int> m_childrenRows;
+    bool m_childrenRowsDirty = false;
+    // the position of this item in its parent children, valid when the parent m_childrenRows is up to date
+    size_t m_indexInParent = 0;
     wxRect m_rowRect;
     wxRect m_buttonRect;
     clMatchResult m_higlightInfo;
@@ -90,6 +99,16 @@ protected:
      * @brief return the nth visible item
      */
     clRowEntry* GetVisibleItem(int index);
+    /**
+     * @brief update the rows count of this item and its parents, after it was expanded, collapsed or its children
+     * were changed
+     */
+    void UpdateRowsCount();
+    void UpdateChildrenRows();
+    /**
+     * @brief return the topmost collapsed parent of this item, nullptr if all the parents are expanded
+     */
+    clRowEntry* GetCollapsedParent() const;
     void DrawSimpleSelection(wxWindow* win, wxDC& dc, const wxRect& rect, const clColours& colours);
     void RenderText(wxWindow* win, wxDC& dc, const clColours& colours, const wxString& text, int x, int y, size_t col);
     void RenderTextSimple(wxWindow* win, wxDC& dc, const clColours& colours, const wxString& text, int x, int y,
@@ -117,6 +136,30 @@ public:
     wxRect GetCellRect(size_t col = 0) const;
     clRowEntry* GetNext() const { return m_next; }
     clRowEntry* GetPrev() const { return m_prev; }
+    /**
+     * @brief return the next row displayed in the tree, skipping the collapsed items children
+     */
+    clRowEntry* GetNextRow() const;
+    /**
+     * @brief return the previous row displayed in the tree, skipping the collapsed items children
+     */
+    clRowEntry* GetPrevRow() const;
+    /**
+     * @brief the number of rows displayed for this subtree, this item included (unless hidden)
+     */
+    int GetRowsCount() const { return m_rowsCount; }
+    /**
+     * @brief return the number of rows displayed before this item, i.e. its row index if it is displayed
+     */
+    int GetRowIndex();
+    /**
+     * @brief return the row at `index` of this subtree (0 is this item, unless hidden). nullptr if out of range
+     */
+    clRowEntry* GetRowAt(int index);
+    /**
+     * @brief must be called after the children array was re-ordered in place (e.g. sorted)
+     */
+    void ChildrenReordered() { m_childrenRowsDirty = true; }
     void SetNext(clRowEntry* next) { this->m_next = next; }
     void SetPrev(clRowEntry* prev) { this->m_prev = prev; }
     void SetHighlightInfo(const clMatchResult& info) { m_higlightInfo = info; }
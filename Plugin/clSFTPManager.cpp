@@ -38,24 +38,45 @@ wxDEFINE_EVENT(wxEVT_SFTP_ASYNC_EXEC_STDOUT, clCommandEvent);
 wxDEFINE_EVENT(wxEVT_SFTP_ASYNC_EXEC_STDERR, clCommandEvent);
 wxDEFINE_EVENT(wxEVT_SFTP_ASYNC_EXEC_DONE, clCommandEvent);
 
+namespace
+{
+// below this size, comparing the checksums costs about as many round trips as uploading the file
+constexpr size_t VERIFY_MIN_FILE_SIZE = 1024 * 1024;
+
+/// return true if the remote file is identical to the local file, in which case there is no need to upload it
+bool is_remote_file_up_to_date(clSFTP::Ptr_t conn, const wxString& localPath, const wxString& remotePath)
+{
+    size_t local_size = FileUtils::GetFileSize(wxFileName(localPath));
+    if (local_size < VERIFY_MIN_FILE_SIZE) {
+        return false;
+    }
+
+    // a 32 bit CRC alone can collide: compare the sizes as well, never skip a save on a checksum match only
+    size_t local_checksum = 0;
+    size_t remote_checksum = 0;
+    size_t remote_size = 0;
+    return FileUtils::GetChecksum(localPath, &local_checksum) &&
+           conn->GetChecksum(remotePath, &remote_checksum, &remote_size) && local_checksum == remote_checksum &&
+           local_size == remote_size;
+}
+} // namespace
+
 clSFTPManager::clSFTPManager()
 {
     EventNotifier::Get()->Bind(wxEVT_GOING_DOWN, &clSFTPManager::OnGoingDown, this);
     EventNotifier::Get()->Bind(wxEVT_FILE_SAVED, &clSFTPManager::OnFileSaved, this);
     m_eventsConnected = true;
-    m_shutdown.store(false);
 
     m_timer = new wxTimer(this);
     m_timer->Start(10000); // 10 seconds should be good enough for a "keep-alive" interval
     Bind(wxEVT_TIMER, &clSFTPManager::OnTimer, this, m_timer->GetId());
     Bind(wxEVT_SFTP_ASYNC_SAVE_COMPLETED, &clSFTPManager::OnSaveCompleted, this);
     Bind(wxEVT_SFTP_ASYNC_SAVE_ERROR, &clSFTPManager::OnSaveError, this);
-    StartWorkerThread();
 }
 
 clSFTPManager::~clSFTPManager()
 {
-    StopWorkerThread();
+    StopAllWorkerThreads();
     if (m_eventsConnected) {
         EventNotifier::Get()->Unbind(wxEVT_GOING_DOWN, &clSFTPManager::OnGoingDown, this);
         EventNotifier::Get()->Unbind(wxEVT_FILE_SAVED, &clSFTPManager::OnFileSaved, this);
@@ -79,7 +100,7 @@ clSFTPManager& clSFTPManager::Get()
 
 void clSFTPManager::Release()
 {
-    StopWorkerThread();
+    StopAllWorkerThreads();
     while (!m_connections.empty()) {
         const auto& conn_info = *(m_connections.begin());
         DeleteConnection(conn_info.first, false);
@@ -96,11 +117,6 @@ void clSFTPManager::Release()
         m_timer->Stop();
         wxDELETE(m_timer);
     }
-    if (m_worker_thread) {
-        m_shutdown.store(true);
-        m_worker_thread->join();
-        wxDELETE(m_worker_thread);
-    }
 }
 
 bool clSFTPManager::AddConnection(const wxString& account_name, bool replace)
@@ -265,7 +281,7 @@ bool clSFTPManager::DoSyncReadFile(const wxString& remotePath, const wxString& a
     };
 
     // queue the task and wait for the response
-    m_q.push_back(std::move(read_func));
+    PushWork(conn, std::move(read_func));
     auto buffer = future.get();
     if (!buffer) {
         return false;
@@ -305,7 +321,7 @@ void clSFTPManager::DoAsyncReadFile(const wxString& remotePath, const wxString&
             clERROR() << "Failed to read remote file:" << remotePath << "." << e.What();
         }
     };
-    m_q.push_back(std::move(read_func));
+    PushWork(conn, std::move(read_func));
 }
 
 bool clSFTPManager::DoSyncDownload(const wxString& remotePath, const wxString& localPath, const wxString& accountName)
@@ -367,7 +383,11 @@ void clSFTPManager::DoAsyncSaveFile(const wxString& localPath, const wxString& r
     // prepare the download work
     auto save_func = [localPath, remotePath, conn, sink, delete_local]() {
         try {
-            conn->Write(localPath, remotePath);
+            if (is_remote_file_up_to_date(conn, localPath, remotePath)) {
+                clDEBUG() << "SFTP Manager: remote file" << remotePath << "is up to date (same checksum)" << endl;
+            } else {
+                conn->Write(localPath, remotePath);
+            }
             if (sink) {
                 // notify about save success
                 clCommandEvent success_event(wxEVT_SFTP_ASYNC_SAVE_COMPLETED);
@@ -388,7 +408,7 @@ void clSFTPManager::DoAsyncSaveFile(const wxString& localPath, const wxString& r
             clRemoveFile(localPath);
         }
     };
-    m_q.push_back(std::move(save_func));
+    PushWork(conn, std::move(save_func));
 }
 
 bool clSFTPManager::DoSyncSaveFileWithConn(clSFTP::Ptr_t conn, const wxString& localPath, const wxString& remotePath,
@@ -399,7 +419,11 @@ bool clSFTPManager::DoSyncSaveFileWithConn(clSFTP::Ptr_t conn, const wxString& l
     auto future = save_promise.get_future();
     auto save_func = [localPath, remotePath, conn, delete_local, &save_promise]() {
         try {
-            conn->Write(localPath, remotePath);
+            if (is_remote_file_up_to_date(conn, localPath, remotePath)) {
+                clDEBUG() << "SFTP Manager: remote file" << remotePath << "is up to date (same checksum)" << endl;
+            } else {
+                conn->Write(localPath, remotePath);
+            }
             save_promise.set_value(true);
         } catch (const clException& e) {
             clERROR() << "Failed to write file:" << remotePath << "." << e.What();
@@ -411,7 +435,7 @@ bool clSFTPManager::DoSyncSaveFileWithConn(clSFTP::Ptr_t conn, const wxString& l
             clRemoveFile(localPath);
         }
     };
-    m_q.push_back(std::move(save_func));
+    PushWork(conn, std::move(save_func));
     return future.get();
 }
 
@@ -497,9 +521,8 @@ bool clSFTPManager::DeleteConnection(const wxString& accountName, bool promptUse
         }
     }
 
-    // before we can delete a connection, we must stop the worker thread
-    // delete the connection and then restart it
-    StopWorkerThread();
+    // before we can delete a connection, we must stop its worker thread
+    StopWorkerThread(accountName);
 
     // notify that a session was closed
     clSFTPEvent event(wxEVT_SFTP_SESSION_CLOSED);
@@ -508,9 +531,6 @@ bool clSFTPManager::DeleteConnection(const wxString& accountName, bool promptUse
 
     // and finally remove the connection
     m_connections.erase(iter);
-
-    // start the worker thread again
-    StartWorkerThread();
     return true;
 }
 
@@ -537,7 +557,7 @@ clResult<SFTPAttribute::List_t, bool> clSFTPManager::List(const wxString& path,
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     if (!future.get()) {
         return clResult<SFTPAttribute::List_t, bool>::make_error(false);
     }
@@ -561,7 +581,7 @@ bool clSFTPManager::NewFile(const wxString& path, const SSHAccountInfo& accountI
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -589,7 +609,7 @@ bool clSFTPManager::NewFolder(const wxString& path, const SSHAccountInfo& accoun
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -610,7 +630,7 @@ bool clSFTPManager::Rename(const wxString& oldpath, const wxString& newpath, con
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -631,7 +651,7 @@ bool clSFTPManager::DeleteDir(const wxString& fullpath, const SSHAccountInfo& ac
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -653,7 +673,7 @@ bool clSFTPManager::UnlinkFile(const wxString& fullpath, const SSHAccountInfo& a
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -676,7 +696,7 @@ void clSFTPManager::OnTimer(wxTimerEvent& event)
                 clERROR() << "failed to send keep-alive message for account:" << e.What() << endl;
             }
         };
-        m_q.push_back(std::move(func));
+        PushWork(conn, std::move(func));
     }
 }
 
@@ -697,7 +717,7 @@ bool clSFTPManager::IsFileExists(const wxString& fullpath, const SSHAccountInfo&
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -718,7 +738,7 @@ bool clSFTPManager::IsDirExists(const wxString& fullpath, const SSHAccountInfo&
             promise.set_value(false);
         }
     };
-    m_q.push_back(std::move(func));
+    PushWork(conn, std::move(func));
     return future.get();
 }
 
@@ -780,33 +800,46 @@ bool clSFTPManager::GetLocalPath(const wxString& remote_path, const wxString& ac
     return false;
 }
 
-void clSFTPManager::StopWorkerThread()
+void clSFTPManager::StopWorkerThread(const wxString& account)
 {
-    if (m_worker_thread) {
-        m_shutdown.store(true);
-        m_worker_thread->join();
-        wxDELETE(m_worker_thread);
+    auto iter = m_workers.find(account);
+    if (iter == m_workers.end()) {
+        return;
     }
-    m_shutdown.store(false);
+
+    auto& worker = iter->second;
+    worker->shutdown.store(true);
+    worker->thread->join();
+    wxDELETE(worker->thread);
+    m_workers.erase(iter);
 }
 
-void clSFTPManager::StartWorkerThread()
+void clSFTPManager::StopAllWorkerThreads()
 {
-    if (m_worker_thread) {
-        return;
+    while (!m_workers.empty()) {
+        wxString account = m_workers.begin()->first;
+        StopWorkerThread(account);
     }
+}
 
-    m_worker_thread = new std::thread(
-        [](SyncQueue<std::function<void()>>& Q, std::atomic_bool& shutdown) {
-            while (!shutdown.load()) {
-                auto work_func = Q.pop_front();
-                if (work_func == nullptr) {
-                    continue;
+void clSFTPManager::PushWork(clSFTP::Ptr_t conn, std::function<void()>&& work)
+{
+    auto& worker = m_workers[conn->GetAccount()];
+    if (!worker) {
+        worker.reset(new connection_worker());
+        worker->thread = new std::thread(
+            [](SyncQueue<std::function<void()>>& Q, std::atomic_bool& shutdown) {
+                while (!shutdown.load()) {
+                    auto work_func = Q.pop_front();
+                    if (work_func == nullptr) {
+                        continue;
+                    }
+                    work_func();
                 }
-                work_func();
-            }
-        },
-        std::ref(m_q), std::ref(m_shutdown));
+            },
+            std::ref(worker->queue), std::ref(worker->shutdown));
+    }
+    worker->queue.push_back(std::move(work));
 }
 
 void clSFTPManager::OnSaveCompleted(clCommandEvent& e)
@@ -930,7 +963,7 @@ ReadOutput_t clSFTPManager::AwaitExecute(const wxString& accountName, const wxSt
         ssh_channel_close(channel);
         ssh_channel_free(channel);
     };
-    m_q.push_back(std::move(exec_func));
+    PushWork(conn, std::move(exec_func));
     return future.get();
 }
 
@@ -1018,6 +1051,6 @@ void clSFTPManager::AsyncExecute(wxEvtHandler* sink, const wxString& accountName
         ssh_channel_close(channel);
         ssh_channel_free(channel);
     };
-    m_q.push_back(std::move(exec_func));
+    PushWork(conn, std::move(exec_func));
 }
 #endif
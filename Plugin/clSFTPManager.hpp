@@ -13,6 +13,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
@@ -35,13 +36,19 @@ protected:
         wxString account_name;
     };
 
+    /// a worker thread and its queue. Each connection has its own worker, so a slow host does not delay the
+    /// requests sent to the others
+    struct connection_worker {
+        std::thread* thread = nullptr;
+        SyncQueue<std::function<void()>> queue;
+        std::atomic_bool shutdown{ false };
+    };
+
 protected:
     std::unordered_map<wxString, std::pair<SSHAccountInfo, clSFTP::Ptr_t>> m_connections;
     wxTimer* m_timer = nullptr;
     bool m_eventsConnected = true;
-    std::thread* m_worker_thread = nullptr;
-    SyncQueue<std::function<void()>> m_q;
-    std::atomic_bool m_shutdown;
+    std::unordered_map<wxString, std::unique_ptr<connection_worker>> m_workers;
     wxString m_lastError;
     std::unordered_map<wxString, saved_file> m_downloadedFileToAccount;
 
@@ -62,8 +69,12 @@ protected:
      */
     void DoAsyncReadFile(const wxString& remotePath, const wxString& accountName, wxEvtHandler* sink);
     bool DoSyncReadFile(const wxString& remotePath, const wxString& accountName, wxMemoryBuffer* content);
-    void StartWorkerThread();
-    void StopWorkerThread();
+    /**
+     * @brief queue a task to the worker thread of `conn`, start the worker if needed
+     */
+    void PushWork(clSFTP::Ptr_t conn, std::function<void()>&& work);
+    void StopWorkerThread(const wxString& account);
+    void StopAllWorkerThreads();
     void OnSaveCompleted(clCommandEvent& e);
     void OnSaveError(clCommandEvent& e);
     void DoAsyncSaveFile(const wxString& localPath, const wxString& remotePath, const wxString& accountName,
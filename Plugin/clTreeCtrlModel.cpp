@@ -232,7 +232,14 @@ void clTreeCtrlModel::DoExpandAllChildren(const wxTreeItemId& item, bool expand)
     if(!p) {
         return;
     }
-    while(p) {
+
+    // visit the subtree of `item` only: stop at the item that follows its last child
+    clRowEntry* last = p;
+    while(last->HasChildren()) {
+        last = last->GetLastChild();
+    }
+    clRowEntry* end = last->GetNext();
+    while(p && p != end) {
         if(p->HasChildren()) {
             if(expand && !p->IsExpanded()) {
                 p->SetExpanded(true);
@@ -358,18 +365,7 @@ int clTreeCtrlModel::GetItemIndex(clRowEntry* item) const
     if(!m_root) {
         return wxNOT_FOUND;
     }
-    int counter = 0;
-    clRowEntry* current = m_root;
-    while(current) {
-        if(current == item) {
-            return counter;
-        }
-        if(current->IsVisible()) {
-            ++counter;
-        }
-        current = current->GetNext();
-    }
-    return wxNOT_FOUND;
+    return item->GetRowIndex();
 }
 
 bool clTreeCtrlModel::GetRange(clRowEntry* from, clRowEntry* to, clRowEntry::Vec_t& items) const
@@ -394,19 +390,17 @@ bool clTreeCtrlModel::GetRange(clRowEntry* from, clRowEntry* to, clRowEntry::Vec
     int index1 = GetItemIndex(from);
     int index2 = GetItemIndex(to);
 
-    clRowEntry* start_item = index1 > index2 ? to : from;
+    // the rows between the two items, followed by the end item
     clRowEntry* end_item = index1 > index2 ? from : to;
-    clRowEntry* current = start_item;
-    while(current) {
-        if(current == end_item) {
-            items.push_back(current);
-            break;
-        }
-        if(current->IsVisible()) {
-            items.push_back(current);
-        }
-        current = current->GetNext();
-    }
+    int start_index = std::min(index1, index2);
+    int end_index = std::max(index1, index2);
+    items.reserve(end_index - start_index + 1);
+    clRowEntry* current = GetItemFromIndex(start_index);
+    for(int i = start_index; current && i < end_index && current != end_item; ++i) {
+        items.push_back(current);
+        current = current->GetNextRow();
+    }
+    items.push_back(end_item);
     return true;
 }
 
@@ -415,7 +409,7 @@ size_t clTreeCtrlModel::GetExpandedLines() const
     if(!GetRoot()) {
         return 0;
     }
-    return m_root->GetExpandedLines();
+    return m_root->GetRowsCount();
 }
 
 clRowEntry* clTreeCtrlModel::GetItemFromIndex(int index) const
@@ -426,18 +420,7 @@ clRowEntry* clTreeCtrlModel::GetItemFromIndex(int index) const
     if(!m_root) {
         return nullptr;
     }
-    int curIndex = -1;
-    clRowEntry* current = m_root;
-    while(current) {
-        if(current->IsVisible()) {
-            ++curIndex;
-        }
-        if(curIndex == index) {
-            return current;
-        }
-        current = current->GetNext();
-    }
-    return nullptr;
+    return m_root->GetRowAt(index);
 }
 
 void clTreeCtrlModel::SelectChildren(const wxTreeItemId& item)
@@ -573,15 +556,7 @@ clRowEntry* clTreeCtrlModel::GetRowBefore(clRowEntry* item, bool visibleItem) co
     if(!curp) {
         return nullptr;
     }
-    curp = curp->GetPrev();
-    while(curp) {
-        if(visibleItem && !curp->IsVisible()) {
-            curp = curp->GetPrev();
-            continue;
-        }
-        break;
-    }
-    return curp;
+    return visibleItem ? curp->GetPrevRow() : curp->GetPrev();
 }
 
 clRowEntry* clTreeCtrlModel::GetRowAfter(clRowEntry* item, bool visibleItem) const
@@ -590,15 +565,7 @@ clRowEntry* clTreeCtrlModel::GetRowAfter(clRowEntry* item, bool visibleItem) con
     if(!curp) {
         return nullptr;
     }
-    curp = curp->GetNext();
-    while(curp) {
-        if(visibleItem && !curp->IsVisible()) {
-            curp = curp->GetNext();
-            continue;
-        }
-        break;
-    }
-    return curp;
+    return visibleItem ? curp->GetNextRow() : curp->GetNext();
 }
 
 clRowEntry* clTreeCtrlModel::GetLastVisibleItem() const
@@ -70,6 +70,7 @@ size_t import_files(const wxString& input_dir, const wxString& output_dir)
     // save the changes
     wxFileName lexer_json(output_dir, "lexers.json");
     ColoursAndFontsManager::Get().Save(lexer_json);
+    FileLogger::CloseLog();
     return count;
 }
 } // namespace
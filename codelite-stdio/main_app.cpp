@@ -25,7 +25,11 @@ MainApp::MainApp() {}
 
 MainApp::~MainApp() { wxDELETE(m_child); }
 
-int MainApp::OnExit() { return TRUE; }
+int MainApp::OnExit()
+{
+    FileLogger::CloseLog();
+    return TRUE;
+}
 
 bool MainApp::OnInit()
 {
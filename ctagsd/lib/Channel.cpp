@@ -1,6 +1,5 @@
 #include "Channel.hpp"
 
-#include "LSP/Message.h"
 #include "file_logger.h"
 
 #include <iostream>
@@ -22,7 +21,7 @@ eReadSome ChannelSocket::read_some()
     size_t bytes_read = 0;
     switch(client->Read(buffer, sizeof(buffer), bytes_read)) {
     case clSocketBase::kSuccess:
-        m_buffer.append(buffer, bytes_read);
+        m_buffer.Append(buffer, bytes_read);
         return eReadSome::kSuccess;
     case clSocketBase::kTimeout:
         return eReadSome::kTimeout;
@@ -58,7 +57,7 @@ bool ChannelSocket::write_reply(const wxString& message)
 std::unique_ptr<JSON> ChannelSocket::read_message()
 {
     while(true) {
-        auto msg = LSP::Message::GetJSONPayload(m_buffer);
+        auto msg = m_buffer.Next();
         if(msg) {
             return msg;
         }
@@ -91,6 +90,8 @@ void ChannelSocket::open()
     client = server.WaitForNewConnection();
     if(!client) {
         clERROR() << "failed to accept new connection. Error code:" << server.GetLastError() << endl;
+        // exit() does not stop the log writer, flush the error that explains the exit
+        FileLogger::CloseLog();
         exit(1);
     }
     clSYSTEM() << "Connection established successfully" << endl;
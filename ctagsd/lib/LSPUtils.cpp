@@ -3,6 +3,7 @@
 #include "SimpleTokenizer.hpp"
 #include "macros.h"
 
+#include <algorithm>
 #include <array>
 
 LSPUtils::LSPUtils() {}
@@ -51,6 +52,33 @@ void LSPUtils::encode_semantic_tokens(const std::vector<TokenWrapper>& tokens_ve
     }
 }
 
+bool LSPUtils::diff_semantic_tokens(const std::vector<int>& before, const std::vector<int>& after, size_t* start,
+                                    size_t* delete_count, std::vector<int>* data)
+{
+    // skip the common prefix
+    size_t prefix = 0;
+    size_t max_prefix = std::min(before.size(), after.size());
+    while(prefix < max_prefix && before[prefix] == after[prefix]) {
+        ++prefix;
+    }
+
+    if(prefix == before.size() && prefix == after.size()) {
+        return false;
+    }
+
+    // skip the common suffix (without overlapping the prefix)
+    size_t suffix = 0;
+    size_t max_suffix = max_prefix - prefix;
+    while(suffix < max_suffix && before[before.size() - suffix - 1] == after[after.size() - suffix - 1]) {
+        ++suffix;
+    }
+
+    *start = prefix;
+    *delete_count = before.size() - prefix - suffix;
+    data->assign(after.begin() + prefix, after.end() - suffix);
+    return true;
+}
+
 LSP::eSymbolKind LSPUtils::get_symbol_kind(const TagEntry* tag)
 {
     LSP::eSymbolKind kind = LSP::eSymbolKind::kSK_Variable;
@@ -31,6 +31,12 @@ public:
     ~LSPUtils();
 
     static void encode_semantic_tokens(const std::vector<TokenWrapper>& tokens_vec, std::vector<int>* encoded_arr);
+    /**
+     * @brief compute the edit that turns the encoded tokens `before` into `after`: `*delete_count` integers starting
+     * at `*start` are replaced with `data`. Return false if both arrays are identical
+     */
+    static bool diff_semantic_tokens(const std::vector<int>& before, const std::vector<int>& after, size_t* start,
+                                     size_t* delete_count, std::vector<int>* data);
     static LSP::eSymbolKind get_symbol_kind(const TagEntry* tag);
     static LSP::CompletionItem::eCompletionItemKind get_completion_kind(const TagEntry* tag);
     static std::vector<LSP::SymbolInformation> to_symbol_information_array(const std::vector<TagEntryPtr>& tags,
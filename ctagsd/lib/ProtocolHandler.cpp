@@ -20,8 +20,14 @@
 #include "fileextmanager.h"
 #include "tags_options_data.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
 #include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <wx/filesys.h>
 #include <wx/stackwalk.h>
 
@@ -30,6 +36,9 @@ using LSP::eSymbolKind;
 
 namespace
 {
+// number of tags stored in the database at once while the indexer output is being read
+constexpr size_t TAGS_BATCH_SIZE = 5000;
+
 FileLogger& operator<<(FileLogger& logger, const TagEntry& tag)
 {
     wxString s;
@@ -46,6 +55,15 @@ FileLogger& operator<<(FileLogger& logger, const std::vector<TagEntryPtr>& tags)
     return logger;
 }
 
+/// open the tags database. When `index` is not null, the tags lookups and updates also go through it
+ITagsStoragePtr open_tags_db(const wxFileName& dbfile, TagsStorageMemoryIndex::Ptr_t index)
+{
+    std::shared_ptr<TagsStorageSQLite> db(new TagsStorageSQLite());
+    db->OpenDatabase(dbfile);
+    db->SetMemoryIndex(index);
+    return db;
+}
+
 void remove_db_if_needed(const wxString& dbpath)
 {
     ITagsStoragePtr db(new TagsStorageSQLite());
@@ -72,6 +90,120 @@ inline size_t count_lines(const wxString& content)
     return lf_count;
 }
 
+inline bool is_identifier_char(wxChar ch) { return ch == '_' || (ch < 128 && wxIsalnum(ch)); }
+
+/**
+ * @brief return the (sorted) list of identifiers found in `text`
+ */
+std::vector<wxString> get_identifiers(const wxString& text)
+{
+    std::vector<wxString> identifiers;
+    size_t i = 0;
+    while(i < text.length()) {
+        if(!is_identifier_char(text[i])) {
+            ++i;
+            continue;
+        }
+
+        size_t start = i;
+        while(i < text.length() && is_identifier_char(text[i])) {
+            ++i;
+        }
+
+        // skip numbers
+        if(!wxIsdigit(text[start])) {
+            identifiers.emplace_back(text.Mid(start, i - start));
+        }
+    }
+    std::sort(identifiers.begin(), identifiers.end());
+    return identifiers;
+}
+
+/**
+ * @brief return true if `text` contains characters that can start or end a comment, a string, a character
+ * literal or a preprocessor directive. Changing them can hide or reveal code without touching any identifier
+ */
+bool has_lexical_markers(const wxString& text)
+{
+    for(wxChar ch : text) {
+        if(ch == '/' || ch == '*' || ch == '"' || ch == '\'' || ch == '#' || ch == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief return true if the range [start, end) of `text` touches a preprocessor directive line
+ */
+bool is_preprocessor_line(const wxString& text, size_t start, size_t end)
+{
+    // move to the start of the first line of the range
+    size_t pos = start;
+    while(pos > 0 && text[pos - 1] != '\n') {
+        --pos;
+    }
+
+    while(pos < text.length()) {
+        size_t first = pos;
+        while(first < text.length() && (text[first] == ' ' || text[first] == '\t')) {
+            ++first;
+        }
+        if(first < text.length() && text[first] == '#') {
+            return true;
+        }
+
+        size_t eol = text.find('\n', pos);
+        if(eol == wxString::npos || eol >= end) {
+            break;
+        }
+        pos = eol + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief return true if the edit that turned `before` into `after` added or removed identifiers. Edits that only
+ * change whitespace, punctuation or numbers do not affect the declarations found by the indexer, unless they
+ * change comments, strings or preprocessor directives (e.g. uncommenting `// int foo;` or `#if 0` -> `#if 1`)
+ */
+bool is_identifiers_change(const wxString& before, const wxString& after)
+{
+    // locate the edited region: skip the common prefix and suffix
+    size_t max_len = std::min(before.length(), after.length());
+    size_t prefix = 0;
+    while(prefix < max_len && before[prefix] == after[prefix]) {
+        ++prefix;
+    }
+
+    if(prefix == before.length() && prefix == after.length()) {
+        return false;
+    }
+
+    size_t suffix = 0;
+    while(suffix < (max_len - prefix) &&
+          before[before.length() - suffix - 1] == after[after.length() - suffix - 1]) {
+        ++suffix;
+    }
+
+    // extend the region to include the words touching it
+    while(prefix > 0 && is_identifier_char(before[prefix - 1])) {
+        --prefix;
+    }
+    while(suffix > 0 && is_identifier_char(before[before.length() - suffix])) {
+        --suffix;
+    }
+
+    wxString removed = before.Mid(prefix, before.length() - prefix - suffix);
+    wxString inserted = after.Mid(prefix, after.length() - prefix - suffix);
+    if(has_lexical_markers(removed) || has_lexical_markers(inserted) ||
+       is_preprocessor_line(before, prefix, before.length() - suffix) ||
+       is_preprocessor_line(after, prefix, after.length() - suffix)) {
+        return true;
+    }
+    return get_identifiers(removed) != get_identifiers(inserted);
+}
+
 /**
  * @brief given a list of files, remove all non c/c++ files from it
  */
@@ -146,7 +278,10 @@ size_t read_file_list(const wxString& settings_dir, const CTagsdSettings& settin
 
 } // namespace
 
-ProtocolHandler::ProtocolHandler() {}
+ProtocolHandler::ProtocolHandler()
+    : m_tags_index(new TagsStorageMemoryIndex())
+{
+}
 
 ProtocolHandler::~ProtocolHandler() { m_parse_thread.stop(); }
 
@@ -172,7 +307,8 @@ JSONItem ProtocolHandler::build_result(JSONItem& reply, size_t id, int result_ki
     return result;
 }
 
-void ProtocolHandler::parse_buffer(const wxFileName& filename, const wxString& buffer, const CTagsdSettings& settings)
+void ProtocolHandler::parse_buffer(const wxFileName& filename, const wxString& buffer, const CTagsdSettings& settings,
+                                   TagsStorageMemoryIndex::Ptr_t index)
 {
     clDEBUG() << "Parsing buffer of file:" << filename << endl;
 
@@ -181,8 +317,7 @@ void ProtocolHandler::parse_buffer(const wxFileName& filename, const wxString& b
     if(!dbfile.FileExists()) {
         clDEBUG() << dbfile << "does not exist, will create it" << endl;
     }
-    ITagsStoragePtr db(new TagsStorageSQLite());
-    db->OpenDatabase(dbfile);
+    ITagsStoragePtr db = open_tags_db(dbfile, index);
     clDEBUG() << "Generating ctags file..." << endl;
 
     std::vector<TagEntryPtr> tags;
@@ -207,47 +342,68 @@ void ProtocolHandler::parse_buffer(const wxFileName& filename, const wxString& b
     clDEBUG() << "Success" << endl;
 }
 
-void ProtocolHandler::parse_file(const wxFileName& filename, const CTagsdSettings& settings)
+void ProtocolHandler::queue_cache_invalidation(const std::vector<wxString>& files)
 {
-    parse_files({ filename.GetFullPath() }, settings);
+    std::lock_guard<std::mutex> lk{ m_stored_files_mutex };
+    m_stored_files.insert(files.begin(), files.end());
 }
 
-void ProtocolHandler::do_parse_chunk(ITagsStoragePtr db, const std::vector<wxString>& file_list, size_t chunk_id,
-                                     const CTagsdSettings& settings)
+void ProtocolHandler::apply_cache_invalidations()
+{
+    wxStringSet_t files;
+    {
+        std::lock_guard<std::mutex> lk{ m_stored_files_mutex };
+        files.swap(m_stored_files);
+    }
+
+    if(files.empty() || !TagsManagerST::Get()->GetDatabase()) {
+        return;
+    }
+
+    // the tags were stored using another connection, evict the lookups cached by ours
+    TagsManagerST::Get()->GetDatabase()->ClearCache(files);
+    LOG_IF_DEBUG { clDEBUG() << "Lookup cache:" << TagsManagerST::Get()->GetDatabase()->GetCacheStatistics() << endl; }
+}
+
+void ProtocolHandler::parse_file(const wxFileName& filename, const CTagsdSettings& settings,
+                                 TagsStorageMemoryIndex::Ptr_t index)
+{
+    parse_files({ filename.GetFullPath() }, settings, index);
+}
+
+size_t ProtocolHandler::do_parse_chunk(const std::vector<wxString>& file_list, size_t chunk_id,
+                                       const CTagsdSettings& settings,
+                                       const std::function<void(std::vector<TagEntryPtr>&)>& on_tags)
 {
-    std::vector<TagEntryPtr> tags;
     LOG_IF_DEBUG { clDEBUG() << "Parsing chunk (" << chunk_id << ") of" << file_list.size() << "files" << endl; }
-    if(CTags::ParseFiles(file_list, settings.GetCodeliteIndexer(), settings.GetMacroTable(), tags) == 0) {
+    size_t count = CTags::ParseFiles(file_list, settings.GetCodeliteIndexer(), settings.GetMacroTable(),
+                                     TAGS_BATCH_SIZE, on_tags);
+    if(count == 0) {
         clDEBUG() << "0 tags generated. processed:" << file_list.size()
                   << "files. Indexer:" << settings.GetCodeliteIndexer() << endl;
-        return;
+        return 0;
     }
+    LOG_IF_TRACE { clDEBUG1() << "Parsing chunk (" << chunk_id << ")...Success" << endl; }
+    return count;
+}
 
-    LOG_IF_TRACE
-    {
-        clDEBUG1() << "Success" << endl;
-        clDEBUG1() << "Updating symbols database..." << endl;
-    }
+void ProtocolHandler::do_store_tags(ITagsStoragePtr db, const std::vector<TagEntryPtr>& tags)
+{
     LOG_IF_DEBUG { clDEBUG() << "Storing" << tags.size() << "tags" << endl; }
     db->Begin();
-
-    time_t update_time = time(nullptr);
     db->Store(tags, false);
-
-    // update the files table in the database
-    // we do this here, since some files might not yield tags
-    // but we still want to mark them as "parsed"
-    for(const wxString& file : file_list) {
-        if(db->InsertFileEntry(file, (int)update_time) == TagExist) {
-            db->UpdateFileEntry(file, (int)update_time);
-        }
-    }
-
-    // Commit whats left
     db->Commit();
 }
 
-void ProtocolHandler::parse_files(const std::vector<wxString>& file_list, const CTagsdSettings& settings)
+void ProtocolHandler::do_mark_files_parsed(ITagsStoragePtr db, const std::vector<wxString>& file_list)
+{
+    // store the files timestamp, size and content hash. The hash allows skipping files
+    // that are touched without being modified (e.g. by switching git branches)
+    TagsManagerST::Get()->MarkFilesParsed(file_list, db);
+}
+
+void ProtocolHandler::parse_files(const std::vector<wxString>& file_list, const CTagsdSettings& settings,
+                                  TagsStorageMemoryIndex::Ptr_t index)
 {
     clDEBUG() << "Parsing" << file_list.size() << "files" << endl;
     clDEBUG() << "Removing un-modified and unwanted files..." << endl;
@@ -256,8 +412,7 @@ void ProtocolHandler::parse_files(const std::vector<wxString>& file_list, const
     if(!dbfile.FileExists()) {
         clDEBUG() << dbfile << "does not exist, will create it" << endl;
     }
-    ITagsStoragePtr db(new TagsStorageSQLite());
-    db->OpenDatabase(dbfile);
+    ITagsStoragePtr db = open_tags_db(dbfile, index);
 
     wxArrayString files_to_parse;
     files_to_parse.reserve(file_list.size());
@@ -274,27 +429,117 @@ void ProtocolHandler::parse_files(const std::vector<wxString>& file_list, const
         return;
     }
 
-    // don't parse all files at once, split them into chunks
-    // how many chunks?
+    size_t processes = settings.GetIndexerProcesses();
+    if(processes == 0) {
+        processes = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // don't parse all files at once, split them into chunks. With multiple indexers, use smaller
+    // chunks so the work is spread evenly between them
     size_t chunk_size = 2500;
-    size_t chunk_count = filtered_file_list.size() / chunk_size + 1;
-    clDEBUG() << "Parsing" << filtered_file_list.size() << "files..." << endl;
-    for(size_t i = 0; i < chunk_count; ++i) {
-        // determine the start/end iterators for each range
-        size_t start_offset = i * chunk_size;
+    if(processes > 1) {
+        chunk_size = std::min(chunk_size, std::max<size_t>(100, filtered_file_list.size() / (processes * 4) + 1));
+    }
+    std::vector<std::vector<wxString>> chunks;
+    for(size_t start_offset = 0; start_offset < filtered_file_list.size(); start_offset += chunk_size) {
         auto iter_start = filtered_file_list.begin() + start_offset;
-        if(iter_start == filtered_file_list.end())
-            // last chunk is empty...
-            // this can happen when our initial file list size divides by 1000
-            // with 0 remainder
-            break;
+        auto iter_end = iter_start + std::min(chunk_size, filtered_file_list.size() - start_offset);
+        chunks.emplace_back(iter_start, iter_end);
+    }
+    processes = std::min(processes, chunks.size());
+
+    clDEBUG() << "Parsing" << filtered_file_list.size() << "files in" << chunks.size() << "chunks using" << processes
+              << "indexer processes..." << endl;
+    if(processes == 1) {
+        for(size_t i = 0; i < chunks.size(); ++i) {
+            auto store = [&db](std::vector<TagEntryPtr>& tags) { do_store_tags(db, tags); };
+            if(do_parse_chunk(chunks[i], i, settings, store) > 0) {
+                do_mark_files_parsed(db, chunks[i]);
+            }
+        }
+        clDEBUG() << "Success" << endl;
+        return;
+    }
+
+    // each worker runs its own indexer process on the next available chunk and queues the tags in
+    // batches, while they are read from the indexer output. This thread is the only one writing them
+    // into the database
+    struct ParsedBatch {
+        size_t chunk_id = 0;
+        std::vector<TagEntryPtr> tags;
+        // the last batch of a chunk: mark the chunk files as parsed if it generated any tag
+        bool last = false;
+        bool ok = false;
+    };
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<ParsedBatch> queue;
+    std::atomic_size_t next_chunk{ 0 };
+
+    auto push_batch = [&](ParsedBatch&& batch) {
+        std::unique_lock<std::mutex> lk{ queue_mutex };
+        // do not let the parsed tags pile up faster than we can store them. While blocked here,
+        // the indexer process is blocked on its output pipe
+        queue_cv.wait(lk, [&]() { return queue.size() < processes; });
+        queue.push_back(std::move(batch));
+        lk.unlock();
+        queue_cv.notify_all();
+    };
+
+    auto worker = [&]() {
+        while(true) {
+            size_t chunk_id = next_chunk.fetch_add(1);
+            if(chunk_id >= chunks.size()) {
+                break;
+            }
+
+            auto on_tags = [&](std::vector<TagEntryPtr>& tags) {
+                ParsedBatch batch;
+                batch.chunk_id = chunk_id;
+                batch.tags.swap(tags);
+                push_batch(std::move(batch));
+            };
+
+            ParsedBatch last;
+            last.chunk_id = chunk_id;
+            last.last = true;
+            last.ok = do_parse_chunk(chunks[chunk_id], chunk_id, settings, on_tags) > 0;
+            push_batch(std::move(last));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(processes);
+    for(size_t i = 0; i < processes; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    size_t chunks_completed = 0;
+    while(chunks_completed < chunks.size()) {
+        ParsedBatch batch;
+        {
+            std::unique_lock<std::mutex> lk{ queue_mutex };
+            queue_cv.wait(lk, [&]() { return !queue.empty(); });
+            batch = std::move(queue.front());
+            queue.pop_front();
+        }
+        queue_cv.notify_all();
+
+        if(!batch.tags.empty()) {
+            do_store_tags(db, batch.tags);
+        }
 
-        auto iter_end = iter_start + chunk_size;
-        if((start_offset + chunk_size) > filtered_file_list.size()) {
-            iter_end = filtered_file_list.end();
+        if(batch.last) {
+            ++chunks_completed;
+            if(batch.ok) {
+                do_mark_files_parsed(db, chunks[batch.chunk_id]);
+            }
         }
-        std::vector<wxString> chunk_vec{ iter_start, iter_end };
-        do_parse_chunk(db, chunk_vec, i, settings);
+    }
+
+    for(auto& t : workers) {
+        t.join();
     }
     clDEBUG() << "Success" << endl;
 }
@@ -444,6 +689,7 @@ void ProtocolHandler::on_initialize(std::unique_ptr<JSON>&& msg, Channel::ptr_t
     auto full = semanticTokensProvider.AddObject("full");
     auto legend = semanticTokensProvider.AddObject("legend");
     full.addProperty("delta", true);
+    semanticTokensProvider.addProperty("range", true);
 
     legend.AddArray("tokenModifiers"); // empty array
     auto tokenTypes = legend.AddArray("tokenTypes");
@@ -499,10 +745,17 @@ void ProtocolHandler::on_initialize(std::unique_ptr<JSON>&& msg, Channel::ptr_t
     wxFileName fn_db_path(m_settings_folder, "tags.db");
     remove_db_if_needed(fn_db_path.GetFullPath());
 
+    // load the symbols parsed by the previous sessions, the parser keeps the index up to date from now on
+    {
+        TagsStorageSQLite db;
+        db.OpenDatabase(fn_db_path);
+        m_tags_index->Load(&db);
+    }
+
     wxString indexer_path = m_settings.GetCodeliteIndexer();
     std::vector<wxString> files_to_parse = { files.begin(), files.end() };
     clDEBUG() << "on_initialize(): parsing files..." << endl;
-    ProtocolHandler::parse_files(files_to_parse, m_settings);
+    ProtocolHandler::parse_files(files_to_parse, m_settings, m_tags_index);
     clDEBUG() << "on_initialize(): parsing files... Success" << endl;
 
     // Now that the database is parsed, re-open it
@@ -511,6 +764,12 @@ void ProtocolHandler::on_initialize(std::unique_ptr<JSON>&& msg, Channel::ptr_t
     TagsManagerST::Get()->GetDatabase()->SetSingleSearchLimit(m_settings.GetLimitResults());
     TagsManagerST::Get()->GetDatabase()->SetUseCache(true);
 
+    // answer the lookups from the in-memory index
+    auto db = std::dynamic_pointer_cast<TagsStorageSQLite>(TagsManagerST::Get()->GetDatabase());
+    if(db) {
+        db->SetMemoryIndex(m_tags_index);
+    }
+
     // reparse the workspace
     send_log_message(_("Initialization completed"), LSP_LOG_INFO, channel);
 
@@ -537,6 +796,18 @@ void ProtocolHandler::on_initialized(std::unique_ptr<JSON>&& msg, Channel::ptr_t
     clDEBUG() << "Received `initialized` message" << endl;
 }
 
+// Notification -->
+void ProtocolHandler::on_cancel_request(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel)
+{
+    // requests are handled one at a time, in order: by the time the cancellation is read, the request it refers to
+    // was already answered. Nothing to do
+    wxUnusedVar(channel);
+    LOG_IF_TRACE
+    {
+        clDEBUG1() << "Ignoring $/cancelRequest for request:" << msg->toElement()["params"]["id"].toInt() << endl;
+    }
+}
+
 // Notification -->
 void ProtocolHandler::on_did_open(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel)
 {
@@ -557,10 +828,13 @@ void ProtocolHandler::on_did_open(std::unique_ptr<JSON>&& msg, Channel::ptr_t ch
     parse_file_for_includes_and_using_namespace(filepath);
 
     // make sure this file is up to date
-    parse_file(filepath, m_settings);
+    parse_file(filepath, m_settings, m_tags_index);
 
     // keep the file content in-cache
     m_filesOpened.insert({ filepath, file_content });
+
+    // the content might differ from the one we have seen before, start with a new semantic tokens cache
+    m_semantic_tokens.erase(filepath);
 }
 
 // Notification -->
@@ -577,6 +851,7 @@ void ProtocolHandler::on_did_close(std::unique_ptr<JSON>&& msg, Channel::ptr_t c
     m_comments_cache.erase(filepath);
     m_parsed_files_info.erase(filepath);
     m_additional_scopes.erase(filepath);
+    m_semantic_tokens.erase(filepath);
 }
 
 // Notification -->
@@ -600,6 +875,17 @@ void ProtocolHandler::on_did_change(std::unique_ptr<JSON>&& msg, Channel::ptr_t
     wxString file_content = json["params"]["contentChanges"][0]["text"].toString();
     line_count_after = count_lines(file_content);
 
+    // a new version of the document: the semantic tokens are re-computed on the next request. The indexer is
+    // only executed again if the edit touched identifiers (i.e. it might have added or removed a declaration)
+    auto semantic_tokens_iter = m_semantic_tokens.find(filepath);
+    if(semantic_tokens_iter != m_semantic_tokens.end()) {
+        auto& cache = semantic_tokens_iter->second;
+        ++cache.document_version;
+        if(!m_filesOpened.count(filepath) || is_identifiers_change(m_filesOpened[filepath], file_content)) {
+            cache.indexed = false;
+        }
+    }
+
     // update the new content
     clDEBUG() << "textDocument/didChange: caching new content for file:" << filepath << endl;
     m_filesOpened.erase(filepath);
@@ -636,7 +922,8 @@ void ProtocolHandler::on_did_change(std::unique_ptr<JSON>&& msg, Channel::ptr_t
         wxString settings_folder = m_settings_folder;
         ParseThreadTaskFunc buffer_parse_task = [=]() {
             clDEBUG() << "on_did_change(): parsing file task" << filepath << endl;
-            ProtocolHandler::parse_buffer(filepath, file_content, m_settings);
+            ProtocolHandler::parse_buffer(filepath, file_content, m_settings, m_tags_index);
+            queue_cache_invalidation({ filepath });
             clDEBUG() << "on_did_change(): parsing file task ... Success" << endl;
             return eParseThreadCallbackRC::RC_SUCCESS;
         };
@@ -648,7 +935,8 @@ void ProtocolHandler::on_did_change(std::unique_ptr<JSON>&& msg, Channel::ptr_t
             std::vector<wxString> includes_to_parse{ new_includes.begin(), new_includes.end() };
             ParseThreadTaskFunc headers_parse_task = [=]() {
                 clDEBUG() << "on_did_change(): parsing header files" << includes_to_parse << endl;
-                ProtocolHandler::parse_files(includes_to_parse, m_settings);
+                ProtocolHandler::parse_files(includes_to_parse, m_settings, m_tags_index);
+                queue_cache_invalidation(includes_to_parse);
                 clDEBUG() << "on_did_change(): parsing header files ... Success" << endl;
                 return eParseThreadCallbackRC::RC_SUCCESS;
             };
@@ -847,6 +1135,7 @@ void ProtocolHandler::on_completion(std::unique_ptr<JSON>&& msg, Channel::ptr_t
         channel->write_reply(response.format(false));
         clDEBUG() << "Success" << endl;
     }
+    LOG_IF_DEBUG { clDEBUG() << "Lookup cache:" << TagsManagerST::Get()->GetDatabase()->GetCacheStatistics() << endl; }
 }
 
 // Notificatin -->
@@ -886,13 +1175,13 @@ void ProtocolHandler::on_did_save(std::unique_ptr<JSON>&& msg, Channel::ptr_t ch
     wxString settings_folder = m_settings_folder;
     ParseThreadTaskFunc task = [=]() {
         clDEBUG() << "on_did_save: parsing task:" << files.size() << "files..." << endl;
-        ProtocolHandler::parse_files(files, m_settings);
+        ProtocolHandler::parse_files(files, m_settings, m_tags_index);
+        queue_cache_invalidation(files);
         clDEBUG() << "on_did_save: parsing task: ... Success!" << endl;
         return eParseThreadCallbackRC::RC_SUCCESS;
     };
 
     m_parse_thread.queue_parse_request(std::move(task));
-    TagsManagerST::Get()->GetDatabase()->ClearCache();
 
     // clear the cached "using namespace"
     m_additional_scopes.clear();
@@ -915,29 +1204,10 @@ void add_to_types_set(const wxString& name, wxStringSet_t& types, const wxString
     }
     types.insert(name);
 }
-} // namespace
 
-// Request <-->
-void ProtocolHandler::on_semantic_tokens(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel)
+void collect_locals_and_types(const std::vector<TagEntryPtr>& tags, wxStringSet_t& locals_set,
+                              wxStringSet_t& types_set)
 {
-    JSONItem json = msg->toElement();
-    LOG_IF_TRACE { clDEBUG1() << json.format() << endl; }
-    wxString filepath_uri = json["params"]["textDocument"]["uri"].toString();
-    wxString filepath = wxFileSystem::URLToFileName(filepath_uri).GetFullPath();
-    clDEBUG() << "textDocument/semanticTokens/full: for file" << filepath << endl;
-
-    // use CTags to gather local variables
-    wxString tmpdir = clStandardPaths::Get().GetTempDir();
-    std::vector<TagEntryPtr> tags;
-
-    // get list of local tags
-    CTags::ParseLocals(filepath, m_filesOpened[filepath], m_settings.GetCodeliteIndexer(), m_settings.GetMacroTable(),
-                       tags);
-
-    LOG_IF_TRACE { clDEBUG1() << "File tags:" << tags.size() << endl; }
-    wxStringSet_t locals_set;
-    wxStringSet_t types_set;
-
     for(auto tag : tags) {
         if(tag->IsLocalVariable() || tag->IsParameter() || tag->IsMember()) {
             wxString type = tag->GetTypename();
@@ -972,25 +1242,30 @@ void ProtocolHandler::on_semantic_tokens(std::unique_ptr<JSON>&& msg, Channel::p
             }
         }
     }
+}
 
-    LOG_IF_TRACE { clDEBUG1() << "The following semantic tokens were found:" << endl; }
-    LOG_IF_TRACE { clDEBUG1() << "Locals:" << locals_set << endl; }
-    LOG_IF_TRACE { clDEBUG1() << "Types:" << types_set << endl; }
-
-    const wxString& buffer = m_filesOpened[filepath];
-
-    // collect all interesting tokens from the document
+/**
+ * @brief collect the interesting tokens of `buffer` found between the lines `from_line` and `to_line`.
+ * Each word is reported once, the tokens are sorted by their position
+ */
+void build_semantic_tokens(const wxString& buffer, const wxStringSet_t& locals_set, const wxStringSet_t& types_set,
+                           long from_line, long to_line, std::vector<TokenWrapper>& tokens_vec)
+{
     SimpleTokenizer tokenizer(buffer);
     TokenWrapper token_wrapper;
 
-    wxStringSet_t visited;
-
     std::unordered_map<wxString, TokenWrapper> variables;
     std::unordered_map<wxString, TokenWrapper> classes;
     std::unordered_map<wxString, TokenWrapper> functions;
 
     while(tokenizer.next(&token_wrapper.token)) {
         const auto& tok = token_wrapper.token;
+        if(tok.line() < from_line) {
+            continue;
+        } else if(tok.line() > to_line) {
+            break;
+        }
+
         auto word = tok.to_string(buffer);
         if(!CompletionHelper::is_cxx_keyword(word)) {
             if(locals_set.count(word)) {
@@ -1030,7 +1305,6 @@ void ProtocolHandler::on_semantic_tokens(std::unique_ptr<JSON>&& msg, Channel::p
     }
 
     // remove all duplicate entries
-    std::vector<TokenWrapper> tokens_vec;
     tokens_vec.reserve(functions.size() + variables.size() + classes.size());
 
     for(const auto& vt : classes) {
@@ -1056,17 +1330,173 @@ void ProtocolHandler::on_semantic_tokens(std::unique_ptr<JSON>&& msg, Channel::p
         tokens_vec.emplace_back(vt.second);
     }
 
+    // report the tokens in the document order, this keeps the encoding stable between two versions of the
+    // document, so the deltas remain small
+    std::sort(tokens_vec.begin(), tokens_vec.end(), [](const TokenWrapper& a, const TokenWrapper& b) {
+        if(a.token.line() != b.token.line()) {
+            return a.token.line() < b.token.line();
+        }
+        return a.token.column() < b.token.column();
+    });
+}
+
+} // namespace
+
+void ProtocolHandler::update_locals_and_types(const wxString& filepath, SemanticTokensCache& cache)
+{
+    if(cache.indexed) {
+        clDEBUG() << "Re-using the local variables and types of file:" << filepath << endl;
+        return;
+    }
+
+    // use CTags to gather local variables
+    std::vector<TagEntryPtr> tags;
+    CTags::ParseLocals(filepath, m_filesOpened[filepath], m_settings.GetCodeliteIndexer(), m_settings.GetMacroTable(),
+                       tags);
+
+    LOG_IF_TRACE { clDEBUG1() << "File tags:" << tags.size() << endl; }
+    cache.locals.clear();
+    cache.types.clear();
+    collect_locals_and_types(tags, cache.locals, cache.types);
+    cache.indexed = true;
+
+    LOG_IF_TRACE { clDEBUG1() << "The following semantic tokens were found:" << endl; }
+    LOG_IF_TRACE { clDEBUG1() << "Locals:" << cache.locals << endl; }
+    LOG_IF_TRACE { clDEBUG1() << "Types:" << cache.types << endl; }
+}
+
+const SemanticTokensCache& ProtocolHandler::update_semantic_tokens(const wxString& filepath)
+{
+    auto& cache = m_semantic_tokens[filepath];
+    if(cache.tokens_version == cache.document_version) {
+        clDEBUG() << "Semantic tokens of file:" << filepath << "are up to date (version" << cache.document_version
+                  << ")" << endl;
+        return cache;
+    }
+
+    update_locals_and_types(filepath, cache);
+
+    // collect all interesting tokens from the document
+    std::vector<TokenWrapper> tokens_vec;
+    build_semantic_tokens(m_filesOpened[filepath], cache.locals, cache.types, 0, LONG_MAX, tokens_vec);
+    clDEBUG() << "Found" << tokens_vec.size() << "semantic tokens" << endl;
+
+    cache.data.clear();
+    LSPUtils::encode_semantic_tokens(tokens_vec, &cache.data);
+    cache.tokens_version = cache.document_version;
+    cache.result_id.clear();
+    cache.result_id << ++m_semantic_tokens_result_id;
+    return cache;
+}
+
+// Request <-->
+void ProtocolHandler::on_semantic_tokens(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel)
+{
+    JSONItem json = msg->toElement();
+    LOG_IF_TRACE { clDEBUG1() << json.format() << endl; }
+    wxString filepath_uri = json["params"]["textDocument"]["uri"].toString();
+    wxString filepath = wxFileSystem::URLToFileName(filepath_uri).GetFullPath();
+    clDEBUG() << "textDocument/semanticTokens/full: for file" << filepath << endl;
+
+    const auto& cache = update_semantic_tokens(filepath);
+
     // build the response
     size_t id = json["id"].toSize_t();
     JSON root(cJSON_Object);
     JSONItem response = root.toElement();
     auto result = build_result(response, id, cJSON_Object);
+    result.addProperty("resultId", cache.result_id);
+    result.addProperty("data", cache.data);
+    LOG_IF_TRACE { clDEBUG1() << response.format() << endl; }
+    channel->write_reply(response);
+}
 
-    std::vector<int> encoding;
-    encoding.reserve(5 * tokens_vec.size());
+// Request <-->
+void ProtocolHandler::on_semantic_tokens_delta(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel)
+{
+    JSONItem json = msg->toElement();
+    LOG_IF_TRACE { clDEBUG1() << json.format() << endl; }
+    wxString filepath_uri = json["params"]["textDocument"]["uri"].toString();
+    wxString filepath = wxFileSystem::URLToFileName(filepath_uri).GetFullPath();
+    wxString previous_result_id = json["params"]["previousResultId"].toString();
+    clDEBUG() << "textDocument/semanticTokens/full/delta: for file" << filepath
+              << "previous result:" << previous_result_id << endl;
+
+    // we can only compute the delta against the last tokens we reported for this file
+    auto iter = m_semantic_tokens.find(filepath);
+    bool has_previous =
+        iter != m_semantic_tokens.end() && !previous_result_id.empty() && iter->second.result_id == previous_result_id;
+
+    std::vector<int> previous_data;
+    if(has_previous && iter->second.tokens_version != iter->second.document_version) {
+        // the tokens are about to be re-computed
+        previous_data.swap(iter->second.data);
+    }
 
+    const auto& cache = update_semantic_tokens(filepath);
+
+    // build the response
+    size_t id = json["id"].toSize_t();
+    JSON root(cJSON_Object);
+    JSONItem response = root.toElement();
+    auto result = build_result(response, id, cJSON_Object);
+    result.addProperty("resultId", cache.result_id);
+
+    if(!has_previous) {
+        // unknown result id, reply with the complete list of tokens
+        clDEBUG() << "Unknown previous result id. Sending all the semantic tokens" << endl;
+        result.addProperty("data", cache.data);
+
+    } else {
+        auto edits = result.AddArray("edits");
+        size_t start = 0;
+        size_t delete_count = 0;
+        std::vector<int> data;
+        if(cache.result_id != previous_result_id &&
+           LSPUtils::diff_semantic_tokens(previous_data, cache.data, &start, &delete_count, &data)) {
+            auto edit = JSONItem::createObject();
+            edit.addProperty("start", start);
+            edit.addProperty("deleteCount", delete_count);
+            edit.addProperty("data", data);
+            edits.arrayAppend(edit);
+        }
+        clDEBUG() << "Semantic tokens delta: replacing" << delete_count << "items at" << start << "with"
+                  << data.size() << "items" << endl;
+    }
+    LOG_IF_TRACE { clDEBUG1() << response.format() << endl; }
+    channel->write_reply(response);
+}
+
+// Request <-->
+void ProtocolHandler::on_semantic_tokens_range(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel)
+{
+    JSONItem json = msg->toElement();
+    LOG_IF_TRACE { clDEBUG1() << json.format() << endl; }
+    wxString filepath_uri = json["params"]["textDocument"]["uri"].toString();
+    wxString filepath = wxFileSystem::URLToFileName(filepath_uri).GetFullPath();
+
+    // the range is rounded to complete lines
+    auto range = json["params"]["range"];
+    long from_line = range["start"]["line"].toInt(0);
+    long to_line = range["end"]["line"].toInt(0);
+    clDEBUG() << "textDocument/semanticTokens/range: for file" << filepath << "lines:" << from_line << "-" << to_line
+              << endl;
+
+    auto& cache = m_semantic_tokens[filepath];
+    update_locals_and_types(filepath, cache);
+
+    std::vector<TokenWrapper> tokens_vec;
+    build_semantic_tokens(m_filesOpened[filepath], cache.locals, cache.types, from_line, to_line, tokens_vec);
     clDEBUG() << "Found" << tokens_vec.size() << "semantic tokens" << endl;
+
+    std::vector<int> encoding;
     LSPUtils::encode_semantic_tokens(tokens_vec, &encoding);
+
+    // build the response
+    size_t id = json["id"].toSize_t();
+    JSON root(cJSON_Object);
+    JSONItem response = root.toElement();
+    auto result = build_result(response, id, cJSON_Object);
     result.addProperty("data", encoding);
     LOG_IF_TRACE { clDEBUG1() << response.format() << endl; }
     channel->write_reply(response);
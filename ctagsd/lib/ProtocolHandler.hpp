@@ -9,9 +9,12 @@
 #include "Scanner.hpp"
 #include "Settings.hpp"
 #include "database/istorage.h"
+#include "database/tags_storage_memory_index.h"
 #include "macros.h"
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <wx/string.h>
 
 struct CachedComment {
@@ -27,6 +30,19 @@ struct ParsedFileInfo {
     wxStringSet_t using_namespace;
 };
 
+struct SemanticTokensCache {
+    // incremented whenever the document content changes (didOpen / didChange)
+    size_t document_version = 1;
+    // the document version `data` was computed for (0: not computed yet)
+    size_t tokens_version = 0;
+    // true if `locals` and `types` (collected by the indexer) are still valid for the document content
+    bool indexed = false;
+    wxStringSet_t locals;
+    wxStringSet_t types;
+    wxString result_id;
+    std::vector<int> data;
+};
+
 class ProtocolHandler
 {
 public:
@@ -42,30 +58,48 @@ private:
     std::unordered_map<wxString, CachedComment::Map_t> m_comments_cache;
     std::unordered_map<wxString, ParsedFileInfo> m_parsed_files_info;
     std::unordered_map<wxString, std::vector<wxString>> m_additional_scopes;
+    std::unordered_map<wxString, SemanticTokensCache> m_semantic_tokens;
+    size_t m_semantic_tokens_result_id = 0;
     wxArrayString m_search_paths;
     Scanner m_file_scanner;
     CxxCodeCompletion::ptr_t m_completer;
+    TagsStorageMemoryIndex::Ptr_t m_tags_index;
     ParseThread m_parse_thread;
+    // files whose tags were stored by the parse thread since the last call to apply_cache_invalidations()
+    std::mutex m_stored_files_mutex;
+    wxStringSet_t m_stored_files;
 
 private:
     JSONItem build_result(JSONItem& reply, size_t id, int result_kind);
 
     /**
-     * @brief parse source file
+     * @brief parse source file. The tags are also stored in `index`, when not null
      */
-    static void parse_file(const wxFileName& filename, const CTagsdSettings& settings);
+    static void parse_file(const wxFileName& filename, const CTagsdSettings& settings,
+                           TagsStorageMemoryIndex::Ptr_t index = nullptr);
     /**
-     * @brief parse buffer of a given file name
+     * @brief parse buffer of a given file name. The tags are also stored in `index`, when not null
      */
-    static void parse_buffer(const wxFileName& filename, const wxString& buffer, const CTagsdSettings& settings);
+    static void parse_buffer(const wxFileName& filename, const wxString& buffer, const CTagsdSettings& settings,
+                             TagsStorageMemoryIndex::Ptr_t index = nullptr);
     /**
-     * @brief parse list of files
+     * @brief parse list of files. The files are split into chunks, parsed by concurrent indexer
+     * processes (see CTagsdSettings::GetIndexerProcesses()) and stored into the database by the calling thread.
+     * The tags are also stored in `index`, when not null
      */
-    static void parse_files(const std::vector<wxString>& files, const CTagsdSettings& settings);
+    static void parse_files(const std::vector<wxString>& files, const CTagsdSettings& settings,
+                            TagsStorageMemoryIndex::Ptr_t index = nullptr);
+
+    // helper method for parsing a chunk of files. The tags are passed to `on_tags` in batches while
+    // the indexer output is read. Can be called from multiple threads. Returns the number of tags generated
+    static size_t do_parse_chunk(const std::vector<wxString>& files, size_t chunk_id, const CTagsdSettings& settings,
+                                 const std::function<void(std::vector<TagEntryPtr>&)>& on_tags);
+
+    // store a batch of tags into the database
+    static void do_store_tags(ITagsStoragePtr db, const std::vector<TagEntryPtr>& tags);
 
-    // helper method for parsing a chunk of files
-    static void do_parse_chunk(ITagsStoragePtr db, const std::vector<wxString>& files, size_t chunk_id,
-                               const CTagsdSettings& settings);
+    // mark the files as parsed in the database (files may not yield any tag)
+    static void do_mark_files_parsed(ITagsStoragePtr db, const std::vector<wxString>& files);
 
     bool ensure_file_content_exists(const wxString& filepath, Channel::ptr_t channel, size_t req_id);
     void update_comments_for_file(const wxString& filepath, const wxString& file_content);
@@ -78,6 +112,21 @@ private:
     size_t do_find_definition_tags(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel, bool try_definition_first,
                                    std::vector<TagEntryPtr>& tags, wxString* file_match);
 
+    /**
+     * @brief return the semantic tokens of `filepath`, computing them if the document changed since the last call.
+     * The indexer is only executed when an edit might have added or removed a declaration
+     */
+    const SemanticTokensCache& update_semantic_tokens(const wxString& filepath);
+    /**
+     * @brief run the indexer on `filepath` to collect its local variables and types, unless `cache` is up to date
+     */
+    void update_locals_and_types(const wxString& filepath, SemanticTokensCache& cache);
+
+    /**
+     * @brief called by the parse thread once the tags of `files` are stored
+     */
+    void queue_cache_invalidation(const std::vector<wxString>& files);
+
     void build_search_path();
     void parse_file_for_includes_and_using_namespace(const wxString& filepath);
     void parse_buffer_for_includes_and_using_namespace(const wxString& filepath, const wxString& buffer);
@@ -105,8 +154,15 @@ public:
     ProtocolHandler();
     ~ProtocolHandler();
 
+    /**
+     * @brief evict the cached lookups affected by the files stored by the parse thread.
+     * Called by the main loop before handling a message
+     */
+    void apply_cache_invalidations();
+
     void on_initialize(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_initialized(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
+    void on_cancel_request(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_unsupported_message(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_did_open(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_did_change(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
@@ -114,6 +170,8 @@ public:
     void on_did_close(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_did_save(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_semantic_tokens(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
+    void on_semantic_tokens_delta(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
+    void on_semantic_tokens_range(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_document_symbol(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_document_signature_help(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
     void on_definition(std::unique_ptr<JSON>&& msg, Channel::ptr_t channel);
@@ -16,6 +16,8 @@ class CTagsdSettings
     wxString m_codelite_indexer;
     wxString m_ignore_spec = "/.git/;/.svn/;/build/;/build-;/CPack_Packages/;/CMakeFiles/";
     size_t m_limit_results = 150;
+    // number of concurrent indexer processes, 0 means: one per core
+    size_t m_indexer_processes = 0;
     wxString m_settings_dir;
 
 private:
@@ -31,6 +33,8 @@ public:
 
     void SetLimitResults(size_t limit_results) { this->m_limit_results = limit_results; }
     size_t GetLimitResults() const { return m_limit_results; }
+    void SetIndexerProcesses(size_t indexer_processes) { this->m_indexer_processes = indexer_processes; }
+    size_t GetIndexerProcesses() const { return m_indexer_processes; }
     void SetCodeliteIndexer(const wxString& codelite_indexer) { this->m_codelite_indexer = codelite_indexer; }
     void SetFileMask(const wxString& file_mask) { this->m_file_mask = file_mask; }
     void SetIgnoreSpec(const wxString& ignore_spec) { this->m_ignore_spec = ignore_spec; }
@@ -15,12 +15,15 @@ namespace
 std::unordered_map<wxString, ProtocolHandler::CallbackFunc> function_table = {
     { "initialize", &ProtocolHandler::on_initialize },
     { "initialized", &ProtocolHandler::on_initialized },
+    { "$/cancelRequest", &ProtocolHandler::on_cancel_request },
     { "textDocument/didOpen", &ProtocolHandler::on_did_open },
     { "textDocument/didChange", &ProtocolHandler::on_did_change },
     { "textDocument/completion", &ProtocolHandler::on_completion },
     { "textDocument/didClose", &ProtocolHandler::on_did_close },
     { "textDocument/didSave", &ProtocolHandler::on_did_save },
     { "textDocument/semanticTokens/full", &ProtocolHandler::on_semantic_tokens },
+    { "textDocument/semanticTokens/full/delta", &ProtocolHandler::on_semantic_tokens_delta },
+    { "textDocument/semanticTokens/range", &ProtocolHandler::on_semantic_tokens_range },
     { "textDocument/signatureHelp", &ProtocolHandler::on_document_signature_help },
     { "textDocument/definition", &ProtocolHandler::on_definition },
     { "textDocument/declaration", &ProtocolHandler::on_declaration },
@@ -80,6 +83,7 @@ int main(int argc, char** argv)
             if(!msg) {
                 break;
             }
+            protocol_handler.apply_cache_invalidations();
             auto json = msg->toElement();
             wxString method = json["method"].toString();
             if(function_table.count(method) == 0) {
@@ -93,10 +97,12 @@ int main(int argc, char** argv)
 
     } catch (const clSocketException& e) {
         clERROR() << "Uncaught exception:" << e.what() << endl;
+        FileLogger::CloseLog();
         exit(1);
     }
 
     // Free resources allocated by the tags manager
     TagsManagerST::Free();
+    FileLogger::CloseLog();
     return 0;
 }
@@ -0,0 +1,158 @@
+// Replay a code completion session against a tags database and report the lookups latency
+//
+// Usage: ctagsd-bench <tags.db> [session-file]
+//
+// The session file contains one lookup per line, fields are separated with a TAB:
+//
+//  name        <prefix>                  GetTagsByName(prefix)
+//  scope_name  <scope> <name-prefix>     GetTagsByScopeAndName(scope, name-prefix, true)
+//  scope       <scope>                   GetTagsByScope(scope)
+//  path        <path>                    GetTagsByPath(path)
+//
+// When no session file is given, a session is generated from the database: the names of random
+// symbols are "typed" one character at a time, each keystroke issues a `name` and a `scope_name` lookup.
+// The results cache is disabled, so every lookup reaches SQLite
+
+#include "database/tags_storage_sqlite3.h"
+#include "fileutils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <wx/init.h>
+#include <wx/log.h>
+#include <wx/tokenzr.h>
+
+using namespace std;
+namespace
+{
+constexpr size_t GENERATED_SYMBOLS_COUNT = 500;
+constexpr size_t ROUNDS = 3;
+
+struct Lookup {
+    wxString method;
+    wxString arg1;
+    wxString arg2;
+};
+
+bool load_session(const wxString& filepath, vector<Lookup>& session)
+{
+    wxString content;
+    if(!FileUtils::ReadFileContent(filepath, content)) {
+        return false;
+    }
+
+    wxArrayString lines = ::wxStringTokenize(content, "\n", wxTOKEN_STRTOK);
+    for(const wxString& line : lines) {
+        wxArrayString fields = ::wxStringTokenize(line, "\t", wxTOKEN_RET_EMPTY_ALL);
+        if(fields.empty() || fields[0].Trim().Trim(false).empty()) {
+            continue;
+        }
+        Lookup lookup;
+        lookup.method = fields[0];
+        lookup.arg1 = fields.size() > 1 ? fields[1] : wxString();
+        lookup.arg2 = fields.size() > 2 ? fields[2] : wxString();
+        session.push_back(lookup);
+    }
+    return true;
+}
+
+void generate_session(TagsStorageSQLite& db, vector<Lookup>& session)
+{
+    wxString sql;
+    sql << "select name, scope from tags where kind in ('class', 'struct', 'function', 'prototype', 'member') "
+        << "order by random() limit " << GENERATED_SYMBOLS_COUNT;
+    try {
+        wxSQLite3ResultSet rs = db.Query(sql);
+        while(rs.NextRow()) {
+            wxString name = rs.GetString(0);
+            wxString scope = rs.GetString(1);
+            for(size_t len = 1; len <= name.length(); ++len) {
+                wxString prefix = name.Left(len);
+                session.push_back({ "name", prefix, wxEmptyString });
+                session.push_back({ "scope_name", scope, prefix });
+            }
+        }
+    } catch (const wxSQLite3Exception& e) {
+        cerr << "failed to generate session: " << e.GetMessage().ToStdString() << endl;
+    }
+}
+
+size_t replay(TagsStorageSQLite& db, const Lookup& lookup)
+{
+    vector<TagEntryPtr> tags;
+    if(lookup.method == "name") {
+        db.GetTagsByName(lookup.arg1, tags);
+    } else if(lookup.method == "scope_name") {
+        db.GetTagsByScopeAndName(lookup.arg1, lookup.arg2, true, tags);
+    } else if(lookup.method == "scope") {
+        db.GetTagsByScope(lookup.arg1, tags);
+    } else if(lookup.method == "path") {
+        db.GetTagsByPath(lookup.arg1, tags);
+    }
+    return tags.size();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    wxInitializer initializer(argc, argv);
+    wxLogNull NOLOG;
+
+    if(argc < 2) {
+        cerr << "Usage: " << argv[0] << " <tags.db> [session-file]" << endl;
+        return 1;
+    }
+
+    wxFileName tags_db(argv[1]);
+    if(!tags_db.FileExists()) {
+        cerr << "no such file: " << tags_db.GetFullPath().ToStdString() << endl;
+        return 1;
+    }
+
+    TagsStorageSQLite db;
+    db.OpenDatabase(tags_db);
+    db.SetUseCache(false);
+
+    vector<Lookup> session;
+    if(argc > 2) {
+        if(!load_session(argv[2], session)) {
+            cerr << "failed to read session file: " << argv[2] << endl;
+            return 1;
+        }
+    } else {
+        generate_session(db, session);
+    }
+
+    if(session.empty()) {
+        cerr << "nothing to replay" << endl;
+        return 1;
+    }
+
+    vector<double> latencies;
+    latencies.reserve(session.size() * ROUNDS);
+    size_t matches = 0;
+    for(size_t round = 0; round < ROUNDS; ++round) {
+        for(const Lookup& lookup : session) {
+            auto start = chrono::steady_clock::now();
+            matches += replay(db, lookup);
+            auto end = chrono::steady_clock::now();
+            latencies.push_back(chrono::duration<double, micro>(end - start).count());
+        }
+    }
+
+    double total = 0.0;
+    for(double latency : latencies) {
+        total += latency;
+    }
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[(size_t)((latencies.size() - 1) * p)]; };
+
+    cout << "lookups: " << latencies.size() << " (" << session.size() << " x " << ROUNDS << " rounds), "
+         << "matches: " << matches << endl;
+    cout << "total: " << (total / 1000.0) << "ms" << endl;
+    cout << "latency (us): avg " << (total / latencies.size()) << ", p50 " << percentile(0.5) << ", p95 "
+         << percentile(0.95) << ", p99 " << percentile(0.99) << ", max " << latencies.back() << endl;
+    return 0;
+}
@@ -5,11 +5,15 @@
 #include "Cxx/CxxScannerTokens.h"
 #include "Cxx/CxxTokenizer.h"
 #include "Cxx/CxxVariableScanner.h"
+#include "LSP/MessageFramer.hpp"
 #include "LSPUtils.hpp"
 #include "Settings.hpp"
 #include "SimpleTokenizer.hpp"
 #include "clFilesCollector.h"
+#include "clFuzzyMatcher.hpp"
+#include "clTrigramIndex.hpp"
 #include "ctags_manager.h"
+#include "database/tags_storage_memory_index.h"
 #include "database/tags_storage_sqlite3.h"
 #include "fileutils.h"
 #include "macros.h"
@@ -430,6 +434,112 @@ TEST_FUNC(TestSimeplTokenizer_2)
     return true;
 }
 
+TEST_FUNC(test_semantic_tokens_delta)
+{
+    size_t start = 0;
+    size_t delete_count = 0;
+    vector<int> data;
+    vector<int> before = { 0, 4, 3, 1, 0, 2, 0, 5, 0, 99, 0, 6, 4, 2, 0 };
+
+    // no change
+    CHECK_BOOL(!LSPUtils::diff_semantic_tokens(before, before, &start, &delete_count, &data));
+
+    // a token was added in the middle
+    vector<int> after = { 0, 4, 3, 1, 0, 1, 2, 3, 0, 99, 1, 0, 5, 0, 99, 0, 6, 4, 2, 0 };
+    CHECK_BOOL(LSPUtils::diff_semantic_tokens(before, after, &start, &delete_count, &data));
+    vector<int> patched = before;
+    patched.erase(patched.begin() + start, patched.begin() + start + delete_count);
+    patched.insert(patched.begin() + start, data.begin(), data.end());
+    CHECK_BOOL(patched == after);
+
+    // all tokens were removed
+    CHECK_BOOL(LSPUtils::diff_semantic_tokens(before, {}, &start, &delete_count, &data));
+    CHECK_SIZE(start, 0);
+    CHECK_SIZE(delete_count, before.size());
+    CHECK_SIZE(data.size(), 0);
+    return true;
+}
+
+TEST_FUNC(test_tags_memory_index)
+{
+    auto make_tag = [](const wxString& file, const wxString& name, const wxString& kind, const wxString& scope) {
+        TagEntryPtr tag(new TagEntry());
+        tag->SetFile(file);
+        tag->SetName(name);
+        tag->SetKind(kind);
+        tag->SetScope(scope);
+        tag->SetPath(scope == "<global>" ? name : scope + "::" + name);
+        return tag;
+    };
+
+    TagsStorageMemoryIndex index;
+    index.Store({ make_tag("/tmp/a.h", "Foo", "class", "<global>"), make_tag("/tmp/a.h", "foobar", "function", "Foo"),
+                  make_tag("/tmp/a.h", "FooBaz", "function", "Foo") });
+    index.Store({ make_tag("/tmp/b.h", "Bar", "struct", "<global>"), make_tag("/tmp/b.h", "m_foo", "member", "Bar") });
+    CHECK_SIZE(index.GetCount(), 5);
+
+    std::vector<TagEntryPtr> tags;
+    index.GetTagsByName("foo", true, true, 0, tags);
+    CHECK_SIZE(tags.size(), 3);
+
+    tags.clear();
+    index.GetTagsByName("Foo", false, false, 0, tags);
+    CHECK_SIZE(tags.size(), 1);
+    CHECK_STRING(tags[0]->GetKind(), "class");
+
+    tags.clear();
+    wxArrayString kinds;
+    kinds.Add("function");
+    index.GetChildren("Foo", "foo", true, false, kinds, 0, tags);
+    CHECK_SIZE(tags.size(), 1);
+    CHECK_STRING(tags[0]->GetPath(), "Foo::foobar");
+
+    tags.clear();
+    index.GetTagsByPartName("foo", 0, tags);
+    CHECK_SIZE(tags.size(), 4);
+
+    // re-storing a file replaces its tags
+    index.Store({ make_tag("/tmp/a.h", "Foo", "class", "<global>") });
+    CHECK_SIZE(index.GetCount(), 3);
+
+    index.DeleteFile("/tmp/b.h");
+    CHECK_SIZE(index.GetCount(), 1);
+    tags.clear();
+    index.GetTagsByPath("Bar", wxArrayString(), 0, tags);
+    CHECK_SIZE(tags.size(), 0);
+    return true;
+}
+
+TEST_FUNC(test_fuzzy_matcher)
+{
+    clFuzzyMatcher matcher;
+    matcher.Add("Find In Files");
+    matcher.Add("Open File");
+    matcher.Add("Close All Files");
+    matcher.Add("Build Project");
+
+    std::vector<clFuzzyMatcher::Match> matches;
+    CHECK_SIZE(matcher.Search("", 0, matches), 4);
+    CHECK_SIZE(matches.size(), 4);
+
+    CHECK_SIZE(matcher.Search("fif", 0, matches), 1);
+    CHECK_SIZE(matches[0].index, 0);
+
+    // same score: the shortest entry comes first
+    CHECK_SIZE(matcher.Search("file", 0, matches), 3);
+    CHECK_SIZE(matches[0].index, 1);
+
+    // refining the previous query
+    CHECK_SIZE(matcher.Search("files", 0, matches), 2);
+
+    // terms can appear in any order, the limit only applies to the returned matches
+    CHECK_SIZE(matcher.Search("files all", 1, matches), 1);
+    CHECK_SIZE(matches.size(), 1);
+    CHECK_SIZE(matches[0].index, 2);
+    CHECK_SIZE(matcher.Search("xyz", 0, matches), 0);
+    return true;
+}
+
 TEST_FUNC(TestSimeplTokenizer)
 {
     {
@@ -501,6 +611,182 @@ TEST_FUNC(test_symlink_is_scandir)
     return true;
 }
 
+TEST_FUNC(test_files_scanner)
+{
+    wxFileName root(clStandardPaths::Get().GetTempDir(), "");
+    root.AppendDir("files_scanner_test");
+    wxString rootdir = root.GetPath();
+    wxFileName::Rmdir(rootdir, wxPATH_RMDIR_RECURSIVE);
+    for(const wxString& dir : { "src/lib", "src/.hidden", "build/obj" }) {
+        wxFileName::Mkdir(rootdir + "/" + dir, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    }
+    for(const wxString& file : { "main.cpp", "README.md", "src/a.cpp", "src/a.h", "src/lib/b.cpp", "src/.hidden/c.cpp",
+                                 "build/obj/d.cpp" }) {
+        FileUtils::WriteFileContent(rootdir + "/" + file, "");
+    }
+
+    clFilesScanner scanner;
+    wxArrayString files;
+    scanner.Scan(rootdir, files, "*.cpp;*.h", "", "build");
+    CHECK_SIZE(files.size(), 5);
+
+    // stop after the first file
+    size_t count = scanner.Scan(rootdir, "*.cpp", "", "", [](const wxString&) { return false; });
+    CHECK_SIZE(count, 0);
+
+    std::vector<wxString> all_files;
+    size_t folders = 0;
+    scanner.ScanWithCallbacks(
+        rootdir,
+        [&](const wxString& fullpath) {
+            ++folders;
+            return !fullpath.EndsWith("build");
+        },
+        [&](const wxArrayString& batch) { all_files.insert(all_files.end(), batch.begin(), batch.end()); },
+        clFilesScanner::SF_EXCLUDE_HIDDEN_DIRS);
+    CHECK_SIZE(folders, 3); // src, src/lib and build
+    CHECK_SIZE(all_files.size(), 5);
+
+    wxFileName::Rmdir(rootdir, wxPATH_RMDIR_RECURSIVE);
+    return true;
+}
+
+TEST_FUNC(test_trigram_index_regex_literals)
+{
+    {
+        auto literals = clTrigramIndex::GetRegexLiterals("foo_bar\\(\\d+\\)");
+        CHECK_SIZE(literals.size(), 1);
+        CHECK_STRING(literals[0], "foo_bar(");
+    }
+    {
+        // optional characters and groups break the literal
+        auto literals = clTrigramIndex::GetRegexLiterals("wxStrings?[A-Z]+(Item|Count)Get");
+        CHECK_SIZE(literals.size(), 2);
+        CHECK_STRING(literals[0], "wxString");
+        CHECK_STRING(literals[1], "Get");
+    }
+    {
+        // top level alternation: no constraints
+        auto literals = clTrigramIndex::GetRegexLiterals("foobar|bazqux");
+        CHECK_SIZE(literals.size(), 0);
+    }
+    {
+        // the ']' closing a POSIX class does not end the bracket expression
+        auto literals = clTrigramIndex::GetRegexLiterals("[[:alpha:]]xyz");
+        CHECK_SIZE(literals.size(), 1);
+        CHECK_STRING(literals[0], "xyz");
+
+        literals = clTrigramIndex::GetRegexLiterals("[[:alpha:]]x");
+        CHECK_SIZE(literals.size(), 0);
+    }
+    {
+        std::vector<uint32_t> trigrams;
+        clTrigramIndex::GetTrigrams("ABCabc", 6, trigrams);
+        // "abc", "bca", "cab"
+        CHECK_SIZE(trigrams.size(), 3);
+    }
+    return true;
+}
+
+TEST_FUNC(test_lsp_message_framer)
+{
+    LSP::MessageFramer framer;
+    std::string first = "Content-Length: 13\r\n\r\n{\"id\": 12345}";
+    std::string second = "Content-Type: application/vscode-jsonrpc; charset=utf-8\r\nContent-Length: 8\r\n\r\n{\"id\":7}";
+
+    // the headers terminator is split between two reads
+    framer.Append(first.substr(0, 20));
+    CHECK_BOOL(framer.Next() == nullptr);
+    framer.Append(first.substr(20) + second.substr(0, 10));
+
+    auto json = framer.Next();
+    CHECK_NOT_NULL(json);
+    CHECK_BOOL(json->isOk());
+    CHECK_SIZE(json->toElement()["id"].toInt(), 12345);
+    CHECK_BOOL(framer.Next() == nullptr);
+
+    framer.Append(second.substr(10));
+    json = framer.Next();
+    CHECK_NOT_NULL(json);
+    CHECK_SIZE(json->toElement()["id"].toInt(), 7);
+    CHECK_BOOL(framer.IsEmpty());
+    return true;
+}
+
+TEST_FUNC(test_tags_storage_cache)
+{
+    auto make_tag = [](const wxString& name, const wxString& file, int line = 1) {
+        TagEntryPtr tag(new TagEntry());
+        tag->SetName(name);
+        tag->SetFile(file);
+        tag->SetLine(line);
+        tag->SetPattern(wxString() << "/^ line " << line << " $/");
+        return tag;
+    };
+
+    TagsStorageSQLiteCache cache;
+    cache.SetLimits(2, 1024 * 1024);
+    cache.Store("q1", { make_tag("foo", "/a.cpp"), make_tag("bar", "/b.cpp") });
+    cache.Store("q2", { make_tag("baz", "/b.cpp") });
+    cache.Store("q3", std::vector<TagEntryPtr>{});
+
+    // q1 is the least recently used entry
+    std::vector<TagEntryPtr> tags;
+    CHECK_BOOL(!cache.Get("q1", tags));
+    CHECK_BOOL(cache.Get("q2", tags));
+    CHECK_SIZE(tags.size(), 1);
+
+    cache.SetLimits(10, 1024 * 1024);
+    cache.Store("q1", { make_tag("foo", "/a.cpp"), make_tag("bar", "/b.cpp") });
+
+    // deleting the tags of a.cpp evicts q1 only: removing symbols can not add matches to the empty q3
+    cache.Invalidate({ "/a.cpp" });
+    tags.clear();
+    CHECK_BOOL(!cache.Get("q1", tags));
+    CHECK_BOOL(cache.Get("q3", tags));
+    CHECK_SIZE(tags.size(), 0);
+    CHECK_BOOL(cache.Get("q2", tags));
+    CHECK_SIZE(tags.size(), 1);
+
+    // the symbols of b.cpp were never seen: a new symbol can match any lookup, the whole cache is cleared
+    cache.Invalidate({ "/b.cpp" }, { make_tag("baz", "/b.cpp") });
+    tags.clear();
+    CHECK_BOOL(!cache.Get("q2", tags));
+    CHECK_BOOL(!cache.Get("q3", tags));
+
+    // only the lines and patterns of b.cpp moved: only the entries holding tags from b.cpp are evicted
+    cache.Store("q2", { make_tag("baz", "/b.cpp") });
+    cache.Store("q3", std::vector<TagEntryPtr>{});
+    cache.Store("q4", { make_tag("qux", "/c.cpp") });
+    cache.Invalidate({ "/b.cpp" }, { make_tag("baz", "/b.cpp", 10) });
+    CHECK_BOOL(!cache.Get("q2", tags));
+    CHECK_BOOL(cache.Get("q3", tags));
+    CHECK_BOOL(cache.Get("q4", tags));
+    CHECK_SIZE(tags.size(), 1);
+
+    // b.cpp now defines another symbol: the whole cache is cleared
+    cache.Invalidate({ "/b.cpp" }, { make_tag("baz", "/b.cpp", 10), make_tag("quux", "/b.cpp", 20) });
+    tags.clear();
+    CHECK_BOOL(!cache.Get("q3", tags));
+    CHECK_BOOL(!cache.Get("q4", tags));
+    return true;
+}
+
+TEST_FUNC(test_file_content_hash)
+{
+    wxFileName tmpfile = FileUtils::CreateTempFileName(clStandardPaths::Get().GetTempDir(), "hash", "txt");
+    CHECK_BOOL(FileUtils::WriteFileContentRaw(tmpfile, "Nobody inspects the spammish repetition"));
+
+    uint64_t hash = 0;
+    size_t size = 0;
+    CHECK_BOOL(FileUtils::GetContentHash(tmpfile.GetFullPath(), &hash, &size));
+    FileUtils::RemoveFile(tmpfile);
+    CHECK_SIZE(size, 39);
+    // xxHash64 reference value
+    CHECK_BOOL(hash == 0xfbcea83c8a378bf1ULL);
+    return true;
+}
+
 TEST_FUNC(test_cxx_expression)
 {
     CxxRemainder remainder;
@@ -166,6 +166,7 @@ bool wxcApp::OnInit()
 int wxcApp::OnExit()
 {
     wxDELETE(m_wxcPlugin);
+    FileLogger::CloseLog();
     return TRUE;
 }
 